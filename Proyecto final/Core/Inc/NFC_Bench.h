@@ -0,0 +1,136 @@
+/*
+ * NFC_Bench.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  On target benchmark of the driver, compiled with NFC_BENCH_ENABLE=1. The
+ *  PN532 is replaced by a memory transport that answers at once, so only CPU
+ *  cost is measured with the DWT cycle counter:
+ *
+ *  - loop:  one NFC_Bus_Process pass while the reader waits its ACK
+ *  - frame: a whole NFC_GetFirmwareVersion, write, ACK and response frames
+ *  - cold:  the same command after caches and ART are emptied, the worst
+ *           case of a transaction; with NFC_TCM_ENABLE=1 it should be
+ *           close to the warm one
+ *
+ *  NFC_Bench_RunTransport moves blocks of NFC_BENCH_SIZES over SPI2 with
+ *  chip select released, through HAL, register level (NFC_SPI_LL) and DMA
+ *  transports, byte by byte and as a whole buffer. Beside its own measure it
+ *  keeps the accounting of the transport (NFC_SPI_GetStats, NFC_SPI_LL_GetStats
+ *  and NFC_SPI_DMA_GetStats) for the same transfers.
+ *
+ *  NFC_Bench_RunIRQ sends NFC_GetFirmwareVersion to the PN532 of SPI2 while
+ *  its ready is taken by NFC_SPI_WaitIRQ, asleep up to the IRQ edge, and by
+ *  a loop on NFC_SPI_GetIRQ. Accounting of NFC_SPI_WaitIRQ is kept with it,
+ *  NFC_SPI_STATS_ENABLE is 1 in builds with NFC_BENCH_ENABLE=1.
+ *
+ *  Maximum is the first (cold) run or an interrupt landing in the measure,
+ *  average shows the cost with warm caches. Results are read with debugger.
+ */
+
+#ifndef INC_NFC_BENCH_H_
+#define INC_NFC_BENCH_H_
+
+#include "main.h"
+#include "NFC.h"
+#include "NFC_SPI.h"
+
+/// Amount of measures of command with empty caches
+#ifndef NFC_BENCH_COLD_ITERATIONS
+#define NFC_BENCH_COLD_ITERATIONS	(16)
+#endif
+
+/// Amount of measures of each operation
+#ifndef NFC_BENCH_ITERATIONS
+#define NFC_BENCH_ITERATIONS	(1000)
+#endif
+
+/// Transfers measured for each transport and size
+#ifndef NFC_BENCH_TRANSFERS
+#define NFC_BENCH_TRANSFERS		(32)
+#endif
+
+/// Sizes of transfer: single byte, ACK, short response, long response, biggest extended frame
+#define NFC_BENCH_SIZES			{1, 6, 16, 64, 265}
+#define NFC_BENCH_SIZECOUNT		(5)
+#define NFC_BENCH_BLOCKSIZE		(265)
+
+/// Transports of NFC_Bench_RunTransport
+#define NFC_BENCH_HAL_BYTES		(0)		///< NFC_SPI_SendByte on each byte
+#define NFC_BENCH_HAL			(1)		///< NFC_SPI_SendBuffer
+#define NFC_BENCH_LL_BYTES		(2)		///< NFC_SPI_LL_SendByte on each byte
+#define NFC_BENCH_LL			(3)		///< NFC_SPI_LL_SendBuffer
+#define NFC_BENCH_DMA			(4)		///< NFC_SPI_DMA_SendBuffer
+#define NFC_BENCH_TRANSPORTS	(5)
+
+/// Ready detection of NFC_Bench_RunIRQ
+#define NFC_BENCH_WAITIRQ		(0)		///< NFC_SPI_WaitIRQ, core sleeps in WFI up to the IRQ edge
+#define NFC_BENCH_SPINIRQ		(1)		///< NFC_SPI_GetIRQ tested in a loop
+#define NFC_BENCH_IRQMODES		(2)
+
+/// Average core clock cycles of a transfer, index is [transport][size]
+typedef struct
+{
+	uint32_t elapsedCycles[NFC_BENCH_TRANSPORTS][NFC_BENCH_SIZECOUNT];	///< Wall time, SPI clock included
+	uint32_t activeCycles[NFC_BENCH_TRANSPORTS][NFC_BENCH_SIZECOUNT];	///< CPU time, without sleep in WFI
+	NFC_SPI_Stats stats[NFC_BENCH_TRANSPORTS][NFC_BENCH_SIZECOUNT];		///< Accounting of the transport, all transfers of a size
+}NFC_Bench_Transport;
+
+/// Average core clock cycles of a command, index is the ready detection
+typedef struct
+{
+	uint32_t elapsedCycles[NFC_BENCH_IRQMODES];		///< Wall time, PN532 processing included
+	uint32_t activeCycles[NFC_BENCH_IRQMODES];		///< CPU time, without sleep in WFI
+	uint32_t failures[NFC_BENCH_IRQMODES];			///< Commands not answered
+	NFC_SPI_IRQStats waits;							///< Waits of NFC_SPI_WaitIRQ, wakeup is IRQ edge to return
+}NFC_Bench_IRQ;
+
+/// Core cycles of one benchmark
+typedef struct
+{
+	uint32_t loopAverage;		///< Average of a bus pass with reader waiting
+	uint32_t loopMax;			///< Worst bus pass
+	uint32_t frameAverage;		///< Average of a command round trip
+	uint32_t frameMax;			///< Worst command round trip
+	uint32_t frameColdMax;		///< Worst command round trip with empty caches
+}NFC_Bench_Result;
+
+/**
+ * \brief Turn on or off I-cache, D-cache, ART accelerator and flash prefetch.
+ * D-cache is cleaned before it is disabled, so no data is lost.
+ *
+ * \param[in] enable 1 to enable all of them, 0 to disable.
+ */
+void NFC_Bench_SetCaches(const uint8_t enable);
+
+/**
+ * \brief Measure driver with current cache configuration.
+ * NFC_Timer_Init must be called before.
+ *
+ * \param[out] result Cycles of each operation.
+ *
+ * \return Return 1 if every command was answered or 0 the other way.
+ */
+uint8_t NFC_Bench_Run(NFC_Bench_Result *result);
+
+/**
+ * \brief Measure SPI2 transports, chip select of every PN532 must be released.
+ * NFC_SPI_Init, NFC_SPI_LL_Init and NFC_SPI_DMA_Init must be called before.
+ *
+ * \param[out] result Cycles of each transport and size.
+ */
+void NFC_Bench_RunTransport(NFC_Bench_Transport *result);
+
+/**
+ * \brief Measure ready detection of PN532 with IRQ line, device 0 of SPI2.
+ * PN532 must answer, NFC_SPI_Init must be called before.
+ *
+ * \param[in] commInterface Interface of the application, GetIRQ and WaitIRQ are replaced.
+ * \param[out] result Cycles of each ready detection.
+ *
+ * \return Return 1 if every command was answered or 0 the other way.
+ */
+uint8_t NFC_Bench_RunIRQ(const NFC_CommInterface *commInterface, NFC_Bench_IRQ *result);
+
+#endif /* INC_NFC_BENCH_H_ */
@@ -0,0 +1,186 @@
+/*
+ * NFC_HSU.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Transport of PN532 over its High Speed UART (HSU) with USART6, for
+ *  installations with long cables to the reader. It keeps the functions of
+ *  NFC_CommInterface, so the driver is the same as with SPI: the operation
+ *  byte sent after select (DATAWRITE, DATAREAD or STATREAD) chooses what the
+ *  next transfers do. Frames are written in one DMA transfer at deselect,
+ *  the first one after NFC_HSU_Init or NFC_HSU_Wakeup carries the wake-up
+ *  preamble of PN532.
+ *
+ *  PN532 sends frames on its own, a circular DMA stream stores every
+ *  received byte in a ring and the idle line interrupt wakes the core at
+ *  the end of each frame, so there is no interrupt by byte. PN532 is ready
+ *  when a start code is in the ring; reads skip what comes before it, like
+ *  the postamble of the previous frame.
+ *
+ *  PN532 boots at 115200 baud; NFC_Link_SetSerial raises the rate with
+ *  SetSerialBaudRate.
+ */
+
+#ifndef INC_NFC_HSU_H_
+#define INC_NFC_HSU_H_
+
+#include "main.h"
+#include <stddef.h>
+
+/// Time maximum of a transfer or to wait bytes of a frame in mS
+#define NFC_HSU_TIMEOUT				(100)
+
+/// Port and pin's number of transmission HSU
+#define HSU_TX_Pin GPIO_PIN_6
+#define HSU_TX_GPIO_Port GPIOC
+
+/// Port and pin's number of reception HSU
+#define HSU_RX_Pin GPIO_PIN_7
+#define HSU_RX_GPIO_Port GPIOC
+
+/// Rate of PN532 after reset and fastest one of its HSU port
+#define NFC_HSU_BAUD_BOOT			(115200)
+#define NFC_HSU_BAUD_MAX			(1288000)
+
+/// Ring of received bytes, holds an ACK and the biggest extended frame
+#define NFC_HSU_RINGSIZE			(512)
+
+/// Transmit buffer, wake-up preamble and biggest extended frame rounded up to D-cache lines
+#define NFC_HSU_BUFFERSIZE			(320)
+
+/// Zeros after the two PN532_WAKEUP bytes, PN532 needs them to leave power down
+#define NFC_HSU_WAKEUPZEROS			(14)
+
+/// USART6_RX is request channel 5 of DMA2 stream 1
+#define NFC_HSU_DMA_RX_STREAM		DMA2_Stream1
+#define NFC_HSU_DMA_RX_CHANNEL		DMA_CHANNEL_5
+
+/// USART6_TX is request channel 5 of DMA2 stream 6
+#define NFC_HSU_DMA_TX_STREAM		DMA2_Stream6
+#define NFC_HSU_DMA_TX_CHANNEL		DMA_CHANNEL_5
+
+/**
+ *  Accounting of HSU transport.
+ */
+typedef struct
+{
+	uint32_t framesSent;		///< Frames written to PN532
+	uint32_t wakeups;			///< Frames sent with wake-up preamble
+	uint32_t bytesReceived;		///< Bytes taken from the ring
+	uint32_t skipped;			///< Bytes dropped before a start code or when a frame was written
+	uint32_t overruns;			///< Bytes lost by overrun or framing errors of USART6
+	uint32_t errors;			///< Reads or transfers ended by timeout
+}NFC_HSU_Stats;
+
+extern DMA_HandleTypeDef hdma_usart6_rx;
+extern DMA_HandleTypeDef hdma_usart6_tx;
+
+/**
+ * \brief Initialize USART6 at NFC_HSU_BAUD_BOOT and its DMA streams.
+ *
+ * \return Return 1 if initialize was success or 0 the other way.
+ */
+uint8_t NFC_HSU_Init(void);
+
+/**
+ * \brief Change baud rate of USART6, bytes in the ring are dropped.
+ *
+ * \param[in] baud Baud rate, up to NFC_HSU_BAUD_MAX.
+ *
+ * \return Return 1 if rate can be generated or 0 the other way.
+ */
+uint8_t NFC_HSU_SetBaudRate(const uint32_t baud);
+
+/**
+ * \brief Get baud rate of USART6.
+ *
+ * \return Baud rate.
+ */
+uint32_t NFC_HSU_GetBaudRate(void);
+
+/**
+ * \brief Send the wake-up preamble before the next frame, e.g. after PowerDown.
+ */
+void NFC_HSU_Wakeup(void);
+
+/**
+ * \brief Receive single byte of the current transaction.
+ *
+ * \return Received byte.
+ */
+uint8_t NFC_HSU_GetByte(void);
+
+/**
+ * \brief Send single byte of the current transaction.
+ *
+ * \param[in] byte Byte to be sent, the first one after select is the operation.
+ */
+void NFC_HSU_SendByte(uint8_t byte);
+
+/**
+ * \brief Receive a whole buffer of the current transaction.
+ * Waits for bytes not received yet, zeros are returned on timeout.
+ *
+ * \param[out] buffer Buffer to store received bytes
+ * \param[in] length Amount of bytes to receive
+ */
+void NFC_HSU_ReceiveBuffer(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Send a whole buffer of the current transaction.
+ *
+ * \param[in] buffer Bytes to be sent, the first one after select is the operation.
+ * \param[in] length Amount of bytes to send
+ */
+void NFC_HSU_SendBuffer(const uint8_t *buffer, size_t length);
+
+/**
+ * \brief Open or close a transaction, frames written are sent on close.
+ *
+ * \param[in] state 1 to open the transaction, 0 to close it.
+ */
+void NFC_HSU_SetSelect(uint8_t state);
+
+/**
+ * \brief Test if PN532 has sent the start of a frame.
+ *
+ * \return Return 1 if PN532 is ready, 0 if not.
+ */
+uint8_t NFC_HSU_GetIRQ(void);
+
+/**
+ * \brief Sleep until PN532 sends a frame or timeout expires.
+ *
+ * \param[in] timeout Time maximum to wait in mS.
+ *
+ * \return Return 1 if PN532 is ready, 0 on timeout.
+ */
+uint8_t NFC_HSU_WaitIRQ(uint32_t timeout);
+
+/**
+ * \brief Sleep the core until a frame ends or next SysTick.
+ * Used by the bus scheduler when no reader can progress.
+ */
+void NFC_HSU_Idle(void);
+
+/**
+ * \brief Serve USART6 interrupt, called from USART6_IRQHandler.
+ */
+void NFC_HSU_IRQHandler(void);
+
+/**
+ * \brief Interrupt handler of USART6. It belongs to the driver, PN532_NFC.ioc
+ * does not configure USART6 so code generation does not create it in
+ * stm32f7xx_it.c.
+ */
+void USART6_IRQHandler(void);
+
+/**
+ * \brief Copy accounting of HSU transport.
+ *
+ * \param[out] stats Structure to store accounting.
+ */
+void NFC_HSU_GetStats(NFC_HSU_Stats *stats);
+
+#endif /* INC_NFC_HSU_H_ */
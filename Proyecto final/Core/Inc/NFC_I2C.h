@@ -0,0 +1,145 @@
+/*
+ * NFC_I2C.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Transport of PN532 over I2C1 for boards that only route I2C. It keeps the
+ *  functions of NFC_CommInterface, so the driver is the same as with SPI: the
+ *  operation byte sent after select (DATAWRITE, DATAREAD or STATREAD) chooses
+ *  what the next transfers do, and the whole select-deselect window is one I2C
+ *  transaction. Frames are written in one transfer at deselect; reads start
+ *  with the status byte of PN532 and go on without STOP while the driver
+ *  reads header and data, the last byte is read at deselect to end with NACK.
+ *  Transfers of NFC_I2C_DMA_MINLENGTH bytes or more use DMA, the shorter ones
+ *  use interrupts; the core sleeps in both cases.
+ *
+ *  Ready of PN532 is found by polling the status byte, or with the IRQ line
+ *  when it is wired: it is the IRQ pin of SPI device 0 and it is served by
+ *  NFC_SPI_WaitIRQ and the EXTI handler of NFC_SPI.
+ */
+
+#ifndef INC_NFC_I2C_H_
+#define INC_NFC_I2C_H_
+
+#include "NFC_SPI.h"
+
+/// Time maximum of an I2C transfer in mS
+#define NFC_I2C_TIMEOUT				(100)
+
+/// Port and pin's number of clock I2C
+#define I2C_SCL_Pin GPIO_PIN_8
+#define I2C_SCL_GPIO_Port GPIOB
+
+/// Port and pin's number of data I2C
+#define I2C_SDA_Pin GPIO_PIN_9
+#define I2C_SDA_GPIO_Port GPIOB
+
+/// PN532 answers up to Fast-mode, 400 kHz from I2C1 kernel clock of 54 MHz (PCLK1):
+/// PRESC 1, SCLDEL 10, SDADEL 2, SCLH 26 and SCLL 39, for rise times up to 300 nS
+#define NFC_I2C_TIMING				(0x10A21A27)
+
+/// Size of DMA buffers, biggest PN532 extended frame with status byte rounded up to D-cache lines
+#define NFC_I2C_BUFFERSIZE			(288)
+
+/// Shorter transfers are moved with interrupts, DMA set up costs more than it saves
+#define NFC_I2C_DMA_MINLENGTH		(8)
+
+/// I2C1_RX is request channel 1 of DMA1 stream 0
+#define NFC_I2C_DMA_RX_STREAM		DMA1_Stream0
+#define NFC_I2C_DMA_RX_CHANNEL		DMA_CHANNEL_1
+#define NFC_I2C_DMA_RX_IRQn			DMA1_Stream0_IRQn
+
+/// I2C1_TX is request channel 1 of DMA1 stream 6
+#define NFC_I2C_DMA_TX_STREAM		DMA1_Stream6
+#define NFC_I2C_DMA_TX_CHANNEL		DMA_CHANNEL_1
+#define NFC_I2C_DMA_TX_IRQn			DMA1_Stream6_IRQn
+
+/**
+ *  Accounting of I2C transport.
+ */
+typedef struct
+{
+	NFC_SPI_Stats transfers;	///< Time of transfers, only updated when NFC_SPI_STATS_ENABLE is 1
+	uint32_t statusReads;		///< Status bytes read to poll ready of PN532
+	uint32_t notReady;			///< Frame reads started while PN532 was busy
+	uint32_t errors;			///< Transfers ended by NACK, bus error or timeout
+}NFC_I2C_Stats;
+
+extern I2C_HandleTypeDef hi2c;
+extern DMA_HandleTypeDef hdma_i2c1_rx;
+extern DMA_HandleTypeDef hdma_i2c1_tx;
+
+/**
+ * \brief Initialize I2C1, its DMA streams and optionally the IRQ pin of PN532.
+ *
+ * \param[in] useIRQ 1 when IRQ line of PN532 is wired, 0 to poll the status byte.
+ *
+ * \return Return 1 if initialize was success or 0 the other way.
+ */
+uint8_t NFC_I2C_Init(const uint8_t useIRQ);
+
+/**
+ * \brief Receive single byte of the current transaction.
+ *
+ * \return Received byte.
+ */
+uint8_t NFC_I2C_GetByte(void);
+
+/**
+ * \brief Send single byte of the current transaction.
+ *
+ * \param[in] byte Byte to be sent, the first one after select is the operation.
+ */
+void NFC_I2C_SendByte(uint8_t byte);
+
+/**
+ * \brief Receive a whole buffer of the current transaction.
+ *
+ * \param[out] buffer Buffer to store received bytes
+ * \param[in] length Amount of bytes to receive
+ */
+void NFC_I2C_ReceiveBuffer(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Send a whole buffer of the current transaction.
+ *
+ * \param[in] buffer Bytes to be sent, the first one after select is the operation.
+ * \param[in] length Amount of bytes to send
+ */
+void NFC_I2C_SendBuffer(const uint8_t *buffer, size_t length);
+
+/**
+ * \brief Open or close a transaction.
+ * Frames written are sent and open reads are ended on close.
+ *
+ * \param[in] state 1 to open the transaction, 0 to close it.
+ */
+void NFC_I2C_SetSelect(uint8_t state);
+
+/**
+ * \brief Test if PN532 has a frame ready.
+ * Reads IRQ pin when it is used, a status byte over I2C the other way.
+ *
+ * \return Return 1 if PN532 is ready, 0 if not.
+ */
+uint8_t NFC_I2C_GetIRQ(void);
+
+/**
+ * \brief Copy accounting of I2C transport.
+ *
+ * \param[out] stats Structure to store accounting.
+ */
+void NFC_I2C_GetStats(NFC_I2C_Stats *stats);
+
+/**
+ * \brief Interrupt handlers of the DMA streams and of I2C1. They belong to the
+ * driver, PN532_NFC.ioc does not configure I2C1 so code generation does not
+ * create them in stm32f7xx_it.c.
+ */
+void DMA1_Stream0_IRQHandler(void);
+void DMA1_Stream6_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
+
+#endif /* INC_NFC_I2C_H_ */
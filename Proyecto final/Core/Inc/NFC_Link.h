@@ -0,0 +1,100 @@
+/*
+ * NFC_Link.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Clock plan of the SPI link with PN532. APB1 runs at 54 MHz (HCLK / 4, its
+ *  maximum) so SPI2 prescalers give 843.75 kHz, 1.6875 MHz and 3.375 MHz
+ *  below the 5 MHz of PN532; 6.75 MHz is out of specification. The link
+ *  boots at NFC_SPI_PRESCALER_BOOT, NFC_Link_Calibrate steps the clock up
+ *  while Diagnose echo and GetFirmwareVersion keep answering right, and
+ *  NFC_Link_Update steps it down at runtime when frames arrive corrupted.
+ *
+ *  Over HSU the rate is agreed with PN532: NFC_Link_SetSerial raises it from
+ *  115200 baud with SetSerialBaudRate, with the same echo tests at each rate.
+ */
+
+#ifndef INC_NFC_LINK_H_
+#define INC_NFC_LINK_H_
+
+#include "NFC_SPI.h"
+#include "NFC_HSU.h"
+#include "NFC.h"
+
+/// Echo tests at each step of calibration, each one with a different pattern
+#ifndef NFC_LINK_ROUNDS
+#define NFC_LINK_ROUNDS			(8)
+#endif
+
+/// Bytes echoed by each test
+#define NFC_LINK_ECHOSIZE		(32)
+
+/// Consecutive commands with corrupted frames before the clock steps down
+#ifndef NFC_LINK_MAXERRORS
+#define NFC_LINK_MAXERRORS		(3)
+#endif
+
+/// Time to wait each answer of calibration in mS
+#define NFC_LINK_TIMEOUT		(10)
+
+/**
+ *  State of the SPI clock of the link.
+ */
+typedef struct
+{
+	uint8_t step;				///< Index of clock in use, 0 is the slowest
+	uint8_t maxStep;			///< Fastest step that passed calibration
+	uint8_t calibrated;			///< Set once a calibration passed, later ones do not go over maxStep
+	uint8_t errors;				///< Consecutive commands with link errors
+	uint32_t fallbacks;			///< Times clock was stepped down at runtime
+	uint32_t linkErrors[NFC_SPI_MAXDEVICES];	///< ACK failures and frame errors of each PN532 in last update
+}NFC_Link;
+
+/**
+ * \brief Find the fastest SPI clock where PN532 answers right and use it.
+ * Starts from boot clock and stops at first step that fails, which goes
+ * back to the previous one. With several PN532, call it once for each
+ * with the same link, the fastest step never goes over a failed one.
+ *
+ * \param[in,out] link Clock state, zeroed before first call.
+ * \param[in] context Context of an initialized PN532 without command in progress.
+ *
+ * \return Return 1 if the link works at least at boot clock or 0 the other way.
+ */
+uint8_t NFC_Link_Calibrate(NFC_Link *link, NFC_Context *context);
+
+/**
+ * \brief Check for link errors after a command ended, fall back to a slower
+ * clock after NFC_LINK_MAXERRORS consecutive commands with errors. Timeouts
+ * are not link errors, PN532 waits cards with IRQ inactive. Needs
+ * NFC_STATS_ENABLE, otherwise it does nothing.
+ *
+ * \param[in,out] link Clock state.
+ * \param[in] context Context of PN532 whose command ended.
+ */
+void NFC_Link_Update(NFC_Link *link, NFC_Context *context);
+
+/**
+ * \brief Raise baud rate of HSU link with PN532 as far as it answers right.
+ * Each rate is set on both sides and tested, the first one that fails is
+ * left with SetSerialBaudRate sent at that rate, back to the previous one.
+ *
+ * \param[in] context Context of PN532 at 115200 baud without command in progress.
+ * \param[in] maxBaud Fastest rate to try, up to NFC_HSU_BAUD_MAX.
+ *
+ * \return Return 1 if the link works at the rate in use, 0 if PN532 was left
+ * at a rate it can not be talked to.
+ */
+uint8_t NFC_Link_SetSerial(NFC_Context *context, const uint32_t maxBaud);
+
+/**
+ * \brief Get SPI clock in use.
+ *
+ * \param[in] link Clock state.
+ *
+ * \return Clock in Hz.
+ */
+uint32_t NFC_Link_GetClockHz(const NFC_Link *link);
+
+#endif /* INC_NFC_LINK_H_ */
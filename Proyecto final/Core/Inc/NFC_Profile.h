@@ -0,0 +1,56 @@
+/*
+ * NFC_Profile.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Profiling build of the firmware, compiled with NFC_PROFILE_ENABLE=1. The
+ *  driver timestamps each phase of a command with the DWT cycle counter and
+ *  every mark is streamed as one 32 bit word on ITM stimulus port
+ *  NFC_PROFILE_PORT through the SWO pin (PB3):
+ *
+ *  bits 31..29 Phase, one of NFC_PHASE_x
+ *  bits 28..27 Number of PN532
+ *  bits 26..0  Command code for NFC_PHASE_START, for the other phases core
+ *              cycles since previous mark of the same PN532, saturated at
+ *              NFC_PROFILE_MAXCYCLES (~621 mS at 216 MHz)
+ *
+ *  A full ITM FIFO drops the record instead of stalling the driver. The
+ *  capture is turned into per phase percentiles by Host/Src/Swo_Decode.c.
+ */
+
+#ifndef INC_NFC_PROFILE_H_
+#define INC_NFC_PROFILE_H_
+
+#include "main.h"
+
+/// ITM stimulus port used by the records
+#define NFC_PROFILE_PORT		(1)
+
+/// Baud rate of SWO pin in bit/s, asynchronous NRZ
+#ifndef NFC_PROFILE_SWO_HZ
+#define NFC_PROFILE_SWO_HZ		(2000000)
+#endif
+
+#define NFC_PROFILE_PHASE_POS	(29)
+#define NFC_PROFILE_DEVICE_POS	(27)
+#define NFC_PROFILE_DEVICE_MASK	(0x03)
+#define NFC_PROFILE_MAXCYCLES	(0x07FFFFFFUL)
+
+/**
+ * \brief Enable DWT cycle counter, ITM stimulus port and SWO output on PB3.
+ * The core clock is kept running in sleep mode, so phases waiting in WFI
+ * are measured in wall time.
+ *
+ * \return Return 1 if cycle counter is running or 0 the other way.
+ */
+uint8_t NFC_Profile_Init(void);
+
+/**
+ * \brief Amount of records dropped because ITM FIFO was full or ITM disabled.
+ *
+ * \return Dropped records since NFC_Profile_Init.
+ */
+uint32_t NFC_Profile_GetDropped(void);
+
+#endif /* INC_NFC_PROFILE_H_ */
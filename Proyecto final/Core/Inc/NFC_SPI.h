@@ -9,6 +9,7 @@
 #define INC_NFC_SPI_H_
 
 #include "main.h"
+#include <stddef.h>
 
 /// Time maximum to transmit data for SPI
 #define SPI_NFC_TIMEOUT_TRANSMISSION	1000
@@ -35,6 +36,65 @@
 /// Port and pin's number of IRQ to PN532 NFC
 #define NFC_IRQ_Pin GPIO_PIN_6
 #define NFC_IRQ_GPIO_Port GPIOH
+#define NFC_IRQ_EXTI_IRQn EXTI9_5_IRQn
+
+/// Fastest SPI clock of PN532 in Hz
+#define NFC_SPI_MAXHZ		(5000000)
+
+/// Prescaler of SPI clock at boot, 843.75 kHz from APB1 at 54 MHz, raised by NFC_Link_Calibrate
+#define NFC_SPI_PRESCALER_BOOT	SPI_BAUDRATEPRESCALER_64
+
+/// Maximum amount of PN532 sharing SPI bus, device 0 uses SPI_CS and NFC_IRQ pins
+#ifndef NFC_SPI_MAXDEVICES
+#define NFC_SPI_MAXDEVICES	4
+#endif
+
+/// Set to 1 to account CPU and wall time spent in SPI transfers, NFC_Bench reports them
+#ifndef NFC_SPI_STATS_ENABLE
+#if defined(NFC_BENCH_ENABLE) && NFC_BENCH_ENABLE
+#define NFC_SPI_STATS_ENABLE	1
+#else
+#define NFC_SPI_STATS_ENABLE	0
+#endif
+#endif
+
+/**
+ *  Time accounting of a SPI transport. Difference between elapsed
+ *  and active cycles is CPU time released to the rest of the firmware.
+ */
+typedef struct
+{
+	uint32_t transfers;			///< Amount of transfer calls
+	uint32_t bytes;				///< Amount of bytes moved
+	uint64_t activeCycles;		///< Core cycles executed inside transfer functions
+	uint64_t elapsedCycles;		///< Wall time of transfer functions in core cycles
+	uint32_t errors;			///< Transfers ended by timeout or error
+}NFC_SPI_Stats;
+
+/**
+ *  Accounting of waits for IRQ of PN532.
+ */
+typedef struct
+{
+	uint32_t waits;				///< Amount of wait calls
+	uint32_t timeouts;			///< Waits ended without IRQ
+	uint64_t activeCycles;		///< Core cycles executed while waiting
+	uint64_t elapsedCycles;		///< Wall time of waits in core cycles
+	uint64_t wakeupCycles;		///< Sum of time from IRQ interrupt entry to return of wait
+	uint32_t wakeupMaxCycles;	///< Worst time from IRQ interrupt entry to return of wait
+	uint32_t wakeups;			///< Waits ended by IRQ edge
+}NFC_SPI_IRQStats;
+
+/**
+ *  Time stamps taken at start of a transfer.
+ */
+typedef struct
+{
+	uint32_t cycles;			///< DWT cycle counter, stop while core sleeps
+	uint64_t wallCycles;		///< SysTick based time, never stops
+}NFC_SPI_StatsMark;
+
+extern SPI_HandleTypeDef hspi;
 
 
 /**
@@ -44,6 +104,32 @@
  */
 uint8_t NFC_SPI_Init(void);
 
+/**
+ * \brief Change SPI clock, it is applied from next transfer.
+ * Must not be called while a transfer is in progress.
+ *
+ * \param[in] prescaler Divider of APB1 clock, one of SPI_BAUDRATEPRESCALER_x.
+ *
+ * \return Return 1 if clock was changed or 0 if it is faster than NFC_SPI_MAXHZ.
+ */
+uint8_t NFC_SPI_SetPrescaler(const uint32_t prescaler);
+
+/**
+ * \brief Get divider of APB1 clock in use.
+ *
+ * \return One of SPI_BAUDRATEPRESCALER_x.
+ */
+uint32_t NFC_SPI_GetPrescaler(void);
+
+/**
+ * \brief Get SPI clock given by a prescaler.
+ *
+ * \param[in] prescaler One of SPI_BAUDRATEPRESCALER_x.
+ *
+ * \return Clock of SCK pin in Hz.
+ */
+uint32_t NFC_SPI_GetClockHz(const uint32_t prescaler);
+
 /**
  * \brief Receive single byte
  *
@@ -58,6 +144,22 @@ uint8_t NFC_SPI_GetByte(void);
  */
 void NFC_SPI_SendByte(const uint8_t byte);
 
+/**
+ * \brief Receive a whole buffer in a single SPI transfer
+ *
+ * \param[out] buffer Buffer to store received bytes
+ * \param[in] length Amount of bytes to receive
+ */
+void NFC_SPI_ReceiveBuffer(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Send a whole buffer in a single SPI transfer
+ *
+ * \param[in] buffer Bytes to be sent over SPI
+ * \param[in] length Amount of bytes to send
+ */
+void NFC_SPI_SendBuffer(const uint8_t *buffer, size_t length);
+
 /**
  * \brief Set SPI Chip enable signal.
  * Setting the CS line will select the PN532, true is selected and false is not selected.
@@ -74,4 +176,109 @@ void NFC_SPI_SetSelect(const uint8_t state);
  */
 uint8_t NFC_SPI_GetIRQ(void);
 
+/**
+ *  \brief Wait for IRQ signal of PN532 sleeping the core.
+ *  The IRQ pin raises an EXTI interrupt on falling edge, the core stays in WFI
+ *  until the edge or the end of timeout.
+ *
+ *  \param[in] timeout Time maximum to wait in mS.
+ *
+ *  \return Return 1 if IRQ signal is active, 0 if timeout was reached.
+ */
+uint8_t NFC_SPI_WaitIRQ(const uint32_t timeout);
+
+/**
+ *  \brief Add a PN532 to SPI bus with its own chip select and IRQ pins.
+ *  Pins are configured here, IRQ pin must be in EXTI lines 5 to 15 and its
+ *  number can not be used by other device, EXTI line is shared by all ports.
+ *
+ *  \param[in] csPort Port of chip select pin.
+ *  \param[in] csPin Chip select pin.
+ *  \param[in] irqPort Port of IRQ pin.
+ *  \param[in] irqPin IRQ pin.
+ *  \param[out] number Number of device to give to NFC_SPI_SetDevice.
+ *
+ *  \return Return 1 if device was added, 0 the other way.
+ */
+uint8_t NFC_SPI_AddDevice(GPIO_TypeDef *csPort, const uint16_t csPin, GPIO_TypeDef *irqPort, const uint16_t irqPin, uint8_t *number);
+
+/**
+ *  \brief Route next chip select, IRQ test and IRQ wait to a device.
+ *
+ *  \param[in] number Number of device, 0 is the PN532 configured by NFC_SPI_Init.
+ */
+void NFC_SPI_SetDevice(const uint8_t number);
+
+/**
+ *  \brief Get chip select pin of device selected by NFC_SPI_SetDevice.
+ *  Used by transports that drive the pin without HAL.
+ *
+ *  \param[out] port Port of chip select pin.
+ *  \param[out] pin Chip select pin.
+ */
+void NFC_SPI_GetSelectPin(GPIO_TypeDef **port, uint16_t *pin);
+
+/**
+ *  \brief Sleep the core until IRQ edge of any device or next SysTick.
+ *  Used by the bus scheduler when no reader can progress.
+ */
+void NFC_SPI_Idle(void);
+
+/**
+ *  \brief Sleep the core with SysTick stopped until IRQ edge of any device.
+ *  Used by the bus scheduler when readers wait responses without timeout.
+ */
+void NFC_SPI_Sleep(void);
+
+/**
+ *  \brief Serve EXTI interrupt of IRQ pins of every device.
+ *  Called from EXTI9_5_IRQHandler and EXTI15_10_IRQHandler.
+ */
+void NFC_SPI_IRQHandler(void);
+
+/**
+ * \brief Interrupt handlers of the EXTI lines of IRQ pins. They belong to the
+ * driver, PN532_NFC.ioc does not enable these interrupts so code generation
+ * does not create them in stm32f7xx_it.c.
+ */
+void EXTI9_5_IRQHandler(void);
+void EXTI15_10_IRQHandler(void);
+
+/**
+ *  \brief Copy accounting of waits for IRQ signal.
+ *  Only updated when NFC_SPI_STATS_ENABLE is 1.
+ *
+ *  \param[out] stats Structure to store accounting.
+ */
+void NFC_SPI_GetIRQStats(NFC_SPI_IRQStats *stats);
+
+/**
+ *  \brief Copy accounting of blocking transfers.
+ *  Only updated when NFC_SPI_STATS_ENABLE is 1.
+ *
+ *  \param[out] stats Structure to store accounting.
+ */
+void NFC_SPI_GetStats(NFC_SPI_Stats *stats);
+
+/**
+ *  \brief Clear accounting of blocking transfers and of waits for IRQ signal.
+ */
+void NFC_SPI_ResetStats(void);
+
+/**
+ *  \brief Take time stamps at start of a transfer.
+ *
+ *  \param[out] mark Structure to store time stamps.
+ */
+void NFC_SPI_StatsStart(NFC_SPI_StatsMark *mark);
+
+/**
+ *  \brief Add time elapsed since mark to stats.
+ *
+ *  \param[in,out] stats Accounting to update.
+ *  \param[in] mark Time stamps taken by NFC_SPI_StatsStart.
+ *  \param[in] bytes Amount of bytes moved by the transfer.
+ */
+void NFC_SPI_StatsStop(NFC_SPI_Stats *stats, const NFC_SPI_StatsMark *mark, const size_t bytes);
+
 #endif /* INC_NFC_SPI_H_ */
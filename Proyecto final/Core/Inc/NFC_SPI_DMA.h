@@ -0,0 +1,98 @@
+/*
+ * NFC_SPI_DMA.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#ifndef INC_NFC_SPI_DMA_H_
+#define INC_NFC_SPI_DMA_H_
+
+#include "NFC_SPI.h"
+#include "NFC_Transport.h"
+
+/// Size of DMA buffers, biggest PN532 extended frame rounded up to D-cache lines
+#define NFC_SPI_DMA_BUFFERSIZE		(288)
+
+/// Size and alignment of the MPU region holding both DMA buffers
+#define NFC_SPI_DMA_REGIONSIZE		(1024)
+
+#if (2 * NFC_SPI_DMA_BUFFERSIZE) > NFC_SPI_DMA_REGIONSIZE
+#error "Both DMA buffers must fit in NFC_SPI_DMA_REGIONSIZE"
+#endif
+
+/// SPI2_RX is request channel 0 of DMA1 stream 3
+#define NFC_SPI_DMA_RX_STREAM		DMA1_Stream3
+#define NFC_SPI_DMA_RX_CHANNEL		DMA_CHANNEL_0
+#define NFC_SPI_DMA_RX_IRQn			DMA1_Stream3_IRQn
+
+/// SPI2_TX is request channel 0 of DMA1 stream 4
+#define NFC_SPI_DMA_TX_STREAM		DMA1_Stream4
+#define NFC_SPI_DMA_TX_CHANNEL		DMA_CHANNEL_0
+#define NFC_SPI_DMA_TX_IRQn			DMA1_Stream4_IRQn
+
+extern DMA_HandleTypeDef hdma_spi2_rx;
+extern DMA_HandleTypeDef hdma_spi2_tx;
+
+/**
+ * \brief Initialize DMA streams of SPI2 and link them to SPI handle.
+ * NFC_SPI_Init must be called before.
+ *
+ * \return Return 1 if initialize was success or 0 the other way.
+ */
+uint8_t NFC_SPI_DMA_Init(void);
+
+/**
+ * \brief Map DMA buffers as shareable non-cacheable memory with an MPU region.
+ * Cache maintenance of transfers is skipped from then on. Must be called
+ * with MPU disabled and before D-cache is enabled.
+ *
+ * \param[in] number MPU region used for buffers (MPU_REGION_NUMBER0...).
+ */
+void NFC_SPI_DMA_ConfigMPU(const uint8_t number);
+
+/**
+ * \brief Receive a whole buffer through DMA.
+ * The CPU sleeps until the completion interrupt of the transfer.
+ *
+ * \param[out] buffer Buffer to store received bytes
+ * \param[in] length Amount of bytes to receive
+ */
+void NFC_SPI_DMA_ReceiveBuffer(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Send a whole buffer through DMA.
+ * The CPU sleeps until the completion interrupt of the transfer.
+ *
+ * \param[in] buffer Bytes to be sent over SPI
+ * \param[in] length Amount of bytes to send
+ */
+void NFC_SPI_DMA_SendBuffer(const uint8_t *buffer, size_t length);
+
+/**
+ * \brief Copy accounting of DMA transfers.
+ * Only updated when NFC_SPI_STATS_ENABLE is 1.
+ *
+ * \param[out] stats Structure to store accounting.
+ */
+void NFC_SPI_DMA_GetStats(NFC_SPI_Stats *stats);
+
+/**
+ * \brief Interrupt handlers of the DMA streams and of SPI2. They belong to the
+ * driver, PN532_NFC.ioc does not configure these interrupts so code generation
+ * does not create them in stm32f7xx_it.c.
+ */
+void DMA1_Stream3_IRQHandler(void);
+void DMA1_Stream4_IRQHandler(void);
+void SPI2_IRQHandler(void);
+
+/**
+ * \brief Transfer completion callback, called from DMA interrupt context.
+ * Weak function, upper layer can override it to be notified when a
+ * frame was moved.
+ *
+ * \param[in] error 0 when transfer was successful, 1 on SPI or DMA error.
+ */
+void NFC_SPI_DMA_TransferCpltCallback(uint8_t error);
+
+#endif /* INC_NFC_SPI_DMA_H_ */
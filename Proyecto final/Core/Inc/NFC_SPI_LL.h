@@ -0,0 +1,84 @@
+/*
+ * NFC_SPI_LL.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Transport of SPI2 written against registers, without the locking, state
+ *  and timeout bookkeeping HAL_SPI pays on every call. Bytes go through the
+ *  32 bit FIFO of SPI with 8 bit accesses to DR and FRXTH set, so RXNE rises
+ *  on each byte; up to NFC_SPI_LL_INFLIGHT bytes are on the way, which keeps
+ *  SCK running between bytes. Chip select is driven through BSRR. Uses the
+ *  configuration left by NFC_SPI_Init and can be mixed with HAL and DMA
+ *  transports on the same bus.
+ */
+
+#ifndef INC_NFC_SPI_LL_H_
+#define INC_NFC_SPI_LL_H_
+
+#include "NFC_SPI.h"
+
+/// Bytes written ahead of received ones, RX FIFO holds 4 bytes so it never overruns
+#define NFC_SPI_LL_INFLIGHT		(4)
+
+/**
+ * \brief Prepare SPI2 for 8 bit FIFO accesses and enable it.
+ * NFC_SPI_Init must be called before.
+ *
+ * \return Return 1 if initialize was success or 0 the other way.
+ */
+uint8_t NFC_SPI_LL_Init(void);
+
+/**
+ * \brief Receive single byte, a zero is sent meanwhile.
+ *
+ * \return Received byte.
+ */
+uint8_t NFC_SPI_LL_GetByte(void);
+
+/**
+ * \brief Send single byte.
+ *
+ * \param[in] byte Byte to be sent over SPI
+ */
+void NFC_SPI_LL_SendByte(uint8_t byte);
+
+/**
+ * \brief Receive a whole buffer, zeros are sent meanwhile.
+ *
+ * \param[out] buffer Buffer to store received bytes
+ * \param[in] length Amount of bytes to receive
+ */
+void NFC_SPI_LL_ReceiveBuffer(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Send a whole buffer.
+ *
+ * \param[in] buffer Bytes to be sent over SPI
+ * \param[in] length Amount of bytes to send
+ */
+void NFC_SPI_LL_SendBuffer(const uint8_t *buffer, size_t length);
+
+/**
+ * \brief Set chip select of current device through BSRR.
+ *
+ * \param[in] state 1 to select PN532, 0 to release it.
+ */
+void NFC_SPI_LL_SetSelect(uint8_t state);
+
+/**
+ * \brief Route next transfers to a device, as NFC_SPI_SetDevice.
+ *
+ * \param[in] number Number of device.
+ */
+void NFC_SPI_LL_SetDevice(uint8_t number);
+
+/**
+ * \brief Copy accounting of register level transfers.
+ * Only updated when NFC_SPI_STATS_ENABLE is 1.
+ *
+ * \param[out] stats Structure to store accounting.
+ */
+void NFC_SPI_LL_GetStats(NFC_SPI_Stats *stats);
+
+#endif /* INC_NFC_SPI_LL_H_ */
@@ -0,0 +1,61 @@
+/*
+ * NFC_TCM.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Build with NFC_TCM_ENABLE=1 to run the hot path of the PN532 driver from
+ *  ITCM (16 KB at 0x00000000) and keep its state in DTCM (128 KB at
+ *  0x20000000), both zero wait state and outside the caches. Functions marked
+ *  NFC_ITCM go to section .itcm_text, variables marked NFC_DTCM to .dtcm_bss.
+ *  The linker script generated by STM32CubeIDE needs the memories and the
+ *  sections; RAM starts after DTCM:
+ *
+ *  MEMORY
+ *  {
+ *    ITCMRAM (xrw) : ORIGIN = 0x00000000, LENGTH = 16K
+ *    DTCMRAM (xrw) : ORIGIN = 0x20000000, LENGTH = 128K
+ *    RAM     (xrw) : ORIGIN = 0x20020000, LENGTH = 384K
+ *    FLASH   (rx)  : ORIGIN = 0x08000000, LENGTH = 2048K
+ *  }
+ *
+ *  .itcm_text :
+ *  {
+ *    . = ALIGN(4);
+ *    _sitcm = .;
+ *    *(.itcm_text)
+ *    *(.text.HAL_DMA_IRQHandler) *(.text.HAL_GPIO_EXTI_IRQHandler)
+ *    . = ALIGN(4);
+ *    _eitcm = .;
+ *  } >ITCMRAM AT> FLASH
+ *  _siitcm = LOADADDR(.itcm_text);
+ *
+ *  .dtcm_bss (NOLOAD) :
+ *  {
+ *    . = ALIGN(4);
+ *    _sdtcm = .;
+ *    *(.dtcm_bss)
+ *    . = ALIGN(4);
+ *    _edtcm = .;
+ *  } >DTCMRAM
+ *
+ *  Interrupt handlers of the transports are NFC_ITCM in their drivers, HAL
+ *  handlers are placed by name (-ffunction-sections) so HAL files are not
+ *  modified. The linker adds veneers for calls between flash and ITCM, out of
+ *  range of a BL instruction.
+ */
+
+#ifndef INC_NFC_TCM_H_
+#define INC_NFC_TCM_H_
+
+#include "main.h"
+#include "NFC.h"
+
+/**
+ * \brief Copy code of ITCM from flash and clear variables of DTCM.
+ * Must be called first in main, before any NFC_ITCM function runs. Does
+ * nothing when NFC_TCM_ENABLE is 0.
+ */
+void NFC_TCM_Init(void);
+
+#endif /* INC_NFC_TCM_H_ */
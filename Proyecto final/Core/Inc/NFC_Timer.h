@@ -0,0 +1,80 @@
+/*
+ * NFC_Timer.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#ifndef INC_NFC_TIMER_H_
+#define INC_NFC_TIMER_H_
+
+#include "main.h"
+
+/// Shorter sleeps of NFC_Timer_SleepUs are waited with the cycle counter, waking up from WFI costs more
+#ifndef NFC_TIMER_SLEEP_MINUS
+#define NFC_TIMER_SLEEP_MINUS	(10)
+#endif
+
+/**
+ * \brief Enable the DWT cycle counter of the Cortex-M7 and TIM7 to wake up
+ * the core from NFC_Timer_SleepUs.
+ *
+ * \return Return 1 if cycle counter is running or 0 the other way.
+ */
+uint8_t NFC_Timer_Init(void);
+
+/**
+ * \brief Read the DWT cycle counter.
+ * The counter stops while the core sleeps in WFI, so a difference of two
+ * readings is the time the CPU was really executing.
+ *
+ * \return Core clock cycles since NFC_Timer_Init, wraps every ~19.9 s at 216 MHz.
+ */
+uint32_t NFC_Timer_GetCycles(void);
+
+/**
+ * \brief Read wall time in core clock cycles from HAL tick and SysTick counter.
+ * Unlike NFC_Timer_GetCycles it keeps counting while the core sleeps.
+ *
+ * \return Core clock cycles since HAL_Init.
+ */
+uint64_t NFC_Timer_GetWallCycles(void);
+
+/**
+ * \brief Read wall time in microseconds, for statistics of NFC driver.
+ *
+ * \return Microseconds since HAL_Init, wraps every ~71 minutes.
+ */
+uint32_t NFC_Timer_GetUs(void);
+
+/**
+ * \brief Busy wait with resolution of core clock based on DWT cycle counter.
+ *
+ * \param[in] us Time to wait in microseconds, maximum is ~19.8 s at 216 MHz.
+ */
+void NFC_Timer_DelayUs(const uint32_t us);
+
+/**
+ * \brief Sleep in WFI until a one-shot of TIM7 ends, other interrupts are
+ * served meanwhile. Waits shorter than NFC_TIMER_SLEEP_MINUS are busy.
+ *
+ * \param[in] us Time to sleep in microseconds.
+ */
+void NFC_Timer_SleepUs(const uint32_t us);
+
+/**
+ * \brief Interrupt handler of TIM7, it belongs to the timer. PN532_NFC.ioc
+ * does not enable TIM7 so code generation does not create it in stm32f7xx_it.c.
+ */
+void TIM7_IRQHandler(void);
+
+/**
+ * \brief Convert core clock cycles to microseconds.
+ *
+ * \param[in] cycles Amount of core clock cycles.
+ *
+ * \return Microseconds equivalent to cycles.
+ */
+uint32_t NFC_Timer_CyclesToUs(const uint64_t cycles);
+
+#endif /* INC_NFC_TIMER_H_ */
@@ -0,0 +1,107 @@
+/*
+ * NFC_Transport.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Helpers shared by the DMA transports of PN532 (SPI, I2C and HSU): cache
+ *  maintenance of DMA buffers, the sleep until a transfer ends and the
+ *  transaction of NFC_CommInterface for buses without the SPI operation
+ *  byte. The driver always sends DATAWRITE, DATAREAD or STATREAD after
+ *  select; I2C and HSU take it to know what the next transfers do and keep
+ *  the frame written up to deselect, to send it in a single transfer.
+ */
+
+#ifndef INC_NFC_TRANSPORT_H_
+#define INC_NFC_TRANSPORT_H_
+
+#include "main.h"
+#include <stddef.h>
+
+/// Size of Cortex-M7 D-cache line, DMA buffers take whole lines
+#define NFC_TRANSPORT_CACHELINE		(32)
+
+/// Operation of the open transaction, chosen by the first byte sent
+#define NFC_TRANSPORT_CLOSED		(0)
+#define NFC_TRANSPORT_PENDING		(1)
+#define NFC_TRANSPORT_WRITE			(2)
+#define NFC_TRANSPORT_READ			(3)
+#define NFC_TRANSPORT_STATUS		(4)
+
+/**
+ *  Transaction of a bus without operation byte, from select to deselect.
+ */
+typedef struct
+{
+	uint8_t *buffer;			///< Frame written, sent by the transport at deselect
+	size_t size;				///< Size of buffer
+	size_t length;				///< Bytes of frame in buffer
+	uint8_t operation;			///< NFC_TRANSPORT_CLOSED...
+}NFC_Transaction;
+
+
+/**
+ * \brief Write lines of a DMA buffer to memory before DMA reads it.
+ * Nothing is done while D-cache is disabled.
+ *
+ * \param[in] buffer Buffer aligned to a cache line.
+ * \param[in] length Bytes of buffer, rounded up to whole lines.
+ */
+void NFC_Transport_CleanCache(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Drop lines of a DMA buffer, so the CPU reads what DMA wrote.
+ * Nothing is done while D-cache is disabled.
+ *
+ * \param[in] buffer Buffer aligned to a cache line.
+ * \param[in] length Bytes of buffer, rounded up to whole lines.
+ */
+void NFC_Transport_InvalidateCache(uint8_t *buffer, size_t length);
+
+/**
+ * \brief Sleep in WFI until an interrupt makes a condition true or timeout.
+ * The condition is tested with interrupts masked.
+ *
+ * \param[in] done Function returning 1 when the wait is over, called with interrupts masked.
+ * \param[in] timeout Timeout in mS.
+ *
+ * \return Return last result of done.
+ */
+uint8_t NFC_Transport_Wait(uint8_t (*done)(void), const uint32_t timeout);
+
+/**
+ * \brief Initialize a closed transaction.
+ *
+ * \param[out] transaction Transaction to initialize.
+ * \param[in] buffer Buffer to keep the frame written.
+ * \param[in] size Size of buffer.
+ */
+void NFC_Transaction_Init(NFC_Transaction *transaction, uint8_t *buffer, const size_t size);
+
+/**
+ * \brief Open a transaction at select, its first byte sent chooses the operation.
+ *
+ * \param[in,out] transaction Transaction of the transport.
+ */
+void NFC_Transaction_Open(NFC_Transaction *transaction);
+
+/**
+ * \brief Take bytes sent by the driver: the operation byte of an open
+ * transaction and then the frame of a write, kept in buffer.
+ *
+ * \param[in,out] transaction Transaction of the transport.
+ * \param[in] buffer Bytes sent.
+ * \param[in] length Amount of bytes.
+ *
+ * \return Return 0 when the frame does not fit in buffer, the transaction is closed then.
+ */
+uint8_t NFC_Transaction_Send(NFC_Transaction *transaction, const uint8_t *buffer, size_t length);
+
+/**
+ * \brief Close a transaction at deselect.
+ *
+ * \param[in,out] transaction Transaction of the transport.
+ */
+void NFC_Transaction_Close(NFC_Transaction *transaction);
+
+#endif /* INC_NFC_TRANSPORT_H_ */
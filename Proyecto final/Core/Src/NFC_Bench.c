@@ -0,0 +1,395 @@
+/*
+ * NFC_Bench.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_Bench.h"
+#include "NFC_Timer.h"
+#include "NFC_Bus.h"
+#include "NFC_SPI.h"
+#include "NFC_SPI_LL.h"
+#include "NFC_SPI_DMA.h"
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Time to wait ACK in the loop benchmark, it never arrives
+#define NFC_BENCH_TIMEOUT	(60000)
+
+static const uint8_t benchAck[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+static const uint8_t benchFirmware[13] = {0x00, 0x00, 0xFF, 0x06, 0xFA, 0xD5, 0x03, 0x32, 0x01, 0x06, 0x07, 0xE8, 0x00};
+
+/// Memory transport: a write is answered with ACK, then with the response
+static const uint8_t *benchFrame = benchAck;
+static size_t benchPosition = 0;
+static uint8_t benchReads = 0;
+static uint8_t benchReady = false;
+
+static void NFC_Bench_Operation(const uint8_t operation);
+static void NFC_Bench_SendBuffer(const uint8_t *buffer, size_t length);
+static void NFC_Bench_SendByte(uint8_t data);
+static void NFC_Bench_ReceiveBuffer(uint8_t *buffer, size_t length);
+static uint8_t NFC_Bench_GetByte(void);
+static void NFC_Bench_SetSelect(uint8_t select);
+static uint8_t NFC_Bench_GetIRQ(void);
+static void NFC_Bench_DelayUs(uint32_t us);
+static void NFC_Bench_FlushCaches(void);
+static void NFC_Bench_Send(const uint8_t transport, const uint8_t *buffer, const uint16_t length);
+static void NFC_Bench_GetStats(const uint8_t transport, NFC_SPI_Stats *stats);
+
+static void NFC_Bench_Operation(const uint8_t operation)
+{
+	if (operation == PN532_SPI_DATAWRITE)
+	{
+		benchReads = 0;
+	}
+	else if (operation == PN532_SPI_DATAREAD)
+	{
+		benchFrame = (benchReads++ == 0) ? benchAck : benchFirmware;
+		benchPosition = 0;
+	}
+}
+
+static void NFC_Bench_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	// First byte after chip select is the SPI operation of PN532
+	NFC_Bench_Operation(buffer[0]);
+}
+
+static void NFC_Bench_SendByte(uint8_t data)
+{
+	NFC_Bench_Operation(data);
+}
+
+static void NFC_Bench_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = NFC_Bench_GetByte();
+	}
+}
+
+static uint8_t NFC_Bench_GetByte(void)
+{
+	size_t size = (benchFrame == benchAck) ? sizeof(benchAck) : sizeof(benchFirmware);
+
+	return (benchPosition < size) ? benchFrame[benchPosition++] : 0x00;
+}
+
+static void NFC_Bench_SetSelect(uint8_t select)
+{
+	UNUSED(select);
+}
+
+static uint8_t NFC_Bench_GetIRQ(void)
+{
+	return benchReady;
+}
+
+static void NFC_Bench_DelayUs(uint32_t us)
+{
+	UNUSED(us);
+}
+
+static void NFC_Bench_FlushCaches(void)
+{
+	// Lines are written back first, so only the contents of caches are lost
+	if (SCB->CCR & SCB_CCR_DC_Msk)
+	{
+		SCB_CleanInvalidateDCache();
+	}
+
+	if (SCB->CCR & SCB_CCR_IC_Msk)
+	{
+		SCB_InvalidateICache();
+	}
+
+	if (FLASH->ACR & FLASH_ACR_ARTEN)
+	{
+		__HAL_FLASH_ART_DISABLE();
+		__HAL_FLASH_ART_RESET();
+		CLEAR_BIT(FLASH->ACR, FLASH_ACR_ARTRST);
+		__HAL_FLASH_ART_ENABLE();
+	}
+}
+
+static void NFC_Bench_Send(const uint8_t transport, const uint8_t *buffer, const uint16_t length)
+{
+	uint16_t i;
+
+	switch (transport)
+	{
+	case NFC_BENCH_HAL_BYTES:
+		for (i = 0; i < length; i++)
+		{
+			NFC_SPI_SendByte(buffer[i]);
+		}
+		break;
+
+	case NFC_BENCH_HAL:
+		NFC_SPI_SendBuffer(buffer, length);
+		break;
+
+	case NFC_BENCH_LL_BYTES:
+		for (i = 0; i < length; i++)
+		{
+			NFC_SPI_LL_SendByte(buffer[i]);
+		}
+		break;
+
+	case NFC_BENCH_LL:
+		NFC_SPI_LL_SendBuffer(buffer, length);
+		break;
+
+	default:
+		NFC_SPI_DMA_SendBuffer(buffer, length);
+		break;
+	}
+}
+
+static void NFC_Bench_GetStats(const uint8_t transport, NFC_SPI_Stats *stats)
+{
+	switch (transport)
+	{
+	case NFC_BENCH_HAL_BYTES:
+	case NFC_BENCH_HAL:
+		NFC_SPI_GetStats(stats);
+		break;
+
+	case NFC_BENCH_LL_BYTES:
+	case NFC_BENCH_LL:
+		NFC_SPI_LL_GetStats(stats);
+		break;
+
+	default:
+		NFC_SPI_DMA_GetStats(stats);
+		break;
+	}
+}
+
+void NFC_Bench_SetCaches(const uint8_t enable)
+{
+	if (enable)
+	{
+		// Enabling D-cache again would invalidate dirty lines without writing them
+		if ((SCB->CCR & SCB_CCR_IC_Msk) == 0)
+		{
+			SCB_EnableICache();
+		}
+
+		if ((SCB->CCR & SCB_CCR_DC_Msk) == 0)
+		{
+			SCB_EnableDCache();
+		}
+
+		__HAL_FLASH_ART_ENABLE();
+		__HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+	}
+	else
+	{
+		// ART must be reset while disabled, so old lines are not used on next enable
+		__HAL_FLASH_PREFETCH_BUFFER_DISABLE();
+		__HAL_FLASH_ART_DISABLE();
+		__HAL_FLASH_ART_RESET();
+		CLEAR_BIT(FLASH->ACR, FLASH_ACR_ARTRST);
+
+		if (SCB->CCR & SCB_CCR_DC_Msk)
+		{
+			SCB_DisableDCache();
+		}
+
+		if (SCB->CCR & SCB_CCR_IC_Msk)
+		{
+			SCB_DisableICache();
+		}
+	}
+}
+
+uint8_t NFC_Bench_Run(NFC_Bench_Result *result)
+{
+	NFC_CommInterface interface = {0};
+	NFC_Context context;
+	NFC_Bus bus;
+	uint64_t loopTotal = 0, frameTotal = 0;
+	uint32_t start, cycles;
+	uint8_t success = true;
+	uint16_t i;
+
+	memset(result, 0, sizeof(NFC_Bench_Result));
+
+	interface.SendByte = &NFC_Bench_SendByte;
+	interface.GetByte = &NFC_Bench_GetByte;
+	interface.SendBuffer = &NFC_Bench_SendBuffer;
+	interface.ReceiveBuffer = &NFC_Bench_ReceiveBuffer;
+	interface.SetSelect = &NFC_Bench_SetSelect;
+	interface.GetIRQ = &NFC_Bench_GetIRQ;
+	interface.DelayUs = &NFC_Bench_DelayUs;
+	interface.GetTimeUs = &NFC_Timer_GetUs;
+
+	NFC_CommInit(&context, &interface, 0);
+	NFC_Bus_Init(&bus, NULL);
+	NFC_Bus_Add(&bus, &context);
+
+	// Reader waits an ACK that never comes, every pass only tests IRQ and timeout
+	benchReady = false;
+	context.buffer[0] = PN532_COMMAND_GETFIRMWAREVERSION;
+	NFC_StartCommand(&context, 1, NFC_BENCH_TIMEOUT);
+
+	for (i = 0; i < NFC_BENCH_ITERATIONS; i++)
+	{
+		start = NFC_Timer_GetCycles();
+		NFC_Bus_Process(&bus);
+		cycles = NFC_Timer_GetCycles() - start;
+
+		loopTotal += cycles;
+		if (cycles > result->loopMax)
+		{
+			result->loopMax = cycles;
+		}
+	}
+
+	// PN532 answers at once, the cost is building and checking frames
+	benchReady = true;
+	context.state = NFC_COMMAND_IDLE;
+
+	for (i = 0; i < NFC_BENCH_ITERATIONS; i++)
+	{
+		start = NFC_Timer_GetCycles();
+		if (NFC_GetFirmwareVersion(&context) == 0)
+		{
+			success = false;
+		}
+		cycles = NFC_Timer_GetCycles() - start;
+
+		frameTotal += cycles;
+		if (cycles > result->frameMax)
+		{
+			result->frameMax = cycles;
+		}
+	}
+
+	for (i = 0; i < NFC_BENCH_COLD_ITERATIONS; i++)
+	{
+		NFC_Bench_FlushCaches();
+
+		start = NFC_Timer_GetCycles();
+		if (NFC_GetFirmwareVersion(&context) == 0)
+		{
+			success = false;
+		}
+		cycles = NFC_Timer_GetCycles() - start;
+
+		if (cycles > result->frameColdMax)
+		{
+			result->frameColdMax = cycles;
+		}
+	}
+
+	result->loopAverage = (uint32_t)(loopTotal / NFC_BENCH_ITERATIONS);
+	result->frameAverage = (uint32_t)(frameTotal / NFC_BENCH_ITERATIONS);
+
+	return success;
+}
+
+void NFC_Bench_RunTransport(NFC_Bench_Transport *result)
+{
+	static const uint16_t sizes[NFC_BENCH_SIZECOUNT] = NFC_BENCH_SIZES;
+	static uint8_t block[NFC_BENCH_BLOCKSIZE];
+	NFC_SPI_Stats before, after;
+	uint64_t elapsed, active, wallStart;
+	uint32_t start;
+	uint8_t transport, size;
+	uint16_t i;
+
+	for (i = 0; i < sizeof(block); i++)
+	{
+		block[i] = (uint8_t)i;
+	}
+
+	for (transport = 0; transport < NFC_BENCH_TRANSPORTS; transport++)
+	{
+		for (size = 0; size < NFC_BENCH_SIZECOUNT; size++)
+		{
+			elapsed = 0;
+			active = 0;
+			NFC_Bench_GetStats(transport, &before);
+
+			for (i = 0; i < NFC_BENCH_TRANSFERS; i++)
+			{
+				wallStart = NFC_Timer_GetWallCycles();
+				start = NFC_Timer_GetCycles();
+
+				NFC_Bench_Send(transport, block, sizes[size]);
+
+				active += NFC_Timer_GetCycles() - start;
+				elapsed += NFC_Timer_GetWallCycles() - wallStart;
+			}
+
+			result->elapsedCycles[transport][size] = (uint32_t)(elapsed / NFC_BENCH_TRANSFERS);
+			result->activeCycles[transport][size] = (uint32_t)(active / NFC_BENCH_TRANSFERS);
+
+			// Transport accounts only its own transfers, so the difference is this size
+			NFC_Bench_GetStats(transport, &after);
+			result->stats[transport][size].transfers = after.transfers - before.transfers;
+			result->stats[transport][size].bytes = after.bytes - before.bytes;
+			result->stats[transport][size].activeCycles = after.activeCycles - before.activeCycles;
+			result->stats[transport][size].elapsedCycles = after.elapsedCycles - before.elapsedCycles;
+			result->stats[transport][size].errors = after.errors - before.errors;
+		}
+	}
+}
+
+uint8_t NFC_Bench_RunIRQ(const NFC_CommInterface *commInterface, NFC_Bench_IRQ *result)
+{
+	NFC_CommInterface interface;
+	NFC_Context context;
+	uint64_t elapsed, active, wallStart;
+	uint32_t start;
+	uint8_t mode, success = true;
+	uint16_t i;
+
+	memset(result, 0, sizeof(NFC_Bench_IRQ));
+
+	for (mode = 0; mode < NFC_BENCH_IRQMODES; mode++)
+	{
+		// Transfers are the ones of the application, only the wait of ready changes
+		interface = *commInterface;
+		interface.GetIRQ = &NFC_SPI_GetIRQ;
+		interface.WaitIRQ = (mode == NFC_BENCH_WAITIRQ) ? &NFC_SPI_WaitIRQ : NULL;
+
+		NFC_CommInit(&context, &interface, 0);
+		NFC_SPI_ResetStats();
+		elapsed = 0;
+		active = 0;
+
+		for (i = 0; i < NFC_BENCH_TRANSFERS; i++)
+		{
+			wallStart = NFC_Timer_GetWallCycles();
+			start = NFC_Timer_GetCycles();
+
+			if (NFC_GetFirmwareVersion(&context) == 0)
+			{
+				result->failures[mode]++;
+				success = false;
+			}
+
+			active += NFC_Timer_GetCycles() - start;
+			elapsed += NFC_Timer_GetWallCycles() - wallStart;
+		}
+
+		result->elapsedCycles[mode] = (uint32_t)(elapsed / NFC_BENCH_TRANSFERS);
+		result->activeCycles[mode] = (uint32_t)(active / NFC_BENCH_TRANSFERS);
+
+		if (mode == NFC_BENCH_WAITIRQ)
+		{
+			NFC_SPI_GetIRQStats(&result->waits);
+		}
+	}
+
+	return success;
+}
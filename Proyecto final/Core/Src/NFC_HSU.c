@@ -0,0 +1,451 @@
+/*
+ * NFC_HSU.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_HSU.h>
+#include <NFC_Transport.h>
+#include <NFC_TCM.h>
+#include <NFC.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Bytes of wake-up preamble, kept ahead of the frame in the transmit buffer
+#define NFC_HSU_WAKEUPLENGTH	(2 + NFC_HSU_WAKEUPZEROS)
+
+DMA_HandleTypeDef hdma_usart6_rx;
+DMA_HandleTypeDef hdma_usart6_tx;
+
+/// Both DMA buffers, whole cache lines so maintenance never touches other variables
+typedef struct
+{
+	uint8_t ring[NFC_HSU_RINGSIZE];
+	uint8_t tx[NFC_HSU_BUFFERSIZE];
+}NFC_HSU_Buffers;
+
+static NFC_HSU_Buffers hsuBuffers NFC_DTCM __attribute__((aligned(NFC_TRANSPORT_CACHELINE)));
+static uint16_t tail NFC_DTCM = 0;				///< Next byte of the ring to read, DMA writes the head
+static uint16_t waitCount NFC_DTCM = 0;			///< Bytes waited by NFC_HSU_WaitBytes, 0 for a start code
+static volatile uint8_t txBusy NFC_DTCM = false;
+static volatile uint8_t lineIdle NFC_DTCM = false;	///< A frame ended since the last sleep
+static NFC_Transaction transaction NFC_DTCM;
+static uint8_t readOpen NFC_DTCM = false;		///< Start code of the frame was already given
+static uint8_t wakeupPending = true;
+static uint32_t baudRate = NFC_HSU_BAUD_BOOT;
+static NFC_HSU_Stats hsuStats;
+
+static uint16_t NFC_HSU_Available(void);
+static void NFC_HSU_Flush(void);
+static uint8_t NFC_HSU_FindStart(void);
+static uint8_t NFC_HSU_BytesReady(void);
+static uint8_t NFC_HSU_WaitBytes(const uint16_t count, const uint32_t timeout);
+static uint8_t NFC_HSU_TxDone(void);
+static uint8_t NFC_HSU_Transmit(const uint8_t wakeup);
+static void NFC_HSU_Receive(uint8_t *buffer, size_t length);
+static void NFC_HSU_Send(const uint8_t *buffer, size_t length);
+
+NFC_ITCM static uint16_t NFC_HSU_Available(void)
+{
+	// DMA counts down the bytes left up to the end of the ring
+	const uint16_t head = (NFC_HSU_RINGSIZE - __HAL_DMA_GET_COUNTER(&hdma_usart6_rx)) % NFC_HSU_RINGSIZE;
+
+	return (head + NFC_HSU_RINGSIZE - tail) % NFC_HSU_RINGSIZE;
+}
+
+NFC_ITCM static void NFC_HSU_Flush(void)
+{
+	const uint16_t available = NFC_HSU_Available();
+
+	hsuStats.skipped += available;
+	tail = (tail + available) % NFC_HSU_RINGSIZE;
+}
+
+NFC_ITCM static uint8_t NFC_HSU_FindStart(void)
+{
+	const uint8_t *ring = hsuBuffers.ring;
+
+	// Ring is only written by DMA, no line of it is ever dirty
+	NFC_Transport_InvalidateCache(hsuBuffers.ring, NFC_HSU_RINGSIZE);
+
+	// Start code is kept, the preamble before it is given back by the read
+	while (NFC_HSU_Available() >= 2)
+	{
+		if (ring[tail] == PN532_STARTCODE1 && ring[(tail + 1) % NFC_HSU_RINGSIZE] == PN532_STARTCODE2)
+		{
+			return true;
+		}
+
+		tail = (tail + 1) % NFC_HSU_RINGSIZE;
+		hsuStats.skipped++;
+	}
+
+	return false;
+}
+
+NFC_ITCM static uint8_t NFC_HSU_BytesReady(void)
+{
+	return (waitCount == 0) ? NFC_HSU_FindStart() : ((NFC_HSU_Available() >= waitCount) ? true : false);
+}
+
+NFC_ITCM static uint8_t NFC_HSU_WaitBytes(const uint16_t count, const uint32_t timeout)
+{
+	uint8_t ready;
+
+	// count 0 waits a start code, the idle line interrupt wakes up the core
+	waitCount = count;
+	ready = NFC_Transport_Wait(&NFC_HSU_BytesReady, timeout);
+
+	// Frames ended during the wait were taken by it
+	lineIdle = false;
+
+	return ready;
+}
+
+NFC_ITCM static uint8_t NFC_HSU_TxDone(void)
+{
+	return txBusy ? false : true;
+}
+
+NFC_ITCM static uint8_t NFC_HSU_Transmit(const uint8_t wakeup)
+{
+	const size_t start = wakeup ? 0 : NFC_HSU_WAKEUPLENGTH;
+	const size_t length = NFC_HSU_WAKEUPLENGTH + transaction.length - start;
+
+	// PN532 leaves power down with 0x55 and needs the zeros before the frame
+	if (wakeup)
+	{
+		hsuBuffers.tx[0] = PN532_WAKEUP;
+		hsuBuffers.tx[1] = PN532_WAKEUP;
+		memset(&hsuBuffers.tx[2], 0x00, NFC_HSU_WAKEUPZEROS);
+		hsuStats.wakeups++;
+	}
+
+	// Write data to memory before DMA read it, lines are taken from the start of the buffer
+	NFC_Transport_CleanCache(hsuBuffers.tx, NFC_HSU_WAKEUPLENGTH + transaction.length);
+
+	txBusy = true;
+	USART6->ICR = USART_ICR_TCCF;
+
+	if (HAL_DMA_Start(&hdma_usart6_tx, (uint32_t)(uintptr_t)&hsuBuffers.tx[start], (uint32_t)(uintptr_t)&USART6->TDR, length) != HAL_OK)
+	{
+		txBusy = false;
+		hsuStats.errors++;
+		return false;
+	}
+
+	// Transmission complete is set when the last stop bit left the pin
+	USART6->CR1 |= USART_CR1_TCIE;
+
+	if (!NFC_Transport_Wait(&NFC_HSU_TxDone, NFC_HSU_TIMEOUT))
+	{
+		USART6->CR1 &= ~USART_CR1_TCIE;
+		HAL_DMA_Abort(&hdma_usart6_tx);
+		txBusy = false;
+		hsuStats.errors++;
+		return false;
+	}
+
+	// Stream finished before TC, this only clears its flags and state
+	HAL_DMA_PollForTransfer(&hdma_usart6_tx, HAL_DMA_FULL_TRANSFER, NFC_HSU_TIMEOUT);
+
+	return true;
+}
+
+NFC_ITCM static void NFC_HSU_Receive(uint8_t *buffer, size_t length)
+{
+	const uint8_t *ring = hsuBuffers.ring;
+	size_t chunk;
+
+	if (transaction.operation == NFC_TRANSPORT_STATUS)
+	{
+		// Answer as SPI status register does
+		memset(buffer, NFC_HSU_FindStart() ? PN532_SPI_READY : 0x00, length);
+		return;
+	}
+
+	if (transaction.operation != NFC_TRANSPORT_READ || length == 0)
+	{
+		memset(buffer, 0x00, length);
+		return;
+	}
+
+	if (!readOpen)
+	{
+		if (!NFC_HSU_WaitBytes(0, NFC_HSU_TIMEOUT))
+		{
+			hsuStats.errors++;
+			memset(buffer, 0x00, length);
+			return;
+		}
+
+		// Preamble of PN532 is optional on HSU, the driver always reads it
+		readOpen = true;
+		*buffer++ = PN532_PREAMBLE;
+		length--;
+	}
+
+	// Frame could still be on the line, the idle interrupt wakes the core at its end
+	if (!NFC_HSU_WaitBytes((uint16_t)length, NFC_HSU_TIMEOUT))
+	{
+		hsuStats.errors++;
+		memset(buffer, 0x00, length);
+		return;
+	}
+
+	NFC_Transport_InvalidateCache(hsuBuffers.ring, NFC_HSU_RINGSIZE);
+
+	// Copy up to the end of the ring and then from its start
+	chunk = NFC_HSU_RINGSIZE - tail;
+	chunk = (length < chunk) ? length : chunk;
+	memcpy(buffer, &ring[tail], chunk);
+	memcpy(&buffer[chunk], ring, length - chunk);
+
+	tail = (tail + length) % NFC_HSU_RINGSIZE;
+	hsuStats.bytesReceived += length;
+}
+
+NFC_ITCM static void NFC_HSU_Send(const uint8_t *buffer, size_t length)
+{
+	if (!NFC_Transaction_Send(&transaction, buffer, length))
+	{
+		hsuStats.errors++;
+	}
+}
+
+uint8_t NFC_HSU_Init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	__HAL_RCC_GPIOC_CLK_ENABLE();
+	__HAL_RCC_USART6_CLK_ENABLE();
+	__HAL_RCC_DMA2_CLK_ENABLE();
+
+	/**
+	PC6     ------> USART6_TX
+	PC7     ------> USART6_RX
+	*/
+
+	/* Pull-up keeps RX at idle level while PN532 is not connected */
+	GPIO_InitStruct.Pin = HSU_TX_Pin | HSU_RX_Pin;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF8_USART6;
+	HAL_GPIO_Init(HSU_TX_GPIO_Port, &GPIO_InitStruct);
+
+	/* USART6_RX Init, circular so PN532 can send at any time */
+	hdma_usart6_rx.Instance = NFC_HSU_DMA_RX_STREAM;
+	hdma_usart6_rx.Init.Channel = NFC_HSU_DMA_RX_CHANNEL;
+	hdma_usart6_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_usart6_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart6_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart6_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart6_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart6_rx.Init.Mode = DMA_CIRCULAR;
+	hdma_usart6_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_usart6_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_usart6_rx) != HAL_OK)
+	{
+		return false;
+	}
+
+	/* USART6_TX Init */
+	hdma_usart6_tx.Instance = NFC_HSU_DMA_TX_STREAM;
+	hdma_usart6_tx.Init.Channel = NFC_HSU_DMA_TX_CHANNEL;
+	hdma_usart6_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_usart6_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_usart6_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_usart6_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_usart6_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_usart6_tx.Init.Mode = DMA_NORMAL;
+	hdma_usart6_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+	hdma_usart6_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_usart6_tx) != HAL_OK)
+	{
+		return false;
+	}
+
+	/* 8 data bits, no parity and 1 stop bit; both directions by DMA, errors interrupt */
+	USART6->CR1 = 0;
+	USART6->CR2 = 0;
+	USART6->CR3 = USART_CR3_DMAR | USART_CR3_DMAT | USART_CR3_EIE;
+
+	if (!NFC_HSU_SetBaudRate(NFC_HSU_BAUD_BOOT))
+	{
+		return false;
+	}
+
+	// Streams are never stopped, the ring is read from the counter of DMA
+	if (HAL_DMA_Start(&hdma_usart6_rx, (uint32_t)(uintptr_t)&USART6->RDR, (uint32_t)(uintptr_t)hsuBuffers.ring, NFC_HSU_RINGSIZE) != HAL_OK)
+	{
+		return false;
+	}
+
+	tail = 0;
+	USART6->ICR = USART_ICR_IDLECF | USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF | USART_ICR_TCCF;
+	USART6->CR1 = USART_CR1_IDLEIE | USART_CR1_TE | USART_CR1_RE | USART_CR1_UE;
+
+	HAL_NVIC_SetPriority(USART6_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(USART6_IRQn);
+
+	NFC_Transaction_Init(&transaction, &hsuBuffers.tx[NFC_HSU_WAKEUPLENGTH], NFC_HSU_BUFFERSIZE - NFC_HSU_WAKEUPLENGTH);
+	readOpen = false;
+	wakeupPending = true;
+	memset(&hsuStats, 0, sizeof(hsuStats));
+
+	return true;
+}
+
+uint8_t NFC_HSU_SetBaudRate(const uint32_t baud)
+{
+	const uint32_t pclk = HAL_RCC_GetPCLK2Freq();
+	uint32_t divider, enabled;
+
+	if (baud == 0 || baud > NFC_HSU_BAUD_MAX)
+	{
+		return false;
+	}
+
+	// Oversampling by 16, kernel clock is PCLK2 after reset of DCKCFGR2
+	divider = (pclk + baud / 2) / baud;
+
+	if (divider < 16 || divider > 0xFFFF)
+	{
+		return false;
+	}
+
+	// BRR is only written with USART disabled
+	enabled = USART6->CR1 & USART_CR1_UE;
+	USART6->CR1 &= ~USART_CR1_UE;
+	USART6->BRR = divider;
+	USART6->CR1 |= enabled;
+
+	// Bytes received at the old rate are noise at the new one
+	NFC_HSU_Flush();
+	baudRate = baud;
+
+	return true;
+}
+
+uint32_t NFC_HSU_GetBaudRate(void)
+{
+	return baudRate;
+}
+
+void NFC_HSU_Wakeup(void)
+{
+	wakeupPending = true;
+}
+
+NFC_ITCM uint8_t NFC_HSU_GetByte(void)
+{
+	uint8_t byte;
+
+	NFC_HSU_ReceiveBuffer(&byte, 1);
+
+	return byte;
+}
+
+NFC_ITCM void NFC_HSU_SendByte(uint8_t byte)
+{
+	NFC_HSU_SendBuffer(&byte, 1);
+}
+
+NFC_ITCM void NFC_HSU_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	NFC_HSU_Receive(buffer, length);
+}
+
+NFC_ITCM void NFC_HSU_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	NFC_HSU_Send(buffer, length);
+}
+
+NFC_ITCM void NFC_HSU_SetSelect(uint8_t state)
+{
+	if (state)
+	{
+		NFC_Transaction_Open(&transaction);
+		readOpen = false;
+		return;
+	}
+
+	if (transaction.operation == NFC_TRANSPORT_WRITE && transaction.length > 0)
+	{
+		// Left bytes of an aborted answer would be taken as the answer of this frame
+		NFC_HSU_Flush();
+
+		if (NFC_HSU_Transmit(wakeupPending))
+		{
+			hsuStats.framesSent++;
+		}
+		wakeupPending = false;
+	}
+
+	NFC_Transaction_Close(&transaction);
+	readOpen = false;
+}
+
+NFC_ITCM uint8_t NFC_HSU_GetIRQ(void)
+{
+	return NFC_HSU_FindStart();
+}
+
+NFC_ITCM uint8_t NFC_HSU_WaitIRQ(uint32_t timeout)
+{
+	return NFC_HSU_WaitBytes(0, timeout);
+}
+
+NFC_ITCM void NFC_HSU_Idle(void)
+{
+	// Same masked test as NFC_HSU_WaitIRQ, the end of a frame can not be lost before WFI
+	__disable_irq();
+	if (!lineIdle)
+	{
+		__WFI();
+	}
+	lineIdle = false;
+	__enable_irq();
+}
+
+NFC_ITCM void NFC_HSU_IRQHandler(void)
+{
+	const uint32_t status = USART6->ISR;
+
+	// One character time without start bit after a byte, the frame ended
+	if (status & USART_ISR_IDLE)
+	{
+		USART6->ICR = USART_ICR_IDLECF;
+		lineIdle = true;
+	}
+
+	// Each error flag holds reception until it is cleared
+	if (status & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE))
+	{
+		USART6->ICR = USART_ICR_ORECF | USART_ICR_FECF | USART_ICR_NCF;
+		hsuStats.overruns++;
+	}
+
+	if ((status & USART_ISR_TC) && (USART6->CR1 & USART_CR1_TCIE))
+	{
+		USART6->CR1 &= ~USART_CR1_TCIE;
+		USART6->ICR = USART_ICR_TCCF;
+		txBusy = false;
+	}
+}
+
+NFC_ITCM void USART6_IRQHandler(void)
+{
+	NFC_HSU_IRQHandler();
+}
+
+void NFC_HSU_GetStats(NFC_HSU_Stats *stats)
+{
+	memcpy(stats, &hsuStats, sizeof(NFC_HSU_Stats));
+}
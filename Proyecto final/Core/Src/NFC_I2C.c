@@ -0,0 +1,494 @@
+/*
+ * NFC_I2C.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_I2C.h>
+#include <NFC_Transport.h>
+#include <NFC_TCM.h>
+#include <NFC.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Address of PN532 as HAL takes it, shifted left one bit
+#define NFC_I2C_ADDRESS		((uint16_t)(PN532_I2C_ADDRESS << 1))
+
+/// States of the interrupt or DMA transfer
+#define NFC_I2C_IDLE		(0)
+#define NFC_I2C_BUSY		(1)
+#define NFC_I2C_ERROR		(2)
+
+I2C_HandleTypeDef hi2c;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c1_tx;
+
+/// Both DMA buffers, whole cache lines so maintenance never touches other variables
+typedef struct
+{
+	uint8_t tx[NFC_I2C_BUFFERSIZE];
+	uint8_t rx[NFC_I2C_BUFFERSIZE];
+}NFC_I2C_Buffers;
+
+static NFC_I2C_Buffers i2cBuffers NFC_DTCM __attribute__((aligned(NFC_TRANSPORT_CACHELINE)));
+static volatile uint8_t i2cState NFC_DTCM = NFC_I2C_IDLE;
+static NFC_Transaction transaction NFC_DTCM;
+static uint8_t readOpen NFC_DTCM = false;		///< Read without STOP in progress
+static uint8_t irqUsed = false;
+static NFC_I2C_Stats i2cStats;
+
+#if NFC_SPI_STATS_ENABLE
+#define NFC_I2C_STATS_START(mark)			NFC_SPI_StatsStart(mark)
+#define NFC_I2C_STATS_STOP(mark, bytes)		NFC_SPI_StatsStop(&i2cStats.transfers, mark, bytes)
+#else
+#define NFC_I2C_STATS_START(mark)			((void)(mark))
+#define NFC_I2C_STATS_STOP(mark, bytes)		((void)(mark))
+#endif
+
+static uint8_t NFC_I2C_Done(void);
+static uint8_t NFC_I2C_Wait(void);
+static uint8_t NFC_I2C_Write(size_t length);
+static uint8_t NFC_I2C_Read(size_t length, uint32_t options);
+static uint8_t NFC_I2C_ReadStatus(void);
+static void NFC_I2C_Receive(uint8_t *buffer, size_t length);
+static void NFC_I2C_Send(const uint8_t *buffer, size_t length);
+static void NFC_I2C_Complete(uint8_t error);
+
+NFC_ITCM static uint8_t NFC_I2C_Done(void)
+{
+	return (i2cState != NFC_I2C_BUSY) ? true : false;
+}
+
+NFC_ITCM static uint8_t NFC_I2C_Wait(void)
+{
+	NFC_Transport_Wait(&NFC_I2C_Done, NFC_I2C_TIMEOUT);
+
+	// Transfer never finished, stop it to release the bus
+	if (i2cState == NFC_I2C_BUSY)
+	{
+		HAL_I2C_Master_Abort_IT(&hi2c, NFC_I2C_ADDRESS);
+		i2cState = NFC_I2C_ERROR;
+	}
+
+	if (i2cState != NFC_I2C_IDLE)
+	{
+		i2cState = NFC_I2C_IDLE;
+		readOpen = false;
+		i2cStats.errors++;
+		return false;
+	}
+
+	return true;
+}
+
+NFC_ITCM static uint8_t NFC_I2C_Write(size_t length)
+{
+	uint8_t *buffer = i2cBuffers.tx;
+	HAL_StatusTypeDef status;
+
+	// Write data to memory before DMA read it
+	NFC_Transport_CleanCache(buffer, length);
+
+	i2cState = NFC_I2C_BUSY;
+
+	if (length >= NFC_I2C_DMA_MINLENGTH)
+	{
+		status = HAL_I2C_Master_Transmit_DMA(&hi2c, NFC_I2C_ADDRESS, buffer, (uint16_t)length);
+	}
+	else
+	{
+		status = HAL_I2C_Master_Transmit_IT(&hi2c, NFC_I2C_ADDRESS, buffer, (uint16_t)length);
+	}
+
+	if (status != HAL_OK)
+	{
+		i2cState = NFC_I2C_IDLE;
+		i2cStats.errors++;
+		return false;
+	}
+
+	return NFC_I2C_Wait();
+}
+
+NFC_ITCM static uint8_t NFC_I2C_Read(size_t length, uint32_t options)
+{
+	uint8_t *buffer = i2cBuffers.rx;
+	HAL_StatusTypeDef status;
+
+	// Drop lines of receive buffer, so no dirty line is evicted over DMA data
+	NFC_Transport_InvalidateCache(buffer, length);
+
+	i2cState = NFC_I2C_BUSY;
+
+	if (length >= NFC_I2C_DMA_MINLENGTH)
+	{
+		status = HAL_I2C_Master_Seq_Receive_DMA(&hi2c, NFC_I2C_ADDRESS, buffer, (uint16_t)length, options);
+	}
+	else
+	{
+		status = HAL_I2C_Master_Seq_Receive_IT(&hi2c, NFC_I2C_ADDRESS, buffer, (uint16_t)length, options);
+	}
+
+	if (status != HAL_OK)
+	{
+		i2cState = NFC_I2C_IDLE;
+		readOpen = false;
+		i2cStats.errors++;
+		return false;
+	}
+
+	if (!NFC_I2C_Wait())
+	{
+		return false;
+	}
+
+	// Lines could be speculatively read during transfer, read memory again
+	NFC_Transport_InvalidateCache(buffer, length);
+
+	return true;
+}
+
+NFC_ITCM static uint8_t NFC_I2C_ReadStatus(void)
+{
+	uint8_t status = PN532_I2C_BUSY;
+
+	i2cStats.statusReads++;
+
+	// A lone status byte is too short to pay the sleep of interrupt transfers, PN532 NACKs while it sleeps
+	if (HAL_I2C_Master_Receive(&hi2c, NFC_I2C_ADDRESS, &status, 1, NFC_I2C_TIMEOUT) != HAL_OK)
+	{
+		return false;
+	}
+
+	return (status == PN532_I2C_READY) ? true : false;
+}
+
+NFC_ITCM static void NFC_I2C_Receive(uint8_t *buffer, size_t length)
+{
+	const uint8_t *received = i2cBuffers.rx;
+	size_t chunk;
+
+	if (transaction.operation == NFC_TRANSPORT_STATUS)
+	{
+		// Answer as SPI status register does
+		memset(buffer, NFC_I2C_ReadStatus() ? PN532_SPI_READY : 0x00, length);
+		return;
+	}
+
+	if (transaction.operation != NFC_TRANSPORT_READ)
+	{
+		memset(buffer, 0x00, length);
+		return;
+	}
+
+	if (!readOpen)
+	{
+		// Each read of PN532 starts with its status byte, frame follows in the same transfer
+		chunk = (length >= NFC_I2C_BUFFERSIZE) ? NFC_I2C_BUFFERSIZE - 1 : length;
+
+		// No STOP at the end, the driver reads the rest of the frame after its header
+		if (!NFC_I2C_Read(chunk + 1, I2C_FIRST_AND_NEXT_FRAME))
+		{
+			memset(buffer, 0x00, length);
+			return;
+		}
+
+		readOpen = true;
+
+		// Busy PN532 sends no frame, zeros fail the checks of the driver
+		if (received[0] != PN532_I2C_READY)
+		{
+			i2cStats.notReady++;
+			memset(buffer, 0x00, length);
+			return;
+		}
+
+		memcpy(buffer, &received[1], chunk);
+		buffer += chunk;
+		length -= chunk;
+	}
+
+	while (length > 0)
+	{
+		chunk = (length > NFC_I2C_BUFFERSIZE) ? NFC_I2C_BUFFERSIZE : length;
+
+		if (!NFC_I2C_Read(chunk, I2C_NEXT_FRAME))
+		{
+			memset(buffer, 0x00, length);
+			return;
+		}
+
+		memcpy(buffer, received, chunk);
+		buffer += chunk;
+		length -= chunk;
+	}
+}
+
+NFC_ITCM static void NFC_I2C_Send(const uint8_t *buffer, size_t length)
+{
+	if (!NFC_Transaction_Send(&transaction, buffer, length))
+	{
+		i2cStats.errors++;
+	}
+}
+
+NFC_ITCM static void NFC_I2C_Complete(uint8_t error)
+{
+	i2cState = error ? NFC_I2C_ERROR : NFC_I2C_IDLE;
+}
+
+uint8_t NFC_I2C_Init(const uint8_t useIRQ)
+{
+	irqUsed = useIRQ;
+
+	hi2c.Instance = I2C1;
+	hi2c.Init.Timing = NFC_I2C_TIMING;
+	hi2c.Init.OwnAddress1 = 0;
+	hi2c.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+	hi2c.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+	hi2c.Init.OwnAddress2 = 0;
+	hi2c.Init.OwnAddress2Masks = I2C_OA2_NOMASK;
+	hi2c.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+	hi2c.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+
+	if (HAL_I2C_Init(&hi2c) != HAL_OK)
+	{
+		return false;
+	}
+
+	if (HAL_I2CEx_ConfigAnalogFilter(&hi2c, I2C_ANALOGFILTER_ENABLE) != HAL_OK)
+	{
+		return false;
+	}
+
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	/* I2C1_RX Init */
+	hdma_i2c1_rx.Instance = NFC_I2C_DMA_RX_STREAM;
+	hdma_i2c1_rx.Init.Channel = NFC_I2C_DMA_RX_CHANNEL;
+	hdma_i2c1_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_i2c1_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_i2c1_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_i2c1_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_i2c1_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_i2c1_rx.Init.Mode = DMA_NORMAL;
+	hdma_i2c1_rx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_i2c1_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_i2c1_rx) != HAL_OK)
+	{
+		return false;
+	}
+
+	__HAL_LINKDMA(&hi2c, hdmarx, hdma_i2c1_rx);
+
+	/* I2C1_TX Init */
+	hdma_i2c1_tx.Instance = NFC_I2C_DMA_TX_STREAM;
+	hdma_i2c1_tx.Init.Channel = NFC_I2C_DMA_TX_CHANNEL;
+	hdma_i2c1_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_i2c1_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_i2c1_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_i2c1_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_i2c1_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_i2c1_tx.Init.Mode = DMA_NORMAL;
+	hdma_i2c1_tx.Init.Priority = DMA_PRIORITY_MEDIUM;
+	hdma_i2c1_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_i2c1_tx) != HAL_OK)
+	{
+		return false;
+	}
+
+	__HAL_LINKDMA(&hi2c, hdmatx, hdma_i2c1_tx);
+
+	/* DMA and I2C event and error interrupts */
+	HAL_NVIC_SetPriority(NFC_I2C_DMA_RX_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(NFC_I2C_DMA_RX_IRQn);
+	HAL_NVIC_SetPriority(NFC_I2C_DMA_TX_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(NFC_I2C_DMA_TX_IRQn);
+	HAL_NVIC_SetPriority(I2C1_EV_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_EV_IRQn);
+	HAL_NVIC_SetPriority(I2C1_ER_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(I2C1_ER_IRQn);
+
+	NFC_Transaction_Init(&transaction, i2cBuffers.tx, NFC_I2C_BUFFERSIZE);
+	readOpen = false;
+	memset(&i2cStats, 0, sizeof(i2cStats));
+
+	return true;
+}
+
+void HAL_I2C_MspInit(I2C_HandleTypeDef *i2cHandle)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	if (i2cHandle->Instance == I2C1)
+	{
+		__HAL_RCC_GPIOB_CLK_ENABLE();
+		__HAL_RCC_GPIOH_CLK_ENABLE();
+
+		/**
+		PB8     ------> I2C1_SCL
+		PB9     ------> I2C1_SDA
+		*/
+
+		/* Open drain with pull-up, boards without external resistors still work at low speed */
+		GPIO_InitStruct.Pin = I2C_SCL_Pin | I2C_SDA_Pin;
+		GPIO_InitStruct.Mode = GPIO_MODE_AF_OD;
+		GPIO_InitStruct.Pull = GPIO_PULLUP;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+		GPIO_InitStruct.Alternate = GPIO_AF4_I2C1;
+		HAL_GPIO_Init(I2C_SCL_GPIO_Port, &GPIO_InitStruct);
+
+		/* I2C1 clock enable */
+		__HAL_RCC_I2C1_CLK_ENABLE();
+
+		if (irqUsed)
+		{
+			/* Configuration of pin IRQ of NFC, PN532 pull it down when a frame is ready */
+			GPIO_InitStruct.Pin = NFC_IRQ_Pin;
+			GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+			GPIO_InitStruct.Pull = GPIO_NOPULL;
+			GPIO_InitStruct.Alternate = 0;
+			HAL_GPIO_Init(NFC_IRQ_GPIO_Port, &GPIO_InitStruct);
+
+			HAL_NVIC_SetPriority(NFC_IRQ_EXTI_IRQn, 1, 0);
+			HAL_NVIC_EnableIRQ(NFC_IRQ_EXTI_IRQn);
+		}
+	}
+}
+
+NFC_ITCM uint8_t NFC_I2C_GetByte(void)
+{
+	uint8_t byte;
+
+	NFC_I2C_ReceiveBuffer(&byte, 1);
+
+	return byte;
+}
+
+NFC_ITCM void NFC_I2C_SendByte(uint8_t byte)
+{
+	NFC_I2C_SendBuffer(&byte, 1);
+}
+
+NFC_ITCM void NFC_I2C_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_I2C_STATS_START(&mark);
+
+	NFC_I2C_Receive(buffer, length);
+
+	NFC_I2C_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_I2C_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_I2C_STATS_START(&mark);
+
+	NFC_I2C_Send(buffer, length);
+
+	NFC_I2C_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_I2C_SetSelect(uint8_t state)
+{
+	NFC_SPI_StatsMark mark;
+
+	if (state)
+	{
+		NFC_Transaction_Open(&transaction);
+		readOpen = false;
+		return;
+	}
+
+	if (transaction.operation == NFC_TRANSPORT_WRITE && transaction.length > 0)
+	{
+		NFC_I2C_STATS_START(&mark);
+		NFC_I2C_Write(transaction.length);
+		NFC_I2C_STATS_STOP(&mark, transaction.length);
+	}
+	else if (transaction.operation == NFC_TRANSPORT_READ && readOpen)
+	{
+		// Master must NACK the last byte before STOP, one byte more ends the read
+		NFC_I2C_STATS_START(&mark);
+		NFC_I2C_Read(1, I2C_LAST_FRAME);
+		NFC_I2C_STATS_STOP(&mark, 1);
+	}
+
+	NFC_Transaction_Close(&transaction);
+	readOpen = false;
+}
+
+NFC_ITCM uint8_t NFC_I2C_GetIRQ(void)
+{
+	if (irqUsed)
+	{
+		return NFC_SPI_GetIRQ();
+	}
+
+	return NFC_I2C_ReadStatus();
+}
+
+void NFC_I2C_GetStats(NFC_I2C_Stats *stats)
+{
+	memcpy(stats, &i2cStats, sizeof(NFC_I2C_Stats));
+}
+
+NFC_ITCM void DMA1_Stream0_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_i2c1_rx);
+}
+
+NFC_ITCM void DMA1_Stream6_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_i2c1_tx);
+}
+
+NFC_ITCM void I2C1_EV_IRQHandler(void)
+{
+	HAL_I2C_EV_IRQHandler(&hi2c);
+}
+
+NFC_ITCM void I2C1_ER_IRQHandler(void)
+{
+	HAL_I2C_ER_IRQHandler(&hi2c);
+}
+
+NFC_ITCM void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *i2cHandle)
+{
+	if (i2cHandle->Instance == I2C1)
+	{
+		NFC_I2C_Complete(false);
+	}
+}
+
+NFC_ITCM void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *i2cHandle)
+{
+	if (i2cHandle->Instance == I2C1)
+	{
+		NFC_I2C_Complete(false);
+	}
+}
+
+NFC_ITCM void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *i2cHandle)
+{
+	if (i2cHandle->Instance == I2C1)
+	{
+		NFC_I2C_Complete(true);
+	}
+}
+
+NFC_ITCM void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *i2cHandle)
+{
+	if (i2cHandle->Instance == I2C1)
+	{
+		NFC_I2C_Complete(true);
+	}
+}
@@ -0,0 +1,220 @@
+/*
+ * NFC_Link.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_Link.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Clock steps from slowest, NFC_SPI_SetPrescaler refuses the ones above NFC_SPI_MAXHZ
+static const uint32_t linkPrescalers[] =
+{
+	SPI_BAUDRATEPRESCALER_64, SPI_BAUDRATEPRESCALER_32, SPI_BAUDRATEPRESCALER_16,
+	SPI_BAUDRATEPRESCALER_8, SPI_BAUDRATEPRESCALER_4
+};
+
+#define NFC_LINK_STEPS	(sizeof(linkPrescalers) / sizeof(linkPrescalers[0]))
+
+/// HSU rates from slowest and their codes of SetSerialBaudRate, PN532 boots at the first one
+static const uint32_t linkBauds[] =
+{
+	115200, 230400, 460800, 921600, 1288000
+};
+
+static const uint8_t linkBaudCodes[] =
+{
+	PN532_HSU_BAUD_115200, PN532_HSU_BAUD_230400, PN532_HSU_BAUD_460800,
+	PN532_HSU_BAUD_921600, PN532_HSU_BAUD_1288000
+};
+
+#define NFC_LINK_BAUDS	(sizeof(linkBauds) / sizeof(linkBauds[0]))
+
+static uint8_t NFC_Link_Test(NFC_Context *context, const uint32_t firmware);
+static uint32_t NFC_Link_CountErrors(NFC_Context *context);
+static uint8_t NFC_Link_SerialBack(NFC_Context *context, const uint8_t step, const uint32_t firmware);
+
+static uint8_t NFC_Link_Test(NFC_Context *context, const uint32_t firmware)
+{
+	uint8_t pattern[NFC_LINK_ECHOSIZE];
+	uint8_t round, i;
+
+	for (round = 0; round < NFC_LINK_ROUNDS; round++)
+	{
+		// Constant levels, alternate bits and a counter, so every bit toggles on wire
+		for (i = 0; i < NFC_LINK_ECHOSIZE; i++)
+		{
+			switch (round & 0x03)
+			{
+			case 0:		pattern[i] = (i & 1) ? 0xFF : 0x00;		break;
+			case 1:		pattern[i] = (i & 1) ? 0xAA : 0x55;		break;
+			case 2:		pattern[i] = (uint8_t)(i * 8 + round);	break;
+			default:	pattern[i] = (uint8_t)~(i * 8 + round);	break;
+			}
+		}
+
+		if (!NFC_Diagnose(context, pattern, NFC_LINK_ECHOSIZE, NFC_LINK_TIMEOUT))
+		{
+			return false;
+		}
+	}
+
+	return NFC_GetFirmwareVersion(context) == firmware ? true : false;
+}
+
+static uint32_t NFC_Link_CountErrors(NFC_Context *context)
+{
+#if NFC_STATS_ENABLE
+	NFC_Stats stats;
+
+	// Copy is retried while the driver updates it
+	while (!NFC_GetStats(context, &stats));
+
+	return stats.ackFailures + stats.frameErrors;
+#else
+	UNUSED(context);
+	return 0;
+#endif
+}
+
+static uint8_t NFC_Link_SerialBack(NFC_Context *context, const uint8_t step, const uint32_t firmware)
+{
+	const uint32_t failed = NFC_HSU_GetBaudRate();
+	uint8_t round;
+
+	// Some frames still pass at the failed rate, PN532 only moves when the answer is acknowledged
+	for (round = 0; round < NFC_LINK_ROUNDS; round++)
+	{
+		if (!NFC_SetSerialBaudRate(context, linkBaudCodes[step]))
+		{
+			continue;
+		}
+
+		NFC_HSU_SetBaudRate(linkBauds[step]);
+
+		if (NFC_GetFirmwareVersion(context) == firmware)
+		{
+			return true;
+		}
+
+		// ACK was lost, PN532 is still at the failed rate
+		NFC_HSU_SetBaudRate(failed);
+	}
+
+	return false;
+}
+
+uint8_t NFC_Link_Calibrate(NFC_Link *link, NFC_Context *context)
+{
+	uint32_t firmware;
+	uint8_t step, limit;
+
+	limit = link->calibrated ? link->maxStep : NFC_LINK_STEPS - 1;
+
+	NFC_SPI_SetPrescaler(linkPrescalers[0]);
+	link->step = 0;
+
+	// Reference answer at the slowest clock
+	firmware = NFC_GetFirmwareVersion(context);
+
+	if (firmware == 0 || !NFC_Link_Test(context, firmware))
+	{
+		return false;
+	}
+
+	for (step = 1; step <= limit; step++)
+	{
+		if (!NFC_SPI_SetPrescaler(linkPrescalers[step]))
+		{
+			break;		// Faster than PN532 supports
+		}
+
+		if (!NFC_Link_Test(context, firmware))
+		{
+			break;
+		}
+
+		link->step = step;
+	}
+
+	NFC_SPI_SetPrescaler(linkPrescalers[link->step]);
+
+	link->maxStep = link->step;
+	link->calibrated = true;
+	link->errors = 0;
+	link->linkErrors[context->device % NFC_SPI_MAXDEVICES] = NFC_Link_CountErrors(context);
+
+	return true;
+}
+
+void NFC_Link_Update(NFC_Link *link, NFC_Context *context)
+{
+	uint32_t errors = NFC_Link_CountErrors(context);
+	uint32_t *last = &link->linkErrors[context->device % NFC_SPI_MAXDEVICES];
+
+	// Counters go back to zero with NFC_ResetStats
+	if (errors <= *last)
+	{
+		*last = errors;
+		link->errors = 0;
+		return;
+	}
+
+	*last = errors;
+
+	if (++link->errors < NFC_LINK_MAXERRORS || link->step == 0)
+	{
+		return;
+	}
+
+	// Stay one step below, a new calibration can raise it again
+	link->step--;
+	link->maxStep = link->step;
+	link->errors = 0;
+	link->fallbacks++;
+	NFC_SPI_SetPrescaler(linkPrescalers[link->step]);
+}
+
+uint8_t NFC_Link_SetSerial(NFC_Context *context, const uint32_t maxBaud)
+{
+	uint32_t firmware;
+	uint8_t step, last = 0;
+
+	NFC_HSU_SetBaudRate(linkBauds[0]);
+
+	// Reference answer at the boot rate
+	firmware = NFC_GetFirmwareVersion(context);
+
+	if (firmware == 0)
+	{
+		return false;
+	}
+
+	for (step = 1; step < NFC_LINK_BAUDS && linkBauds[step] <= maxBaud; step++)
+	{
+		// PN532 keeps its rate when the command was not answered
+		if (!NFC_SetSerialBaudRate(context, linkBaudCodes[step]))
+		{
+			break;
+		}
+
+		NFC_HSU_SetBaudRate(linkBauds[step]);
+
+		if (!NFC_Link_Test(context, firmware))
+		{
+			return NFC_Link_SerialBack(context, last, firmware);
+		}
+
+		last = step;
+	}
+
+	return true;
+}
+
+uint32_t NFC_Link_GetClockHz(const NFC_Link *link)
+{
+	return NFC_SPI_GetClockHz(linkPrescalers[link->step]);
+}
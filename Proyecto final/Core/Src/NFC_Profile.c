@@ -0,0 +1,103 @@
+/*
+ * NFC_Profile.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_Profile.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+
+#if NFC_PROFILE_ENABLE
+
+#define true	(1)
+#define false	(0)
+
+/// Key to unlock write access to ITM registers of Cortex-M7
+#define ITM_LAR_KEY		(0xC5ACCE55)
+
+/// Selected pin protocol of TPI, asynchronous NRZ (UART like)
+#define TPI_SPPR_NRZ	(2)
+
+static uint32_t lastCycles[NFC_PROFILE_DEVICE_MASK + 1];
+static uint32_t dropped = 0;
+
+uint8_t NFC_Profile_Init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+
+	if (!NFC_Timer_Init())
+	{
+		return false;
+	}
+
+	// Keep core clock in sleep mode so DWT counts time waiting in WFI, enable trace pins
+	DBGMCU->CR |= DBGMCU_CR_DBG_SLEEP | DBGMCU_CR_TRACE_IOEN;
+
+	// PB3 as TRACESWO
+	__HAL_RCC_GPIOB_CLK_ENABLE();
+	GPIO_InitStruct.Pin = GPIO_PIN_3;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF0_TRACE;
+	HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+	// SWO clock is derived from core clock, formatter off to send ITM packets as they are
+	TPI->CSPSR = 1;
+	TPI->SPPR = TPI_SPPR_NRZ;
+	TPI->ACPR = (SystemCoreClock / NFC_PROFILE_SWO_HZ) - 1;
+	TPI->FFCR = TPI_FFCR_TrigIn_Msk;
+
+	ITM->LAR = ITM_LAR_KEY;
+	ITM->TCR = (1UL << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk | ITM_TCR_ITMENA_Msk;
+	ITM->TPR = 0;									// Unprivileged code can write the port
+	ITM->TER |= 1UL << NFC_PROFILE_PORT;
+
+	dropped = 0;
+
+	return true;
+}
+
+void NFC_Profile_Mark(const uint8_t device, const uint8_t phase, const uint8_t command)
+{
+	uint32_t now = DWT->CYCCNT;
+	uint32_t payload;
+	uint8_t number = device & NFC_PROFILE_DEVICE_MASK;
+
+	if (phase == NFC_PHASE_START)
+	{
+		payload = command;
+	}
+	else
+	{
+		// Unsigned difference is right also when counter wraps
+		payload = now - lastCycles[number];
+
+		if (payload > NFC_PROFILE_MAXCYCLES)
+		{
+			payload = NFC_PROFILE_MAXCYCLES;
+		}
+	}
+
+	lastCycles[number] = now;
+
+	// Port reads 0 while ITM FIFO is full, the record is dropped instead of waiting
+	if ((ITM->TCR & ITM_TCR_ITMENA_Msk) == 0 || (ITM->TER & (1UL << NFC_PROFILE_PORT)) == 0 ||
+		ITM->PORT[NFC_PROFILE_PORT].u32 == 0)
+	{
+		dropped++;
+		return;
+	}
+
+	ITM->PORT[NFC_PROFILE_PORT].u32 = ((uint32_t)phase << NFC_PROFILE_PHASE_POS) |
+									  ((uint32_t)number << NFC_PROFILE_DEVICE_POS) | payload;
+}
+
+uint32_t NFC_Profile_GetDropped(void)
+{
+	return dropped;
+}
+
+#endif
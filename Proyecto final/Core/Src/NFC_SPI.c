@@ -6,12 +6,45 @@
  */
 
 #include <NFC_SPI.h>
+#include <NFC_Timer.h>
+#include <NFC_TCM.h>
+#include <string.h>
 
 #define true	(1)
 #define false	(0)
 
 SPI_HandleTypeDef hspi;
 
+/// Pins of a PN532 on the bus
+typedef struct
+{
+	GPIO_TypeDef *csPort;
+	uint16_t csPin;
+	GPIO_TypeDef *irqPort;
+	uint16_t irqPin;
+}NFC_SPI_Device;
+
+static NFC_SPI_Device devices[NFC_SPI_MAXDEVICES] =
+{
+	{SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin}
+};
+static uint8_t deviceCount = 1;
+static NFC_SPI_Device *device = &devices[0];
+
+/// Set from EXTI interrupt on falling edge of IRQ pins, one bit by pin
+static volatile uint16_t irqEdges NFC_DTCM = 0;
+
+#if NFC_SPI_STATS_ENABLE
+static NFC_SPI_Stats spiStats;
+static NFC_SPI_IRQStats irqStats;
+static volatile uint64_t irqEdgeWallCycles;
+#define NFC_SPI_STATS_START(mark)			NFC_SPI_StatsStart(mark)
+#define NFC_SPI_STATS_STOP(mark, bytes)		NFC_SPI_StatsStop(&spiStats, mark, bytes)
+#else
+#define NFC_SPI_STATS_START(mark)			((void)(mark))
+#define NFC_SPI_STATS_STOP(mark, bytes)		((void)(mark))
+#endif
+
 uint8_t NFC_SPI_Init(void)
 {
 	hspi.Instance = SPI2;
@@ -21,7 +54,7 @@ uint8_t NFC_SPI_Init(void)
 	hspi.Init.CLKPolarity = SPI_POLARITY_LOW;
 	hspi.Init.CLKPhase = SPI_PHASE_1EDGE;
 	hspi.Init.NSS = SPI_NSS_SOFT;
-	hspi.Init.BaudRatePrescaler = SPI_BAUDRATEPRESCALER_16;
+	hspi.Init.BaudRatePrescaler = NFC_SPI_PRESCALER_BOOT;
 	hspi.Init.FirstBit = SPI_FIRSTBIT_LSB;
 	hspi.Init.TIMode = SPI_TIMODE_DISABLE;
 	hspi.Init.CRCCalculation = SPI_CRCCALCULATION_DISABLE;
@@ -37,6 +70,32 @@ uint8_t NFC_SPI_Init(void)
 	return true;
 }
 
+uint8_t NFC_SPI_SetPrescaler(const uint32_t prescaler)
+{
+	if (NFC_SPI_GetClockHz(prescaler) > NFC_SPI_MAXHZ)
+	{
+		return false;
+	}
+
+	// Baud rate can only be changed while SPI is disabled, HAL enables it again on next transfer
+	__HAL_SPI_DISABLE(&hspi);
+	MODIFY_REG(hspi.Instance->CR1, SPI_CR1_BR, prescaler);
+	hspi.Init.BaudRatePrescaler = prescaler;
+
+	return true;
+}
+
+uint32_t NFC_SPI_GetPrescaler(void)
+{
+	return hspi.Init.BaudRatePrescaler;
+}
+
+uint32_t NFC_SPI_GetClockHz(const uint32_t prescaler)
+{
+	// Field BR divides APB1 clock by 2 << BR
+	return HAL_RCC_GetPCLK1Freq() / (2UL << ((prescaler & SPI_CR1_BR) >> SPI_CR1_BR_Pos));
+}
+
 void HAL_SPI_MspInit(SPI_HandleTypeDef *spiHandle)
 {
 	GPIO_InitTypeDef GPIO_InitStruct = {0};
@@ -90,49 +149,332 @@ void HAL_SPI_MspInit(SPI_HandleTypeDef *spiHandle)
 	    GPIO_InitStruct.Alternate = GPIO_AF5_SPI2;
 	    HAL_GPIO_Init(SPI_MOSI_GPIO_Port, &GPIO_InitStruct);
 
-	    /* Configuration of pin IRQ of NFC */
+	    /* Configuration of pin IRQ of NFC, PN532 pull it down when a frame is ready */
 	    GPIO_InitStruct.Pin = NFC_IRQ_Pin;
-	    GPIO_InitStruct.Mode = GPIO_MODE_INPUT;
+	    GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
 	    GPIO_InitStruct.Pull = GPIO_NOPULL;
 	    HAL_GPIO_Init(NFC_IRQ_GPIO_Port, &GPIO_InitStruct);
+
+	    HAL_NVIC_SetPriority(NFC_IRQ_EXTI_IRQn, 1, 0);
+	    HAL_NVIC_EnableIRQ(NFC_IRQ_EXTI_IRQn);
 	}
 }
 
-uint8_t NFC_SPI_GetByte(void)
+NFC_ITCM uint8_t NFC_SPI_GetByte(void)
 {
 	uint8_t byte = 0x00;
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_STATS_START(&mark);
 
 	while (HAL_SPI_GetState(&hspi) != HAL_SPI_STATE_READY); 			//Is possble receive?
 	HAL_SPI_Receive(&hspi, &byte, 1, SPI_NFC_TIMEOUT_RECEPTION);
 
+	NFC_SPI_STATS_STOP(&mark, 1);
+
 	return byte;
 }
 
-void NFC_SPI_SendByte(const uint8_t byte)
+NFC_ITCM void NFC_SPI_SendByte(const uint8_t byte)
 {
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_STATS_START(&mark);
+
 	while (HAL_SPI_GetState(&hspi) != HAL_SPI_STATE_READY); 					//Is possble transmit?
 	HAL_SPI_Transmit(&hspi, (uint8_t *)&byte, 1, SPI_NFC_TIMEOUT_TRANSMISSION);	// send 8 bits of data
 	while (HAL_SPI_GetState(&hspi) == HAL_SPI_STATE_BUSY);						//Transmission ready?
+
+	NFC_SPI_STATS_STOP(&mark, 1);
+}
+
+NFC_ITCM void NFC_SPI_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_STATS_START(&mark);
+
+	while (HAL_SPI_GetState(&hspi) != HAL_SPI_STATE_READY); 			//Is possble receive?
+	HAL_SPI_Receive(&hspi, buffer, (uint16_t)length, SPI_NFC_TIMEOUT_RECEPTION);
+
+	NFC_SPI_STATS_STOP(&mark, length);
 }
 
-void NFC_SPI_SetSelect(const uint8_t state)
+NFC_ITCM void NFC_SPI_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_STATS_START(&mark);
+
+	while (HAL_SPI_GetState(&hspi) != HAL_SPI_STATE_READY); 								//Is possble transmit?
+	HAL_SPI_Transmit(&hspi, (uint8_t *)buffer, (uint16_t)length, SPI_NFC_TIMEOUT_TRANSMISSION);	// send whole frame
+	while (HAL_SPI_GetState(&hspi) == HAL_SPI_STATE_BUSY);									//Transmission ready?
+
+	NFC_SPI_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_SPI_SetSelect(const uint8_t state)
 {
 	if (state)
 	{
-		HAL_GPIO_WritePin(SPI_CS_GPIO_Port, SPI_CS_Pin, GPIO_PIN_RESET);
+		HAL_GPIO_WritePin(device->csPort, device->csPin, GPIO_PIN_RESET);
 	}
 	else
 	{
-		HAL_GPIO_WritePin(SPI_CS_GPIO_Port, SPI_CS_Pin, GPIO_PIN_SET);
+		HAL_GPIO_WritePin(device->csPort, device->csPin, GPIO_PIN_SET);
+	}
+}
+
+NFC_ITCM uint8_t NFC_SPI_GetIRQ(void)
+{
+	if ( HAL_GPIO_ReadPin(device->irqPort, device->irqPin) == GPIO_PIN_SET )
+	{
+		return false;
+	}
+
+	return true;
+}
+
+NFC_ITCM uint8_t NFC_SPI_WaitIRQ(const uint32_t timeout)
+{
+	uint32_t startTick = HAL_GetTick();
+	const uint16_t pin = device->irqPin;
+	uint8_t ready, edge;
+#if NFC_SPI_STATS_ENABLE
+	NFC_SPI_StatsMark mark;
+	uint64_t wakeup;
+
+	NFC_SPI_StatsStart(&mark);
+#endif
+
+	// Flags of other devices are set from interrupt, clear only this one
+	__disable_irq();
+	irqEdges &= ~pin;
+	__enable_irq();
+
+	// Signal could be already active, edge was before clearing flag
+	ready = NFC_SPI_GetIRQ();
+
+	/* Interrupts are masked while the flag is tested, so the edge can not happen
+	 * between the test and WFI. A pending interrupt still wakes up the core,
+	 * SysTick wakes it every mS to check timeout. */
+	__disable_irq();
+	while (!ready && !(irqEdges & pin))
+	{
+		if (HAL_GetTick() - startTick >= timeout)
+		{
+			break;
+		}
+
+		__WFI();
+		__enable_irq();
+		__disable_irq();
 	}
+	__enable_irq();
+
+	edge = (irqEdges & pin) ? true : false;
+	ready = ready || edge || NFC_SPI_GetIRQ();
+
+#if NFC_SPI_STATS_ENABLE
+	if (edge)
+	{
+		wakeup = NFC_Timer_GetWallCycles() - irqEdgeWallCycles;
+		irqStats.wakeupCycles += wakeup;
+		irqStats.wakeups++;
+
+		if (wakeup > irqStats.wakeupMaxCycles)
+		{
+			irqStats.wakeupMaxCycles = (uint32_t)wakeup;
+		}
+	}
+
+	irqStats.activeCycles += NFC_Timer_GetCycles() - mark.cycles;
+	irqStats.elapsedCycles += NFC_Timer_GetWallCycles() - mark.wallCycles;
+	irqStats.timeouts += ready ? 0 : 1;
+	irqStats.waits++;
+#endif
+
+	return ready;
 }
 
-uint8_t NFC_SPI_GetIRQ(void)
+uint8_t NFC_SPI_AddDevice(GPIO_TypeDef *csPort, const uint16_t csPin, GPIO_TypeDef *irqPort, const uint16_t irqPin, uint8_t *number)
 {
-	if ( HAL_GPIO_ReadPin(NFC_IRQ_GPIO_Port, NFC_IRQ_Pin) == GPIO_PIN_SET )
+	GPIO_InitTypeDef GPIO_InitStruct = {0};
+	uint8_t i;
+
+	if (deviceCount >= NFC_SPI_MAXDEVICES)
+	{
+		return false;
+	}
+
+	// Only EXTI9_5 and EXTI15_10 handlers serve the IRQ pins, one pin at once
+	if (irqPin < GPIO_PIN_5 || (irqPin & (irqPin - 1)) != 0)
 	{
 		return false;
 	}
 
+	for (i = 0; i < deviceCount; i++)
+	{
+		if (devices[i].irqPin == irqPin)
+		{
+			return false;
+		}
+	}
+
+	// GPIO ports are 1 KB apart and their clock bits follow the same order
+	RCC->AHB1ENR |= 1UL << (((uintptr_t)csPort - GPIOA_BASE) / 0x400UL);
+	RCC->AHB1ENR |= 1UL << (((uintptr_t)irqPort - GPIOA_BASE) / 0x400UL);
+	(void)RCC->AHB1ENR;
+
+	/* Configuration pin of CS, not selected */
+	HAL_GPIO_WritePin(csPort, csPin, GPIO_PIN_SET);
+
+	GPIO_InitStruct.Pin = csPin;
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	HAL_GPIO_Init(csPort, &GPIO_InitStruct);
+
+	/* Configuration of pin IRQ, PN532 pull it down when a frame is ready */
+	GPIO_InitStruct.Pin = irqPin;
+	GPIO_InitStruct.Mode = GPIO_MODE_IT_FALLING;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	HAL_GPIO_Init(irqPort, &GPIO_InitStruct);
+
+	if (irqPin <= GPIO_PIN_9)
+	{
+		HAL_NVIC_SetPriority(EXTI9_5_IRQn, 1, 0);
+		HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+	}
+	else
+	{
+		HAL_NVIC_SetPriority(EXTI15_10_IRQn, 1, 0);
+		HAL_NVIC_EnableIRQ(EXTI15_10_IRQn);
+	}
+
+	devices[deviceCount].csPort = csPort;
+	devices[deviceCount].csPin = csPin;
+	devices[deviceCount].irqPort = irqPort;
+	devices[deviceCount].irqPin = irqPin;
+	*number = deviceCount++;
+
 	return true;
 }
+
+NFC_ITCM void NFC_SPI_SetDevice(const uint8_t number)
+{
+	if (number < deviceCount)
+	{
+		device = &devices[number];
+	}
+}
+
+NFC_ITCM void NFC_SPI_GetSelectPin(GPIO_TypeDef **port, uint16_t *pin)
+{
+	*port = device->csPort;
+	*pin = device->csPin;
+}
+
+NFC_ITCM void NFC_SPI_Idle(void)
+{
+	// Same masked test as NFC_SPI_WaitIRQ, an edge can not be lost before WFI
+	__disable_irq();
+	if (irqEdges == 0)
+	{
+		__WFI();
+	}
+	irqEdges = 0;
+	__enable_irq();
+}
+
+NFC_ITCM void NFC_SPI_Sleep(void)
+{
+	// Nothing is timed while readers wait without limit, SysTick would only wake the core
+	__disable_irq();
+	if (irqEdges == 0)
+	{
+		HAL_SuspendTick();
+		__WFI();
+		HAL_ResumeTick();
+	}
+	irqEdges = 0;
+	__enable_irq();
+}
+
+NFC_ITCM void NFC_SPI_IRQHandler(void)
+{
+	uint8_t i;
+
+	// HAL handler only serves the line when its pending flag is set
+	for (i = 0; i < deviceCount; i++)
+	{
+		HAL_GPIO_EXTI_IRQHandler(devices[i].irqPin);
+	}
+}
+
+NFC_ITCM void EXTI9_5_IRQHandler(void)
+{
+	NFC_SPI_IRQHandler();
+}
+
+NFC_ITCM void EXTI15_10_IRQHandler(void)
+{
+	NFC_SPI_IRQHandler();
+}
+
+NFC_ITCM void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		if (GPIO_Pin == devices[i].irqPin)
+		{
+#if NFC_SPI_STATS_ENABLE
+			irqEdgeWallCycles = NFC_Timer_GetWallCycles();
+#endif
+			irqEdges |= GPIO_Pin;
+			return;
+		}
+	}
+}
+
+void NFC_SPI_GetIRQStats(NFC_SPI_IRQStats *stats)
+{
+#if NFC_SPI_STATS_ENABLE
+	memcpy(stats, &irqStats, sizeof(NFC_SPI_IRQStats));
+#else
+	memset(stats, 0, sizeof(NFC_SPI_IRQStats));
+#endif
+}
+
+void NFC_SPI_GetStats(NFC_SPI_Stats *stats)
+{
+#if NFC_SPI_STATS_ENABLE
+	memcpy(stats, &spiStats, sizeof(NFC_SPI_Stats));
+#else
+	memset(stats, 0, sizeof(NFC_SPI_Stats));
+#endif
+}
+
+void NFC_SPI_ResetStats(void)
+{
+#if NFC_SPI_STATS_ENABLE
+	memset(&spiStats, 0, sizeof(NFC_SPI_Stats));
+	memset(&irqStats, 0, sizeof(NFC_SPI_IRQStats));
+#endif
+}
+
+void NFC_SPI_StatsStart(NFC_SPI_StatsMark *mark)
+{
+	mark->cycles = NFC_Timer_GetCycles();
+	mark->wallCycles = NFC_Timer_GetWallCycles();
+}
+
+void NFC_SPI_StatsStop(NFC_SPI_Stats *stats, const NFC_SPI_StatsMark *mark, const size_t bytes)
+{
+	stats->activeCycles += NFC_Timer_GetCycles() - mark->cycles;
+	stats->elapsedCycles += NFC_Timer_GetWallCycles() - mark->wallCycles;
+	stats->bytes += bytes;
+	stats->transfers++;
+}
@@ -0,0 +1,325 @@
+/*
+ * NFC_SPI_DMA.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_SPI_DMA.h>
+#include <NFC_TCM.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// States of the DMA transfer
+#define NFC_SPI_DMA_IDLE	(0)
+#define NFC_SPI_DMA_BUSY	(1)
+#define NFC_SPI_DMA_ERROR	(2)
+
+DMA_HandleTypeDef hdma_spi2_rx;
+DMA_HandleTypeDef hdma_spi2_tx;
+
+/// Both DMA buffers, in one block so a single MPU region covers them
+typedef struct
+{
+	uint8_t tx[NFC_SPI_DMA_BUFFERSIZE];
+	uint8_t rx[NFC_SPI_DMA_BUFFERSIZE];
+}NFC_SPI_DMA_Buffers;
+
+/* DMA reads and writes memory behind the D-cache. Buffers take whole cache
+ * lines, so clean and invalidate operations never touch other variables. The
+ * block is aligned to its MPU region, which needs base aligned to its size. */
+static NFC_SPI_DMA_Buffers dmaBuffers NFC_DTCM __attribute__((aligned(NFC_SPI_DMA_REGIONSIZE)));
+static uint8_t * const dmaTxBuffer = dmaBuffers.tx;
+static uint8_t * const dmaRxBuffer = dmaBuffers.rx;
+static volatile uint8_t dmaState NFC_DTCM = NFC_SPI_DMA_IDLE;
+static uint8_t dmaUncached = false;
+
+#if NFC_SPI_STATS_ENABLE
+static NFC_SPI_Stats dmaStats;
+#define NFC_SPI_DMA_STATS_START(mark)			NFC_SPI_StatsStart(mark)
+#define NFC_SPI_DMA_STATS_STOP(mark, bytes)		NFC_SPI_StatsStop(&dmaStats, mark, bytes)
+#define NFC_SPI_DMA_STATS_ERROR()				(dmaStats.errors++)
+#else
+#define NFC_SPI_DMA_STATS_START(mark)			((void)(mark))
+#define NFC_SPI_DMA_STATS_STOP(mark, bytes)		((void)(mark))
+#define NFC_SPI_DMA_STATS_ERROR()				((void)0)
+#endif
+
+static void NFC_SPI_DMA_CleanCache(uint8_t *buffer, size_t length);
+static void NFC_SPI_DMA_InvalidateCache(uint8_t *buffer, size_t length);
+static uint8_t NFC_SPI_DMA_Done(void);
+static void NFC_SPI_DMA_Wait(void);
+static uint8_t NFC_SPI_DMA_Transfer(const uint8_t *txData, uint8_t *rxData, size_t length);
+static void NFC_SPI_DMA_Complete(uint8_t error);
+
+NFC_ITCM static void NFC_SPI_DMA_CleanCache(uint8_t *buffer, size_t length)
+{
+	// Buffers in an uncached MPU region need no maintenance
+	if (!dmaUncached)
+	{
+		NFC_Transport_CleanCache(buffer, length);
+	}
+}
+
+NFC_ITCM static void NFC_SPI_DMA_InvalidateCache(uint8_t *buffer, size_t length)
+{
+	// Buffers in an uncached MPU region need no maintenance
+	if (!dmaUncached)
+	{
+		NFC_Transport_InvalidateCache(buffer, length);
+	}
+}
+
+NFC_ITCM static uint8_t NFC_SPI_DMA_Done(void)
+{
+	return (dmaState != NFC_SPI_DMA_BUSY) ? true : false;
+}
+
+NFC_ITCM static void NFC_SPI_DMA_Wait(void)
+{
+	NFC_Transport_Wait(&NFC_SPI_DMA_Done, SPI_NFC_TIMEOUT_TRANSMISSION);
+
+	// Transfer never finished, stop streams to release the SPI
+	if (dmaState == NFC_SPI_DMA_BUSY)
+	{
+		HAL_SPI_Abort(&hspi);
+		dmaState = NFC_SPI_DMA_ERROR;
+	}
+}
+
+NFC_ITCM static uint8_t NFC_SPI_DMA_Transfer(const uint8_t *txData, uint8_t *rxData, size_t length)
+{
+	HAL_StatusTypeDef status;
+	size_t chunk;
+
+	// Chip select is driven by caller, so long buffers can be split in chunks
+	while (length > 0)
+	{
+		chunk = (length > NFC_SPI_DMA_BUFFERSIZE) ? NFC_SPI_DMA_BUFFERSIZE : length;
+
+		// PN532 ignores MOSI while data is read, dummy bytes are zero
+		if (txData != NULL)
+		{
+			memcpy(dmaTxBuffer, txData, chunk);
+		}
+		else
+		{
+			memset(dmaTxBuffer, 0x00, chunk);
+		}
+
+		// Write data to memory before DMA read it
+		NFC_SPI_DMA_CleanCache(dmaTxBuffer, chunk);
+
+		while (HAL_SPI_GetState(&hspi) != HAL_SPI_STATE_READY);	//Is possble transmit?
+
+		dmaState = NFC_SPI_DMA_BUSY;
+
+		if (rxData != NULL)
+		{
+			// Drop lines of receive buffer, so no dirty line is evicted over DMA data
+			NFC_SPI_DMA_InvalidateCache(dmaRxBuffer, chunk);
+			status = HAL_SPI_TransmitReceive_DMA(&hspi, dmaTxBuffer, dmaRxBuffer, (uint16_t)chunk);
+		}
+		else
+		{
+			status = HAL_SPI_Transmit_DMA(&hspi, dmaTxBuffer, (uint16_t)chunk);
+		}
+
+		if (status != HAL_OK)
+		{
+			dmaState = NFC_SPI_DMA_IDLE;
+			return false;
+		}
+
+		NFC_SPI_DMA_Wait();
+
+		if (dmaState != NFC_SPI_DMA_IDLE)
+		{
+			dmaState = NFC_SPI_DMA_IDLE;
+			return false;
+		}
+
+		if (rxData != NULL)
+		{
+			// Lines could be speculatively read during transfer, read memory again
+			NFC_SPI_DMA_InvalidateCache(dmaRxBuffer, chunk);
+			memcpy(rxData, dmaRxBuffer, chunk);
+			rxData += chunk;
+		}
+
+		if (txData != NULL)
+		{
+			txData += chunk;
+		}
+
+		length -= chunk;
+	}
+
+	return true;
+}
+
+NFC_ITCM static void NFC_SPI_DMA_Complete(uint8_t error)
+{
+	dmaState = error ? NFC_SPI_DMA_ERROR : NFC_SPI_DMA_IDLE;
+	NFC_SPI_DMA_TransferCpltCallback(error);
+}
+
+void NFC_SPI_DMA_ConfigMPU(const uint8_t number)
+{
+	MPU_Region_InitTypeDef MPU_InitStruct = {0};
+
+	// TEX 1 without C and B is normal non-cacheable memory, CPU and DMA see the same data
+	MPU_InitStruct.Enable = MPU_REGION_ENABLE;
+	MPU_InitStruct.Number = number;
+	MPU_InitStruct.BaseAddress = (uint32_t)(uintptr_t)&dmaBuffers;
+	MPU_InitStruct.Size = MPU_REGION_SIZE_1KB;
+	MPU_InitStruct.SubRegionDisable = 0x00;
+	MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+	MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+	MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+	MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+	MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+	MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+
+	HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+	dmaUncached = true;
+}
+
+uint8_t NFC_SPI_DMA_Init(void)
+{
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	/* SPI2_RX Init */
+	hdma_spi2_rx.Instance = NFC_SPI_DMA_RX_STREAM;
+	hdma_spi2_rx.Init.Channel = NFC_SPI_DMA_RX_CHANNEL;
+	hdma_spi2_rx.Init.Direction = DMA_PERIPH_TO_MEMORY;
+	hdma_spi2_rx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi2_rx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi2_rx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi2_rx.Init.Mode = DMA_NORMAL;
+	hdma_spi2_rx.Init.Priority = DMA_PRIORITY_VERY_HIGH;		// Reception first to avoid overrun
+	hdma_spi2_rx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_spi2_rx) != HAL_OK)
+	{
+		return false;
+	}
+
+	__HAL_LINKDMA(&hspi, hdmarx, hdma_spi2_rx);
+
+	/* SPI2_TX Init */
+	hdma_spi2_tx.Instance = NFC_SPI_DMA_TX_STREAM;
+	hdma_spi2_tx.Init.Channel = NFC_SPI_DMA_TX_CHANNEL;
+	hdma_spi2_tx.Init.Direction = DMA_MEMORY_TO_PERIPH;
+	hdma_spi2_tx.Init.PeriphInc = DMA_PINC_DISABLE;
+	hdma_spi2_tx.Init.MemInc = DMA_MINC_ENABLE;
+	hdma_spi2_tx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+	hdma_spi2_tx.Init.MemDataAlignment = DMA_MDATAALIGN_BYTE;
+	hdma_spi2_tx.Init.Mode = DMA_NORMAL;
+	hdma_spi2_tx.Init.Priority = DMA_PRIORITY_HIGH;
+	hdma_spi2_tx.Init.FIFOMode = DMA_FIFOMODE_DISABLE;
+
+	if (HAL_DMA_Init(&hdma_spi2_tx) != HAL_OK)
+	{
+		return false;
+	}
+
+	__HAL_LINKDMA(&hspi, hdmatx, hdma_spi2_tx);
+
+	/* DMA and SPI error interrupts */
+	HAL_NVIC_SetPriority(NFC_SPI_DMA_RX_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(NFC_SPI_DMA_RX_IRQn);
+	HAL_NVIC_SetPriority(NFC_SPI_DMA_TX_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(NFC_SPI_DMA_TX_IRQn);
+	HAL_NVIC_SetPriority(SPI2_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(SPI2_IRQn);
+
+	return true;
+}
+
+NFC_ITCM void NFC_SPI_DMA_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_DMA_STATS_START(&mark);
+
+	// Frame check of a failed read must fail, never use stale data
+	if (!NFC_SPI_DMA_Transfer(NULL, buffer, length))
+	{
+		memset(buffer, 0x00, length);
+		NFC_SPI_DMA_STATS_ERROR();
+	}
+
+	NFC_SPI_DMA_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_SPI_DMA_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_DMA_STATS_START(&mark);
+
+	if (!NFC_SPI_DMA_Transfer(buffer, NULL, length))
+	{
+		NFC_SPI_DMA_STATS_ERROR();
+	}
+
+	NFC_SPI_DMA_STATS_STOP(&mark, length);
+}
+
+void NFC_SPI_DMA_GetStats(NFC_SPI_Stats *stats)
+{
+#if NFC_SPI_STATS_ENABLE
+	memcpy(stats, &dmaStats, sizeof(NFC_SPI_Stats));
+#else
+	memset(stats, 0, sizeof(NFC_SPI_Stats));
+#endif
+}
+
+NFC_ITCM void DMA1_Stream3_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi2_rx);
+}
+
+NFC_ITCM void DMA1_Stream4_IRQHandler(void)
+{
+	HAL_DMA_IRQHandler(&hdma_spi2_tx);
+}
+
+NFC_ITCM void SPI2_IRQHandler(void)
+{
+	HAL_SPI_IRQHandler(&hspi);
+}
+
+__weak void NFC_SPI_DMA_TransferCpltCallback(uint8_t error)
+{
+	UNUSED(error);
+}
+
+NFC_ITCM void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *spiHandle)
+{
+	if (spiHandle->Instance == SPI2)
+	{
+		NFC_SPI_DMA_Complete(false);
+	}
+}
+
+NFC_ITCM void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *spiHandle)
+{
+	if (spiHandle->Instance == SPI2)
+	{
+		NFC_SPI_DMA_Complete(false);
+	}
+}
+
+NFC_ITCM void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *spiHandle)
+{
+	if (spiHandle->Instance == SPI2)
+	{
+		NFC_SPI_DMA_Complete(true);
+	}
+}
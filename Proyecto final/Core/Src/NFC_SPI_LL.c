@@ -0,0 +1,217 @@
+/*
+ * NFC_SPI_LL.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_SPI_LL.h>
+#include <NFC_TCM.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Chip select of current device, cached so each select is one store
+static GPIO_TypeDef *csPort NFC_DTCM;
+static uint32_t csPin NFC_DTCM;
+
+#if NFC_SPI_STATS_ENABLE
+static NFC_SPI_Stats llStats;
+#define NFC_SPI_LL_STATS_START(mark)			NFC_SPI_StatsStart(mark)
+#define NFC_SPI_LL_STATS_STOP(mark, bytes)		NFC_SPI_StatsStop(&llStats, mark, bytes)
+#define NFC_SPI_LL_STATS_ERROR()				(llStats.errors++)
+#else
+#define NFC_SPI_LL_STATS_START(mark)			((void)(mark))
+#define NFC_SPI_LL_STATS_STOP(mark, bytes)		((void)(mark))
+#define NFC_SPI_LL_STATS_ERROR()				((void)0)
+#endif
+
+static void NFC_SPI_LL_Abort(SPI_TypeDef *spi);
+static uint8_t NFC_SPI_LL_Transfer(const uint8_t *txData, uint8_t *rxData, size_t length);
+
+/* Procedure of reference manual to disable SPI: TX FIFO is emptied and the last
+ * frame is clocked out before SPE is cleared, then RX FIFO is read until empty.
+ * Next transfer starts with both FIFOs empty and enables SPI again. */
+NFC_ITCM static void NFC_SPI_LL_Abort(SPI_TypeDef *spi)
+{
+	volatile uint8_t *data = (volatile uint8_t *)&spi->DR;
+	uint32_t startTick = HAL_GetTick();
+
+	while ((spi->SR & (SPI_SR_FTLVL | SPI_SR_BSY)) && HAL_GetTick() - startTick < SPI_NFC_TIMEOUT_TRANSMISSION)
+	{
+		// RX FIFO keeps room for the frames still in flight
+		if (spi->SR & SPI_SR_RXNE)
+		{
+			(void)*data;
+		}
+	}
+
+	spi->CR1 &= ~SPI_CR1_SPE;
+
+	while (spi->SR & (SPI_SR_FRLVL | SPI_SR_RXNE))
+	{
+		(void)*data;
+	}
+}
+
+NFC_ITCM static uint8_t NFC_SPI_LL_Transfer(const uint8_t *txData, uint8_t *rxData, size_t length)
+{
+	SPI_TypeDef *spi = hspi.Instance;
+	volatile uint8_t *data = (volatile uint8_t *)&spi->DR;	// 8 bit access moves one byte of FIFO
+	size_t sent = 0, received = 0;
+	uint32_t startTick = HAL_GetTick();
+	uint8_t byte;
+
+	// HAL clears FRXTH to read 16 bits at once, NFC_SPI_SetPrescaler leaves SPI disabled
+	if ((spi->CR2 & SPI_CR2_FRXTH) == 0)
+	{
+		spi->CR2 |= SPI_CR2_FRXTH;
+	}
+
+	if ((spi->CR1 & SPI_CR1_SPE) == 0)
+	{
+		spi->CR1 |= SPI_CR1_SPE;
+	}
+
+	while (received < length)
+	{
+		// Every byte written is read back, so RX FIFO never overruns
+		if (sent < length && (sent - received) < NFC_SPI_LL_INFLIGHT && (spi->SR & SPI_SR_TXE))
+		{
+			*data = (txData != NULL) ? txData[sent] : 0x00;		// PN532 ignores MOSI while data is read
+			sent++;
+		}
+
+		if (spi->SR & SPI_SR_RXNE)
+		{
+			byte = *data;
+			if (rxData != NULL)
+			{
+				rxData[received] = byte;
+			}
+			received++;
+		}
+		else if (HAL_GetTick() - startTick >= SPI_NFC_TIMEOUT_TRANSMISSION)
+		{
+			// Bytes left in FIFOs would shift every later transfer
+			NFC_SPI_LL_Abort(spi);
+
+			// Frame check of a failed read must fail, never use stale data
+			if (rxData != NULL)
+			{
+				memset(rxData, 0x00, length);
+			}
+
+			return false;
+		}
+	}
+
+	// Last clock edge is done before chip select can be released
+	while (spi->SR & SPI_SR_BSY);
+
+	return true;
+}
+
+uint8_t NFC_SPI_LL_Init(void)
+{
+	SPI_TypeDef *spi = hspi.Instance;
+	uint16_t pin;
+
+	if (spi == NULL)
+	{
+		return false;
+	}
+
+	// RXNE on each received byte instead of each 16 bits
+	spi->CR2 |= SPI_CR2_FRXTH;
+	spi->CR1 |= SPI_CR1_SPE;
+
+	NFC_SPI_GetSelectPin(&csPort, &pin);
+	csPin = pin;
+
+	return true;
+}
+
+NFC_ITCM uint8_t NFC_SPI_LL_GetByte(void)
+{
+	uint8_t byte = 0x00;
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_LL_STATS_START(&mark);
+
+	if (!NFC_SPI_LL_Transfer(NULL, &byte, 1))
+	{
+		NFC_SPI_LL_STATS_ERROR();
+	}
+
+	NFC_SPI_LL_STATS_STOP(&mark, 1);
+
+	return byte;
+}
+
+NFC_ITCM void NFC_SPI_LL_SendByte(uint8_t byte)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_LL_STATS_START(&mark);
+
+	if (!NFC_SPI_LL_Transfer(&byte, NULL, 1))
+	{
+		NFC_SPI_LL_STATS_ERROR();
+	}
+
+	NFC_SPI_LL_STATS_STOP(&mark, 1);
+}
+
+NFC_ITCM void NFC_SPI_LL_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_LL_STATS_START(&mark);
+
+	if (!NFC_SPI_LL_Transfer(NULL, buffer, length))
+	{
+		NFC_SPI_LL_STATS_ERROR();
+	}
+
+	NFC_SPI_LL_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_SPI_LL_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	NFC_SPI_StatsMark mark;
+
+	NFC_SPI_LL_STATS_START(&mark);
+
+	if (!NFC_SPI_LL_Transfer(buffer, NULL, length))
+	{
+		NFC_SPI_LL_STATS_ERROR();
+	}
+
+	NFC_SPI_LL_STATS_STOP(&mark, length);
+}
+
+NFC_ITCM void NFC_SPI_LL_SetSelect(uint8_t state)
+{
+	// Low half of BSRR sets the pin, high half resets it, chip select is active low
+	csPort->BSRR = state ? (csPin << 16) : csPin;
+}
+
+NFC_ITCM void NFC_SPI_LL_SetDevice(uint8_t number)
+{
+	uint16_t pin;
+
+	NFC_SPI_SetDevice(number);
+	NFC_SPI_GetSelectPin(&csPort, &pin);
+	csPin = pin;
+}
+
+void NFC_SPI_LL_GetStats(NFC_SPI_Stats *stats)
+{
+#if NFC_SPI_STATS_ENABLE
+	memcpy(stats, &llStats, sizeof(NFC_SPI_Stats));
+#else
+	memset(stats, 0, sizeof(NFC_SPI_Stats));
+#endif
+}
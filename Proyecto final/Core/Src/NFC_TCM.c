@@ -0,0 +1,35 @@
+/*
+ * NFC_TCM.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_TCM.h"
+
+#if NFC_TCM_ENABLE
+/// Symbols of linker script, see NFC_TCM.h
+extern uint32_t _siitcm, _sitcm, _eitcm, _sdtcm, _edtcm;
+#endif
+
+void NFC_TCM_Init(void)
+{
+#if NFC_TCM_ENABLE
+	const uint32_t *source = &_siitcm;
+	uint32_t *destination;
+
+	for (destination = &_sitcm; destination < &_eitcm; destination++)
+	{
+		*destination = *source++;
+	}
+
+	for (destination = &_sdtcm; destination < &_edtcm; destination++)
+	{
+		*destination = 0;
+	}
+
+	// TCM is not cached, code is fetched from it once writes are done
+	__DSB();
+	__ISB();
+#endif
+}
@@ -0,0 +1,138 @@
+/*
+ * NFC_Timer.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_Timer.h>
+#include <NFC_TCM.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Key to unlock write access to DWT registers of Cortex-M7
+#define DWT_LAR_KEY		(0xC5ACCE55)
+
+/// Longest one-shot of TIM7 in uS, its counter has 16 bits
+#define NFC_TIMER_SHOTUS	(0x10000UL)
+
+/// Set from TIM7 interrupt when the one-shot of NFC_Timer_SleepUs ends
+static volatile uint8_t timerFired;
+
+uint8_t NFC_Timer_Init(void)
+{
+	uint32_t clock = HAL_RCC_GetPCLK1Freq();
+
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;	// Enable trace and debug blocks
+	DWT->LAR = DWT_LAR_KEY;							// Cortex-M7 lock DWT after reset
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+	// Timers of APB1 run at twice PCLK1 when APB1 is divided
+	if ((RCC->CFGR & RCC_CFGR_PPRE1) != 0)
+	{
+		clock *= 2;
+	}
+
+	/* TIM7 counts uS in one pulse mode, it stops itself at the update. Only
+	 * overflow updates, the prescaler is loaded without an interrupt. */
+	RCC->APB1ENR |= RCC_APB1ENR_TIM7EN;
+	(void)RCC->APB1ENR;
+	TIM7->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+	TIM7->PSC = clock / 1000000 - 1;
+	TIM7->EGR = TIM_EGR_UG;
+	TIM7->SR = 0;
+	TIM7->DIER = TIM_DIER_UIE;
+
+	HAL_NVIC_SetPriority(TIM7_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(TIM7_IRQn);
+
+	// Counter is not implemented when bit is read back as zero
+	if ((DWT->CTRL & DWT_CTRL_CYCCNTENA_Msk) == 0)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+NFC_ITCM uint32_t NFC_Timer_GetCycles(void)
+{
+	return DWT->CYCCNT;
+}
+
+NFC_ITCM uint64_t NFC_Timer_GetWallCycles(void)
+{
+	uint32_t tick, value, load;
+
+	load = SysTick->LOAD + 1;
+
+	// Read again when the tick interrupt happened in the middle of the reading
+	do
+	{
+		tick = HAL_GetTick();
+		value = SysTick->VAL;
+	} while (tick != HAL_GetTick());
+
+	// Each SysTick period adds uwTickFreq mS to the HAL tick
+	return ((uint64_t)tick * load / uwTickFreq) + (load - 1 - value);
+}
+
+NFC_ITCM uint32_t NFC_Timer_GetUs(void)
+{
+	return NFC_Timer_CyclesToUs(NFC_Timer_GetWallCycles());
+}
+
+NFC_ITCM void NFC_Timer_DelayUs(const uint32_t us)
+{
+	uint32_t start = DWT->CYCCNT;
+	uint32_t cycles = us * (SystemCoreClock / 1000000);
+
+	// Unsigned difference is right also when counter wraps
+	while (DWT->CYCCNT - start < cycles);
+}
+
+NFC_ITCM void NFC_Timer_SleepUs(const uint32_t us)
+{
+	uint32_t left = us, shot;
+
+	// Waking up costs more than a short wait
+	if (us < NFC_TIMER_SLEEP_MINUS)
+	{
+		NFC_Timer_DelayUs(us);
+		return;
+	}
+
+	while (left > 0)
+	{
+		shot = (left > NFC_TIMER_SHOTUS) ? NFC_TIMER_SHOTUS : left;
+		left -= shot;
+
+		timerFired = false;
+		TIM7->CNT = 0;
+		TIM7->ARR = shot - 1;
+		TIM7->CR1 |= TIM_CR1_CEN;
+
+		// Same masked test as NFC_SPI_WaitIRQ, SysTick and other interrupts wake up the core before
+		__disable_irq();
+		while (!timerFired)
+		{
+			__WFI();
+			__enable_irq();
+			__disable_irq();
+		}
+		__enable_irq();
+	}
+}
+
+NFC_ITCM void TIM7_IRQHandler(void)
+{
+	TIM7->SR = 0;
+	timerFired = true;
+}
+
+uint32_t NFC_Timer_CyclesToUs(const uint64_t cycles)
+{
+	return (uint32_t)(cycles / (SystemCoreClock / 1000000));
+}
@@ -0,0 +1,125 @@
+/*
+ * NFC_Transport.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <NFC_Transport.h>
+#include <NFC_TCM.h>
+#include <NFC.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+NFC_ITCM void NFC_Transport_CleanCache(uint8_t *buffer, size_t length)
+{
+	// Maintenance is only needed while D-cache is enabled
+	if (SCB->CCR & SCB_CCR_DC_Msk)
+	{
+		length = (length + NFC_TRANSPORT_CACHELINE - 1) & ~(NFC_TRANSPORT_CACHELINE - 1);
+		SCB_CleanDCache_by_Addr((uint32_t *)buffer, (int32_t)length);
+	}
+}
+
+NFC_ITCM void NFC_Transport_InvalidateCache(uint8_t *buffer, size_t length)
+{
+	if (SCB->CCR & SCB_CCR_DC_Msk)
+	{
+		length = (length + NFC_TRANSPORT_CACHELINE - 1) & ~(NFC_TRANSPORT_CACHELINE - 1);
+		SCB_InvalidateDCache_by_Addr((uint32_t *)buffer, (int32_t)length);
+	}
+}
+
+NFC_ITCM uint8_t NFC_Transport_Wait(uint8_t (*done)(void), const uint32_t timeout)
+{
+	uint32_t startTick = HAL_GetTick();
+	uint8_t result;
+
+	/* Interrupts are masked while the condition is tested, so the interrupt can
+	 * not happen between the test and WFI. A pending interrupt still wakes up the
+	 * core and it is served as soon as interrupts are unmasked. */
+	__disable_irq();
+	while (!(result = done()))
+	{
+		if (HAL_GetTick() - startTick >= timeout)
+		{
+			break;
+		}
+
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	__enable_irq();
+
+	return result;
+}
+
+void NFC_Transaction_Init(NFC_Transaction *transaction, uint8_t *buffer, const size_t size)
+{
+	transaction->buffer = buffer;
+	transaction->size = size;
+	transaction->length = 0;
+	transaction->operation = NFC_TRANSPORT_CLOSED;
+}
+
+NFC_ITCM void NFC_Transaction_Open(NFC_Transaction *transaction)
+{
+	transaction->operation = NFC_TRANSPORT_PENDING;
+	transaction->length = 0;
+}
+
+NFC_ITCM uint8_t NFC_Transaction_Send(NFC_Transaction *transaction, const uint8_t *buffer, size_t length)
+{
+	if (length == 0)
+	{
+		return true;
+	}
+
+	// First byte after select tells what the transaction is, the bus has no such byte
+	if (transaction->operation == NFC_TRANSPORT_PENDING)
+	{
+		switch (buffer[0])
+		{
+			case PN532_SPI_DATAWRITE:
+				transaction->operation = NFC_TRANSPORT_WRITE;
+				break;
+			case PN532_SPI_DATAREAD:
+				transaction->operation = NFC_TRANSPORT_READ;
+				break;
+			case PN532_SPI_STATREAD:
+				transaction->operation = NFC_TRANSPORT_STATUS;
+				break;
+			default:
+				transaction->operation = NFC_TRANSPORT_CLOSED;
+				break;
+		}
+
+		buffer++;
+		length--;
+	}
+
+	if (transaction->operation != NFC_TRANSPORT_WRITE)
+	{
+		return true;
+	}
+
+	// Frame is kept up to deselect and written in a single transfer
+	if (transaction->length + length > transaction->size)
+	{
+		transaction->operation = NFC_TRANSPORT_CLOSED;
+		return false;
+	}
+
+	memcpy(&transaction->buffer[transaction->length], buffer, length);
+	transaction->length += length;
+
+	return true;
+}
+
+NFC_ITCM void NFC_Transaction_Close(NFC_Transaction *transaction)
+{
+	transaction->operation = NFC_TRANSPORT_CLOSED;
+}
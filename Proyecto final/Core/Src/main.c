@@ -25,7 +25,17 @@
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
 #include "NFC_SPI.h"
+#include "NFC_SPI_DMA.h"
+#include "NFC_SPI_LL.h"
+#include "NFC_I2C.h"
+#include "NFC_HSU.h"
+#include "NFC_Timer.h"
+#include "NFC_Profile.h"
+#include "NFC_Bench.h"
+#include "NFC_TCM.h"
+#include "NFC_Link.h"
 #include "NFC.h"
+#include "NFC_Bus.h"
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
@@ -35,6 +45,54 @@
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
+/// Move PN532 frames with DMA (1) or with blocking SPI transfers (0)
+#define NFC_SPI_USE_DMA		1
+
+/// Blocking transfers and chip select written on registers (1) or through HAL (0)
+#define NFC_SPI_USE_LL		1
+
+/// Over SPI2, wait ready with IRQ line (1) or reading status of PN532 with STATREAD (0), for readers without PH6 wired
+#ifndef NFC_SPI_USE_IRQ
+#define NFC_SPI_USE_IRQ		1
+#endif
+
+/// Talk to PN532 over I2C1 (1) or over SPI2 (0)
+#ifndef NFC_USE_I2C
+#define NFC_USE_I2C			0
+#endif
+
+/// Over I2C, wait ready with IRQ line (1) or reading the status byte of PN532 as the driver polls it (0)
+#ifndef NFC_I2C_USE_IRQ
+#define NFC_I2C_USE_IRQ		1
+#endif
+
+/// Talk to PN532 over its HSU port with USART6 (1), it goes before NFC_USE_I2C
+#ifndef NFC_USE_HSU
+#define NFC_USE_HSU			0
+#endif
+
+/// SPI2 is the link with PN532 when no other port was chosen
+#define NFC_USE_SPI			(!NFC_USE_I2C && !NFC_USE_HSU)
+
+/// Let PN532 poll the field by itself with InAutoPoll (1) or list a Mifare card with InListPassiveTarget each second (0)
+#ifndef NFC_USE_AUTOPOLL
+#define NFC_USE_AUTOPOLL	1
+#endif
+
+/// Polls of InAutoPoll and time between them in units of 150 mS
+#define NFC_AUTOPOLL_COUNT	PN532_AUTOPOLL_ENDLESS
+#define NFC_AUTOPOLL_PERIOD	1
+
+/// Sleep with SysTick stopped while PN532 waits a card, only when its IRQ line wakes the MCU
+#define NFC_SLEEP_ENABLE	((NFC_USE_SPI && NFC_SPI_USE_IRQ) || (NFC_USE_I2C && NFC_I2C_USE_IRQ))
+
+/// Run with I-cache, D-cache, ART accelerator and flash prefetch (1) or with all of them off (0)
+#define NFC_CACHE_ENABLE	1
+
+/// Measure the driver with caches off and on before the application starts
+#ifndef NFC_BENCH_ENABLE
+#define NFC_BENCH_ENABLE	0
+#endif
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -45,12 +103,31 @@
 /* Private variables ---------------------------------------------------------*/
 
 /* USER CODE BEGIN PV */
-
+static NFC_Context nfcReader NFC_DTCM;
+static NFC_Bus nfcBus NFC_DTCM;
+#if NFC_USE_SPI
+static NFC_Link nfcLink;
+#endif
+#if NFC_TRACE_ENABLE
+// Save it with the debugger for Trace_Replay: dump binary value trace.bin nfcTrace
+static NFC_Trace nfcTrace;
+#endif
+#if NFC_USE_AUTOPOLL
+// Cards searched by InAutoPoll, first type matching a card is the one reported
+static const uint8_t nfcAutoPollTypes[] = {PN532_AUTOPOLL_MIFARE, PN532_AUTOPOLL_ISO14443_4A, PN532_AUTOPOLL_FELICA212, PN532_AUTOPOLL_ISO14443_4B};
+#endif
+#if NFC_BENCH_ENABLE
+// Cycles of driver without and with caches, read them with the debugger
+static NFC_Bench_Result benchUncached, benchCached;
+static NFC_Bench_Transport benchTransport;
+static NFC_Bench_IRQ benchIRQ;
+#endif
 /* USER CODE END PV */
 
 /* Private function prototypes -----------------------------------------------*/
 void SystemClock_Config(void);
 /* USER CODE BEGIN PFP */
+static void MPU_Config(void);
 
 /* USER CODE END PFP */
 
@@ -66,10 +143,26 @@ void SystemClock_Config(void);
 int main(void)
 {
   /* USER CODE BEGIN 1 */
-	uint8_t success = 0, uid[7] = {0, 0, 0, 0, 0, 0, 0}, length_uid;
+	uint8_t success = 0, uid[NFC_PASSIVE_UIDSIZE] = {0}, length_uid;
 	uint32_t info;
-	NFC_CommInterface nfcInterface;
+	NFC_CommInterface nfcInterface = {0};
+	NFC_Context *reader;
+#if NFC_USE_AUTOPOLL
+	NFC_AutoPollTarget targets[PN532_AUTOPOLL_MAXTARGETS];
+	uint8_t found;
+#endif
 	uint8_t model, version, subversion;
+
+	// Code of ITCM is copied before the first call to it
+	NFC_TCM_Init();
+
+	// DMA buffers are made non-cacheable before D-cache is on, so no line of them is ever cached
+	MPU_Config();
+
+#if NFC_CACHE_ENABLE
+	SCB_EnableICache();
+	SCB_EnableDCache();
+#endif
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -78,10 +171,60 @@ int main(void)
   HAL_Init();
 
   /* USER CODE BEGIN Init */
-	nfcInterface.GetByte = &NFC_SPI_GetByte;
+#if NFC_CACHE_ENABLE
+	// ART caches flash reads over the ITCM bus, prefetch fills it ahead of the core
+	__HAL_FLASH_ART_ENABLE();
+	__HAL_FLASH_PREFETCH_BUFFER_ENABLE();
+#endif
+
+	nfcInterface.DelayUs = &NFC_Timer_DelayUs;
+	nfcInterface.GetTimeUs = &NFC_Timer_GetUs;
+	nfcInterface.SleepUs = &NFC_Timer_SleepUs;
+#if NFC_USE_HSU
+	// A single PN532 on the serial line, frames end with idle line instead of IRQ pin
+	nfcInterface.GetByte = &NFC_HSU_GetByte;
+	nfcInterface.SendByte = &NFC_HSU_SendByte;
+	nfcInterface.SetSelect = &NFC_HSU_SetSelect;
+	nfcInterface.SendBuffer = &NFC_HSU_SendBuffer;
+	nfcInterface.ReceiveBuffer = &NFC_HSU_ReceiveBuffer;
+	nfcInterface.GetIRQ = &NFC_HSU_GetIRQ;
+	nfcInterface.WaitIRQ = &NFC_HSU_WaitIRQ;
+#elif NFC_USE_I2C
+	// A single PN532 answers at the fixed I2C address, there is no device to route
+	nfcInterface.GetByte = &NFC_I2C_GetByte;
+	nfcInterface.SendByte = &NFC_I2C_SendByte;
+	nfcInterface.SetSelect = &NFC_I2C_SetSelect;
+	nfcInterface.SendBuffer = &NFC_I2C_SendBuffer;
+	nfcInterface.ReceiveBuffer = &NFC_I2C_ReceiveBuffer;
+#if NFC_I2C_USE_IRQ
+	nfcInterface.GetIRQ = &NFC_I2C_GetIRQ;
+	nfcInterface.WaitIRQ = &NFC_SPI_WaitIRQ;
+#endif
+#else
+#if NFC_SPI_USE_IRQ
 	nfcInterface.GetIRQ = &NFC_SPI_GetIRQ;
+	nfcInterface.WaitIRQ = &NFC_SPI_WaitIRQ;
+#endif
+#if NFC_SPI_USE_LL
+	nfcInterface.GetByte = &NFC_SPI_LL_GetByte;
+	nfcInterface.SendByte = &NFC_SPI_LL_SendByte;
+	nfcInterface.SetSelect = &NFC_SPI_LL_SetSelect;
+	nfcInterface.SetDevice = &NFC_SPI_LL_SetDevice;
+	nfcInterface.SendBuffer = &NFC_SPI_LL_SendBuffer;
+	nfcInterface.ReceiveBuffer = &NFC_SPI_LL_ReceiveBuffer;
+#else
+	nfcInterface.GetByte = &NFC_SPI_GetByte;
 	nfcInterface.SendByte = &NFC_SPI_SendByte;
 	nfcInterface.SetSelect = &NFC_SPI_SetSelect;
+	nfcInterface.SetDevice = &NFC_SPI_SetDevice;
+	nfcInterface.SendBuffer = &NFC_SPI_SendBuffer;
+	nfcInterface.ReceiveBuffer = &NFC_SPI_ReceiveBuffer;
+#endif
+#if NFC_SPI_USE_DMA
+	nfcInterface.SendBuffer = &NFC_SPI_DMA_SendBuffer;
+	nfcInterface.ReceiveBuffer = &NFC_SPI_DMA_ReceiveBuffer;
+#endif
+#endif
   /* USER CODE END Init */
 
   /* Configure the system clock */
@@ -94,20 +237,99 @@ int main(void)
   /* Initialize all configured peripherals */
 
   /* USER CODE BEGIN 2 */
+	NFC_Timer_Init();
+
+#if NFC_PROFILE_ENABLE
+	NFC_Profile_Init();
+#endif
+
+#if NFC_BENCH_ENABLE
+	NFC_Bench_SetCaches(0);
+	NFC_Bench_Run(&benchUncached);
+	NFC_Bench_SetCaches(1);
+	NFC_Bench_Run(&benchCached);
+	NFC_Bench_SetCaches(NFC_CACHE_ENABLE);
+#endif
+
+#if NFC_USE_HSU
+	if (NFC_HSU_Init() == 0)
+	{
+		return 0;
+	}
+#elif NFC_USE_I2C
+	if (NFC_I2C_Init(NFC_I2C_USE_IRQ) == 0)
+	{
+		return 0;
+	}
+#endif
+
+#if NFC_USE_SPI || NFC_BENCH_ENABLE
 	if (NFC_SPI_Init() == 0)
 	{
 		return 0;
 	}
+#endif
 
-	NFC_CommInit(&nfcInterface);
+#if (NFC_USE_SPI && NFC_SPI_USE_LL) || NFC_BENCH_ENABLE
+	if (NFC_SPI_LL_Init() == 0)
+	{
+		return 0;
+	}
+#endif
 
-	info = NFC_GetFirmwareVersion();
+#if (NFC_USE_SPI && NFC_SPI_USE_DMA) || NFC_BENCH_ENABLE
+	if (NFC_SPI_DMA_Init() == 0)
+	{
+		return 0;
+	}
+#endif
+
+#if NFC_BENCH_ENABLE
+	NFC_Bench_RunTransport(&benchTransport);
+#endif
+
+	// More PN532 are added with NFC_SPI_AddDevice and their own context
+	NFC_CommInit(&nfcReader, &nfcInterface, 0);
+#if NFC_USE_HSU
+	NFC_Bus_Init(&nfcBus, &NFC_HSU_Idle);
+#else
+	NFC_Bus_Init(&nfcBus, &NFC_SPI_Idle);
+#endif
+	NFC_Bus_Add(&nfcBus, &nfcReader);
+#if NFC_SLEEP_ENABLE
+	NFC_Bus_SetSleep(&nfcBus, &NFC_SPI_Sleep);
+#endif
+
+#if NFC_TRACE_ENABLE
+	NFC_InitTrace(&nfcTrace);
+	NFC_SetTrace(&nfcReader, &nfcTrace);
+#endif
+
+	info = NFC_GetFirmwareVersion(&nfcReader);
 
 	if (info == 0)
 	{
 		return 0;
 	}
 
+#if NFC_USE_SPI
+	// Raise SPI clock as far as PN532 answers right
+	if (NFC_Link_Calibrate(&nfcLink, &nfcReader) == 0)
+	{
+		return 0;
+	}
+#if NFC_BENCH_ENABLE
+	// Ready of PN532 by IRQ edge and by a loop on its pin, at the calibrated clock
+	NFC_Bench_RunIRQ(&nfcInterface, &benchIRQ);
+#endif
+#elif NFC_USE_HSU
+	// Same for the baud rate of HSU, agreed with PN532
+	if (NFC_Link_SetSerial(&nfcReader, NFC_HSU_BAUD_MAX) == 0)
+	{
+		return 0;
+	}
+#endif
+
 	model = (info & 0x00FF0000)>>16;
 	version = (info & 0x0000FF00) >> 8;
 	subversion = (info & 0x000000FF);
@@ -115,7 +337,7 @@ int main(void)
 	// Set the max number of retry attempts to read from a card
 	// This prevents us from waiting forever for a card, which is
 	// the default behaviour of the PN532.
-	success = NFC_SetPassiveActivationRetries(0xFF);
+	success = NFC_SetPassiveActivationRetries(&nfcReader, 0xFF);
 	if( success == 0)
 	{
 		return 0;
@@ -123,23 +345,59 @@ int main(void)
 
 	// configure board to read RFID tags
 	success = 0;
-	success = NFC_SAMConfig();
+	success = NFC_SAMConfig(&nfcReader);
 	if( success == 0)
 	{
 		return 0;
 	}
+
+#if NFC_USE_AUTOPOLL
+	// PN532 answers only when a card is in the field, there is no traffic meanwhile
+	if (NFC_StartAutoPoll(&nfcReader, nfcAutoPollTypes, sizeof(nfcAutoPollTypes), NFC_AUTOPOLL_COUNT, NFC_AUTOPOLL_PERIOD, NFC_TIMEOUT_NONE) == 0)
+	{
+		return 0;
+	}
+#else
+	NFC_StartReadPassiveTargetID(&nfcReader, PN532_MIFARE_ISO14443A, 1000);
+#endif
   /* USER CODE END 2 */
 
   /* Infinite loop */
   /* USER CODE BEGIN WHILE */
 	while (1)
 	{
-		strncpy((char *)uid, "\0", 7);
-		success = NFC_ReadPassiveTargetID(PN532_MIFARE_ISO14443A, uid, &length_uid, 1000);
+		// Serve every reader on the bus, sleep while all PN532 are busy
+		reader = NFC_Bus_Process(&nfcBus);
 
-		if ( success != 0 )
+		if (reader != NULL)
 		{
-			HAL_Delay(1000);
+#if NFC_USE_SPI
+			// Corrupted frames make the SPI clock slower
+			NFC_Link_Update(&nfcLink, reader);
+#endif
+
+#if NFC_USE_AUTOPOLL
+			success = NFC_GetAutoPollTargets(reader, targets, &found);
+
+			if (success != 0 && found != 0)
+			{
+				length_uid = (targets[0].uidLength < sizeof(uid)) ? targets[0].uidLength : sizeof(uid);
+				memcpy(uid, targets[0].uid, length_uid);
+				HAL_Delay(1000);
+			}
+
+			NFC_StartAutoPoll(reader, nfcAutoPollTypes, sizeof(nfcAutoPollTypes), NFC_AUTOPOLL_COUNT, NFC_AUTOPOLL_PERIOD, NFC_TIMEOUT_NONE);
+#else
+			strncpy((char *)uid, "\0", 7);
+			success = NFC_GetPassiveTargetID(reader, uid, &length_uid);
+
+			if ( success != 0 )
+			{
+				HAL_Delay(1000);
+			}
+
+			NFC_StartReadPassiveTargetID(reader, PN532_MIFARE_ISO14443A, 1000);
+#endif
 		}
 
     /* USER CODE END WHILE */
@@ -189,7 +447,7 @@ void SystemClock_Config(void)
                               |RCC_CLOCKTYPE_PCLK1|RCC_CLOCKTYPE_PCLK2;
   RCC_ClkInitStruct.SYSCLKSource = RCC_SYSCLKSOURCE_PLLCLK;
   RCC_ClkInitStruct.AHBCLKDivider = RCC_SYSCLK_DIV1;
-  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV16;
+  RCC_ClkInitStruct.APB1CLKDivider = RCC_HCLK_DIV4;
   RCC_ClkInitStruct.APB2CLKDivider = RCC_HCLK_DIV2;
 
   if (HAL_RCC_ClockConfig(&RCC_ClkInitStruct, FLASH_LATENCY_7) != HAL_OK)
@@ -199,6 +457,19 @@ void SystemClock_Config(void)
 }
 
 /* USER CODE BEGIN 4 */
+/**
+  * @brief MPU Configuration
+  * @retval None
+  */
+static void MPU_Config(void)
+{
+	HAL_MPU_Disable();
+
+	NFC_SPI_DMA_ConfigMPU(MPU_REGION_NUMBER0);
+
+	// Memory outside regions keeps the default map
+	HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+}
 
 /* USER CODE END 4 */
 
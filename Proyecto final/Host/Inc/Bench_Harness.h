@@ -0,0 +1,74 @@
+/*
+ * Bench_Harness.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Tap harness of the card benchmarks (Bench_Inventory, Bench_Mifare,
+ *  Bench_MifareKeys and Bench_MifareValue). Each tap starts from a new
+ *  PN532_Sim with the cards added by the benchmark, runs the tap of the
+ *  strategy and takes virtual time and commands. A line is printed for
+ *  each strategy.
+ */
+
+#ifndef INC_BENCH_HARNESS_H_
+#define INC_BENCH_HARNESS_H_
+
+#include <stdint.h>
+#include "NFC.h"
+
+/// Default time of InListPassiveTarget up to the card activated
+#define BENCH_HARNESS_TARGET_US		(3000)
+
+/// Sectors of the ticket read by the MIFARE benchmarks
+#define BENCH_HARNESS_SECTORS		(4)
+
+/// Ticket sectors and card of the MIFARE benchmarks
+extern const uint8_t benchHarnessSectors[BENCH_HARNESS_SECTORS];
+extern const uint8_t benchHarnessUid[4];
+
+/**
+ *  Strategy compared by a benchmark.
+ */
+typedef struct
+{
+	const char *name;			///< Name printed in the report
+	uint8_t strategy;			///< Value given to the functions of the benchmark
+}Bench_HarnessStrategy;
+
+/**
+ *  Benchmark run by the harness. Start, Done and Finish may be NULL.
+ */
+typedef struct
+{
+	uint32_t targetUs;			///< Time of InListPassiveTarget
+	const Bench_HarnessStrategy *strategies;
+	uint8_t count;				///< Amount of strategies
+	const uint32_t *counter;	///< Counter of the benchmark reported per tap, NULL for none
+	const char *counterName;	///< Name of counter in the report
+
+	/// Called before the first tap of a strategy
+	void (*Start)(const uint8_t strategy);
+	/// Add the cards of a tap to the new PN532_Sim, returns 0 on error
+	uint8_t (*Setup)(const uint32_t iteration, const uint8_t strategy);
+	/// Tap of the strategy, returns 0 when it failed
+	uint8_t (*Tap)(NFC_Context *context, const uint8_t strategy);
+	/// Called after each tap, the cards are still in PN532_Sim
+	void (*Done)(const uint8_t strategy);
+	/// Check after the last tap, returns 0 and prints why when it failed
+	uint8_t (*Finish)(const uint8_t strategy, const uint32_t iterations);
+}Bench_Harness;
+
+
+/**
+ * \brief Run every strategy of a benchmark and print a line for each one:
+ * time per tap, commands per tap, time SPI was busy per tap and counter.
+ *
+ * \param[in] harness Benchmark to run.
+ * \param[in] iterations Taps of each strategy.
+ *
+ * \return Return 1 if every tap succeeded, 0 otherwise.
+ */
+uint8_t Bench_Harness_Run(const Bench_Harness *harness, const uint32_t iterations);
+
+#endif /* INC_BENCH_HARNESS_H_ */
@@ -0,0 +1,87 @@
+/*
+ * Host_CMSIS.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Replacement of cmsis_gcc.h for the host build of the firmware. It is
+ *  included first on every file (-include), so the include guard keeps the
+ *  ARM version out. Compiler macros are the same; core intrinsics that are
+ *  ARM instructions (CPSID, CPSIE, WFI...) call the HAL shim instead.
+ */
+
+#ifndef INC_HOST_CMSIS_H_
+#define INC_HOST_CMSIS_H_
+
+#include <stdint.h>
+
+/// Guard of cmsis_gcc.h, the ARM intrinsics are not compiled on host
+#define __CMSIS_GCC_H
+
+#define __ASM									__asm
+#define __INLINE								inline
+#define __STATIC_INLINE							static inline
+#define __STATIC_FORCEINLINE					__attribute__((always_inline)) static inline
+#define __NO_RETURN								__attribute__((__noreturn__))
+#define __USED									__attribute__((used))
+#define __WEAK									__attribute__((weak))
+#define __PACKED								__attribute__((packed, aligned(1)))
+#define __PACKED_STRUCT							struct __attribute__((packed, aligned(1)))
+#define __PACKED_UNION							union __attribute__((packed, aligned(1)))
+#define __ALIGNED(x)							__attribute__((aligned(x)))
+#define __RESTRICT								__restrict
+#define __UNALIGNED_UINT32(x)					(*(uint32_t *)(x))
+#define __UNALIGNED_UINT16_WRITE(addr, val)		(void)(*(uint16_t *)(void *)(addr) = (val))
+#define __UNALIGNED_UINT16_READ(addr)			(*(const uint16_t *)(const void *)(addr))
+#define __UNALIGNED_UINT32_WRITE(addr, val)		(void)(*(uint32_t *)(void *)(addr) = (val))
+#define __UNALIGNED_UINT32_READ(addr)			(*(const uint32_t *)(const void *)(addr))
+
+/// Implemented by Host_HAL.c
+void Host_HAL_EnableIRQ(void);
+void Host_HAL_DisableIRQ(void);
+uint32_t Host_HAL_GetPRIMASK(void);
+void Host_HAL_WaitForInterrupt(void);
+
+__STATIC_FORCEINLINE void __enable_irq(void)
+{
+	Host_HAL_EnableIRQ();
+}
+
+__STATIC_FORCEINLINE void __disable_irq(void)
+{
+	Host_HAL_DisableIRQ();
+}
+
+__STATIC_FORCEINLINE uint32_t __get_PRIMASK(void)
+{
+	return Host_HAL_GetPRIMASK();
+}
+
+/// Memory barriers only order the host compiler
+#define __DSB()			__asm volatile ("" ::: "memory")
+#define __ISB()			__asm volatile ("" ::: "memory")
+#define __DMB()			__asm volatile ("" ::: "memory")
+#define __NOP()			__asm volatile ("" ::: "memory")
+#define __WFI()			Host_HAL_WaitForInterrupt()
+#define __WFE()			Host_HAL_WaitForInterrupt()
+#define __SEV()			((void)0)
+#define __BKPT(value)	((void)0)
+
+#define __CLZ			(uint8_t)__builtin_clz
+#define __REV			__builtin_bswap32
+
+__STATIC_FORCEINLINE uint32_t __RBIT(uint32_t value)
+{
+	uint32_t result = 0;
+	uint8_t i;
+
+	for (i = 0; i < 32; i++)
+	{
+		result = (result << 1) | (value & 0x01);
+		value >>= 1;
+	}
+
+	return result;
+}
+
+#endif /* INC_HOST_CMSIS_H_ */
@@ -0,0 +1,68 @@
+/*
+ * Host_Clock.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#ifndef INC_HOST_CLOCK_H_
+#define INC_HOST_CLOCK_H_
+
+#include <stdint.h>
+
+/// Default time charged by each HAL_GetTick call, one poll of a busy-wait loop
+#define HOST_CLOCK_POLLCOST_NS	(1000)
+
+/**
+ * \brief Set virtual time back to zero.
+ */
+void Host_Clock_Reset(void);
+
+/**
+ * \brief Get virtual time.
+ *
+ * \return Time in nS since last reset.
+ */
+uint64_t Host_Clock_Now(void);
+
+/**
+ * \brief Move virtual time forward.
+ *
+ * \param[in] ns Time to add in nS.
+ */
+void Host_Clock_Advance(const uint64_t ns);
+
+/**
+ * \brief Set time charged by each HAL_GetTick call.
+ * Busy-wait loops poll the tick, so virtual time moves while they spin.
+ *
+ * \param[in] ns Time in nS, 0 to read the tick without moving time.
+ */
+void Host_Clock_SetPollCost(const uint32_t ns);
+
+/**
+ * \brief Set end of simulation.
+ * When virtual time reaches the limit the handler is called, it must not
+ * return (longjmp out of firmware loop or exit).
+ *
+ * \param[in] ns Virtual time of end, 0 for no limit.
+ * \param[in] handler Function called once when limit is reached.
+ */
+void Host_Clock_SetLimit(const uint64_t ns, void (*handler)(void));
+
+/**
+ * \brief Set function called each time virtual time moves forward.
+ * Models peripherals that work on their own, as DMA storing received bytes.
+ *
+ * \param[in] hook Function called after each advance, NULL for none.
+ */
+void Host_Clock_SetHook(void (*hook)(void));
+
+/**
+ * \brief Get end of simulation set with Host_Clock_SetLimit.
+ *
+ * \return Virtual time of end in nS, 0 for no limit.
+ */
+uint64_t Host_Clock_GetLimit(void);
+
+#endif /* INC_HOST_CLOCK_H_ */
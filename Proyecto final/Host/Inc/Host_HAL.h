@@ -0,0 +1,116 @@
+/*
+ * Host_HAL.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Subset of STM32F7 HAL for the host build of the firmware. main.c, NFC_SPI.c,
+ *  NFC_SPI_DMA.c, NFC_I2C.c and NFC_HSU.c are compiled unmodified against the
+ *  real HAL headers; this module implements the HAL functions they call over
+ *  the virtual clock (Host_Clock) and routes SPI, I2C, USART and GPIO traffic
+ *  to PN532_Sim:
+ *
+ *  - Register blocks of peripherals and core are plain memory mapped at
+ *    their real addresses, so register macros read and write RAM.
+ *  - Chip select and IRQ pins are attached to simulated PN532.
+ *  - HAL_Delay, WFI and busy-waits move virtual time forward instead of
+ *    spinning, WFI jumps to next IRQ edge or SysTick.
+ *  - SPI transfers, also with DMA, finish inside the call. Each byte takes
+ *    the time of SPI2 clock, from APB1 divider and SPI2 prescaler.
+ *  - I2C transfers go to the first PN532 attached, as SPI transactions of
+ *    its simulator; reads start with the status byte of PN532. Each byte
+ *    takes 9 clocks of the SCL period given by I2C timing.
+ *  - USART6 is wired to the HSU port of the first PN532. A DMA stream started
+ *    on its RDR is a circular ring: as virtual time passes each byte sent by
+ *    PN532 is written to memory once its stop bit is received and NDTR counts
+ *    down, one character after the end of a frame IDLE is set. A frame written
+ *    by a DMA stream to TDR reaches PN532 when its last byte is sent, then TC
+ *    is set. Each byte takes 10 bits of the rate given by BRR and PCLK2, when
+ *    USART6 and PN532 use different rates no frame gets through. USART6
+ *    interrupt is served like EXTI ones.
+ */
+
+#ifndef INC_HOST_HAL_H_
+#define INC_HOST_HAL_H_
+
+#include "stm32f7xx_hal.h"
+
+/// Amount of PN532 pins pairs attached to the shim
+#define HOST_HAL_MAXDEVICES		(4)
+
+/// Frames received above the rate limit of USART6 line, one of them is corrupted
+#define HOST_HAL_USART_ERRORPERIOD	(4)
+
+/**
+ * \brief Map register blocks of peripherals and Cortex-M7 core.
+ * Must be called before any firmware code.
+ *
+ * \return Return 1 if memory was mapped, 0 the other way.
+ */
+uint8_t Host_HAL_Init(void);
+
+/**
+ * \brief Connect chip select and IRQ pins to a simulated PN532.
+ *
+ * \param[in] csPort Port of chip select pin.
+ * \param[in] csPin Chip select pin.
+ * \param[in] irqPort Port of IRQ pin.
+ * \param[in] irqPin IRQ pin.
+ * \param[in] device Number of PN532 in simulator.
+ *
+ * \return Return 1 if pins were attached, 0 the other way.
+ */
+uint8_t Host_HAL_AttachPN532(GPIO_TypeDef *csPort, const uint16_t csPin, GPIO_TypeDef *irqPort, const uint16_t irqPin, const uint8_t device);
+
+/**
+ * \brief Get virtual time the core spent sleeping in WFI.
+ * DWT cycle counter of host build does not count it.
+ *
+ * \return Time in nS.
+ */
+uint64_t Host_HAL_GetSleepNs(void);
+
+/**
+ * \brief Get amount of times the core woke up from WFI.
+ *
+ * \return Wake ups since Host_HAL_Init.
+ */
+uint32_t Host_HAL_GetWakeups(void);
+
+/**
+ * \brief Move bytes between SPI2 and PN532 of chip select asserted.
+ * Used by HAL_SPI functions and by transports that write SPI registers.
+ *
+ * \param[in] txData Bytes to send, ignored when rxData is not NULL.
+ * \param[out] rxData Buffer of received bytes, NULL to send.
+ * \param[in] size Amount of bytes.
+ * \param[in] callNs Modelled time of the call, without bytes on the wire.
+ */
+void Host_HAL_SpiTransfer(const uint8_t *txData, uint8_t *rxData, const uint16_t size, const uint32_t callNs);
+
+/**
+ * \brief Set fastest SPI clock the link works at, faster transfers
+ * receive corrupted bytes. Models wiring that does not reach PN532 limit.
+ *
+ * \param[in] hz Clock in Hz, 0 for no limit.
+ */
+void Host_HAL_SetSpiMaxHz(const uint32_t hz);
+
+/**
+ * \brief Set fastest rate USART6 line works at. Above it one frame of every
+ * HOST_HAL_USART_ERRORPERIOD received has a wrong bit, the direction to PN532
+ * still works. Models a cable run too long for the rate.
+ *
+ * \param[in] baud Baud rate, 0 for no limit.
+ */
+void Host_HAL_SetUsartMaxBaud(const uint32_t baud);
+
+/**
+ * \brief Set virtual time of the interrupt of TIM7 one-shot, WFI ends there
+ * as on target. Used by NFC_Timer_SleepUs of host.
+ *
+ * \param[in] ns Time of interrupt in nS, PN532_SIM_NEVER to stop timer.
+ */
+void Host_HAL_SetTimerWakeup(const uint64_t ns);
+
+#endif /* INC_HOST_HAL_H_ */
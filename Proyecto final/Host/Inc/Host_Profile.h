@@ -0,0 +1,25 @@
+/*
+ * Host_Profile.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  NFC_Profile over the virtual clock, replaces Core/Src/NFC_Profile.c in the
+ *  host profiling build. Records are written to a file as the ITM packets the
+ *  SWO pin would send, so Swo_Decode reads captures of target and simulator.
+ */
+
+#ifndef INC_HOST_PROFILE_H_
+#define INC_HOST_PROFILE_H_
+
+#include <stdio.h>
+#include "NFC_Profile.h"
+
+/**
+ * \brief Set file that receives the SWO stream, NULL drops every record.
+ *
+ * \param[in] file File opened for binary write.
+ */
+void Host_Profile_SetOutput(FILE *file);
+
+#endif /* INC_HOST_PROFILE_H_ */
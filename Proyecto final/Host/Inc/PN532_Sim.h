@@ -0,0 +1,186 @@
+/*
+ * PN532_Sim.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host simulator of PN532 seen through its SPI port. It implements every
+ *  function of NFC_CommInterface, so the driver runs unmodified on a
+ *  workstation: DATAWRITE/DATAREAD/STATREAD operations, ACK and NACK frames,
+ *  IRQ line and the answer of commands used by the driver. Frames can also be
+ *  taken as the HSU port sends them. Time is virtual (Host_Clock), every
+ *  transfer is charged a modelled cost and each command has its own
+ *  processing latency.
+ */
+
+#ifndef INC_PN532_SIM_H_
+#define INC_PN532_SIM_H_
+
+#include "NFC.h"
+
+/// Amount of PN532 simulated, selected with PN532_Sim_SetDevice
+#define PN532_SIM_MAXDEVICES		(4)
+
+/// Amount of cards in the field of each PN532
+#define PN532_SIM_MAXCARDS			(4)
+
+/// Largest frame exchanged, extended frame with 265 bytes of data
+#define PN532_SIM_FRAMESIZE			(280)
+
+/// MIFARE Classic 1K memory, 16 sectors of 4 blocks
+#define PN532_SIM_BLOCKSIZE			(16)
+#define PN532_SIM_BLOCKS			(64)
+
+/// Default model, SPI2 at 843.75 kHz driven by HAL blocking calls
+#define PN532_SIM_CALLCOST_NS		(4000)
+#define PN532_SIM_BYTECOST_NS		(9481)
+#define PN532_SIM_ACK_US			(100)
+#define PN532_SIM_LATENCY_US		(1000)
+
+/// Anticollision and activation of each more target listed by one InListPassiveTarget
+#define PN532_SIM_ACTIVATION_US		(1000)
+
+/// Status byte of InDataExchange and InCommunicateThru
+#define PN532_SIM_STATUS_OK			(0x00)
+#define PN532_SIM_STATUS_TIMEOUT	(0x01)
+#define PN532_SIM_STATUS_AUTH		(0x14)
+#define PN532_SIM_STATUS_CONTEXT	(0x27)
+
+/// Time of an event that never happens
+#define PN532_SIM_NEVER				(UINT64_MAX)
+
+/**
+ *  Virtual card, MIFARE Classic 1K with 4 or 7 bytes UID.
+ */
+typedef struct
+{
+	uint8_t uid[7];
+	uint8_t uidLength;
+	uint8_t sensRes[2];							///< ATQA
+	uint8_t selRes;								///< SAK
+	uint64_t arriveNs;							///< Card is in field from this time...
+	uint64_t leaveNs;							///< ...up to this time
+	uint8_t halted;								///< Released by InRelease, no answer to polls any more
+	uint8_t memory[PN532_SIM_BLOCKS][PN532_SIM_BLOCKSIZE];
+}PN532_Sim_Card;
+
+/**
+ *  Transport accounting of one PN532.
+ */
+typedef struct
+{
+	uint32_t calls;				///< Transfer calls, one by byte in per-byte mode
+	uint32_t bytes;				///< Bytes moved on SPI
+	uint64_t transportNs;		///< Modelled time spent in transfer calls
+	uint32_t commands;			///< Command frames accepted
+	uint32_t acks;				///< ACK frames read by host
+	uint32_t responses;			///< Response frames read by host
+	uint32_t nacks;				///< NACK frames received from host
+	uint32_t errors;			///< Frames dropped for bad checksum
+	uint32_t targets;			///< Cards reported by InListPassiveTarget
+}PN532_Sim_Stats;
+
+
+/**
+ * \brief Reset every simulated PN532 and the virtual clock.
+ * Cost model and latencies go back to defaults and no card is in field.
+ */
+void PN532_Sim_Init(void);
+
+/**
+ * \brief Fill a communication interface with simulator functions.
+ *
+ * \param[out] interface Interface to fill.
+ * \param[in] bulk 1 to move frames with buffer functions, 0 byte by byte.
+ */
+void PN532_Sim_GetInterface(NFC_CommInterface *interface, const uint8_t bulk);
+
+/**
+ * \brief Set modelled cost of transfers.
+ *
+ * \param[in] callNs Fixed time of each transfer call.
+ * \param[in] byteNs Time of each byte on the wire.
+ */
+void PN532_Sim_SetTransportCost(const uint32_t callNs, const uint32_t byteNs);
+
+/**
+ * \brief Set processing time of a command, from end of command frame to IRQ of response.
+ *
+ * \param[in] device Number of simulated PN532.
+ * \param[in] command Command code.
+ * \param[in] us Time in uS.
+ */
+void PN532_Sim_SetLatency(const uint8_t device, const uint8_t command, const uint32_t us);
+
+/**
+ * \brief Set time from end of command frame to IRQ of ACK, for every PN532.
+ *
+ * \param[in] us Time in uS.
+ */
+void PN532_Sim_SetAckLatency(const uint32_t us);
+
+/**
+ * \brief Put a card in field of a PN532, with default MIFARE Classic 1K content.
+ *
+ * \param[in] device Number of simulated PN532.
+ * \param[in] uid UID of card.
+ * \param[in] uidLength Length of UID, 4 or 7.
+ * \param[in] arriveNs Virtual time when card enters the field.
+ * \param[in] leaveNs Virtual time when card leaves the field, PN532_SIM_NEVER to stay.
+ *
+ * \return Return pointer to card to change its content, NULL if there is no room.
+ */
+PN532_Sim_Card *PN532_Sim_AddCard(const uint8_t device, const uint8_t *uid, const uint8_t uidLength, const uint64_t arriveNs, const uint64_t leaveNs);
+
+/**
+ * \brief Copy transport accounting of a PN532.
+ *
+ * \param[in] device Number of simulated PN532.
+ * \param[out] stats Structure to store accounting.
+ */
+void PN532_Sim_GetStats(const uint8_t device, PN532_Sim_Stats *stats);
+
+/**
+ * \brief Get virtual time when IRQ line of a PN532 will be active.
+ * Used to sleep up to the next event instead of polling.
+ *
+ * \param[in] device Number of simulated PN532.
+ *
+ * \return Time in nS, in the past when IRQ is already active, PN532_SIM_NEVER without pending frame.
+ */
+uint64_t PN532_Sim_GetNextIRQ(const uint8_t device);
+
+/**
+ * \brief Take the next frame of selected PN532 as its HSU port sends it, on
+ * its own once it is ready. Used by transports without SPI transactions.
+ *
+ * \param[out] buffer Buffer to store the frame.
+ * \param[in] size Size of buffer.
+ * \param[out] readyNs Virtual time when the frame was ready.
+ *
+ * \return Length of frame, 0 when no frame is ready.
+ */
+uint16_t PN532_Sim_TakeFrame(uint8_t *buffer, const uint16_t size, uint64_t *readyNs);
+
+/**
+ * \brief Get baud rate of HSU port of a PN532, changed by SetSerialBaudRate.
+ *
+ * \param[in] device Number of simulated PN532.
+ *
+ * \return Baud rate code, PN532_HSU_BAUD_115200 after reset.
+ */
+uint8_t PN532_Sim_GetSerialRate(const uint8_t device);
+
+/// Functions of NFC_CommInterface
+uint8_t PN532_Sim_GetByte(void);
+void PN532_Sim_SendByte(uint8_t byte);
+void PN532_Sim_SendBuffer(const uint8_t *buffer, size_t length);
+void PN532_Sim_ReceiveBuffer(uint8_t *buffer, size_t length);
+void PN532_Sim_SetSelect(uint8_t state);
+uint8_t PN532_Sim_GetIRQ(void);
+uint8_t PN532_Sim_WaitIRQ(uint32_t timeout);
+void PN532_Sim_DelayUs(uint32_t us);
+void PN532_Sim_SetDevice(uint8_t device);
+uint32_t PN532_Sim_GetTimeUs(void);
+
+#endif /* INC_PN532_SIM_H_ */
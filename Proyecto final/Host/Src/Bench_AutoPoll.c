@@ -0,0 +1,187 @@
+/*
+ * Bench_AutoPoll.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of the ways the firmware waits a card in an empty field:
+ *
+ *  - inlist:   InListPassiveTarget of a Mifare card with a timeout of 1 s,
+ *              started again each time it ends without card, bus idles in WFI
+ *  - autopoll: endless InAutoPoll of the types of main.c, PN532 only answers
+ *              when a card is found, bus sleeps with SysTick stopped
+ *
+ *  NFC_SPI.c, NFC_SPI_DMA.c and NFC_Bus.c run over the HAL shim (Host_HAL)
+ *  with PN532_Sim behind them. The field is empty for the given seconds, then
+ *  a card enters. Results: commands, SPI bytes and wakeups of the core while
+ *  the field was empty, and time from the card entering to its UID read.
+ *
+ *  Usage: Bench_AutoPoll [empty field seconds] [InListPassiveTarget timeout mS] [InAutoPoll period]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC_SPI.h"
+#include "NFC_SPI_DMA.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+#include "NFC_Bus.h"
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Time the card stays out of the field by default in seconds
+#define BENCH_EMPTY_S		(10)
+
+/// Time to wait the card after it entered in seconds
+#define BENCH_CARD_S		(3)
+
+static const uint8_t benchUid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+static const uint8_t benchTypes[] = {PN532_AUTOPOLL_MIFARE, PN532_AUTOPOLL_ISO14443_4A, PN532_AUTOPOLL_FELICA212, PN532_AUTOPOLL_ISO14443_4B};
+
+static uint8_t Bench_Start(NFC_Context *context, const uint8_t autoPoll, const uint16_t timeout, const uint8_t period)
+{
+	if (autoPoll)
+	{
+		return NFC_StartAutoPoll(context, benchTypes, sizeof(benchTypes), PN532_AUTOPOLL_ENDLESS, period, NFC_TIMEOUT_NONE);
+	}
+
+	NFC_StartReadPassiveTargetID(context, PN532_MIFARE_ISO14443A, timeout);
+	return true;
+}
+
+/// Card is read when the UID given by PN532 is the one of the simulated card
+static uint8_t Bench_CardRead(NFC_Context *context, const uint8_t autoPoll)
+{
+	NFC_AutoPollTarget targets[PN532_AUTOPOLL_MAXTARGETS];
+	uint8_t uid[NFC_PASSIVE_UIDSIZE], length, found;
+
+	if (autoPoll)
+	{
+		return NFC_GetAutoPollTargets(context, targets, &found) && found != 0 &&
+			targets[0].uidLength == sizeof(benchUid) && memcmp(targets[0].uid, benchUid, sizeof(benchUid)) == 0;
+	}
+
+	return NFC_GetPassiveTargetID(context, uid, &length) && length == sizeof(benchUid) &&
+		memcmp(uid, benchUid, sizeof(benchUid)) == 0;
+}
+
+static uint8_t Bench_Run(const char *name, const uint8_t autoPoll, const uint32_t emptyS, const uint16_t timeout, const uint8_t period)
+{
+	static NFC_Context context;
+	static NFC_Bus bus;
+	NFC_CommInterface interface = {0};
+	PN532_Sim_Stats stats;
+	const uint64_t arrive = (uint64_t)emptyS * 1000000000ULL;
+	const uint64_t end = arrive + (uint64_t)BENCH_CARD_S * 1000000000ULL;
+	uint32_t commands = 0, bytes = 0, wakeups = 0, startWakeups;
+	uint8_t empty = true;
+
+	PN532_Sim_Init();
+	PN532_Sim_AddCard(0, benchUid, sizeof(benchUid), arrive, PN532_SIM_NEVER);
+
+	interface.DelayUs = &NFC_Timer_DelayUs;
+	interface.GetTimeUs = &NFC_Timer_GetUs;
+	interface.GetByte = &NFC_SPI_GetByte;
+	interface.SendByte = &NFC_SPI_SendByte;
+	interface.SetSelect = &NFC_SPI_SetSelect;
+	interface.GetIRQ = &NFC_SPI_GetIRQ;
+	interface.WaitIRQ = &NFC_SPI_WaitIRQ;
+	interface.SendBuffer = &NFC_SPI_DMA_SendBuffer;
+	interface.ReceiveBuffer = &NFC_SPI_DMA_ReceiveBuffer;
+
+	if (!NFC_SPI_Init() || !NFC_SPI_DMA_Init() || !NFC_CommInit(&context, &interface, 0))
+	{
+		printf("%-9s can not be initialized\n", name);
+		return false;
+	}
+
+	NFC_Bus_Init(&bus, &NFC_SPI_Idle);
+	NFC_Bus_Add(&bus, &context);
+	if (autoPoll)
+	{
+		NFC_Bus_SetSleep(&bus, &NFC_SPI_Sleep);
+	}
+
+	startWakeups = Host_HAL_GetWakeups();
+
+	if (!Bench_Start(&context, autoPoll, timeout, period))
+	{
+		printf("%-9s command can not be started\n", name);
+		return false;
+	}
+
+	while (Host_Clock_Now() < end)
+	{
+		// Traffic of the empty field is taken when the card enters
+		if (empty && Host_Clock_Now() >= arrive)
+		{
+			PN532_Sim_GetStats(0, &stats);
+			commands = stats.commands;
+			bytes = stats.bytes;
+			wakeups = Host_HAL_GetWakeups() - startWakeups;
+			empty = false;
+		}
+
+		if (NFC_Bus_Process(&bus) == NULL)
+		{
+			continue;
+		}
+
+		if (Bench_CardRead(&context, autoPoll))
+		{
+			printf("%-9s %8.1f commands/s  %8.1f SPI bytes/s  %8.1f wakeups/s  card read after %6.1f ms\n",
+					name,
+					commands / (double)emptyS,
+					bytes / (double)emptyS,
+					wakeups / (double)emptyS,
+					(Host_Clock_Now() - arrive) / 1e6);
+			return true;
+		}
+
+		Bench_Start(&context, autoPoll, timeout, period);
+	}
+
+	printf("%-9s card was not read\n", name);
+	return false;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t emptyS = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_EMPTY_S;
+	uint16_t timeout = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000;
+	uint8_t period = (argc > 3) ? strtoul(argv[3], NULL, 0) : 1;
+	RCC_ClkInitTypeDef clocks = {0};
+
+	if (emptyS == 0)
+	{
+		emptyS = 1;
+	}
+
+	if (!Host_HAL_Init())
+	{
+		printf("Register blocks can not be mapped\n");
+		return EXIT_FAILURE;
+	}
+
+	// APB1 of firmware, SPI2 kernel clock at 54 MHz
+	clocks.APB1CLKDivider = RCC_HCLK_DIV4;
+	HAL_RCC_ClockConfig(&clocks, FLASH_LATENCY_7);
+
+	Host_HAL_AttachPN532(SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin, 0);
+
+	printf("Field empty for %u s, InListPassiveTarget timeout %u ms, InAutoPoll period %u ms\n",
+			emptyS, timeout, period * PN532_AUTOPOLL_PERIODMS);
+
+	if (!Bench_Run("inlist", false, emptyS, timeout, period) ||
+		!Bench_Run("autopoll", true, emptyS, timeout, period))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
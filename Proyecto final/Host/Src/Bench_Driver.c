@@ -0,0 +1,372 @@
+/*
+ * Bench_Driver.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of the hot paths of NFC.c. The driver is included in this
+ *  file, so its static functions are measured directly:
+ *
+ *  - encode:     NFC_WriteCommand frame assembly, over a sink transport
+ *  - ack:        NFC_ReadACK read and validation of a canned ACK
+ *  - frame:      NFC_ReadFrame read and validation of a canned response
+ *  - checkack:   NFC_SendCommandCheckAck round trip against PN532_Sim
+ *  - readtarget: whole NFC_ReadPassiveTargetID against PN532_Sim, card in field
+ *
+ *  Round trips run over each transport model: per-byte and bulk blocking
+ *  calls, and DMA where the core is free while bytes are on the wire.
+ *  Results per operation: host CPU time (ns/op), modelled time on target
+ *  (us/op), frames on the bus per modelled second, core time in transport
+ *  calls, and heap allocations (malloc family is wrapped by the linker).
+ *
+ *  Usage: Bench_Driver [iterations] [SPI clock Hz] [ACK latency us] [command latency us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include "../../NFC_Drivers/Src/NFC.c"
+
+#define true	(1)
+#define false	(0)
+
+#define BENCH_ITERATIONS		(20000)
+#define BENCH_SPI_CLOCK_HZ		(843750)
+
+/// Cost of a HAL blocking call and of setting up a DMA transfer at 216 MHz
+#define BENCH_BLOCKING_CALL_NS	(4000)
+#define BENCH_DMA_CALL_NS		(1500)
+
+/// Transport model
+typedef struct
+{
+	const char *name;
+	uint8_t bulk;				///< Buffer functions instead of byte functions
+	uint32_t callNs;			///< Fixed cost of a call
+	uint8_t wireUsesCore;		///< Core waits bytes on wire, 0 for DMA
+}Bench_Transport;
+
+/// Result of one benchmark
+typedef struct
+{
+	double hostNs;				///< Host CPU time
+	double virtualNs;			///< Modelled time on target
+	double coreNs;				///< Modelled core time inside transport calls
+	double frames;				///< Frames moved on bus
+	double allocations;
+}Bench_Result;
+
+static const uint8_t benchAck[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+static const uint8_t benchFirmware[13] = {0x00, 0x00, 0xFF, 0x06, 0xFA, 0xD5, 0x03, 0x32, 0x01, 0x06, 0x07, 0xE8, 0x00};
+
+/// Sink transport: writes are dropped, reads replay a canned frame
+static const uint8_t *sinkFrame;
+static size_t sinkLength;
+static size_t sinkPosition;
+
+/// Heap accounting of wrapped malloc family
+static volatile uint32_t allocations;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size)
+{
+	allocations++;
+	return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *pointer, size_t size)
+{
+	allocations++;
+	return __real_realloc(pointer, size);
+}
+
+static void Sink_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	// Keep the compiler from dropping frame assembly
+	__asm volatile ("" : : "r" (buffer) : "memory");
+}
+
+static void Sink_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = (sinkPosition < sinkLength) ? sinkFrame[sinkPosition] : 0x00;
+		sinkPosition++;
+	}
+}
+
+static void Sink_SetSelect(uint8_t state)
+{
+	// First byte read after op code is the start of frame
+	sinkPosition = 0;
+}
+
+static uint8_t Sink_GetIRQ(void)
+{
+	return true;
+}
+
+static void Sink_DelayUs(uint32_t us)
+{
+}
+
+static void Sink_Interface(NFC_CommInterface *interface, const uint8_t *frame, size_t length)
+{
+	memset(interface, 0, sizeof(NFC_CommInterface));
+	interface->SendBuffer = &Sink_SendBuffer;
+	interface->ReceiveBuffer = &Sink_ReceiveBuffer;
+	interface->SetSelect = &Sink_SetSelect;
+	interface->GetIRQ = &Sink_GetIRQ;
+	interface->DelayUs = &Sink_DelayUs;
+
+	sinkFrame = frame;
+	sinkLength = length;
+	sinkPosition = 0;
+}
+
+static double Bench_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static void Bench_Print(const char *name, const char *transport, const Bench_Result *result)
+{
+	printf("%-14s %-9s %9.1f ns/op  %9.1f us/op  %9.0f frames/s  %8.1f us core/op  %5.2f allocs/op\n",
+			name, transport, result->hostNs, result->virtualNs / 1e3,
+			(result->virtualNs > 0) ? result->frames * 1e9 / result->virtualNs : 1e9 / result->hostNs,
+			result->coreNs / 1e3, result->allocations);
+}
+
+static void Bench_Encode(uint32_t iterations, uint16_t length)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	Bench_Result result = {0};
+	uint8_t command[PN532_BUFFERSIZE];
+	char name[24];
+	uint32_t i, heap;
+	double start;
+
+	Sink_Interface(&interface, NULL, 0);
+	NFC_CommInit(&context, &interface, 0);
+
+	memset(command, 0xA5, sizeof(command));
+	command[0] = PN532_COMMAND_INDATAEXCHANGE;
+
+	heap = allocations;
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		NFC_WriteCommand(&context, command, length);
+	}
+	result.hostNs = (Bench_Now() - start) / iterations;
+	result.allocations = (double)(allocations - heap) / iterations;
+	result.frames = 1;
+
+	snprintf(name, sizeof(name), "encode/%u", length);
+	Bench_Print(name, "sink", &result);
+}
+
+static void Bench_Ack(uint32_t iterations)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	Bench_Result result = {0};
+	uint32_t i, heap, valid = 0;
+	double start;
+
+	Sink_Interface(&interface, benchAck, sizeof(benchAck));
+	NFC_CommInit(&context, &interface, 0);
+
+	heap = allocations;
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		valid += NFC_ReadACK(&context);
+	}
+	result.hostNs = (Bench_Now() - start) / iterations;
+	result.allocations = (double)(allocations - heap) / iterations;
+
+	if (valid != iterations)
+	{
+		printf("ack: validation failed\n");
+	}
+
+	Bench_Print("ack", "sink", &result);
+}
+
+static void Bench_Frame(uint32_t iterations)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	NFC_FrameView view;
+	Bench_Result result = {0};
+	uint32_t i, heap, valid = 0;
+	double start;
+
+	Sink_Interface(&interface, benchFirmware, sizeof(benchFirmware));
+	NFC_CommInit(&context, &interface, 0);
+
+	heap = allocations;
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		valid += NFC_ReadFrame(&context, PN532_COMMAND_GETFIRMWAREVERSION, context.buffer, PN532_FRAMESIZE, &view);
+	}
+	result.hostNs = (Bench_Now() - start) / iterations;
+	result.allocations = (double)(allocations - heap) / iterations;
+
+	if (valid != iterations)
+	{
+		printf("frame: validation failed\n");
+	}
+
+	Bench_Print("frame", "sink", &result);
+}
+
+static void Bench_Setup(const Bench_Transport *transport, NFC_CommInterface *interface, uint32_t byteNs, uint32_t ackUs, uint32_t latencyUs)
+{
+	static const uint8_t uid[4] = {0x04, 0x1A, 0x2B, 0x3C};
+	uint16_t command;
+
+	PN532_Sim_Init();
+	PN532_Sim_SetTransportCost(transport->callNs, byteNs);
+	PN532_Sim_SetAckLatency(ackUs);
+
+	for (command = 0; command < 256; command++)
+	{
+		PN532_Sim_SetLatency(0, (uint8_t)command, latencyUs);
+	}
+
+	PN532_Sim_AddCard(0, uid, sizeof(uid), 0, PN532_SIM_NEVER);
+	PN532_Sim_GetInterface(interface, transport->bulk);
+}
+
+static void Bench_Finish(Bench_Result *result, const Bench_Transport *transport, uint32_t iterations, double hostNs, uint32_t heap)
+{
+	PN532_Sim_Stats stats;
+
+	PN532_Sim_GetStats(0, &stats);
+
+	result->hostNs = hostNs / iterations;
+	result->virtualNs = (double)Host_Clock_Now() / iterations;
+	result->frames = (double)(stats.commands + stats.acks + stats.responses) / iterations;
+	result->allocations = (double)(allocations - heap) / iterations;
+
+	// With DMA the core only pays set up of each transfer
+	result->coreNs = transport->wireUsesCore ? (double)stats.transportNs / iterations :
+					 (double)stats.calls * transport->callNs / iterations;
+}
+
+static void Bench_CheckAck(const Bench_Transport *transport, uint32_t iterations, uint32_t byteNs, uint32_t ackUs, uint32_t latencyUs)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	Bench_Result result = {0};
+	uint32_t i, heap, valid = 0;
+	double start;
+
+	Bench_Setup(transport, &interface, byteNs, ackUs, latencyUs);
+	NFC_CommInit(&context, &interface, 0);
+
+	heap = allocations;
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		// Response is left unread, next command frame drops it
+		context.buffer[0] = PN532_COMMAND_GETFIRMWAREVERSION;
+		valid += NFC_SendCommandCheckAck(&context, context.buffer, 1, 10);
+	}
+	Bench_Finish(&result, transport, iterations, Bench_Now() - start, heap);
+
+	if (valid != iterations)
+	{
+		printf("checkack: %u of %u failed\n", iterations - valid, iterations);
+	}
+
+	Bench_Print("checkack", transport->name, &result);
+}
+
+static void Bench_ReadTarget(const Bench_Transport *transport, uint32_t iterations, uint32_t byteNs, uint32_t ackUs, uint32_t latencyUs)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	Bench_Result result = {0};
+	uint8_t uid[NFC_PASSIVE_UIDSIZE], length;
+	uint32_t i, heap, valid = 0;
+	double start;
+
+	Bench_Setup(transport, &interface, byteNs, ackUs, latencyUs);
+	NFC_CommInit(&context, &interface, 0);
+
+	heap = allocations;
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		valid += NFC_ReadPassiveTargetID(&context, PN532_MIFARE_ISO14443A, uid, &length, 100);
+	}
+	Bench_Finish(&result, transport, iterations, Bench_Now() - start, heap);
+
+	if (valid != iterations)
+	{
+		printf("readtarget: %u of %u failed\n", iterations - valid, iterations);
+	}
+
+	Bench_Print("readtarget", transport->name, &result);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : BENCH_ITERATIONS;
+	uint32_t spiClock = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_SPI_CLOCK_HZ;
+	uint32_t ackUs = (argc > 3) ? strtoul(argv[3], NULL, 0) : PN532_SIM_ACK_US;
+	uint32_t latencyUs = (argc > 4) ? strtoul(argv[4], NULL, 0) : PN532_SIM_LATENCY_US;
+	uint32_t byteNs = (uint32_t)(8ULL * 1000000000ULL / spiClock);
+	const Bench_Transport transports[] =
+	{
+		{"per-byte", false, BENCH_BLOCKING_CALL_NS, true},
+		{"bulk", true, BENCH_BLOCKING_CALL_NS, true},
+		{"dma", true, BENCH_DMA_CALL_NS, false},
+	};
+	uint8_t i;
+
+	// Polls of HAL tick are free, only modelled transport and PN532 time count
+	Host_Clock_SetPollCost(0);
+
+	printf("%u iterations, %u Hz SPI, ACK %u us, command %u us\n", iterations, spiClock, ackUs, latencyUs);
+
+	Bench_Encode(iterations, 1);
+	Bench_Encode(iterations, 16);
+	Bench_Encode(iterations, PN532_BUFFERSIZE);
+	Bench_Ack(iterations);
+	Bench_Frame(iterations);
+
+	for (i = 0; i < sizeof(transports) / sizeof(transports[0]); i++)
+	{
+		Bench_CheckAck(&transports[i], iterations, byteNs, ackUs, latencyUs);
+	}
+
+	for (i = 0; i < sizeof(transports) / sizeof(transports[0]); i++)
+	{
+		Bench_ReadTarget(&transports[i], iterations, byteNs, ackUs, latencyUs);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,167 @@
+/*
+ * Bench_HSU.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of the HSU transport of the firmware against its SPI one.
+ *  NFC_SPI.c, NFC_SPI_DMA.c and NFC_HSU.c run over the HAL shim (Host_HAL),
+ *  with PN532_Sim behind them and default command latencies of the
+ *  simulator, so results are what the application sees.
+ *
+ *  The HSU link is raised with NFC_Link_SetSerial as the firmware does, then
+ *  each transport reads the UID of a card that stays in the field, and runs
+ *  GetFirmwareVersion; times are virtual. The last run limits the line to
+ *  500 kbaud to show negotiation going back from a rate that fails.
+ *
+ *  Usage: Bench_HSU [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "NFC_SPI.h"
+#include "NFC_SPI_DMA.h"
+#include "NFC_HSU.h"
+#include "NFC_Link.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Rate limit of the line in the last run
+#define BENCH_LIMITBAUD		(500000)
+
+static const uint8_t benchUid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+static uint8_t Bench_Setup(const uint32_t baud, NFC_CommInterface *interface)
+{
+	NFC_CommInterface setup = {0};
+
+	setup.DelayUs = &NFC_Timer_DelayUs;
+	setup.GetTimeUs = &NFC_Timer_GetUs;
+
+	if (baud != 0)
+	{
+		setup.GetByte = &NFC_HSU_GetByte;
+		setup.SendByte = &NFC_HSU_SendByte;
+		setup.SetSelect = &NFC_HSU_SetSelect;
+		setup.SendBuffer = &NFC_HSU_SendBuffer;
+		setup.ReceiveBuffer = &NFC_HSU_ReceiveBuffer;
+		setup.GetIRQ = &NFC_HSU_GetIRQ;
+		setup.WaitIRQ = &NFC_HSU_WaitIRQ;
+		*interface = setup;
+
+		return NFC_HSU_Init();
+	}
+
+	setup.GetByte = &NFC_SPI_GetByte;
+	setup.SendByte = &NFC_SPI_SendByte;
+	setup.SetSelect = &NFC_SPI_SetSelect;
+	setup.GetIRQ = &NFC_SPI_GetIRQ;
+	setup.WaitIRQ = &NFC_SPI_WaitIRQ;
+	setup.SendBuffer = &NFC_SPI_DMA_SendBuffer;
+	setup.ReceiveBuffer = &NFC_SPI_DMA_ReceiveBuffer;
+	*interface = setup;
+
+	return NFC_SPI_Init() && NFC_SPI_DMA_Init() && NFC_SPI_SetPrescaler(SPI_BAUDRATEPRESCALER_16);
+}
+
+/// baud 0 runs SPI2 at 3.375 MHz with DMA, the other way the fastest HSU rate to negotiate
+static uint8_t Bench_Run(const char *name, const uint32_t baud, const uint32_t limit, const uint32_t iterations)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	uint8_t uid[NFC_PASSIVE_UIDSIZE], length;
+	uint64_t start, negotiateNs = 0, readNs, versionNs;
+	uint32_t i;
+
+	PN532_Sim_Init();
+	PN532_Sim_AddCard(0, benchUid, sizeof(benchUid), 0, PN532_SIM_NEVER);
+	Host_HAL_SetUsartMaxBaud(limit);
+
+	if (!Bench_Setup(baud, &interface) || !NFC_CommInit(&context, &interface, 0) ||
+		!NFC_SAMConfig(&context))
+	{
+		printf("%-14s can not be initialized\n", name);
+		return false;
+	}
+
+	if (baud != 0)
+	{
+		start = Host_Clock_Now();
+		if (!NFC_Link_SetSerial(&context, baud))
+		{
+			printf("%-14s negotiation failed\n", name);
+			return false;
+		}
+		negotiateNs = Host_Clock_Now() - start;
+	}
+
+	start = Host_Clock_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (!NFC_ReadPassiveTargetID(&context, PN532_MIFARE_ISO14443A, uid, &length, 100) || length != sizeof(benchUid))
+		{
+			printf("%-14s card read failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	readNs = Host_Clock_Now() - start;
+
+	start = Host_Clock_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (NFC_GetFirmwareVersion(&context) != 0x03320106)
+		{
+			printf("%-14s GetFirmwareVersion failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	versionNs = Host_Clock_Now() - start;
+
+	printf("%-14s %8u baud  %8.1f us/card read  %8.1f us/version  %8.1f us negotiation\n",
+			name,
+			(baud != 0) ? NFC_HSU_GetBaudRate() : 0,
+			readNs / 1e3 / iterations,
+			versionNs / 1e3 / iterations,
+			negotiateNs / 1e3);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	RCC_ClkInitTypeDef clocks = {0};
+
+	if (!Host_HAL_Init())
+	{
+		printf("Register blocks can not be mapped\n");
+		return EXIT_FAILURE;
+	}
+
+	// APB1 and APB2 of firmware, SPI2 kernel clock at 54 MHz and USART6 one at 108 MHz
+	clocks.APB1CLKDivider = RCC_HCLK_DIV4;
+	clocks.APB2CLKDivider = RCC_HCLK_DIV2;
+	HAL_RCC_ClockConfig(&clocks, FLASH_LATENCY_7);
+
+	Host_HAL_AttachPN532(SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin, 0);
+
+	printf("InListPassiveTarget of a card in field and GetFirmwareVersion x %u\n", iterations);
+
+	if (!Bench_Run("spi 3.4M dma", 0, 0, iterations) ||
+		!Bench_Run("hsu 115200", 115200, 0, iterations) ||
+		!Bench_Run("hsu 460800", 460800, 0, iterations) ||
+		!Bench_Run("hsu 921600", 921600, 0, iterations) ||
+		!Bench_Run("hsu 1288000", NFC_HSU_BAUD_MAX, 0, iterations) ||
+		!Bench_Run("hsu limited", NFC_HSU_BAUD_MAX, BENCH_LIMITBAUD, iterations))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+/*
+ * Bench_Harness.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include <stdio.h>
+#include "Bench_Harness.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+
+#define true	(1)
+#define false	(0)
+
+const uint8_t benchHarnessSectors[BENCH_HARNESS_SECTORS] = {1, 2, 3, 4};
+const uint8_t benchHarnessUid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+static uint8_t Bench_Harness_Strategy(const Bench_Harness *harness, const Bench_HarnessStrategy *strategy, const uint32_t iterations)
+{
+	static NFC_Context context;
+	NFC_CommInterface interface;
+	PN532_Sim_Stats stats;
+	uint64_t elapsed = 0, bus = 0;
+	uint32_t i, commands = 0;
+
+	PN532_Sim_GetInterface(&interface, true);
+
+	if (harness->Start != NULL)
+	{
+		harness->Start(strategy->strategy);
+	}
+
+	for (i = 0; i < iterations; i++)
+	{
+		// Every tap starts with the cards just put in field and the clock at zero
+		PN532_Sim_Init();
+		PN532_Sim_SetLatency(0, PN532_COMMAND_INLISTPASSIVETARGET, harness->targetUs);
+
+		if (!harness->Setup(i, strategy->strategy) || !NFC_CommInit(&context, &interface, 0) ||
+			!harness->Tap(&context, strategy->strategy))
+		{
+			printf("%-10s tap failed at iteration %u\n", strategy->name, i);
+			return false;
+		}
+
+		PN532_Sim_GetStats(0, &stats);
+		elapsed += Host_Clock_Now();
+		bus += stats.transportNs;
+		commands += stats.commands;
+
+		if (harness->Done != NULL)
+		{
+			harness->Done(strategy->strategy);
+		}
+	}
+
+	if (harness->Finish != NULL && !harness->Finish(strategy->strategy, iterations))
+	{
+		return false;
+	}
+
+	printf("%-10s %8.1f us/tap  %5.1f commands/tap  %8.1f us bus/tap",
+			strategy->name,
+			elapsed / 1e3 / iterations,
+			(double)commands / iterations,
+			bus / 1e3 / iterations);
+
+	if (harness->counter != NULL)
+	{
+		printf("  %4.1f %s/tap", (double)*harness->counter / iterations, harness->counterName);
+	}
+	printf("\n");
+
+	return true;
+}
+
+uint8_t Bench_Harness_Run(const Bench_Harness *harness, const uint32_t iterations)
+{
+	uint8_t i;
+
+	for (i = 0; i < harness->count; i++)
+	{
+		if (!Bench_Harness_Strategy(harness, &harness->strategies[i], iterations))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,166 @@
+/*
+ * Bench_I2C.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of the I2C transport of the firmware against its SPI one.
+ *  NFC_SPI.c, NFC_SPI_DMA.c and NFC_I2C.c run over the HAL shim (Host_HAL)
+ *  with PN532_Sim behind them, so every transfer is charged the wire time of
+ *  its bus: SPI bytes take 8 clocks of SPI2, I2C bytes 9 clocks of SCL plus
+ *  START, address and STOP of each transfer, and I2C reads one status byte
+ *  more. Processing time of commands is zero, results are transport only.
+ *
+ *  Each transport runs GetFirmwareVersion and Diagnose with the biggest data
+ *  the driver buffer takes; times are virtual, core busy is the time it was
+ *  not asleep in WFI.
+ *
+ *  Usage: Bench_I2C [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "NFC_SPI.h"
+#include "NFC_SPI_DMA.h"
+#include "NFC_I2C.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Data echoed by Diagnose, the whole command buffer of the driver
+#define BENCH_DIAGNOSE_LENGTH	(PN532_BUFFERSIZE - 2)
+
+/// Transports compared
+#define BENCH_SPI				(0)
+#define BENCH_SPI_DMA			(1)
+#define BENCH_I2C_POLL			(2)
+#define BENCH_I2C_IRQ			(3)
+
+static uint8_t Bench_Setup(const uint8_t transport, NFC_CommInterface *interface)
+{
+	NFC_CommInterface setup = {0};
+
+	setup.DelayUs = &NFC_Timer_DelayUs;
+	setup.GetTimeUs = &NFC_Timer_GetUs;
+
+	if (transport == BENCH_I2C_POLL || transport == BENCH_I2C_IRQ)
+	{
+		setup.GetByte = &NFC_I2C_GetByte;
+		setup.SendByte = &NFC_I2C_SendByte;
+		setup.SetSelect = &NFC_I2C_SetSelect;
+		setup.SendBuffer = &NFC_I2C_SendBuffer;
+		setup.ReceiveBuffer = &NFC_I2C_ReceiveBuffer;
+		setup.GetIRQ = &NFC_I2C_GetIRQ;
+		setup.WaitIRQ = (transport == BENCH_I2C_IRQ) ? &NFC_SPI_WaitIRQ : NULL;
+		*interface = setup;
+
+		return NFC_I2C_Init(transport == BENCH_I2C_IRQ);
+	}
+
+	setup.GetByte = &NFC_SPI_GetByte;
+	setup.SendByte = &NFC_SPI_SendByte;
+	setup.SetSelect = &NFC_SPI_SetSelect;
+	setup.GetIRQ = &NFC_SPI_GetIRQ;
+	setup.WaitIRQ = &NFC_SPI_WaitIRQ;
+	setup.SendBuffer = (transport == BENCH_SPI_DMA) ? &NFC_SPI_DMA_SendBuffer : &NFC_SPI_SendBuffer;
+	setup.ReceiveBuffer = (transport == BENCH_SPI_DMA) ? &NFC_SPI_DMA_ReceiveBuffer : &NFC_SPI_ReceiveBuffer;
+	*interface = setup;
+
+	return NFC_SPI_Init() && NFC_SPI_DMA_Init();
+}
+
+/// SPI2 clock is given by prescaler, 0 for I2C transports
+static uint8_t Bench_Run(const char *name, const uint8_t transport, const uint32_t prescaler, const uint32_t iterations)
+{
+	static NFC_Context context;
+	static uint8_t data[BENCH_DIAGNOSE_LENGTH];
+	NFC_CommInterface interface;
+	uint64_t start, sleep, versionNs, diagnoseNs;
+	uint32_t i;
+
+	PN532_Sim_Init();
+	PN532_Sim_SetLatency(0, PN532_COMMAND_GETFIRMWAREVERSION, 0);
+	PN532_Sim_SetLatency(0, PN532_COMMAND_DIAGNOSE, 0);
+
+	if (!Bench_Setup(transport, &interface) || !NFC_CommInit(&context, &interface, 0) ||
+		(prescaler != 0 && !NFC_SPI_SetPrescaler(prescaler)))
+	{
+		printf("%-14s can not be initialized\n", name);
+		return false;
+	}
+
+	for (i = 0; i < BENCH_DIAGNOSE_LENGTH; i++)
+	{
+		data[i] = (uint8_t)(i * 7 + 1);
+	}
+
+	sleep = Host_HAL_GetSleepNs();
+	start = Host_Clock_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (NFC_GetFirmwareVersion(&context) != 0x03320106)
+		{
+			printf("%-14s GetFirmwareVersion failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	versionNs = Host_Clock_Now() - start;
+
+	start = Host_Clock_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (!NFC_Diagnose(&context, data, BENCH_DIAGNOSE_LENGTH, 100))
+		{
+			printf("%-14s Diagnose failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	diagnoseNs = Host_Clock_Now() - start;
+	sleep = Host_HAL_GetSleepNs() - sleep;
+
+	printf("%-14s %8.1f us/version  %8.1f us/diagnose  %8.0f data bytes/s  %5.1f %% core busy\n",
+			name,
+			versionNs / 1e3 / iterations,
+			diagnoseNs / 1e3 / iterations,
+			2.0 * BENCH_DIAGNOSE_LENGTH * iterations * 1e9 / diagnoseNs,
+			100.0 - 100.0 * sleep / (versionNs + diagnoseNs));
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	RCC_ClkInitTypeDef clocks = {0};
+
+	if (!Host_HAL_Init())
+	{
+		printf("Register blocks can not be mapped\n");
+		return EXIT_FAILURE;
+	}
+
+	// APB1 of firmware, SPI2 and I2C1 kernel clock at 54 MHz
+	clocks.APB1CLKDivider = RCC_HCLK_DIV4;
+	HAL_RCC_ClockConfig(&clocks, FLASH_LATENCY_7);
+
+	Host_HAL_AttachPN532(SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin, 0);
+
+	printf("GetFirmwareVersion and Diagnose of %u bytes x %u, I2C1 in Fast-mode\n",
+			BENCH_DIAGNOSE_LENGTH, iterations);
+
+	if (!Bench_Run("spi 844k", BENCH_SPI, SPI_BAUDRATEPRESCALER_64, iterations) ||
+		!Bench_Run("spi 844k dma", BENCH_SPI_DMA, SPI_BAUDRATEPRESCALER_64, iterations) ||
+		!Bench_Run("spi 3.4M dma", BENCH_SPI_DMA, SPI_BAUDRATEPRESCALER_16, iterations) ||
+		!Bench_Run("i2c poll", BENCH_I2C_POLL, 0, iterations) ||
+		!Bench_Run("i2c irq", BENCH_I2C_IRQ, 0, iterations))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
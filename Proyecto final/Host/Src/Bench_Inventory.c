@@ -0,0 +1,168 @@
+/*
+ * Bench_Inventory.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of reading two MIFARE Classic cards stacked in the field.
+ *  Each card is authenticated in sector 1 and block 4 is read:
+ *
+ *  - repoll:    InListPassiveTarget of one card, read, InRelease to halt
+ *               it, then InListPassiveTarget again for the other card
+ *  - inventory: one InListPassiveTarget of both cards, InDataExchange
+ *               selects each target by its logical number, starting with
+ *               the last one listed as it is still selected
+ *  - select:    same inventory with InSelect before each card
+ *
+ *  PN532_Sim charges the given time to list the first target, its
+ *  PN532_SIM_ACTIVATION_US for the second one, the given time to select a
+ *  target again, PN532_SIM_LATENCY_US to exchange a frame with a card and
+ *  BENCH_RELEASE_US to halt a card. Times are virtual, SPI transfers are
+ *  charged with the cost model of the simulator.
+ *
+ *  Usage: Bench_Inventory [iterations] [InListPassiveTarget us] [selection us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include "Bench_Harness.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default time to wake up and select a listed target again
+#define BENCH_SELECT_US		(1000)
+
+/// Time of InRelease and InDeselect, a HLTA frame to the card
+#define BENCH_RELEASE_US	(300)
+
+/// Strategies compared
+#define BENCH_REPOLL		(0)
+#define BENCH_INVENTORY		(1)
+#define BENCH_SELECT		(2)
+
+static const uint8_t benchUid[2][4] = {{0xDE, 0xAD, 0xBE, 0xEF}, {0xCA, 0xFE, 0xF0, 0x0D}};
+static const uint8_t benchKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static const Bench_HarnessStrategy benchStrategies[] =
+{
+	{"repoll", BENCH_REPOLL},
+	{"inventory", BENCH_INVENTORY},
+	{"select", BENCH_SELECT},
+};
+
+static uint32_t selectUs;
+
+/// Authenticate sector 1 with key A and read block 4, the block is checked against the card
+static uint8_t Bench_ReadCard(NFC_Context *context, const NFC_Target *target)
+{
+	uint8_t command[12];
+	NFC_FrameView response;
+
+	command[0] = MIFARE_CMD_AUTH_A;
+	command[1] = 4;
+	memcpy(&command[2], benchKey, sizeof(benchKey));
+	memcpy(&command[8], target->uid, 4);
+
+	if (!NFC_InDataExchange(context, target->number, command, sizeof(command), &response, 100))
+	{
+		return false;
+	}
+
+	command[0] = MIFARE_CMD_READ;
+	command[1] = 4;
+
+	if (!NFC_InDataExchange(context, target->number, command, 2, &response, 100) || response.length != 16)
+	{
+		return false;
+	}
+
+	// Sim writes the first byte of UID in block 4 of each card
+	return response.data[0] == target->uid[0];
+}
+
+static uint8_t Bench_Tap(NFC_Context *context, const uint8_t strategy)
+{
+	NFC_Target targets[PN532_AUTOPOLL_MAXTARGETS];
+	uint8_t found, i;
+
+	if (strategy == BENCH_REPOLL)
+	{
+		// Card read is halted, so the next poll finds the other one
+		for (i = 0; i < 2; i++)
+		{
+			if (!NFC_ListPassiveTargets(context, 1, targets, &found, 100) ||
+				!Bench_ReadCard(context, &targets[0]) ||
+				!NFC_InRelease(context, targets[0].number, 100))
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	if (!NFC_ListPassiveTargets(context, PN532_AUTOPOLL_MAXTARGETS, targets, &found, 100) || found != 2)
+	{
+		return false;
+	}
+
+	for (i = found; i > 0; i--)
+	{
+		if ((strategy == BENCH_SELECT && !NFC_InSelect(context, targets[i - 1].number, 100)) ||
+			!Bench_ReadCard(context, &targets[i - 1]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/// Both cards are put in field, the first byte of their UID is written in block 4
+static uint8_t Bench_Setup(const uint32_t iteration, const uint8_t strategy)
+{
+	PN532_Sim_Card *card;
+	uint8_t i;
+
+	PN532_Sim_SetLatency(0, PN532_COMMAND_INSELECT, selectUs);
+	PN532_Sim_SetLatency(0, PN532_COMMAND_INRELEASE, BENCH_RELEASE_US);
+	PN532_Sim_SetLatency(0, PN532_COMMAND_INDESELECT, BENCH_RELEASE_US);
+
+	for (i = 0; i < 2; i++)
+	{
+		card = PN532_Sim_AddCard(0, benchUid[i], sizeof(benchUid[i]), 0, PN532_SIM_NEVER);
+		if (card == NULL)
+		{
+			return false;
+		}
+
+		card->memory[4][0] = benchUid[i][0];
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	Bench_Harness harness =
+	{
+		.targetUs = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_HARNESS_TARGET_US,
+		.strategies = benchStrategies,
+		.count = sizeof(benchStrategies) / sizeof(benchStrategies[0]),
+		.Setup = &Bench_Setup,
+		.Tap = &Bench_Tap,
+	};
+
+	selectUs = (argc > 3) ? strtoul(argv[3], NULL, 0) : BENCH_SELECT_US;
+
+	printf("Two cards x %u, InListPassiveTarget %u us + %u us, selection %u us, exchange %u us, release %u us\n",
+			iterations, harness.targetUs, PN532_SIM_ACTIVATION_US, selectUs, PN532_SIM_LATENCY_US, BENCH_RELEASE_US);
+
+	return Bench_Harness_Run(&harness, iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
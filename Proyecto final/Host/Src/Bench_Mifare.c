@@ -0,0 +1,188 @@
+/*
+ * Bench_Mifare.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of a ticketing tap: a MIFARE Classic card is listed and
+ *  the data blocks of sectors 1 to 4 are read and parsed.
+ *
+ *  - block:     NFC_Mifare_SetKey and NFC_Mifare_Authenticate before each
+ *               block, the key set ends the session so every block is
+ *               authenticated
+ *  - cached:    NFC_Mifare_Authenticate before each block, sent once each
+ *               sector as the sector stays authenticated
+ *  - sector:    NFC_Mifare_ReadSector, one authentication each sector,
+ *               blocks are parsed after the sector is read
+ *  - pipelined: NFC_Mifare_ReadSectors, each block is parsed while PN532
+ *               exchanges the next one with the card
+ *
+ *  Parsing of a block takes the given time of the core. PN532_Sim answers
+ *  with its default times, listing the card takes BENCH_TARGET_US. Times are
+ *  virtual, tap-to-result is the time from InListPassiveTarget to the last
+ *  block parsed.
+ *
+ *  Usage: Bench_Mifare [iterations] [parse us per block]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "NFC_Mifare.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include "Bench_Harness.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default time of the core to parse one block
+#define BENCH_PARSE_US		(300)
+
+/// Strategies compared
+#define BENCH_BLOCK			(0)
+#define BENCH_CACHED		(1)
+#define BENCH_SECTOR		(2)
+#define BENCH_PIPELINED		(3)
+
+static const uint8_t benchKey[NFC_MIFARE_KEYSIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static const Bench_HarnessStrategy benchStrategies[] =
+{
+	{"block", BENCH_BLOCK},
+	{"cached", BENCH_CACHED},
+	{"sector", BENCH_SECTOR},
+	{"pipelined", BENCH_PIPELINED},
+};
+
+static uint32_t parseUs;
+static uint32_t parsed;
+
+/// Parsing of a ticket block, checks the block pattern written in the card
+static void Bench_Parse(const uint8_t block, const uint8_t *data, void *user)
+{
+	Host_Clock_Advance((uint64_t)parseUs * 1000);
+
+	if (data[0] == block && (data[15] ^ block) == 0xFF)
+	{
+		parsed++;
+	}
+}
+
+static uint8_t Bench_Tap(NFC_Context *context, const uint8_t strategy)
+{
+	uint8_t data[NFC_MIFARE_MAXBLOCKS * NFC_MIFARE_BLOCKSIZE], found, i, j, block;
+	NFC_Target target;
+	NFC_Mifare card;
+
+	if (!NFC_ListPassiveTargets(context, 1, &target, &found, 100) || !NFC_Mifare_Init(&card, context, &target))
+	{
+		return false;
+	}
+
+	if (strategy == BENCH_PIPELINED)
+	{
+		return NFC_Mifare_ReadSectors(&card, benchHarnessSectors, BENCH_HARNESS_SECTORS, false, &Bench_Parse, NULL);
+	}
+
+	for (i = 0; i < BENCH_HARNESS_SECTORS; i++)
+	{
+		block = NFC_Mifare_FirstBlock(benchHarnessSectors[i]);
+
+		if (strategy == BENCH_SECTOR)
+		{
+			if (!NFC_Mifare_ReadSector(&card, benchHarnessSectors[i], false, data))
+			{
+				return false;
+			}
+
+			for (j = 0; j < 3; j++)
+			{
+				Bench_Parse(block + j, &data[j * NFC_MIFARE_BLOCKSIZE], NULL);
+			}
+			continue;
+		}
+
+		for (j = 0; j < 3; j++)
+		{
+			if (strategy == BENCH_BLOCK)
+			{
+				NFC_Mifare_SetKey(&card, MIFARE_CMD_AUTH_A, benchKey);
+			}
+
+			if (!NFC_Mifare_Authenticate(&card, benchHarnessSectors[i]) || !NFC_Mifare_ReadBlock(&card, block + j, data))
+			{
+				return false;
+			}
+
+			Bench_Parse(block + j, data, NULL);
+		}
+	}
+
+	return true;
+}
+
+static void Bench_Start(const uint8_t strategy)
+{
+	parsed = 0;
+}
+
+/// Data blocks hold a pattern of their number, trailers keep the transport keys
+static uint8_t Bench_Setup(const uint32_t iteration, const uint8_t strategy)
+{
+	PN532_Sim_Card *card;
+	uint8_t block;
+
+	card = PN532_Sim_AddCard(0, benchHarnessUid, sizeof(benchHarnessUid), 0, PN532_SIM_NEVER);
+	if (card == NULL)
+	{
+		return false;
+	}
+
+	for (block = 4; block < 4 + BENCH_HARNESS_SECTORS * 4; block++)
+	{
+		if ((block & 0x03) == 0x03)
+		{
+			continue;
+		}
+
+		card->memory[block][0] = block;
+		card->memory[block][15] = ~block;
+	}
+
+	return true;
+}
+
+static uint8_t Bench_Finish(const uint8_t strategy, const uint32_t iterations)
+{
+	if (parsed != iterations * BENCH_HARNESS_SECTORS * 3)
+	{
+		printf("%u blocks parsed of %u\n", parsed, iterations * BENCH_HARNESS_SECTORS * 3);
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	Bench_Harness harness =
+	{
+		.targetUs = BENCH_HARNESS_TARGET_US,
+		.strategies = benchStrategies,
+		.count = sizeof(benchStrategies) / sizeof(benchStrategies[0]),
+		.Start = &Bench_Start,
+		.Setup = &Bench_Setup,
+		.Tap = &Bench_Tap,
+		.Finish = &Bench_Finish,
+	};
+
+	parseUs = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_PARSE_US;
+
+	printf("%u sectors of 3 blocks x %u, exchange %u us, parse %u us/block\n",
+			BENCH_HARNESS_SECTORS, iterations, PN532_SIM_LATENCY_US, parseUs);
+
+	return Bench_Harness_Run(&harness, iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
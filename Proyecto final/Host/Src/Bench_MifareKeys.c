@@ -0,0 +1,187 @@
+/*
+ * Bench_MifareKeys.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of a ticketing tap with keys diversified per UID: sectors
+ *  1 to 4 are read, then block 16 of sector 4 is written with the new ticket
+ *  and read back to check it.
+ *
+ *  - derive:  key of each sector is derived before its authentication and
+ *             set with NFC_Mifare_SetKey, every access authenticates
+ *  - table:   key table of NFC_Mifare_UseKeys, keys are derived during the
+ *             first exchange and sector 4 stays authenticated for the update
+ *  - retap:   same as table with the card tapped again, its keys are in table
+ *
+ *  Diversification of a key takes the given time of the core. Times are
+ *  virtual, tap-to-result is the time from InListPassiveTarget to the block
+ *  read back.
+ *
+ *  Usage: Bench_MifareKeys [iterations] [diversification us per key]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "NFC_Mifare.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include "Bench_Harness.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default time of the core to derive one key
+#define BENCH_DIVERSIFY_US	(500)
+
+/// Block of the ticket updated in each tap
+#define BENCH_TICKET		(16)
+
+/// Strategies compared
+#define BENCH_DERIVE		(0)
+#define BENCH_TABLE			(1)
+#define BENCH_RETAP			(2)
+
+static const Bench_HarnessStrategy benchStrategies[] =
+{
+	{"derive", BENCH_DERIVE},
+	{"table", BENCH_TABLE},
+	{"retap", BENCH_RETAP},
+};
+
+static NFC_MifareKeys benchKeys;
+static uint32_t diversifyUs;
+static uint32_t derived;
+
+/// Key of a sector of a card, written in its trailer by the issuer
+static void Bench_Key(const uint8_t *uid, const uint8_t uidLength, const uint8_t sector, uint8_t *key)
+{
+	uint8_t i;
+
+	for (i = 0; i < NFC_MIFARE_KEYSIZE; i++)
+	{
+		key[i] = uid[i % uidLength] ^ (sector * 0x11) ^ i;
+	}
+}
+
+/// Diversification of a key in the reader, the cost of a CMAC is charged to the core
+static void Bench_Diversify(const uint8_t *uid, const uint8_t uidLength, const uint8_t sector, uint8_t *key, void *user)
+{
+	Host_Clock_Advance((uint64_t)diversifyUs * 1000);
+	derived++;
+
+	Bench_Key(uid, uidLength, sector, key);
+}
+
+/// Blocks read are not parsed, only counted
+static void Bench_Block(const uint8_t block, const uint8_t *data, void *user)
+{
+	(*(uint8_t *)user)++;
+}
+
+static uint8_t Bench_Tap(NFC_Context *context, const uint8_t strategy)
+{
+	uint8_t data[NFC_MIFARE_MAXBLOCKS * NFC_MIFARE_BLOCKSIZE], key[NFC_MIFARE_KEYSIZE], found, i, blocks = 0;
+	NFC_Target target;
+	NFC_Mifare card;
+
+	if (!NFC_ListPassiveTargets(context, 1, &target, &found, 100) || !NFC_Mifare_Init(&card, context, &target))
+	{
+		return false;
+	}
+
+	if (strategy == BENCH_DERIVE)
+	{
+		for (i = 0; i < BENCH_HARNESS_SECTORS; i++)
+		{
+			Bench_Diversify(target.uid, target.uidLength, benchHarnessSectors[i], key, NULL);
+			NFC_Mifare_SetKey(&card, MIFARE_CMD_AUTH_A, key);
+
+			if (!NFC_Mifare_ReadSectors(&card, &benchHarnessSectors[i], 1, false, &Bench_Block, &blocks))
+			{
+				return false;
+			}
+		}
+
+		// Ticket update authenticates sector 4 again
+		Bench_Diversify(target.uid, target.uidLength, 4, key, NULL);
+		NFC_Mifare_SetKey(&card, MIFARE_CMD_AUTH_A, key);
+	}
+	else
+	{
+		NFC_Mifare_UseKeys(&card, &benchKeys);
+
+		if (!NFC_Mifare_ReadSectors(&card, benchHarnessSectors, BENCH_HARNESS_SECTORS, false, &Bench_Block, &blocks))
+		{
+			return false;
+		}
+	}
+
+	memset(data, 0xA5, NFC_MIFARE_BLOCKSIZE);
+
+	if (!NFC_Mifare_Authenticate(&card, 4) ||
+		!NFC_Mifare_WriteBlock(&card, BENCH_TICKET, data) ||
+		!NFC_Mifare_ReadBlock(&card, BENCH_TICKET, data))
+	{
+		return false;
+	}
+
+	return (blocks == BENCH_HARNESS_SECTORS * 3 && data[0] == 0xA5) ? true : false;
+}
+
+/// Key table starts empty for each strategy
+static void Bench_Start(const uint8_t strategy)
+{
+	NFC_Mifare_KeysInit(&benchKeys, MIFARE_CMD_AUTH_A, benchHarnessSectors, BENCH_HARNESS_SECTORS, &Bench_Diversify, NULL);
+	derived = 0;
+}
+
+/// A new card each tap, or the same one again, trailers hold its diversified key A
+static uint8_t Bench_Setup(const uint32_t iteration, const uint8_t strategy)
+{
+	PN532_Sim_Card *card;
+	uint8_t uid[4], i;
+
+	uid[0] = 0x04;
+	uid[1] = (strategy == BENCH_RETAP) ? 0 : iteration;
+	uid[2] = (strategy == BENCH_RETAP) ? 0 : iteration >> 8;
+	uid[3] = (strategy == BENCH_RETAP) ? 0 : iteration >> 16;
+
+	card = PN532_Sim_AddCard(0, uid, sizeof(uid), 0, PN532_SIM_NEVER);
+	if (card == NULL)
+	{
+		return false;
+	}
+
+	for (i = 0; i < BENCH_HARNESS_SECTORS; i++)
+	{
+		Bench_Key(uid, sizeof(uid), benchHarnessSectors[i], card->memory[benchHarnessSectors[i] * 4 + 3]);
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	Bench_Harness harness =
+	{
+		.targetUs = BENCH_HARNESS_TARGET_US,
+		.strategies = benchStrategies,
+		.count = sizeof(benchStrategies) / sizeof(benchStrategies[0]),
+		.counter = &derived,
+		.counterName = "keys derived",
+		.Start = &Bench_Start,
+		.Setup = &Bench_Setup,
+		.Tap = &Bench_Tap,
+	};
+
+	diversifyUs = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_DIVERSIFY_US;
+
+	printf("%u sectors of 3 blocks and a ticket update x %u, exchange %u us, diversification %u us/key\n",
+			BENCH_HARNESS_SECTORS, iterations, PN532_SIM_LATENCY_US, diversifyUs);
+
+	return Bench_Harness_Run(&harness, iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
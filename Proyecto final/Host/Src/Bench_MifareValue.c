@@ -0,0 +1,180 @@
+/*
+ * Bench_MifareValue.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of a turnstile tap: sectors 1 to 4 of the ticket are read
+ *  and one fare is deducted from the purse of blocks 17 and 18 in sector 4.
+ *  The same card is tapped again and again, its balance is checked at the end.
+ *
+ *  - readback: value read again, decrement transferred to block 17, read
+ *              back to check it and restored to backup block 18
+ *  - purse:    purse loaded from the blocks of the ticket read, decrement
+ *              of current block transferred to the other one. Every 10th
+ *              tap the block not current is torn before the tap
+ *
+ *  PN532_Sim answers with its default times, listing the card takes
+ *  BENCH_TARGET_US. Times are virtual, tap-to-result is the time from
+ *  InListPassiveTarget to the fare deducted.
+ *
+ *  Usage: Bench_MifareValue [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "NFC_Mifare.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include "Bench_Harness.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Blocks of purse, in the last sector of the ticket
+#define BENCH_VALUE			(17)
+#define BENCH_BACKUP		(18)
+
+/// Fare and initial balance
+#define BENCH_FARE			(125)
+#define BENCH_BALANCE		(100000000)
+
+/// Strategies compared
+#define BENCH_READBACK		(0)
+#define BENCH_PURSE			(1)
+
+static const Bench_HarnessStrategy benchStrategies[] =
+{
+	{"readback", BENCH_READBACK},
+	{"purse", BENCH_PURSE},
+};
+
+/// Memory of card kept between taps
+static uint8_t benchMemory[PN532_SIM_BLOCKS][PN532_SIM_BLOCKSIZE];
+
+/// Card of the tap in PN532_Sim
+static PN532_Sim_Card *benchCard;
+
+/// Blocks of purse taken from the ticket read
+static uint8_t benchPurse[2][NFC_MIFARE_BLOCKSIZE];
+
+static void Bench_Block(const uint8_t block, const uint8_t *data, void *user)
+{
+	if (block == BENCH_VALUE || block == BENCH_BACKUP)
+	{
+		memcpy(benchPurse[block - BENCH_VALUE], data, NFC_MIFARE_BLOCKSIZE);
+	}
+}
+
+static uint8_t Bench_Tap(NFC_Context *context, const uint8_t strategy)
+{
+	NFC_MifarePurse purse;
+	NFC_Target target;
+	NFC_Mifare card;
+	int32_t value, check;
+	uint8_t found;
+
+	if (!NFC_ListPassiveTargets(context, 1, &target, &found, 100) || !NFC_Mifare_Init(&card, context, &target) ||
+		!NFC_Mifare_ReadSectors(&card, benchHarnessSectors, BENCH_HARNESS_SECTORS, false, &Bench_Block, NULL))
+	{
+		return false;
+	}
+
+	if (strategy == BENCH_PURSE)
+	{
+		// Redundancy of both blocks is checked on the data of the ticket read
+		return (NFC_Mifare_PurseInit(&purse, BENCH_VALUE, BENCH_BACKUP) &&
+				NFC_Mifare_PurseLoad(&purse, benchPurse[0], benchPurse[1]) &&
+				NFC_Mifare_PurseDebit(&card, &purse, BENCH_FARE)) ? true : false;
+	}
+
+	if (!NFC_Mifare_ReadValue(&card, BENCH_VALUE, &value, NULL) || value < BENCH_FARE ||
+		!NFC_Mifare_Decrement(&card, BENCH_VALUE, BENCH_FARE, BENCH_VALUE) ||
+		!NFC_Mifare_ReadValue(&card, BENCH_VALUE, &check, NULL) || check != value - BENCH_FARE ||
+		!NFC_Mifare_Restore(&card, BENCH_VALUE, BENCH_BACKUP))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+/// Card is issued with the balance in both blocks
+static void Bench_Start(const uint8_t strategy)
+{
+	PN532_Sim_Card *card;
+
+	PN532_Sim_Init();
+	card = PN532_Sim_AddCard(0, benchHarnessUid, sizeof(benchHarnessUid), 0, PN532_SIM_NEVER);
+	memcpy(benchMemory, card->memory, sizeof(benchMemory));
+	NFC_Mifare_EncodeValue(BENCH_BALANCE, BENCH_VALUE, benchMemory[BENCH_VALUE]);
+	NFC_Mifare_EncodeValue(BENCH_BALANCE, BENCH_BACKUP, benchMemory[BENCH_BACKUP]);
+}
+
+/// Same card tapped again with the memory left by the last tap
+static uint8_t Bench_Setup(const uint32_t iteration, const uint8_t strategy)
+{
+	NFC_MifarePurse purse;
+
+	benchCard = PN532_Sim_AddCard(0, benchHarnessUid, sizeof(benchHarnessUid), 0, PN532_SIM_NEVER);
+	if (benchCard == NULL)
+	{
+		return false;
+	}
+
+	memcpy(benchCard->memory, benchMemory, sizeof(benchMemory));
+
+	// Tear the block with the old balance, as a transfer cut by the card leaving
+	if (strategy == BENCH_PURSE && iteration % 10 == 9)
+	{
+		NFC_Mifare_PurseInit(&purse, BENCH_VALUE, BENCH_BACKUP);
+		NFC_Mifare_PurseLoad(&purse, benchCard->memory[BENCH_VALUE], benchCard->memory[BENCH_BACKUP]);
+		benchCard->memory[purse.blocks[purse.current ^ 1]][5] ^= 0x5A;
+	}
+
+	return true;
+}
+
+static void Bench_Done(const uint8_t strategy)
+{
+	memcpy(benchMemory, benchCard->memory, sizeof(benchMemory));
+}
+
+/// Balance left in the card after every fare deducted
+static uint8_t Bench_Finish(const uint8_t strategy, const uint32_t iterations)
+{
+	NFC_MifarePurse purse;
+
+	NFC_Mifare_PurseInit(&purse, BENCH_VALUE, BENCH_BACKUP);
+
+	if (!NFC_Mifare_PurseLoad(&purse, benchMemory[BENCH_VALUE], benchMemory[BENCH_BACKUP]) ||
+		purse.value != BENCH_BALANCE - (int32_t)(iterations * BENCH_FARE))
+	{
+		printf("balance %d, expected %d\n", purse.value, BENCH_BALANCE - (int32_t)(iterations * BENCH_FARE));
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	Bench_Harness harness =
+	{
+		.targetUs = BENCH_HARNESS_TARGET_US,
+		.strategies = benchStrategies,
+		.count = sizeof(benchStrategies) / sizeof(benchStrategies[0]),
+		.Start = &Bench_Start,
+		.Setup = &Bench_Setup,
+		.Tap = &Bench_Tap,
+		.Done = &Bench_Done,
+		.Finish = &Bench_Finish,
+	};
+
+	printf("%u sectors of 3 blocks and one fare x %u, exchange %u us\n", BENCH_HARNESS_SECTORS, iterations, PN532_SIM_LATENCY_US);
+
+	return Bench_Harness_Run(&harness, iterations) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,194 @@
+/*
+ * Bench_Poll.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of the ways the driver detects that PN532 is ready:
+ *
+ *  - irq:      IRQ line, the core sleeps until its edge (WaitIRQ)
+ *  - tight:    STATREAD in every loop of the wait, as a GetIRQ reading status
+ *  - adaptive: no GetIRQ, the driver reads status with the gaps of NFC_POLL_*
+ *  - bus:      as adaptive, the command is advanced by NFC_Bus_Process. It
+ *              sleeps with SleepUs up to the next status read, its idle WFI
+ *              would last up to the next SysTick
+ *
+ *  PN532_Sim answers with its default ACK time, the given processing time of
+ *  GetFirmwareVersion and of InListPassiveTarget with a card in field. Times
+ *  are virtual, SPI transfers are charged with the cost model of the
+ *  simulator. Results per command: latency, status reads and time the bus
+ *  was taken, the rest of the bus is free for other PN532 or peripherals.
+ *
+ *  Usage: Bench_Poll [iterations] [GetFirmwareVersion us] [InListPassiveTarget us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "NFC.h"
+#include "NFC_Bus.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default processing time of InListPassiveTarget with a card in field
+#define BENCH_TARGET_US		(3000)
+
+static const uint8_t benchUid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+/// Period of SysTick waking the core from WFI
+#define BENCH_TICK_NS		(1000000)
+
+static uint32_t tightReads;
+
+/// Ready read with STATREAD each time the driver asks, the polling of NFC_I2C_GetIRQ without IRQ
+static uint8_t Bench_TightStatus(void)
+{
+	uint8_t status;
+
+	tightReads++;
+
+	PN532_Sim_SetSelect(true);
+	PN532_Sim_DelayUs(PN532_CS_SETUP_US);
+	PN532_Sim_SendByte(PN532_SPI_STATREAD);
+	status = PN532_Sim_GetByte();
+	PN532_Sim_SetSelect(false);
+
+	return (status & PN532_SPI_READY) ? true : false;
+}
+
+/// WFI with no IRQ line, only the next SysTick wakes the core
+static void Bench_Idle(void)
+{
+	Host_Clock_Advance(BENCH_TICK_NS - Host_Clock_Now() % BENCH_TICK_NS);
+}
+
+/// Command advanced by the bus, as the main loop does
+static uint8_t Bench_BusCommand(NFC_Bus *bus, NFC_Context *context, const uint8_t command)
+{
+	uint8_t uid[7], length;
+
+	if (command == PN532_COMMAND_INLISTPASSIVETARGET)
+	{
+		NFC_StartReadPassiveTargetID(context, PN532_MIFARE_ISO14443A, 100);
+	}
+	else
+	{
+		context->buffer[0] = command;
+		NFC_StartCommand(context, 1, 2);
+	}
+
+	while (NFC_Bus_Process(bus) == NULL);
+
+	if (command == PN532_COMMAND_INLISTPASSIVETARGET)
+	{
+		return NFC_GetPassiveTargetID(context, uid, &length);
+	}
+
+	return (context->state == NFC_COMMAND_DONE && context->response.length >= 3) ? true : false;
+}
+
+static uint8_t Bench_Run(const char *name, NFC_CommInterface *interface, const uint8_t useBus, const uint8_t command, const uint32_t latencyUs, const uint32_t iterations)
+{
+	static NFC_Context context;
+	static NFC_Bus bus;
+	PN532_Sim_Stats stats;
+	NFC_Stats driverStats;
+	uint8_t uid[7], length;
+	uint64_t start, elapsed;
+	uint32_t i, reads;
+
+	PN532_Sim_Init();
+	PN532_Sim_SetLatency(0, command, latencyUs);
+	PN532_Sim_AddCard(0, benchUid, sizeof(benchUid), 0, PN532_SIM_NEVER);
+	tightReads = 0;
+
+	if (!NFC_CommInit(&context, interface, 0))
+	{
+		return false;
+	}
+
+	NFC_Bus_Init(&bus, &Bench_Idle);
+	NFC_Bus_Add(&bus, &context);
+
+	start = Host_Clock_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (useBus)
+		{
+			if (!Bench_BusCommand(&bus, &context, command))
+			{
+				printf("%-9s command failed at iteration %u\n", name, i);
+				return false;
+			}
+		}
+		else if (command == PN532_COMMAND_INLISTPASSIVETARGET)
+		{
+			if (!NFC_ReadPassiveTargetID(&context, PN532_MIFARE_ISO14443A, uid, &length, 100))
+			{
+				printf("%-9s card read failed at iteration %u\n", name, i);
+				return false;
+			}
+		}
+		else if (NFC_GetFirmwareVersion(&context) != 0x03320106)
+		{
+			printf("%-9s GetFirmwareVersion failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	elapsed = Host_Clock_Now() - start;
+
+	PN532_Sim_GetStats(0, &stats);
+	NFC_GetStats(&context, &driverStats);
+	reads = tightReads + driverStats.statusReads;
+
+	printf("%-9s %8.1f us/command  %8.2f status reads/command  %8.1f us bus/command  %5.1f %% bus busy\n",
+			name,
+			elapsed / 1e3 / iterations,
+			(double)reads / iterations,
+			stats.transportNs / 1e3 / iterations,
+			100.0 * stats.transportNs / elapsed);
+
+	return true;
+}
+
+static uint8_t Bench_Command(const char *name, const uint8_t command, const uint32_t latencyUs, const uint32_t iterations)
+{
+	NFC_CommInterface irq, tight, adaptive;
+
+	PN532_Sim_GetInterface(&irq, true);
+
+	PN532_Sim_GetInterface(&tight, true);
+	tight.GetIRQ = &Bench_TightStatus;
+	tight.WaitIRQ = NULL;
+
+	PN532_Sim_GetInterface(&adaptive, true);
+	adaptive.GetIRQ = NULL;
+	adaptive.WaitIRQ = NULL;
+	adaptive.SleepUs = &PN532_Sim_DelayUs;		// Virtual time goes on the same asleep or busy
+
+	printf("%s, %u us\n", name, latencyUs);
+
+	return Bench_Run("irq", &irq, false, command, latencyUs, iterations) &&
+		Bench_Run("tight", &tight, false, command, latencyUs, iterations) &&
+		Bench_Run("adaptive", &adaptive, false, command, latencyUs, iterations) &&
+		Bench_Run("bus", &adaptive, true, command, latencyUs, iterations);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000;
+	uint32_t versionUs = (argc > 2) ? strtoul(argv[2], NULL, 0) : PN532_SIM_LATENCY_US;
+	uint32_t targetUs = (argc > 3) ? strtoul(argv[3], NULL, 0) : BENCH_TARGET_US;
+
+	printf("x %u, ACK after %u us\n", iterations, PN532_SIM_ACK_US);
+
+	if (!Bench_Command("GetFirmwareVersion", PN532_COMMAND_GETFIRMWAREVERSION, versionUs, iterations) ||
+		!Bench_Command("InListPassiveTarget", PN532_COMMAND_INLISTPASSIVETARGET, targetUs, iterations))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,207 @@
+/*
+ * Bench_Readers.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of several PN532 sharing SPI2: 1 to 4 readers, each one
+ *  with its own card, chip select and IRQ pin added with NFC_SPI_AddDevice,
+ *  list their card again and again with InListPassiveTarget advanced by
+ *  NFC_Bus_Process. While a PN532 works on its field the bus serves others.
+ *
+ *  NFC_SPI.c, NFC_SPI_DMA.c and NFC_Bus.c run over the HAL shim (Host_HAL)
+ *  with PN532_Sim behind them. Times are virtual. Results for each amount of
+ *  readers: cards read per second of each reader (mean and slowest), of the
+ *  whole bus, mean of a reader against one reader alone and time SPI was busy.
+ *
+ *  Usage: Bench_Readers [simulated seconds] [InListPassiveTarget us]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC_SPI.h"
+#include "NFC_SPI_DMA.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+#include "NFC_Bus.h"
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default processing time of InListPassiveTarget with a card in field
+#define BENCH_TARGET_US		(3000)
+
+/// Readers on the bus at most
+#define BENCH_READERS		(4)
+
+/// Chip select and IRQ pins of readers added after the one of NFC_SPI_Init
+static GPIO_TypeDef * const benchCsPorts[BENCH_READERS - 1] = {GPIOA, GPIOA, GPIOA};
+static const uint16_t benchCsPins[BENCH_READERS - 1] = {GPIO_PIN_8, GPIO_PIN_12, GPIO_PIN_15};
+static GPIO_TypeDef * const benchIrqPorts[BENCH_READERS - 1] = {GPIOH, GPIOH, GPIOH};
+static const uint16_t benchIrqPins[BENCH_READERS - 1] = {GPIO_PIN_7, GPIO_PIN_8, GPIO_PIN_9};
+
+/// Number given by NFC_SPI to each reader
+static uint8_t benchDevices[BENCH_READERS];
+
+/// Card of each reader, the last byte tells the reader
+static void Bench_Uid(const uint8_t reader, uint8_t *uid)
+{
+	uid[0] = 0xDE;
+	uid[1] = 0xAD;
+	uid[2] = 0xBE;
+	uid[3] = reader;
+}
+
+static uint8_t Bench_Run(const uint8_t readers, const uint32_t seconds, const uint32_t targetUs, double *alone)
+{
+	static NFC_Context contexts[BENCH_READERS];
+	static NFC_Bus bus;
+	NFC_CommInterface interface = {0};
+	PN532_Sim_Stats stats;
+	NFC_Context *context;
+	const uint64_t end = (uint64_t)seconds * 1000000000ULL;
+	uint32_t reads[BENCH_READERS] = {0}, slowest = UINT32_MAX, total = 0;
+	uint64_t busNs = 0;
+	uint8_t uid[NFC_PASSIVE_UIDSIZE], expected[4], length, i;
+	double mean;
+
+	PN532_Sim_Init();
+
+	interface.DelayUs = &NFC_Timer_DelayUs;
+	interface.GetTimeUs = &NFC_Timer_GetUs;
+	interface.GetByte = &NFC_SPI_GetByte;
+	interface.SendByte = &NFC_SPI_SendByte;
+	interface.SetSelect = &NFC_SPI_SetSelect;
+	interface.SetDevice = &NFC_SPI_SetDevice;
+	interface.GetIRQ = &NFC_SPI_GetIRQ;
+	interface.WaitIRQ = &NFC_SPI_WaitIRQ;
+	interface.SendBuffer = &NFC_SPI_DMA_SendBuffer;
+	interface.ReceiveBuffer = &NFC_SPI_DMA_ReceiveBuffer;
+
+	NFC_Bus_Init(&bus, &NFC_SPI_Idle);
+
+	for (i = 0; i < readers; i++)
+	{
+		Bench_Uid(i, expected);
+		PN532_Sim_SetLatency(benchDevices[i], PN532_COMMAND_INLISTPASSIVETARGET, targetUs);
+		PN532_Sim_AddCard(benchDevices[i], expected, sizeof(expected), 0, PN532_SIM_NEVER);
+
+		if (!NFC_CommInit(&contexts[i], &interface, benchDevices[i]) || !NFC_Bus_Add(&bus, &contexts[i]))
+		{
+			printf("%u readers, reader %u can not be initialized\n", readers, i);
+			return false;
+		}
+
+		NFC_StartReadPassiveTargetID(&contexts[i], PN532_MIFARE_ISO14443A, 100);
+	}
+
+	while (Host_Clock_Now() < end)
+	{
+		context = NFC_Bus_Process(&bus);
+		if (context == NULL)
+		{
+			continue;
+		}
+
+		i = context - contexts;
+		Bench_Uid(i, expected);
+
+		if (!NFC_GetPassiveTargetID(context, uid, &length) || length != sizeof(expected) ||
+			memcmp(uid, expected, sizeof(expected)) != 0)
+		{
+			printf("%u readers, reader %u did not read its card\n", readers, i);
+			return false;
+		}
+
+		reads[i]++;
+		NFC_StartReadPassiveTargetID(context, PN532_MIFARE_ISO14443A, 100);
+	}
+
+	for (i = 0; i < readers; i++)
+	{
+		PN532_Sim_GetStats(benchDevices[i], &stats);
+		busNs += stats.transportNs;
+		total += reads[i];
+
+		if (reads[i] < slowest)
+		{
+			slowest = reads[i];
+		}
+	}
+
+	mean = (double)total / readers / seconds;
+	if (readers == 1)
+	{
+		*alone = mean;
+	}
+
+	printf("%u readers %8.1f reads/s each  %8.1f slowest  %8.1f reads/s bus  %5.1f %% of alone  %5.1f %% SPI busy\n",
+			readers,
+			mean,
+			(double)slowest / seconds,
+			(double)total / seconds,
+			100.0 * mean / *alone,
+			100.0 * busNs / end);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t seconds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1;
+	uint32_t targetUs = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_TARGET_US;
+	RCC_ClkInitTypeDef clocks = {0};
+	double alone = 0;
+	uint8_t i;
+
+	if (seconds == 0)
+	{
+		seconds = 1;
+	}
+
+	if (!Host_HAL_Init())
+	{
+		printf("Register blocks can not be mapped\n");
+		return EXIT_FAILURE;
+	}
+
+	// APB1 of firmware, SPI2 kernel clock at 54 MHz
+	clocks.APB1CLKDivider = RCC_HCLK_DIV4;
+	HAL_RCC_ClockConfig(&clocks, FLASH_LATENCY_7);
+
+	if (!NFC_SPI_Init() || !NFC_SPI_DMA_Init())
+	{
+		printf("SPI can not be initialized\n");
+		return EXIT_FAILURE;
+	}
+
+	// Reader 0 is the one of NFC_SPI_Init, the others are added with their own pins
+	benchDevices[0] = 0;
+	Host_HAL_AttachPN532(SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin, 0);
+
+	for (i = 1; i < BENCH_READERS; i++)
+	{
+		if (!NFC_SPI_AddDevice(benchCsPorts[i - 1], benchCsPins[i - 1], benchIrqPorts[i - 1], benchIrqPins[i - 1], &benchDevices[i]) ||
+			!Host_HAL_AttachPN532(benchCsPorts[i - 1], benchCsPins[i - 1], benchIrqPorts[i - 1], benchIrqPins[i - 1], benchDevices[i]))
+		{
+			printf("Reader %u can not be added\n", i);
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf("%u s, InListPassiveTarget %u us, ACK after %u us\n", seconds, targetUs, PN532_SIM_ACK_US);
+
+	for (i = 1; i <= BENCH_READERS; i++)
+	{
+		if (!Bench_Run(i, seconds, targetUs, &alone))
+		{
+			return EXIT_FAILURE;
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
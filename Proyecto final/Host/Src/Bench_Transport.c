@@ -0,0 +1,115 @@
+/*
+ * Bench_Transport.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Host benchmark of per-byte against bulk transfers of NFC_CommInterface, and of
+ *  the chip select set up delay (1 mS HAL tick against DelayUs).
+ *
+ *  PN532_Sim answers GetFirmwareVersion and every transfer call is charged
+ *  a modelled time: a fixed cost per call (HAL_SPI_Transmit/Receive setup and
+ *  state spins in NFC_SPI.c) plus the SPI wire time of each byte. Bytes/s are
+ *  computed over that modelled transport time, so results are deterministic
+ *  and independent of the workstation. Processing time of the command is set
+ *  to zero, only the ACK delay of the simulator remains in us/command.
+ *
+ *  Usage: Bench_Transport [iterations] [call overhead ns] [SPI clock Hz]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "NFC.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Default modelled cost of one HAL transfer call at 216 MHz
+#define BENCH_CALL_OVERHEAD_NS		(4000)
+
+/// Default SPI2 clock: APB1 13.5 MHz with prescaler 16
+#define BENCH_SPI_CLOCK_HZ			(843750)
+
+static double Bench_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+static uint8_t Bench_Run(const char *name, NFC_CommInterface *interface, uint32_t iterations, uint32_t callNs, uint32_t byteNs)
+{
+	static NFC_Context context;
+	PN532_Sim_Stats stats;
+	uint32_t i;
+	double start, elapsed;
+
+	PN532_Sim_Init();
+	PN532_Sim_SetTransportCost(callNs, byteNs);
+	PN532_Sim_SetLatency(0, PN532_COMMAND_GETFIRMWAREVERSION, 0);
+
+	if (!NFC_CommInit(&context, interface, 0))
+	{
+		return false;
+	}
+
+	start = Bench_Now();
+	for (i = 0; i < iterations; i++)
+	{
+		if (NFC_GetFirmwareVersion(&context) != 0x03320106)
+		{
+			printf("%-9s failed at iteration %u\n", name, i);
+			return false;
+		}
+	}
+	elapsed = Bench_Now() - start;
+
+	PN532_Sim_GetStats(0, &stats);
+
+	printf("%-9s %10.0f bytes/s  %6.2f calls/frame  %8.1f us transport/frame  %8.1f us/command  %8.1f ns host/frame\n",
+			name,
+			stats.bytes * 1e9 / stats.transportNs,
+			(double)stats.calls / iterations,
+			stats.transportNs / 1e3 / iterations,
+			Host_Clock_Now() / 1e3 / iterations,
+			elapsed / iterations);
+
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t iterations = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+	uint32_t callNs = (argc > 2) ? strtoul(argv[2], NULL, 0) : BENCH_CALL_OVERHEAD_NS;
+	uint32_t spiClock = (argc > 3) ? strtoul(argv[3], NULL, 0) : BENCH_SPI_CLOCK_HZ;
+	uint32_t byteNs = (uint32_t)(8ULL * 1000000000ULL / spiClock);
+	NFC_CommInterface perByte, bulk, bulkDelayUs;
+
+	// Driver polls IRQ with HAL tick, as the board without EXTI wake up
+	PN532_Sim_GetInterface(&perByte, false);
+	perByte.WaitIRQ = NULL;
+	perByte.DelayUs = NULL;
+
+	PN532_Sim_GetInterface(&bulk, true);
+	bulk.WaitIRQ = NULL;
+	bulk.DelayUs = NULL;
+
+	PN532_Sim_GetInterface(&bulkDelayUs, true);
+	bulkDelayUs.WaitIRQ = NULL;
+
+	printf("GetFirmwareVersion x %u, %u ns per call, %u Hz SPI\n", iterations, callNs, spiClock);
+
+	if (!Bench_Run("per-byte", &perByte, iterations, callNs, byteNs) ||
+		!Bench_Run("bulk", &bulk, iterations, callNs, byteNs) ||
+		!Bench_Run("bulk+us", &bulkDelayUs, iterations, callNs, byteNs))
+	{
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
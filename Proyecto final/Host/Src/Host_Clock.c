@@ -0,0 +1,71 @@
+/*
+ * Host_Clock.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "Host_Clock.h"
+#include <stddef.h>
+
+static uint64_t nowNs;
+static uint32_t pollCostNs = HOST_CLOCK_POLLCOST_NS;
+static uint64_t limitNs;
+static void (*limitHandler)(void);
+static void (*clockHook)(void);
+
+void Host_Clock_Reset(void)
+{
+	nowNs = 0;
+}
+
+uint64_t Host_Clock_Now(void)
+{
+	return nowNs;
+}
+
+void Host_Clock_Advance(const uint64_t ns)
+{
+	void (*handler)(void) = limitHandler;
+
+	nowNs += ns;
+
+	if (clockHook != NULL)
+	{
+		clockHook();
+	}
+
+	if (handler != NULL && limitNs != 0 && nowNs >= limitNs)
+	{
+		limitHandler = NULL;
+		handler();
+	}
+}
+
+void Host_Clock_SetPollCost(const uint32_t ns)
+{
+	pollCostNs = ns;
+}
+
+void Host_Clock_SetLimit(const uint64_t ns, void (*handler)(void))
+{
+	limitNs = ns;
+	limitHandler = handler;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	// Each poll of the tick costs modelled time, so busy-waits end
+	Host_Clock_Advance(pollCostNs);
+	return (uint32_t)(nowNs / 1000000);
+}
+
+void Host_Clock_SetHook(void (*hook)(void))
+{
+	clockHook = hook;
+}
+
+uint64_t Host_Clock_GetLimit(void)
+{
+	return limitNs;
+}
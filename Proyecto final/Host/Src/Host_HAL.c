@@ -0,0 +1,1092 @@
+/*
+ * Host_HAL.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+#include "NFC_HSU.h"
+#include <sys/mman.h>
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Register blocks used by firmware: APB1, APB2 and AHB1 peripherals, and core
+#define HOST_HAL_PERIPH_SIZE	(0x00080000UL)
+#define HOST_HAL_CORE_BASE		(0xE0000000UL)
+#define HOST_HAL_CORE_SIZE		(0x00100000UL)
+
+/// SysTick period of HAL, the core wakes up from WFI on each tick
+#define HOST_HAL_TICK_NS		(1000000ULL)
+
+/// I2C bits of a byte with its acknowledge, and of START, address and STOP of a transfer
+#define HOST_HAL_I2C_BYTEBITS	(9)
+#define HOST_HAL_I2C_FRAMEBITS	(11)
+
+/// PN532 of simulator wired to USART6
+#define HOST_HAL_USART_DEVICE	(0)
+
+/// Start bit, 8 data bits and stop bit of each byte
+#define HOST_HAL_USART_BYTEBITS	(10)
+
+/// Bytes PN532 can have on the line ahead of USART6
+#define HOST_HAL_USART_LINESIZE	(2 * PN532_SIM_FRAMESIZE)
+
+/// Rate error between USART6 and PN532 the line stands, in parts per thousand
+#define HOST_HAL_USART_TOLERANCE	(20)
+
+/// Pins of a simulated PN532
+typedef struct
+{
+	GPIO_TypeDef *csPort;
+	uint16_t csPin;
+	GPIO_TypeDef *irqPort;
+	uint16_t irqPin;
+	uint8_t device;
+	uint8_t irqLevel;			///< Last level seen, 1 is active (pin low)
+}Host_HAL_Device;
+
+uint32_t SystemCoreClock = 216000000;
+
+static Host_HAL_Device devices[HOST_HAL_MAXDEVICES];
+static uint8_t deviceCount;
+static Host_HAL_Device *selected;
+static uint8_t primask;
+static uint16_t pendingEdges;	///< EXTI lines waiting to be served
+static uint64_t sleepNs;
+static uint32_t wakeups;
+static uint8_t tickSuspended;	///< SysTick stopped by HAL_SuspendTick, WFI only ends on an IRQ edge
+static uint32_t pclk1Hz = 216000000 / 16;
+static uint32_t spiMaxHz = 0;
+static uint32_t i2cTiming = 0;
+static uint8_t i2cReading = false;	///< Read without STOP in progress
+static uint8_t i2cReady = false;	///< PN532 answered ready at start of the read
+static uint32_t pclk2Hz = 216000000 / 2;
+
+/// Rates of SetSerialBaudRate codes
+static const uint32_t usartBauds[] =
+{
+	9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 1288000
+};
+
+/// Bytes PN532 put on the line with the time their stop bit ends
+static uint8_t usartLine[HOST_HAL_USART_LINESIZE];
+static uint64_t usartArriveNs[HOST_HAL_USART_LINESIZE];
+static uint16_t usartHead, usartTail;
+static uint64_t usartLineFreeNs;		///< End of last byte PN532 put on the line
+static uint64_t usartIdleNs;			///< IDLE of last frame, 0 when it was set
+static DMA_Stream_TypeDef *usartRxStream;
+static uint8_t *usartRing;				///< Memory of circular stream on RDR
+static uint32_t usartRingSize;
+static DMA_Stream_TypeDef *usartTxStream;
+static const uint8_t *usartTxData;		///< Frame of stream on TDR, NULL when none is sent
+static uint32_t usartTxLength;
+static uint64_t usartTxEndNs;
+static uint32_t usartMaxBaud = 0;
+static uint32_t usartFrames;
+static uint8_t usartSyncing = false;
+static uint64_t timerWakeupNs = PN532_SIM_NEVER;	///< Interrupt of TIM7 one-shot
+
+static Host_HAL_Device *Host_HAL_FindCS(GPIO_TypeDef *port, const uint16_t pin);
+static Host_HAL_Device *Host_HAL_FindIRQ(GPIO_TypeDef *port, const uint16_t pin);
+static void Host_HAL_SampleIRQ(void);
+static void Host_HAL_ServeEdges(void);
+static void Host_HAL_Route(const uint32_t callNs);
+static uint32_t Host_HAL_GetSpiHz(void);
+static void Host_HAL_Corrupt(uint8_t *buffer, const uint16_t size);
+static uint32_t Host_HAL_GetI2cBitNs(void);
+static void Host_HAL_I2cSelect(const uint8_t state, const uint8_t operation);
+static void Host_HAL_I2cReceive(uint8_t *pData, uint16_t Size, const uint8_t start);
+static uint8_t Host_HAL_UsartEnabled(void);
+static uint32_t Host_HAL_GetUsartBaud(void);
+static uint8_t Host_HAL_UsartRateMatches(void);
+static void Host_HAL_UsartPump(void);
+static void Host_HAL_UsartTransmit(void);
+static void Host_HAL_UsartSync(void);
+static uint8_t Host_HAL_UsartPending(void);
+static uint64_t Host_HAL_UsartNextEvent(const uint64_t now);
+
+static Host_HAL_Device *Host_HAL_FindCS(GPIO_TypeDef *port, const uint16_t pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		if (devices[i].csPort == port && (devices[i].csPin & pin))
+		{
+			return &devices[i];
+		}
+	}
+
+	return NULL;
+}
+
+static Host_HAL_Device *Host_HAL_FindIRQ(GPIO_TypeDef *port, const uint16_t pin)
+{
+	uint8_t i;
+
+	for (i = 0; i < deviceCount; i++)
+	{
+		if (devices[i].irqPort == port && devices[i].irqPin == pin)
+		{
+			return &devices[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void Host_HAL_SampleIRQ(void)
+{
+	uint8_t i, level;
+
+	// Falling edge of an IRQ pin sets its EXTI pending bit
+	for (i = 0; i < deviceCount; i++)
+	{
+		PN532_Sim_SetDevice(devices[i].device);
+		level = PN532_Sim_GetIRQ();
+
+		if (level && !devices[i].irqLevel)
+		{
+			pendingEdges |= devices[i].irqPin;
+		}
+
+		devices[i].irqLevel = level;
+	}
+
+	Host_HAL_Route(PN532_SIM_CALLCOST_NS);
+}
+
+static void Host_HAL_ServeEdges(void)
+{
+	uint16_t edges;
+	uint8_t line;
+
+	if (primask)
+	{
+		return;
+	}
+
+	while (pendingEdges)
+	{
+		edges = pendingEdges;
+		pendingEdges = 0;
+
+		for (line = 0; line < 16; line++)
+		{
+			if (edges & (1U << line))
+			{
+				HAL_GPIO_EXTI_Callback(1U << line);
+			}
+		}
+	}
+
+	// USART6 interrupt stays pending up to its flags are cleared
+	while (Host_HAL_UsartPending())
+	{
+		USART6_IRQHandler();
+	}
+}
+
+static void Host_HAL_Route(const uint32_t callNs)
+{
+	// Sampling IRQ lines moves simulator to other devices
+	if (selected != NULL)
+	{
+		PN532_Sim_SetDevice(selected->device);
+	}
+
+	PN532_Sim_SetTransportCost(callNs, (uint32_t)(8000000000ULL / Host_HAL_GetSpiHz()));
+}
+
+static uint32_t Host_HAL_GetSpiHz(void)
+{
+	return pclk1Hz / (2UL << ((SPI2->CR1 & SPI_CR1_BR) >> SPI_CR1_BR_Pos));
+}
+
+static void Host_HAL_Corrupt(uint8_t *buffer, const uint16_t size)
+{
+	// A bit sampled too early, once per transfer is enough to break checksums
+	if (spiMaxHz != 0 && Host_HAL_GetSpiHz() > spiMaxHz && size > 0)
+	{
+		buffer[size - 1] ^= 0x01;
+	}
+}
+
+static uint32_t Host_HAL_GetI2cBitNs(void)
+{
+	// SCL period is SCLL + 1 plus SCLH + 1 prescaled kernel clocks, synchronization is left out
+	const uint32_t presc = ((i2cTiming & I2C_TIMINGR_PRESC) >> I2C_TIMINGR_PRESC_Pos) + 1;
+	const uint32_t scll = ((i2cTiming & I2C_TIMINGR_SCLL) >> I2C_TIMINGR_SCLL_Pos) + 1;
+	const uint32_t sclh = ((i2cTiming & I2C_TIMINGR_SCLH) >> I2C_TIMINGR_SCLH_Pos) + 1;
+
+	return (uint32_t)(1000000000ULL * presc * (scll + sclh) / pclk1Hz);
+}
+
+static void Host_HAL_I2cSelect(const uint8_t state, const uint8_t operation)
+{
+	// PN532 of I2C bus is the first one attached, its transaction is a SPI one without cost of operation byte
+	if (deviceCount == 0)
+	{
+		return;
+	}
+
+	PN532_Sim_SetDevice(devices[0].device);
+	PN532_Sim_SetSelect(state);
+	selected = state ? &devices[0] : NULL;
+
+	if (state)
+	{
+		PN532_Sim_SetTransportCost(0, 0);
+		PN532_Sim_SendByte(operation);
+	}
+	else
+	{
+		Host_HAL_SampleIRQ();
+		Host_HAL_ServeEdges();
+	}
+}
+
+static void Host_HAL_I2cReceive(uint8_t *pData, uint16_t Size, const uint8_t start)
+{
+	const uint32_t bitNs = Host_HAL_GetI2cBitNs();
+	const uint32_t callNs = PN532_SIM_CALLCOST_NS + (start ? HOST_HAL_I2C_FRAMEBITS * bitNs : 0);
+
+	if (start)
+	{
+		// Status byte comes first, PN532 sends frame after it only when ready
+		PN532_Sim_SetDevice(devices[0].device);
+		i2cReady = PN532_Sim_GetIRQ();
+		pData[0] = i2cReady ? PN532_I2C_READY : PN532_I2C_BUSY;
+		Host_Clock_Advance(HOST_HAL_I2C_BYTEBITS * bitNs);
+		pData++;
+		Size--;
+	}
+
+	if (i2cReady && Size > 0)
+	{
+		if (selected == NULL)
+		{
+			Host_HAL_I2cSelect(true, PN532_SPI_DATAREAD);
+		}
+
+		PN532_Sim_SetTransportCost(callNs, HOST_HAL_I2C_BYTEBITS * bitNs);
+		PN532_Sim_ReceiveBuffer(pData, Size);
+	}
+	else
+	{
+		memset(pData, 0x00, Size);
+		Host_Clock_Advance(callNs + (uint64_t)Size * HOST_HAL_I2C_BYTEBITS * bitNs);
+	}
+}
+
+static uint8_t Host_HAL_UsartEnabled(void)
+{
+	return (usartRing != NULL && (USART6->CR1 & USART_CR1_UE) && USART6->BRR != 0) ? true : false;
+}
+
+static uint32_t Host_HAL_GetUsartBaud(void)
+{
+	// Oversampling by 16, BRR is the divider of kernel clock
+	return pclk2Hz / USART6->BRR;
+}
+
+static uint8_t Host_HAL_UsartRateMatches(void)
+{
+	const uint32_t pn532 = usartBauds[PN532_Sim_GetSerialRate(HOST_HAL_USART_DEVICE)];
+	const uint32_t usart = Host_HAL_GetUsartBaud();
+	const uint32_t error = (usart > pn532) ? usart - pn532 : pn532 - usart;
+
+	return ((uint64_t)error * 1000 <= (uint64_t)pn532 * HOST_HAL_USART_TOLERANCE) ? true : false;
+}
+
+static void Host_HAL_UsartPump(void)
+{
+	uint8_t frame[PN532_SIM_FRAMESIZE];
+	uint64_t ready, start, byteNs;
+	uint16_t length, i;
+
+	PN532_Sim_SetDevice(HOST_HAL_USART_DEVICE);
+
+	// PN532 sends each frame as soon as it is ready, one after the other
+	while ((length = PN532_Sim_TakeFrame(frame, sizeof(frame), &ready)) > 0)
+	{
+		byteNs = HOST_HAL_USART_BYTEBITS * 1000000000ULL / Host_HAL_GetUsartBaud();
+
+		if (!Host_HAL_UsartRateMatches())
+		{
+			// Sampled at the wrong rate, nothing looks like a start code
+			byteNs = HOST_HAL_USART_BYTEBITS * 1000000000ULL / usartBauds[PN532_Sim_GetSerialRate(HOST_HAL_USART_DEVICE)];
+
+			for (i = 0; i < length; i++)
+			{
+				frame[i] ^= 0x5A;
+			}
+		}
+		else if (usartMaxBaud != 0 && Host_HAL_GetUsartBaud() > usartMaxBaud && (++usartFrames % HOST_HAL_USART_ERRORPERIOD) == 0)
+		{
+			// A bit of the checksum, or of the ACK, is received wrong
+			frame[length - 2] ^= 0x01;
+		}
+
+		start = (ready > usartLineFreeNs) ? ready : usartLineFreeNs;
+
+		// Line of the previous frame went idle before this one started
+		if (usartIdleNs != 0 && usartIdleNs <= start)
+		{
+			USART6->ISR |= USART_ISR_IDLE;
+		}
+
+		for (i = 0; i < length; i++)
+		{
+			if ((uint16_t)((usartHead + 1) % HOST_HAL_USART_LINESIZE) == usartTail)
+			{
+				USART6->ISR |= USART_ISR_ORE;
+				break;
+			}
+
+			usartLine[usartHead] = frame[i];
+			usartArriveNs[usartHead] = start + (i + 1) * byteNs;
+			usartHead = (usartHead + 1) % HOST_HAL_USART_LINESIZE;
+		}
+
+		usartLineFreeNs = start + length * byteNs;
+		usartIdleNs = start + (length + 1) * byteNs;
+	}
+}
+
+static void Host_HAL_UsartTransmit(void)
+{
+	const uint8_t *data = usartTxData;
+
+	usartTxData = NULL;
+	usartTxStream->CR &= ~DMA_SxCR_EN;
+	USART6->ISR |= USART_ISR_TC;
+
+	// PN532 samples noise, the line was only busy
+	if (!Host_HAL_UsartRateMatches())
+	{
+		return;
+	}
+
+	// Frame is a DATAWRITE transaction of the simulator, the preamble is skipped by it
+	PN532_Sim_SetDevice(HOST_HAL_USART_DEVICE);
+	PN532_Sim_SetSelect(true);
+	PN532_Sim_SetTransportCost(0, 0);
+	PN532_Sim_SendByte(PN532_SPI_DATAWRITE);
+	PN532_Sim_SendBuffer(data, usartTxLength);
+	PN532_Sim_SetSelect(false);
+}
+
+static void Host_HAL_UsartSync(void)
+{
+	const uint64_t now = Host_Clock_Now();
+
+	// Simulator moves time while it takes the frame sent
+	if (usartSyncing || !Host_HAL_UsartEnabled())
+	{
+		return;
+	}
+
+	usartSyncing = true;
+
+	// Bits written to ICR clear the same bits of ISR
+	USART6->ISR &= ~USART6->ICR;
+	USART6->ICR = 0;
+
+	if (usartTxData != NULL && now >= usartTxEndNs)
+	{
+		Host_HAL_UsartTransmit();
+	}
+
+	if (USART6->CR1 & USART_CR1_RE)
+	{
+		Host_HAL_UsartPump();
+	}
+
+	// DMA writes each byte received to the ring, NDTR counts the bytes left up to its end
+	while (usartTail != usartHead && usartArriveNs[usartTail] <= now)
+	{
+		usartRing[usartRingSize - usartRxStream->NDTR] = usartLine[usartTail];
+		usartRxStream->NDTR = (usartRxStream->NDTR > 1) ? usartRxStream->NDTR - 1 : usartRingSize;
+		usartTail = (usartTail + 1) % HOST_HAL_USART_LINESIZE;
+	}
+
+	if (usartIdleNs != 0 && now >= usartIdleNs)
+	{
+		USART6->ISR |= USART_ISR_IDLE;
+		usartIdleNs = 0;
+	}
+
+	// Simulator is left on the PN532 of chip select asserted
+	if (selected != NULL)
+	{
+		PN532_Sim_SetDevice(selected->device);
+	}
+
+	usartSyncing = false;
+}
+
+static uint8_t Host_HAL_UsartPending(void)
+{
+	uint32_t status;
+
+	if (!Host_HAL_UsartEnabled())
+	{
+		return false;
+	}
+
+	Host_HAL_UsartSync();
+	status = USART6->ISR;
+
+	return (((status & USART_ISR_IDLE) && (USART6->CR1 & USART_CR1_IDLEIE)) ||
+			((status & USART_ISR_TC) && (USART6->CR1 & USART_CR1_TCIE)) ||
+			((status & (USART_ISR_ORE | USART_ISR_FE | USART_ISR_NE)) && (USART6->CR3 & USART_CR3_EIE))) ? true : false;
+}
+
+static uint64_t Host_HAL_UsartNextEvent(const uint64_t now)
+{
+	uint64_t next = PN532_SIM_NEVER, event;
+
+	if (!Host_HAL_UsartEnabled())
+	{
+		return PN532_SIM_NEVER;
+	}
+
+	if (usartIdleNs > now)
+	{
+		next = usartIdleNs;
+	}
+
+	if (usartTxData != NULL && usartTxEndNs > now && usartTxEndNs < next)
+	{
+		next = usartTxEndNs;
+	}
+
+	// Next frame of PN532 starts on the line, its bytes are received before IDLE
+	event = PN532_Sim_GetNextIRQ(HOST_HAL_USART_DEVICE);
+
+	if (event > now && event < next)
+	{
+		next = event;
+	}
+
+	return next;
+}
+
+uint8_t Host_HAL_Init(void)
+{
+	void *periph, *core;
+
+	periph = mmap((void *)PERIPH_BASE, HOST_HAL_PERIPH_SIZE, PROT_READ | PROT_WRITE,
+				  MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+	core = mmap((void *)HOST_HAL_CORE_BASE, HOST_HAL_CORE_SIZE, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+	if (periph != (void *)PERIPH_BASE || core != (void *)HOST_HAL_CORE_BASE)
+	{
+		return false;
+	}
+
+	deviceCount = 0;
+	selected = NULL;
+	primask = false;
+	pendingEdges = 0;
+	sleepNs = 0;
+	wakeups = 0;
+	tickSuspended = false;
+	i2cReading = false;
+	i2cReady = false;
+	usartRing = NULL;
+	usartTxData = NULL;
+
+	// DMA of USART6 works on its own while time passes
+	Host_Clock_SetHook(&Host_HAL_UsartSync);
+
+	return true;
+}
+
+uint8_t Host_HAL_AttachPN532(GPIO_TypeDef *csPort, const uint16_t csPin, GPIO_TypeDef *irqPort, const uint16_t irqPin, const uint8_t device)
+{
+	if (deviceCount >= HOST_HAL_MAXDEVICES)
+	{
+		return false;
+	}
+
+	devices[deviceCount].csPort = csPort;
+	devices[deviceCount].csPin = csPin;
+	devices[deviceCount].irqPort = irqPort;
+	devices[deviceCount].irqPin = irqPin;
+	devices[deviceCount].device = device;
+	devices[deviceCount].irqLevel = false;
+	deviceCount++;
+
+	return true;
+}
+
+void Host_HAL_SpiTransfer(const uint8_t *txData, uint8_t *rxData, const uint16_t size, const uint32_t callNs)
+{
+	Host_HAL_Route(callNs);
+
+	// PN532 ignores MOSI while it answers, only the received bytes matter
+	if (rxData != NULL)
+	{
+		PN532_Sim_ReceiveBuffer(rxData, size);
+		Host_HAL_Corrupt(rxData, size);
+	}
+	else
+	{
+		PN532_Sim_SendBuffer(txData, size);
+	}
+}
+
+void Host_HAL_SetSpiMaxHz(const uint32_t hz)
+{
+	spiMaxHz = hz;
+}
+
+void Host_HAL_SetTimerWakeup(const uint64_t ns)
+{
+	timerWakeupNs = ns;
+}
+
+void Host_HAL_SetUsartMaxBaud(const uint32_t baud)
+{
+	usartMaxBaud = baud;
+	usartFrames = 0;
+}
+
+uint64_t Host_HAL_GetSleepNs(void)
+{
+	return sleepNs;
+}
+
+uint32_t Host_HAL_GetWakeups(void)
+{
+	return wakeups;
+}
+
+void Host_HAL_EnableIRQ(void)
+{
+	primask = false;
+	Host_HAL_ServeEdges();
+}
+
+void Host_HAL_DisableIRQ(void)
+{
+	primask = true;
+}
+
+uint32_t Host_HAL_GetPRIMASK(void)
+{
+	return primask;
+}
+
+void Host_HAL_WaitForInterrupt(void)
+{
+	uint64_t now, wakeup, event;
+	uint8_t i, line;
+
+	Host_HAL_SampleIRQ();
+
+	// A pending interrupt does not let the core sleep
+	if (pendingEdges == 0 && !Host_HAL_UsartPending())
+	{
+		wakeups++;
+
+		// Bytes of USART6 line are stored by DMA, the core sleeps on up to an interrupt
+		do
+		{
+			now = Host_Clock_Now();
+			wakeup = (now / HOST_HAL_TICK_NS + 1) * HOST_HAL_TICK_NS;
+
+			// Without SysTick the core sleeps up to the end of simulation
+			if (tickSuspended)
+			{
+				wakeup = (Host_Clock_GetLimit() > now) ? Host_Clock_GetLimit() : PN532_SIM_NEVER;
+			}
+
+			for (i = 0; i < deviceCount; i++)
+			{
+				if (devices[i].irqLevel)
+				{
+					continue;
+				}
+
+				event = PN532_Sim_GetNextIRQ(devices[i].device);
+
+				if (event > now && event < wakeup)
+				{
+					wakeup = event;
+				}
+			}
+
+			if (timerWakeupNs > now && timerWakeupNs < wakeup)
+			{
+				wakeup = timerWakeupNs;
+			}
+
+			event = Host_HAL_UsartNextEvent(now);
+			line = (event < wakeup) ? true : false;
+			wakeup = line ? event : wakeup;
+
+			sleepNs += wakeup - now;
+			Host_Clock_Advance(wakeup - now);
+			Host_HAL_SampleIRQ();
+		}
+		while (line && pendingEdges == 0 && !Host_HAL_UsartPending());
+	}
+
+	// With interrupts masked they are served when unmasked
+	Host_HAL_ServeEdges();
+}
+
+HAL_StatusTypeDef HAL_Init(void)
+{
+	HAL_MspInit();
+	return HAL_OK;
+}
+
+__weak void HAL_MspInit(void)
+{
+}
+
+void HAL_SuspendTick(void)
+{
+	tickSuspended = true;
+}
+
+void HAL_ResumeTick(void)
+{
+	tickSuspended = false;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+	// HAL waits one tick more to guarantee the minimum time
+	Host_Clock_Advance((uint64_t)(Delay + 1) * HOST_HAL_TICK_NS);
+	Host_HAL_SampleIRQ();
+	Host_HAL_ServeEdges();
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef *RCC_OscInitStruct)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef *RCC_ClkInitStruct, uint32_t FLatency)
+{
+	// HCLK is the core clock, PPRE1 field divides it by 2 << (PPRE1 & 3) from DIV2 on
+	if (RCC_ClkInitStruct->APB1CLKDivider & RCC_HCLK_DIV2)
+	{
+		pclk1Hz = SystemCoreClock / (2UL << ((RCC_ClkInitStruct->APB1CLKDivider >> RCC_CFGR_PPRE1_Pos) & 0x03));
+	}
+	else
+	{
+		pclk1Hz = SystemCoreClock;
+	}
+
+	// APB2 divider takes the same values, PPRE2 field is 3 bits up
+	if (RCC_ClkInitStruct->APB2CLKDivider & RCC_HCLK_DIV2)
+	{
+		pclk2Hz = SystemCoreClock / (2UL << ((RCC_ClkInitStruct->APB2CLKDivider >> RCC_CFGR_PPRE1_Pos) & 0x03));
+	}
+	else
+	{
+		pclk2Hz = SystemCoreClock;
+	}
+
+	return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void)
+{
+	return pclk1Hz;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void)
+{
+	return pclk2Hz;
+}
+
+HAL_StatusTypeDef HAL_PWREx_EnableOverDrive(void)
+{
+	return HAL_OK;
+}
+
+void HAL_MPU_Enable(uint32_t MPU_Control)
+{
+}
+
+void HAL_MPU_Disable(void)
+{
+}
+
+void HAL_MPU_ConfigRegion(MPU_Region_InitTypeDef *MPU_Init)
+{
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority)
+{
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn)
+{
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	Host_HAL_Device *device = Host_HAL_FindCS(GPIOx, GPIO_Pin);
+
+	if (PinState == GPIO_PIN_SET)
+	{
+		GPIOx->ODR |= GPIO_Pin;
+	}
+	else
+	{
+		GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+	}
+
+	if (device == NULL)
+	{
+		return;
+	}
+
+	// Chip select is active low
+	PN532_Sim_SetDevice(device->device);
+	PN532_Sim_SetSelect(PinState == GPIO_PIN_RESET);
+	selected = (PinState == GPIO_PIN_RESET) ? device : NULL;
+
+	if (selected == NULL)
+	{
+		Host_HAL_SampleIRQ();
+		Host_HAL_ServeEdges();
+	}
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	Host_HAL_Device *device = Host_HAL_FindIRQ(GPIOx, GPIO_Pin);
+
+	if (device == NULL)
+	{
+		return (GPIOx->IDR & GPIO_Pin) ? GPIO_PIN_SET : GPIO_PIN_RESET;
+	}
+
+	Host_HAL_SampleIRQ();
+
+	// PN532 pulls IRQ low when a frame is ready
+	return device->irqLevel ? GPIO_PIN_RESET : GPIO_PIN_SET;
+}
+
+void HAL_GPIO_EXTI_IRQHandler(uint16_t GPIO_Pin)
+{
+	if (pendingEdges & GPIO_Pin)
+	{
+		pendingEdges &= ~GPIO_Pin;
+		HAL_GPIO_EXTI_Callback(GPIO_Pin);
+	}
+}
+
+__weak void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin)
+{
+	UNUSED(GPIO_Pin);
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+	hdma->State = HAL_DMA_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Start(DMA_HandleTypeDef *hdma, uint32_t SrcAddress, uint32_t DstAddress, uint32_t DataLength)
+{
+	DMA_Stream_TypeDef *stream = hdma->Instance;
+
+	// Flags of the line up to now are kept before the stream changes
+	Host_HAL_UsartSync();
+
+	stream->PAR = (hdma->Init.Direction == DMA_MEMORY_TO_PERIPH) ? DstAddress : SrcAddress;
+	stream->M0AR = (hdma->Init.Direction == DMA_MEMORY_TO_PERIPH) ? SrcAddress : DstAddress;
+	stream->NDTR = DataLength;
+	stream->CR |= DMA_SxCR_EN;
+	hdma->State = HAL_DMA_STATE_BUSY;
+
+	// Addresses are 32 bit as on the target, the host executable is not position independent
+	if (SrcAddress == (uint32_t)(uintptr_t)&USART6->RDR)
+	{
+		usartRxStream = stream;
+		usartRing = (uint8_t *)(uintptr_t)DstAddress;
+		usartRingSize = DataLength;
+		usartHead = 0;
+		usartTail = 0;
+		usartLineFreeNs = 0;
+		usartIdleNs = 0;
+	}
+	else if (DstAddress == (uint32_t)(uintptr_t)&USART6->TDR && USART6->BRR != 0)
+	{
+		usartTxStream = stream;
+		usartTxData = (const uint8_t *)(uintptr_t)SrcAddress;
+		usartTxLength = DataLength;
+		usartTxEndNs = Host_Clock_Now() + DataLength * (HOST_HAL_USART_BYTEBITS * 1000000000ULL / Host_HAL_GetUsartBaud());
+	}
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_Abort(DMA_HandleTypeDef *hdma)
+{
+	if (hdma->Instance == usartTxStream)
+	{
+		usartTxData = NULL;
+	}
+
+	hdma->Instance->CR &= ~DMA_SxCR_EN;
+	hdma->State = HAL_DMA_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_DMA_PollForTransfer(DMA_HandleTypeDef *hdma, HAL_DMA_LevelCompleteTypeDef CompleteLevel, uint32_t Timeout)
+{
+	// Stream of TDR ended with the frame, circular streams never end
+	if (hdma->Instance == usartTxStream && usartTxData != NULL)
+	{
+		return HAL_ERROR;
+	}
+
+	hdma->State = HAL_DMA_STATE_READY;
+	return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+}
+
+HAL_StatusTypeDef HAL_SPI_Init(SPI_HandleTypeDef *hspi)
+{
+	if (hspi->State == HAL_SPI_STATE_RESET)
+	{
+		hspi->Lock = HAL_UNLOCKED;
+		HAL_SPI_MspInit(hspi);
+	}
+
+	// Clock of transfers is taken from the register, as the peripheral does
+	MODIFY_REG(hspi->Instance->CR1, SPI_CR1_BR, hspi->Init.BaudRatePrescaler);
+
+	hspi->ErrorCode = HAL_SPI_ERROR_NONE;
+	hspi->State = HAL_SPI_STATE_READY;
+	return HAL_OK;
+}
+
+__weak void HAL_SPI_MspInit(SPI_HandleTypeDef *hspi)
+{
+	UNUSED(hspi);
+}
+
+HAL_SPI_StateTypeDef HAL_SPI_GetState(SPI_HandleTypeDef *hspi)
+{
+	return hspi->State;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	Host_HAL_SpiTransfer(pData, NULL, Size, PN532_SIM_CALLCOST_NS);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	Host_HAL_SpiTransfer(NULL, pData, Size, PN532_SIM_CALLCOST_NS);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size, uint32_t Timeout)
+{
+	Host_HAL_SpiTransfer(pTxData, pRxData, Size, PN532_SIM_CALLCOST_NS);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *pData, uint16_t Size)
+{
+	HAL_SPI_Transmit(hspi, pData, Size, HAL_MAX_DELAY);
+	HAL_SPI_TxCpltCallback(hspi);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_TransmitReceive_DMA(SPI_HandleTypeDef *hspi, uint8_t *pTxData, uint8_t *pRxData, uint16_t Size)
+{
+	HAL_SPI_TransmitReceive(hspi, pTxData, pRxData, Size, HAL_MAX_DELAY);
+	HAL_SPI_TxRxCpltCallback(hspi);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Abort(SPI_HandleTypeDef *hspi)
+{
+	hspi->State = HAL_SPI_STATE_READY;
+	return HAL_OK;
+}
+
+void HAL_SPI_IRQHandler(SPI_HandleTypeDef *hspi)
+{
+}
+
+__weak void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	UNUSED(hspi);
+}
+
+__weak void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+	UNUSED(hspi);
+}
+
+__weak void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+	UNUSED(hspi);
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+	if (hi2c->State == HAL_I2C_STATE_RESET)
+	{
+		hi2c->Lock = HAL_UNLOCKED;
+		HAL_I2C_MspInit(hi2c);
+	}
+
+	// Clock of transfers is taken from timing, as the peripheral does
+	i2cTiming = hi2c->Init.Timing;
+	hi2c->Instance->TIMINGR = hi2c->Init.Timing;
+
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	hi2c->State = HAL_I2C_STATE_READY;
+	return HAL_OK;
+}
+
+__weak void HAL_I2C_MspInit(I2C_HandleTypeDef *hi2c)
+{
+	UNUSED(hi2c);
+}
+
+HAL_StatusTypeDef HAL_I2CEx_ConfigAnalogFilter(I2C_HandleTypeDef *hi2c, uint32_t AnalogFilter)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	const uint32_t bitNs = Host_HAL_GetI2cBitNs();
+
+	// Whole write is one transaction of PN532
+	Host_HAL_I2cSelect(true, PN532_SPI_DATAWRITE);
+	PN532_Sim_SetTransportCost(PN532_SIM_CALLCOST_NS + HOST_HAL_I2C_FRAMEBITS * bitNs, HOST_HAL_I2C_BYTEBITS * bitNs);
+	PN532_Sim_SendBuffer(pData, Size);
+	Host_HAL_I2cSelect(false, 0);
+
+	HAL_I2C_MasterTxCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Transmit_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size)
+{
+	return HAL_I2C_Master_Transmit_IT(hi2c, DevAddress, pData, Size);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Receive(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+	if (Size == 0 || deviceCount == 0)
+	{
+		return HAL_ERROR;
+	}
+
+	Host_HAL_I2cReceive(pData, Size, true);
+
+	if (selected != NULL)
+	{
+		Host_HAL_I2cSelect(false, 0);
+	}
+
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+	if (Size == 0 || deviceCount == 0)
+	{
+		return HAL_ERROR;
+	}
+
+	Host_HAL_I2cReceive(pData, Size, !i2cReading);
+	i2cReading = true;
+
+	// Automatic end of last frame closes the transaction with STOP
+	if (XferOptions == I2C_LAST_FRAME)
+	{
+		if (selected != NULL)
+		{
+			Host_HAL_I2cSelect(false, 0);
+		}
+
+		i2cReading = false;
+	}
+
+	HAL_I2C_MasterRxCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Seq_Receive_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint8_t *pData, uint16_t Size, uint32_t XferOptions)
+{
+	return HAL_I2C_Master_Seq_Receive_IT(hi2c, DevAddress, pData, Size, XferOptions);
+}
+
+HAL_StatusTypeDef HAL_I2C_Master_Abort_IT(I2C_HandleTypeDef *hi2c, uint16_t DevAddress)
+{
+	if (selected != NULL)
+	{
+		Host_HAL_I2cSelect(false, 0);
+	}
+
+	i2cReading = false;
+	hi2c->State = HAL_I2C_STATE_READY;
+	HAL_I2C_AbortCpltCallback(hi2c);
+	return HAL_OK;
+}
+
+void HAL_I2C_EV_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+}
+
+void HAL_I2C_ER_IRQHandler(I2C_HandleTypeDef *hi2c)
+{
+}
+
+__weak void HAL_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	UNUSED(hi2c);
+}
+
+__weak void HAL_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	UNUSED(hi2c);
+}
+
+__weak void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	UNUSED(hi2c);
+}
+
+__weak void HAL_I2C_AbortCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	UNUSED(hi2c);
+}
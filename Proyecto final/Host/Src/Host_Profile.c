@@ -0,0 +1,87 @@
+/*
+ * Host_Profile.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "Host_Profile.h"
+#include "NFC_Timer.h"
+#include "NFC.h"
+
+#define true	(1)
+#define false	(0)
+
+/// Header of ITM software packet with 4 bytes of payload
+#define ITM_HEADER_WORD(port)	((uint8_t)(((port) << 3) | 0x03))
+
+static FILE *output = NULL;
+static uint32_t lastCycles[NFC_PROFILE_DEVICE_MASK + 1];
+static uint32_t dropped = 0;
+
+void Host_Profile_SetOutput(FILE *file)
+{
+	output = file;
+}
+
+uint8_t NFC_Profile_Init(void)
+{
+	// Synchronization packet: at least 47 zero bits followed by a one
+	static const uint8_t sync[6] = {0x00, 0x00, 0x00, 0x00, 0x00, 0x80};
+
+	if (output != NULL)
+	{
+		fwrite(sync, 1, sizeof(sync), output);
+	}
+
+	dropped = 0;
+
+	return true;
+}
+
+void NFC_Profile_Mark(const uint8_t device, const uint8_t phase, const uint8_t command)
+{
+	// Wall time, as DWT on target with core clock kept in sleep mode
+	uint32_t now = (uint32_t)NFC_Timer_GetWallCycles();
+	uint32_t payload, record;
+	uint8_t number = device & NFC_PROFILE_DEVICE_MASK;
+	uint8_t packet[5];
+
+	if (phase == NFC_PHASE_START)
+	{
+		payload = command;
+	}
+	else
+	{
+		payload = now - lastCycles[number];
+
+		if (payload > NFC_PROFILE_MAXCYCLES)
+		{
+			payload = NFC_PROFILE_MAXCYCLES;
+		}
+	}
+
+	lastCycles[number] = now;
+
+	if (output == NULL)
+	{
+		dropped++;
+		return;
+	}
+
+	record = ((uint32_t)phase << NFC_PROFILE_PHASE_POS) | ((uint32_t)number << NFC_PROFILE_DEVICE_POS) | payload;
+
+	// Payload of ITM packets is little endian
+	packet[0] = ITM_HEADER_WORD(NFC_PROFILE_PORT);
+	packet[1] = (uint8_t)record;
+	packet[2] = (uint8_t)(record >> 8);
+	packet[3] = (uint8_t)(record >> 16);
+	packet[4] = (uint8_t)(record >> 24);
+
+	fwrite(packet, 1, sizeof(packet), output);
+}
+
+uint32_t NFC_Profile_GetDropped(void)
+{
+	return dropped;
+}
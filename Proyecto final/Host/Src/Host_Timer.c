@@ -0,0 +1,77 @@
+/*
+ * Host_Timer.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  NFC_Timer over the virtual clock, replaces Core/Src/NFC_Timer.c in the host
+ *  build. Like DWT on target, cycle counter does not count time asleep in WFI.
+ */
+
+#include "NFC_Timer.h"
+#include "Host_Clock.h"
+#include "Host_HAL.h"
+#include "PN532_Sim.h"
+
+#define true	(1)
+#define false	(0)
+
+static uint64_t Host_Timer_NsToCycles(const uint64_t ns)
+{
+	return ns * (SystemCoreClock / 1000000) / 1000;
+}
+
+uint8_t NFC_Timer_Init(void)
+{
+	return true;
+}
+
+uint32_t NFC_Timer_GetCycles(void)
+{
+	return (uint32_t)Host_Timer_NsToCycles(Host_Clock_Now() - Host_HAL_GetSleepNs());
+}
+
+uint64_t NFC_Timer_GetWallCycles(void)
+{
+	return Host_Timer_NsToCycles(Host_Clock_Now());
+}
+
+uint32_t NFC_Timer_GetUs(void)
+{
+	return (uint32_t)(Host_Clock_Now() / 1000);
+}
+
+void NFC_Timer_DelayUs(const uint32_t us)
+{
+	Host_Clock_Advance((uint64_t)us * 1000);
+}
+
+void NFC_Timer_SleepUs(const uint32_t us)
+{
+	const uint64_t end = Host_Clock_Now() + (uint64_t)us * 1000;
+
+	if (us < NFC_TIMER_SLEEP_MINUS)
+	{
+		NFC_Timer_DelayUs(us);
+		return;
+	}
+
+	// TIM7 interrupt ends WFI, SysTick and IRQ edges wake up the core before
+	Host_HAL_SetTimerWakeup(end);
+
+	__disable_irq();
+	while (Host_Clock_Now() < end)
+	{
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	__enable_irq();
+
+	Host_HAL_SetTimerWakeup(PN532_SIM_NEVER);
+}
+
+uint32_t NFC_Timer_CyclesToUs(const uint64_t cycles)
+{
+	return (uint32_t)(cycles / (SystemCoreClock / 1000000));
+}
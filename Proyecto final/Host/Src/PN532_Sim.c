@@ -0,0 +1,1141 @@
+/*
+ * PN532_Sim.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+/// Frames waiting to be read by host: ACK first, then response
+#define PN532_SIM_QUEUE		(2)
+
+/// Card not matching any type of InAutoPoll
+#define PN532_SIM_NOTYPE	(0xFF)
+
+/// Target listed by InListPassiveTarget
+typedef struct
+{
+	uint8_t card;				///< Index of card in field
+	int8_t sector;				///< Sector authenticated, -1 for none
+	uint8_t valueReady;			///< Transfer buffer holds a value
+	uint8_t released;			///< Forgotten by InRelease
+	uint8_t value[4];			///< Transfer buffer of value operations
+}PN532_Sim_Target;
+
+typedef struct
+{
+	/* Configuration */
+	uint32_t latencyUs[256];
+	uint8_t firmware[3];		///< IC, Ver and Rev
+	uint8_t maxRetries;			///< MxRtyPassiveActivation of RFConfiguration
+	PN532_Sim_Card cards[PN532_SIM_MAXCARDS];
+	uint8_t cardCount;
+
+	/* SPI transaction */
+	uint8_t selected;
+	uint8_t operation;			///< First byte after select, 0 until it is received
+	uint8_t input[PN532_SIM_FRAMESIZE];
+	uint16_t inputLength;
+	uint16_t readPosition;
+
+	/* Frames to host */
+	uint8_t output[PN532_SIM_QUEUE][PN532_SIM_FRAMESIZE];
+	uint16_t outputLength[PN532_SIM_QUEUE];
+	uint64_t outputReadyNs[PN532_SIM_QUEUE];
+	uint8_t outputCount;
+	uint8_t last[PN532_SIM_FRAMESIZE];	///< Last response, sent again on NACK
+	uint16_t lastLength;
+
+	/* InListPassiveTarget or InAutoPoll waiting a card */
+	uint8_t waitCard;
+	uint8_t waitCommand;		///< Command answered when a card is found
+	uint8_t waitTargets;		///< MaxTg of command
+	uint64_t waitStartNs;
+	uint64_t waitEndNs;			///< Answer without targets, PN532_SIM_NEVER with infinite retries
+	uint8_t autoTypes[PN532_AUTOPOLL_MAXTYPES];	///< Types of InAutoPoll
+	uint8_t autoTypeCount;
+	uint64_t autoPeriodNs;		///< Time between polls of InAutoPoll
+
+	PN532_Sim_Target targets[2];
+	uint8_t targetCount;
+	uint8_t selectedTarget;		///< Tg of target selected, 0 for none
+
+	/* HSU port */
+	uint8_t serialRate;			///< Baud rate code in use
+	uint8_t serialNext;			///< Code taken after ACK of SetSerialBaudRate answer, 0xFF for none
+
+	PN532_Sim_Stats stats;
+}PN532_Sim_Device;
+
+static PN532_Sim_Device devices[PN532_SIM_MAXDEVICES];
+static PN532_Sim_Device *device = &devices[0];
+static uint32_t callCostNs = PN532_SIM_CALLCOST_NS;
+static uint32_t byteCostNs = PN532_SIM_BYTECOST_NS;
+static uint32_t ackLatencyUs = PN532_SIM_ACK_US;
+
+static const uint8_t simAck[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+static const uint8_t simNack[6] = {0x00, 0x00, 0xFF, 0xFF, 0x00, 0x00};
+static const uint8_t simError[8] = {0x00, 0x00, 0xFF, 0x01, 0xFF, 0x7F, 0x81, 0x00};
+static const uint8_t simDefaultKey[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static const uint8_t simDefaultAccess[4] = {0xFF, 0x07, 0x80, 0x69};
+
+static void PN532_Sim_Charge(const size_t bytes);
+static uint8_t PN532_Sim_CardPresent(const PN532_Sim_Card *card, const uint64_t now);
+static void PN532_Sim_Queue(const uint8_t *frame, const uint16_t length, const uint64_t readyNs);
+static void PN532_Sim_Respond(const uint8_t command, const uint8_t *data, const uint16_t length, const uint64_t readyNs);
+static uint8_t PN532_Sim_AutoPollType(const PN532_Sim_Card *card);
+static uint64_t PN532_Sim_FoundNs(const PN532_Sim_Card *card);
+static void PN532_Sim_ListTargets(uint64_t readyNs);
+static void PN532_Sim_Update(void);
+static uint64_t PN532_Sim_NextEvent(void);
+static uint8_t PN532_Sim_Select(const uint8_t number);
+static uint8_t PN532_Sim_ValueValid(const uint8_t *block);
+static uint16_t PN532_Sim_Mifare(PN532_Sim_Target *target, const uint8_t *data, const uint16_t length, uint8_t *answer);
+static void PN532_Sim_Command(const uint8_t *data, const uint16_t length);
+static void PN532_Sim_Receive(void);
+static void PN532_Sim_Write(const uint8_t byte);
+static uint8_t PN532_Sim_Read(void);
+
+static void PN532_Sim_Charge(const size_t bytes)
+{
+	uint64_t cost = callCostNs + (uint64_t)bytes * byteCostNs;
+
+	Host_Clock_Advance(cost);
+	device->stats.transportNs += cost;
+	device->stats.bytes += bytes;
+	device->stats.calls++;
+}
+
+static uint8_t PN532_Sim_CardPresent(const PN532_Sim_Card *card, const uint64_t now)
+{
+	return (now >= card->arriveNs && now < card->leaveNs) ? true : false;
+}
+
+static void PN532_Sim_Queue(const uint8_t *frame, const uint16_t length, const uint64_t readyNs)
+{
+	if (device->outputCount >= PN532_SIM_QUEUE)
+	{
+		return;
+	}
+
+	memcpy(device->output[device->outputCount], frame, length);
+	device->outputLength[device->outputCount] = length;
+	device->outputReadyNs[device->outputCount] = readyNs;
+	device->outputCount++;
+}
+
+static void PN532_Sim_Respond(const uint8_t command, const uint8_t *data, const uint16_t length, const uint64_t readyNs)
+{
+	uint8_t *frame = device->last;
+	uint8_t checksum = PN532_PN532TOHOST + command + 1;
+	uint16_t i, position = 0, frameLength = length + 2;	// TFI and response code
+
+	frame[position++] = PN532_PREAMBLE;
+	frame[position++] = PN532_STARTCODE1;
+	frame[position++] = PN532_STARTCODE2;
+
+	if (frameLength > PN532_NORMAL_MAXLEN)
+	{
+		frame[position++] = 0xFF;
+		frame[position++] = 0xFF;
+		frame[position++] = (uint8_t)(frameLength >> 8);
+		frame[position++] = (uint8_t)frameLength;
+		frame[position++] = ~(uint8_t)((frameLength >> 8) + frameLength) + 1;
+	}
+	else
+	{
+		frame[position++] = (uint8_t)frameLength;
+		frame[position++] = ~(uint8_t)frameLength + 1;
+	}
+
+	frame[position++] = PN532_PN532TOHOST;
+	frame[position++] = command + 1;
+
+	for (i = 0; i < length; i++)
+	{
+		frame[position++] = data[i];
+		checksum += data[i];
+	}
+
+	frame[position++] = ~checksum + 1;
+	frame[position++] = PN532_POSTAMBLE;
+
+	device->lastLength = position;
+	PN532_Sim_Queue(frame, position, readyNs);
+}
+
+static uint8_t PN532_Sim_AutoPollType(const PN532_Sim_Card *card)
+{
+	uint8_t i;
+
+	// Simulated cards are 106 kbps type A, first type of the list they match is reported
+	for (i = 0; i < device->autoTypeCount; i++)
+	{
+		switch (device->autoTypes[i])
+		{
+		case PN532_AUTOPOLL_GENERIC106:
+			return device->autoTypes[i];
+
+		case PN532_AUTOPOLL_MIFARE:
+			if (card->selRes & 0x08)
+			{
+				return device->autoTypes[i];
+			}
+			break;
+
+		case PN532_AUTOPOLL_ISO14443_4A:
+			if (card->selRes & 0x20)
+			{
+				return device->autoTypes[i];
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	return PN532_SIM_NOTYPE;
+}
+
+static uint64_t PN532_Sim_FoundNs(const PN532_Sim_Card *card)
+{
+	uint64_t event = (card->arriveNs > device->waitStartNs) ? card->arriveNs : device->waitStartNs;
+	uint64_t polls;
+
+	if (card->halted)
+	{
+		return PN532_SIM_NEVER;
+	}
+
+	if (device->waitCommand == PN532_COMMAND_INAUTOPOLL)
+	{
+		if (PN532_Sim_AutoPollType(card) == PN532_SIM_NOTYPE)
+		{
+			return PN532_SIM_NEVER;
+		}
+
+		// InAutoPoll only looks at the field once each period
+		polls = (event - device->waitStartNs + device->autoPeriodNs - 1) / device->autoPeriodNs;
+		event = device->waitStartNs + polls * device->autoPeriodNs;
+	}
+
+	// Card answers one activation time after it is polled in the field
+	event += (uint64_t)device->latencyUs[PN532_COMMAND_INLISTPASSIVETARGET] * 1000;
+
+	return (event < card->leaveNs) ? event : PN532_SIM_NEVER;
+}
+
+static void PN532_Sim_ListTargets(uint64_t readyNs)
+{
+	const uint64_t now = Host_Clock_Now();
+	uint8_t answer[1 + PN532_AUTOPOLL_MAXTARGETS * 17], i, position = 1, type = 0;
+	PN532_Sim_Card *card;
+
+	device->targetCount = 0;
+
+	for (i = 0; i < device->cardCount && device->targetCount < device->waitTargets; i++)
+	{
+		card = &device->cards[i];
+
+		if (!PN532_Sim_CardPresent(card, now) || card->halted)
+		{
+			continue;
+		}
+
+		if (device->waitCommand == PN532_COMMAND_INAUTOPOLL)
+		{
+			type = PN532_Sim_AutoPollType(card);
+			if (type == PN532_SIM_NOTYPE)
+			{
+				continue;
+			}
+		}
+
+		device->targets[device->targetCount].card = i;
+		device->targets[device->targetCount].sector = -1;
+		device->targets[device->targetCount].valueReady = false;
+		device->targets[device->targetCount].released = false;
+		device->targetCount++;
+
+		// InAutoPoll puts type and length of data before the data of each target
+		if (device->waitCommand == PN532_COMMAND_INAUTOPOLL)
+		{
+			answer[position++] = type;
+			answer[position++] = 5 + card->uidLength;
+		}
+
+		answer[position++] = device->targetCount;	// Tg
+		answer[position++] = card->sensRes[0];
+		answer[position++] = card->sensRes[1];
+		answer[position++] = card->selRes;
+		answer[position++] = card->uidLength;
+		memcpy(&answer[position], card->uid, card->uidLength);
+		position += card->uidLength;
+	}
+
+	answer[0] = device->targetCount;	// NbTg
+	device->stats.targets += device->targetCount;
+	device->waitCard = false;
+
+	// First target is halted to activate the next one, the last target stays selected
+	device->selectedTarget = device->targetCount;
+	if (device->targetCount > 1)
+	{
+		readyNs += (uint64_t)(device->targetCount - 1) * PN532_SIM_ACTIVATION_US * 1000;
+	}
+
+	PN532_Sim_Respond(device->waitCommand, answer, position, readyNs);
+}
+
+static void PN532_Sim_Update(void)
+{
+	const uint64_t now = Host_Clock_Now();
+	uint8_t i;
+
+	if (!device->waitCard)
+	{
+		return;
+	}
+
+	for (i = 0; i < device->cardCount; i++)
+	{
+		if (PN532_Sim_CardPresent(&device->cards[i], now) && now >= PN532_Sim_FoundNs(&device->cards[i]))
+		{
+			PN532_Sim_ListTargets(now);
+			return;
+		}
+	}
+
+	if (now >= device->waitEndNs)
+	{
+		PN532_Sim_ListTargets(now);
+	}
+}
+
+static uint64_t PN532_Sim_NextEvent(void)
+{
+	const uint64_t now = Host_Clock_Now();
+	uint64_t next = PN532_SIM_NEVER, event;
+	uint8_t i;
+
+	if (device->outputCount > 0)
+	{
+		return device->outputReadyNs[0];
+	}
+
+	if (!device->waitCard)
+	{
+		return PN532_SIM_NEVER;
+	}
+
+	// First card that enters, or is already in, the field
+	for (i = 0; i < device->cardCount; i++)
+	{
+		if (device->cards[i].leaveNs <= now)
+		{
+			continue;
+		}
+
+		event = PN532_Sim_FoundNs(&device->cards[i]);
+
+		if (event < next)
+		{
+			next = event;
+		}
+	}
+
+	return (device->waitEndNs < next) ? device->waitEndNs : next;
+}
+
+static uint8_t PN532_Sim_Select(const uint8_t number)
+{
+	if (number == device->selectedTarget)
+	{
+		return false;
+	}
+
+	// Crypto1 session of the card selected before ends with its selection
+	if (device->selectedTarget != 0)
+	{
+		device->targets[device->selectedTarget - 1].sector = -1;
+		device->targets[device->selectedTarget - 1].valueReady = false;
+	}
+
+	device->selectedTarget = number;
+	return true;
+}
+
+static uint8_t PN532_Sim_ValueValid(const uint8_t *block)
+{
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (block[i] != block[8 + i] || (block[i] ^ block[4 + i]) != 0xFF)
+		{
+			return false;
+		}
+	}
+
+	return (block[12] == block[14] && block[13] == block[15] && (block[12] ^ block[13]) == 0xFF) ? true : false;
+}
+
+static uint16_t PN532_Sim_Mifare(PN532_Sim_Target *target, const uint8_t *data, const uint16_t length, uint8_t *answer)
+{
+	PN532_Sim_Card *card = &device->cards[target->card];
+	const uint8_t *key;
+	uint8_t block;
+	int32_t value;
+
+	answer[0] = PN532_SIM_STATUS_OK;
+
+	if (!PN532_Sim_CardPresent(card, Host_Clock_Now()))
+	{
+		answer[0] = PN532_SIM_STATUS_TIMEOUT;
+		return 1;
+	}
+
+	if (length < 2 || data[1] >= PN532_SIM_BLOCKS)
+	{
+		answer[0] = PN532_SIM_STATUS_CONTEXT;
+		return 1;
+	}
+
+	block = data[1];
+
+	switch (data[0])
+	{
+	case MIFARE_CMD_AUTH_A:
+	case MIFARE_CMD_AUTH_B:
+		// Key A is in bytes 0 to 5 of trailer, key B in bytes 10 to 15
+		key = &card->memory[block | 0x03][(data[0] == MIFARE_CMD_AUTH_A) ? 0 : 10];
+
+		if (length < 12 || memcmp(&data[2], key, 6) != 0 || memcmp(&data[8], card->uid, 4) != 0)
+		{
+			target->sector = -1;
+			answer[0] = PN532_SIM_STATUS_AUTH;
+			return 1;
+		}
+
+		target->sector = block / 4;
+		return 1;
+
+	case MIFARE_CMD_READ:
+		if (target->sector != block / 4)
+		{
+			answer[0] = PN532_SIM_STATUS_TIMEOUT;
+			return 1;
+		}
+
+		memcpy(&answer[1], card->memory[block], PN532_SIM_BLOCKSIZE);
+		return 1 + PN532_SIM_BLOCKSIZE;
+
+	case MIFARE_CMD_WRITE:
+		if (target->sector != block / 4 || length < 2 + PN532_SIM_BLOCKSIZE)
+		{
+			answer[0] = PN532_SIM_STATUS_TIMEOUT;
+			return 1;
+		}
+
+		memcpy(card->memory[block], &data[2], PN532_SIM_BLOCKSIZE);
+		return 1;
+
+	case MIFARE_CMD_INCREMENT:
+	case MIFARE_CMD_DECREMENT:
+	case MIFARE_CMD_STORE:
+		// Value block is loaded in transfer buffer, operand follows the block number.
+		// Card refuses a block without the redundancy of a value block
+		if (target->sector != block / 4 || length < 6 || !PN532_Sim_ValueValid(card->memory[block]))
+		{
+			answer[0] = PN532_SIM_STATUS_TIMEOUT;
+			return 1;
+		}
+
+		memcpy(&value, card->memory[block], 4);
+
+		if (data[0] != MIFARE_CMD_STORE)
+		{
+			int32_t operand;
+
+			memcpy(&operand, &data[2], 4);
+			value = (data[0] == MIFARE_CMD_INCREMENT) ? value + operand : value - operand;
+		}
+
+		memcpy(target->value, &value, 4);
+		target->valueReady = true;
+		return 1;
+
+	case MIFARE_CMD_TRANSFER:
+		if (target->sector != block / 4 || !target->valueReady)
+		{
+			answer[0] = PN532_SIM_STATUS_TIMEOUT;
+			return 1;
+		}
+
+		// Value block keeps the value, its inverse and the value again, then the address
+		for (uint8_t i = 0; i < 4; i++)
+		{
+			card->memory[block][i] = target->value[i];
+			card->memory[block][4 + i] = ~target->value[i];
+			card->memory[block][8 + i] = target->value[i];
+		}
+		card->memory[block][12] = block;
+		card->memory[block][13] = ~block;
+		card->memory[block][14] = block;
+		card->memory[block][15] = ~block;
+
+		target->valueReady = false;
+		return 1;
+
+	default:
+		answer[0] = PN532_SIM_STATUS_CONTEXT;
+		return 1;
+	}
+}
+
+static void PN532_Sim_Command(const uint8_t *data, const uint16_t length)
+{
+	const uint64_t now = Host_Clock_Now();
+	const uint8_t command = data[0];
+	uint64_t ready = now + (uint64_t)device->latencyUs[command] * 1000;
+	uint8_t answer[PN532_SIM_FRAMESIZE];
+	uint16_t answerLength = 0;
+
+	device->stats.commands++;
+
+	// ACK is ready first, the answer follows after processing time
+	PN532_Sim_Queue(simAck, sizeof(simAck), now + (uint64_t)ackLatencyUs * 1000);
+
+	switch (command)
+	{
+	case PN532_COMMAND_DIAGNOSE:
+		// Communication line test answers the same data
+		memcpy(answer, &data[1], length - 1);
+		answerLength = length - 1;
+		break;
+
+	case PN532_COMMAND_GETFIRMWAREVERSION:
+		answer[0] = device->firmware[0];
+		answer[1] = device->firmware[1];
+		answer[2] = device->firmware[2];
+		answer[3] = 0x07;	// ISO14443A, ISO14443B and ISO18092 supported
+		answerLength = 4;
+		break;
+
+	case PN532_COMMAND_SAMCONFIGURATION:
+		break;
+
+	case PN532_COMMAND_SETSERIALBAUDRATE:
+		// New rate is used once host acknowledges this answer
+		if (length < 2 || data[1] > PN532_HSU_BAUD_1288000)
+		{
+			PN532_Sim_Queue(simError, sizeof(simError), ready);
+			return;
+		}
+
+		device->serialNext = data[1];
+		break;
+
+	case PN532_COMMAND_RFCONFIGURATION:
+		if (length >= 5 && data[1] == 0x05)
+		{
+			device->maxRetries = data[4];
+		}
+		break;
+
+	case PN532_COMMAND_INLISTPASSIVETARGET:
+		device->waitCommand = command;
+		device->waitTargets = (length >= 2 && data[1] == 2) ? 2 : 1;
+		device->waitStartNs = now;
+
+		// Only 106 kbps type A cards are simulated, other baud rates find no target
+		if (length < 3 || data[2] != PN532_MIFARE_ISO14443A)
+		{
+			device->waitEndNs = now;
+		}
+		else if (device->maxRetries == 0xFF)
+		{
+			device->waitEndNs = PN532_SIM_NEVER;
+		}
+		else
+		{
+			device->waitEndNs = now + (uint64_t)device->latencyUs[command] * 1000 * (device->maxRetries + 1);
+		}
+
+		device->waitCard = true;
+		PN532_Sim_Update();
+		return;
+
+	case PN532_COMMAND_INAUTOPOLL:
+		// PollNr, Period from 1 to 15 and up to 15 types
+		if (length < 4 || length > 3 + PN532_AUTOPOLL_MAXTYPES || data[1] == 0 || data[2] == 0 || data[2] > 15)
+		{
+			PN532_Sim_Queue(simError, sizeof(simError), ready);
+			return;
+		}
+
+		device->waitCommand = command;
+		device->waitTargets = PN532_AUTOPOLL_MAXTARGETS;
+		device->waitStartNs = now;
+		device->autoPeriodNs = (uint64_t)data[2] * PN532_AUTOPOLL_PERIODMS * 1000000;
+		device->autoTypeCount = length - 3;
+		memcpy(device->autoTypes, &data[3], device->autoTypeCount);
+
+		if (data[1] == PN532_AUTOPOLL_ENDLESS)
+		{
+			device->waitEndNs = PN532_SIM_NEVER;
+		}
+		else
+		{
+			device->waitEndNs = now + data[1] * device->autoPeriodNs;
+		}
+
+		device->waitCard = true;
+		PN532_Sim_Update();
+		return;
+
+	case PN532_COMMAND_INDATAEXCHANGE:
+		if (length < 3 || data[1] < 1 || data[1] > device->targetCount || device->targets[data[1] - 1].released)
+		{
+			answer[0] = PN532_SIM_STATUS_CONTEXT;
+			answerLength = 1;
+			break;
+		}
+
+		// Target not selected is woken up and selected first
+		if (PN532_Sim_Select(data[1]))
+		{
+			ready += (uint64_t)device->latencyUs[PN532_COMMAND_INSELECT] * 1000;
+		}
+
+		answerLength = PN532_Sim_Mifare(&device->targets[data[1] - 1], &data[2], length - 2, answer);
+		break;
+
+	case PN532_COMMAND_INCOMMUNICATETHRU:
+		if (length < 2 || device->selectedTarget == 0)
+		{
+			answer[0] = PN532_SIM_STATUS_CONTEXT;
+			answerLength = 1;
+			break;
+		}
+
+		answerLength = PN532_Sim_Mifare(&device->targets[device->selectedTarget - 1], &data[1], length - 1, answer);
+		break;
+
+	case PN532_COMMAND_INSELECT:
+		answer[0] = PN532_SIM_STATUS_OK;
+		answerLength = 1;
+
+		if (length < 2 || data[1] < 1 || data[1] > device->targetCount || device->targets[data[1] - 1].released)
+		{
+			answer[0] = PN532_SIM_STATUS_CONTEXT;
+			break;
+		}
+
+		// Selecting the same target again starts a new session too
+		if (!PN532_Sim_Select(data[1]))
+		{
+			device->targets[data[1] - 1].sector = -1;
+			device->targets[data[1] - 1].valueReady = false;
+		}
+		break;
+
+	case PN532_COMMAND_INDESELECT:
+	case PN532_COMMAND_INRELEASE:
+		answer[0] = PN532_SIM_STATUS_OK;
+		answerLength = 1;
+
+		if (length < 2 || data[1] > device->targetCount)
+		{
+			answer[0] = PN532_SIM_STATUS_CONTEXT;
+			break;
+		}
+
+		for (uint8_t i = 1; i <= device->targetCount; i++)
+		{
+			if (data[1] != NFC_TARGET_ALL && data[1] != i)
+			{
+				continue;
+			}
+
+			if (device->selectedTarget == i)
+			{
+				PN532_Sim_Select(0);
+			}
+
+			// Released target is halted, it does not answer to polls while it stays in field
+			if (command == PN532_COMMAND_INRELEASE && !device->targets[i - 1].released)
+			{
+				device->targets[i - 1].released = true;
+				device->cards[device->targets[i - 1].card].halted = true;
+			}
+		}
+		break;
+
+	default:
+		// Unknown command, answer is an error frame instead of a response
+		PN532_Sim_Queue(simError, sizeof(simError), ready);
+		return;
+	}
+
+	PN532_Sim_Respond(command, answer, answerLength, ready);
+}
+
+static void PN532_Sim_Receive(void)
+{
+	const uint8_t *frame = device->input;
+	uint16_t position = 0, length, header, i;
+	uint8_t checksum = 0;
+
+	// Skip preamble up to start code
+	while (position + 1 < device->inputLength && !(frame[position] == PN532_STARTCODE1 && frame[position + 1] == PN532_STARTCODE2))
+	{
+		position++;
+	}
+
+	if (position + 4 > device->inputLength)
+	{
+		device->stats.errors++;
+		return;
+	}
+
+	frame = &frame[position];
+	position = device->inputLength - position;	// Bytes from start code
+
+	// ACK from host aborts the command in progress
+	if (position >= 5 && memcmp(frame, &simAck[1], 5) == 0)
+	{
+		// Answer of SetSerialBaudRate was read, ACK confirms the change
+		if (device->serialNext != 0xFF && device->outputCount == 0)
+		{
+			device->serialRate = device->serialNext;
+		}
+
+		device->serialNext = 0xFF;
+		device->outputCount = 0;
+		device->waitCard = false;
+		return;
+	}
+
+	// NACK from host asks for the last response again
+	if (position >= 5 && memcmp(frame, &simNack[1], 5) == 0)
+	{
+		device->stats.nacks++;
+		device->outputCount = 0;
+
+		if (device->lastLength > 0)
+		{
+			PN532_Sim_Queue(device->last, device->lastLength, Host_Clock_Now());
+		}
+		return;
+	}
+
+	if (frame[2] == 0xFF && frame[3] == 0xFF)
+	{
+		if (position < 7 || (uint8_t)(frame[4] + frame[5] + frame[6]) != 0)
+		{
+			device->stats.errors++;
+			return;
+		}
+
+		length = ((uint16_t)frame[4] << 8) | frame[5];
+		header = 7;
+	}
+	else
+	{
+		if ((uint8_t)(frame[2] + frame[3]) != 0)
+		{
+			device->stats.errors++;
+			return;
+		}
+
+		length = frame[2];
+		header = 4;
+	}
+
+	if (length < 2 || header + length + 1 > position || frame[header] != PN532_HOSTTOPN532)
+	{
+		device->stats.errors++;
+		return;
+	}
+
+	for (i = 0; i <= length; i++)
+	{
+		checksum += frame[header + i];
+	}
+
+	if (checksum != 0)
+	{
+		device->stats.errors++;
+		return;
+	}
+
+	// New command drops frames not read
+	device->outputCount = 0;
+	device->waitCard = false;
+	device->serialNext = 0xFF;
+
+	PN532_Sim_Command(&frame[header + 1], length - 1);
+}
+
+static void PN532_Sim_Write(const uint8_t byte)
+{
+	if (!device->selected)
+	{
+		return;
+	}
+
+	if (device->operation == 0)
+	{
+		device->operation = byte;
+		device->readPosition = 0;
+		return;
+	}
+
+	if (device->operation == PN532_SPI_DATAWRITE && device->inputLength < PN532_SIM_FRAMESIZE)
+	{
+		device->input[device->inputLength++] = byte;
+	}
+}
+
+static uint8_t PN532_Sim_Read(void)
+{
+	if (!device->selected)
+	{
+		return 0x00;
+	}
+
+	PN532_Sim_Update();
+
+	if (device->operation == PN532_SPI_STATREAD)
+	{
+		return PN532_Sim_GetIRQ() ? PN532_SPI_READY : 0x00;
+	}
+
+	// Frame is only streamed once it is ready
+	if (device->operation != PN532_SPI_DATAREAD || device->outputCount == 0 ||
+		Host_Clock_Now() < device->outputReadyNs[0] || device->readPosition >= device->outputLength[0])
+	{
+		if (device->operation == PN532_SPI_DATAREAD)
+		{
+			device->readPosition++;
+		}
+		return 0x00;
+	}
+
+	return device->output[0][device->readPosition++];
+}
+
+
+
+void PN532_Sim_Init(void)
+{
+	uint8_t i;
+	uint16_t j;
+
+	memset(devices, 0, sizeof(devices));
+
+	for (i = 0; i < PN532_SIM_MAXDEVICES; i++)
+	{
+		for (j = 0; j < 256; j++)
+		{
+			devices[i].latencyUs[j] = PN532_SIM_LATENCY_US;
+		}
+
+		devices[i].firmware[0] = 0x32;	// PN532
+		devices[i].firmware[1] = 0x01;
+		devices[i].firmware[2] = 0x06;
+		devices[i].maxRetries = 0xFF;
+		devices[i].serialRate = PN532_HSU_BAUD_115200;
+		devices[i].serialNext = 0xFF;
+	}
+
+	device = &devices[0];
+	callCostNs = PN532_SIM_CALLCOST_NS;
+	byteCostNs = PN532_SIM_BYTECOST_NS;
+	ackLatencyUs = PN532_SIM_ACK_US;
+	Host_Clock_Reset();
+}
+
+void PN532_Sim_GetInterface(NFC_CommInterface *interface, const uint8_t bulk)
+{
+	memset(interface, 0, sizeof(NFC_CommInterface));
+
+	interface->GetByte = &PN532_Sim_GetByte;
+	interface->SendByte = &PN532_Sim_SendByte;
+	interface->SetSelect = &PN532_Sim_SetSelect;
+	interface->GetIRQ = &PN532_Sim_GetIRQ;
+	interface->WaitIRQ = &PN532_Sim_WaitIRQ;
+	interface->DelayUs = &PN532_Sim_DelayUs;
+	interface->SetDevice = &PN532_Sim_SetDevice;
+	interface->GetTimeUs = &PN532_Sim_GetTimeUs;
+
+	if (bulk)
+	{
+		interface->SendBuffer = &PN532_Sim_SendBuffer;
+		interface->ReceiveBuffer = &PN532_Sim_ReceiveBuffer;
+	}
+}
+
+void PN532_Sim_SetTransportCost(const uint32_t callNs, const uint32_t byteNs)
+{
+	callCostNs = callNs;
+	byteCostNs = byteNs;
+}
+
+void PN532_Sim_SetLatency(const uint8_t number, const uint8_t command, const uint32_t us)
+{
+	if (number < PN532_SIM_MAXDEVICES)
+	{
+		devices[number].latencyUs[command] = us;
+	}
+}
+
+void PN532_Sim_SetAckLatency(const uint32_t us)
+{
+	ackLatencyUs = us;
+}
+
+PN532_Sim_Card *PN532_Sim_AddCard(const uint8_t number, const uint8_t *uid, const uint8_t uidLength, const uint64_t arriveNs, const uint64_t leaveNs)
+{
+	PN532_Sim_Device *target;
+	PN532_Sim_Card *card;
+	uint8_t block;
+
+	if (number >= PN532_SIM_MAXDEVICES || (uidLength != 4 && uidLength != 7))
+	{
+		return NULL;
+	}
+
+	target = &devices[number];
+
+	if (target->cardCount >= PN532_SIM_MAXCARDS)
+	{
+		return NULL;
+	}
+
+	card = &target->cards[target->cardCount++];
+	memset(card, 0, sizeof(PN532_Sim_Card));
+	memcpy(card->uid, uid, uidLength);
+	card->uidLength = uidLength;
+	card->sensRes[0] = 0x00;
+	card->sensRes[1] = (uidLength == 4) ? 0x04 : 0x44;
+	card->selRes = 0x08;	// MIFARE Classic 1K
+	card->arriveNs = arriveNs;
+	card->leaveNs = leaveNs;
+
+	// Transport configuration: default keys and access bits in every trailer
+	for (block = 3; block < PN532_SIM_BLOCKS; block += 4)
+	{
+		memcpy(&card->memory[block][0], simDefaultKey, 6);
+		memcpy(&card->memory[block][6], simDefaultAccess, 4);
+		memcpy(&card->memory[block][10], simDefaultKey, 6);
+	}
+
+	// Manufacturer block starts with UID
+	memcpy(card->memory[0], uid, uidLength);
+
+	return card;
+}
+
+uint64_t PN532_Sim_GetNextIRQ(const uint8_t number)
+{
+	PN532_Sim_Device *current = device;
+	uint64_t next;
+
+	if (number >= PN532_SIM_MAXDEVICES)
+	{
+		return PN532_SIM_NEVER;
+	}
+
+	device = &devices[number];
+	PN532_Sim_Update();
+	next = PN532_Sim_NextEvent();
+	device = current;
+
+	return next;
+}
+
+void PN532_Sim_GetStats(const uint8_t number, PN532_Sim_Stats *stats)
+{
+	if (number < PN532_SIM_MAXDEVICES)
+	{
+		memcpy(stats, &devices[number].stats, sizeof(PN532_Sim_Stats));
+	}
+}
+
+uint16_t PN532_Sim_TakeFrame(uint8_t *buffer, const uint16_t size, uint64_t *readyNs)
+{
+	uint16_t length;
+
+	PN532_Sim_Update();
+
+	if (device->outputCount == 0 || Host_Clock_Now() < device->outputReadyNs[0] || device->outputLength[0] > size)
+	{
+		return 0;
+	}
+
+	length = device->outputLength[0];
+	memcpy(buffer, device->output[0], length);
+	*readyNs = device->outputReadyNs[0];
+
+	if (device->output[0][3] == 0x00 && device->output[0][4] == 0xFF)
+	{
+		device->stats.acks++;
+	}
+	else
+	{
+		device->stats.responses++;
+	}
+
+	device->outputCount--;
+	memmove(device->output[0], device->output[1], device->outputLength[1]);
+	device->outputLength[0] = device->outputLength[1];
+	device->outputReadyNs[0] = device->outputReadyNs[1];
+
+	return length;
+}
+
+uint8_t PN532_Sim_GetSerialRate(const uint8_t number)
+{
+	return (number < PN532_SIM_MAXDEVICES) ? devices[number].serialRate : PN532_HSU_BAUD_115200;
+}
+
+uint8_t PN532_Sim_GetByte(void)
+{
+	PN532_Sim_Charge(1);
+	return PN532_Sim_Read();
+}
+
+void PN532_Sim_SendByte(uint8_t byte)
+{
+	PN532_Sim_Charge(1);
+	PN532_Sim_Write(byte);
+}
+
+void PN532_Sim_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	size_t i;
+
+	PN532_Sim_Charge(length);
+
+	for (i = 0; i < length; i++)
+	{
+		PN532_Sim_Write(buffer[i]);
+	}
+}
+
+void PN532_Sim_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	size_t i;
+
+	PN532_Sim_Charge(length);
+
+	for (i = 0; i < length; i++)
+	{
+		buffer[i] = PN532_Sim_Read();
+	}
+}
+
+void PN532_Sim_SetSelect(uint8_t state)
+{
+	if (state)
+	{
+		device->selected = true;
+		device->operation = 0;
+		device->inputLength = 0;
+		return;
+	}
+
+	if (!device->selected)
+	{
+		return;
+	}
+
+	// Release of chip select ends the transaction
+	if (device->operation == PN532_SPI_DATAWRITE)
+	{
+		PN532_Sim_Receive();
+	}
+	else if (device->operation == PN532_SPI_DATAREAD && device->readPosition > 0 &&
+			 device->outputCount > 0 && Host_Clock_Now() >= device->outputReadyNs[0])
+	{
+		// Frame was read, next one moves to the front
+		if (device->output[0][3] == 0x00 && device->output[0][4] == 0xFF)
+		{
+			device->stats.acks++;
+		}
+		else
+		{
+			device->stats.responses++;
+		}
+
+		device->outputCount--;
+		memmove(device->output[0], device->output[1], device->outputLength[1]);
+		device->outputLength[0] = device->outputLength[1];
+		device->outputReadyNs[0] = device->outputReadyNs[1];
+	}
+
+	device->selected = false;
+	device->operation = 0;
+}
+
+uint8_t PN532_Sim_GetIRQ(void)
+{
+	PN532_Sim_Update();
+
+	return (device->outputCount > 0 && Host_Clock_Now() >= device->outputReadyNs[0]) ? true : false;
+}
+
+uint8_t PN532_Sim_WaitIRQ(uint32_t timeout)
+{
+	const uint64_t end = Host_Clock_Now() + (uint64_t)timeout * 1000000;
+	uint64_t now, next;
+
+	// Time jumps to the IRQ edge instead of polling, a card found still takes the time of its answer
+	while (!PN532_Sim_GetIRQ())
+	{
+		now = Host_Clock_Now();
+		next = PN532_Sim_NextEvent();
+
+		if (next > end)
+		{
+			Host_Clock_Advance(end - now);
+			return PN532_Sim_GetIRQ();
+		}
+
+		if (next <= now)
+		{
+			return false;
+		}
+
+		Host_Clock_Advance(next - now);
+	}
+
+	return true;
+}
+
+void PN532_Sim_DelayUs(uint32_t us)
+{
+	Host_Clock_Advance((uint64_t)us * 1000);
+}
+
+uint32_t PN532_Sim_GetTimeUs(void)
+{
+	return (uint32_t)(Host_Clock_Now() / 1000);
+}
+
+void PN532_Sim_SetDevice(uint8_t number)
+{
+	if (number < PN532_SIM_MAXDEVICES)
+	{
+		device = &devices[number];
+	}
+}
@@ -0,0 +1,121 @@
+/*
+ * Sim_Main.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Runs main() of the firmware on a workstation. main.c, NFC_SPI.c and
+ *  NFC_SPI_DMA.c are compiled unmodified over the HAL shim (Host_HAL) and
+ *  talk to a simulated PN532 (PN532_Sim). Time is virtual: waits and WFI
+ *  jump forward, so the reader loop runs far faster than real time. The
+ *  firmware never returns, the run ends when virtual time reaches the limit.
+ *
+ *  A card enters the field at 0.5 s and stays; with the 1 s pause of the
+ *  loop after each read, reads are close to simulated seconds.
+ *
+ *  Sim_Profile is the same runner built with NFC_PROFILE_ENABLE=1, it saves
+ *  the SWO stream of the driver to a file for Swo_Decode.
+ *
+ *  SPI clock chosen by the link calibration is printed at the end; variable
+ *  SIM_SPI_MAXHZ of environment limits the clock the wiring works at.
+ *
+ *  Usage: Sim_Main [simulated seconds]
+ *         Sim_Profile [simulated seconds] [capture file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+#include "NFC_SPI.h"
+#include "Host_HAL.h"
+#include "Host_Clock.h"
+#include "PN532_Sim.h"
+#if NFC_PROFILE_ENABLE
+#include "Host_Profile.h"
+#endif
+
+/// Default length of the run in simulated seconds
+#define SIM_SECONDS		(3600)
+
+/// Default capture file of profiling build
+#define SIM_CAPTURE		"profile.swo"
+
+/// main() of firmware, renamed when main.c is compiled for host
+int Firmware_Main(void);
+
+static jmp_buf simEnd;
+
+static void Sim_Stop(void)
+{
+	longjmp(simEnd, 1);
+}
+
+static double Sim_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint8_t uid[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+	uint32_t seconds = (argc > 1) ? strtoul(argv[1], NULL, 0) : SIM_SECONDS;
+	const char *spiMaxHz = getenv("SIM_SPI_MAXHZ");
+	PN532_Sim_Stats stats;
+	double start, elapsed, simulated;
+#if NFC_PROFILE_ENABLE
+	const char *capture = (argc > 2) ? argv[2] : SIM_CAPTURE;
+	FILE *file = fopen(capture, "wb");
+
+	if (file == NULL)
+	{
+		perror(capture);
+		return EXIT_FAILURE;
+	}
+
+	Host_Profile_SetOutput(file);
+#endif
+
+	if (!Host_HAL_Init())
+	{
+		printf("Register blocks can not be mapped\n");
+		return EXIT_FAILURE;
+	}
+
+	PN532_Sim_Init();
+	PN532_Sim_AddCard(0, uid, sizeof(uid), 500000000ULL, PN532_SIM_NEVER);
+	Host_HAL_AttachPN532(SPI_CS_GPIO_Port, SPI_CS_Pin, NFC_IRQ_GPIO_Port, NFC_IRQ_Pin, 0);
+	Host_HAL_SetSpiMaxHz((spiMaxHz != NULL) ? strtoul(spiMaxHz, NULL, 0) : 0);
+	Host_Clock_SetLimit((uint64_t)seconds * 1000000000ULL, &Sim_Stop);
+
+	start = Sim_Now();
+
+	if (setjmp(simEnd) == 0)
+	{
+		Firmware_Main();
+
+		// Firmware only returns when initialization fails
+		printf("Firmware stopped at %.3f s\n", Host_Clock_Now() * 1e-9);
+		return EXIT_FAILURE;
+	}
+
+	elapsed = Sim_Now() - start;
+	simulated = Host_Clock_Now() * 1e-9;
+	PN532_Sim_GetStats(0, &stats);
+
+	printf("Simulated %.1f s in %.3f s real (x%.0f)\n", simulated, elapsed, simulated / elapsed);
+	printf("commands %u  cards read %u  SPI bytes %u  transport %.3f s  core asleep %.1f %%\n",
+			stats.commands, stats.targets, stats.bytes, stats.transportNs * 1e-9,
+			100.0 * Host_HAL_GetSleepNs() / Host_Clock_Now());
+	printf("SPI clock %u Hz  wakeups %u\n", NFC_SPI_GetClockHz(NFC_SPI_GetPrescaler()), Host_HAL_GetWakeups());
+
+#if NFC_PROFILE_ENABLE
+	fclose(file);
+	printf("SWO capture saved in %s, dropped records %u\n", capture, NFC_Profile_GetDropped());
+#endif
+
+	return EXIT_SUCCESS;
+}
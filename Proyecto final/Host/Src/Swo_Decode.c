@@ -0,0 +1,304 @@
+/*
+ * Swo_Decode.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Turns the SWO stream of the profiling build (NFC_PROFILE_ENABLE=1) into
+ *  percentiles of each phase of each PN532 command. The input is the raw ITM
+ *  byte stream, as saved by the SWV trace of the debugger (or by a UART
+ *  adapter on PB3 at NFC_PROFILE_SWO_HZ) or by the host profiling build of
+ *  Sim_Main. Packets of other stimulus ports, timestamps and hardware source
+ *  packets are skipped; commands missing a record (dropped, overflow or failed
+ *  command) are discarded.
+ *
+ *  Usage: Swo_Decode capture [core Hz] [stimulus port]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "NFC_Profile.h"
+
+/// Core clock of the firmware, converts cycles to microseconds
+#define DECODE_CORE_HZ		(216000000UL)
+
+/// Row of the table holding duration of whole command
+#define DECODE_TOTAL		(NFC_PHASE_COUNT)
+
+/// ITM overflow packet, records were lost
+#define ITM_OVERFLOW		(0x70)
+
+typedef struct
+{
+	double *values;
+	size_t count;
+	size_t capacity;
+}Decode_Samples;
+
+typedef struct
+{
+	uint8_t active;
+	uint8_t command;
+	uint8_t saturated;
+	uint8_t seen;
+	double cycles[NFC_PHASE_COUNT];
+}Decode_Command;
+
+static Decode_Samples samples[256][NFC_PHASE_COUNT + 1];
+static uint32_t completed[256];
+static uint32_t saturated[256];
+static Decode_Command pending[NFC_PROFILE_DEVICE_MASK + 1];
+static uint32_t discarded = 0;
+static uint32_t overflows = 0;
+
+static const char *phaseNames[NFC_PHASE_COUNT + 1] =
+{
+	"start", "select", "write", "wait ack", "read ack", "wait response", "read response", "total"
+};
+
+static const char *Decode_CommandName(const uint8_t command)
+{
+	switch (command)
+	{
+	case PN532_COMMAND_DIAGNOSE:				return "Diagnose";
+	case PN532_COMMAND_GETFIRMWAREVERSION:		return "GetFirmwareVersion";
+	case PN532_COMMAND_SETSERIALBAUDRATE:		return "SetSerialBaudRate";
+	case PN532_COMMAND_SAMCONFIGURATION:		return "SAMConfiguration";
+	case PN532_COMMAND_RFCONFIGURATION:			return "RFConfiguration";
+	case PN532_COMMAND_INLISTPASSIVETARGET:		return "InListPassiveTarget";
+	case PN532_COMMAND_INDATAEXCHANGE:			return "InDataExchange";
+	case PN532_COMMAND_INCOMMUNICATETHRU:		return "InCommunicateThru";
+	case PN532_COMMAND_INDESELECT:				return "InDeselect";
+	case PN532_COMMAND_INRELEASE:				return "InRelease";
+	case PN532_COMMAND_INSELECT:				return "InSelect";
+	case PN532_COMMAND_INAUTOPOLL:				return "InAutoPoll";
+	default:									return "";
+	}
+}
+
+static void Decode_Add(Decode_Samples *row, const double value)
+{
+	if (row->count == row->capacity)
+	{
+		row->capacity = row->capacity ? row->capacity * 2 : 64;
+		row->values = realloc(row->values, row->capacity * sizeof(double));
+
+		if (row->values == NULL)
+		{
+			fprintf(stderr, "Out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	row->values[row->count++] = value;
+}
+
+static int Decode_Compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/// Nearest rank percentile of sorted values
+static double Decode_Percentile(const Decode_Samples *row, const double percent)
+{
+	size_t rank = (size_t)(percent / 100.0 * row->count + 0.999999);
+
+	if (rank == 0)
+	{
+		rank = 1;
+	}
+
+	return row->values[rank - 1];
+}
+
+static void Decode_Record(const uint32_t record)
+{
+	uint8_t phase = record >> NFC_PROFILE_PHASE_POS;
+	uint8_t device = (record >> NFC_PROFILE_DEVICE_POS) & NFC_PROFILE_DEVICE_MASK;
+	uint32_t payload = record & NFC_PROFILE_MAXCYCLES;
+	Decode_Command *current = &pending[device];
+	double total = 0;
+	uint8_t i;
+
+	if (phase >= NFC_PHASE_COUNT)
+	{
+		return;
+	}
+
+	if (phase == NFC_PHASE_START)
+	{
+		if (current->active)
+		{
+			discarded++;	// Previous command failed or lost its last record
+		}
+
+		memset(current, 0, sizeof(Decode_Command));
+		current->active = 1;
+		current->command = (uint8_t)payload;
+		return;
+	}
+
+	if (!current->active)
+	{
+		return;
+	}
+
+	// A phase can be marked twice, InListPassiveTarget waits IRQ again after ACK
+	current->cycles[phase] += payload;
+	current->seen |= 1U << phase;
+
+	if (payload == NFC_PROFILE_MAXCYCLES)
+	{
+		current->saturated = 1;
+	}
+
+	if (phase != NFC_PHASE_READ)
+	{
+		return;
+	}
+
+	current->active = 0;
+
+	for (i = NFC_PHASE_SELECT; i < NFC_PHASE_COUNT; i++)
+	{
+		if (current->seen & (1U << i))
+		{
+			Decode_Add(&samples[current->command][i], current->cycles[i]);
+			total += current->cycles[i];
+		}
+	}
+
+	Decode_Add(&samples[current->command][DECODE_TOTAL], total);
+	completed[current->command]++;
+	saturated[current->command] += current->saturated;
+}
+
+/// Parse ITM packets, return amount of records of the port
+static uint32_t Decode_Stream(FILE *file, const uint8_t port)
+{
+	static const uint8_t sizes[4] = {0, 1, 2, 4};
+	uint32_t records = 0, zeros = 0, value;
+	int header, byte, i;
+	uint8_t size;
+
+	while ((header = fgetc(file)) != EOF)
+	{
+		if (header == 0x00)
+		{
+			zeros++;
+			continue;
+		}
+
+		// Synchronization packet ends with 0x80 after five zero bytes
+		if (header == 0x80 && zeros >= 5)
+		{
+			zeros = 0;
+			continue;
+		}
+
+		zeros = 0;
+
+		if (header == ITM_OVERFLOW)
+		{
+			// Records were lost, commands in progress can not be trusted
+			overflows++;
+			memset(pending, 0, sizeof(pending));
+			continue;
+		}
+
+		size = sizes[header & 0x03];
+
+		if (size == 0)
+		{
+			// Timestamp or extension packet, continuation bit links the next byte
+			byte = header;
+			while ((byte & 0x80) && (byte = fgetc(file)) != EOF);
+			continue;
+		}
+
+		value = 0;
+
+		for (i = 0; i < size; i++)
+		{
+			if ((byte = fgetc(file)) == EOF)
+			{
+				return records;
+			}
+			value |= (uint32_t)byte << (8 * i);
+		}
+
+		// Software source packet of the port with a whole record
+		if ((header & 0x04) == 0 && (header >> 3) == port && size == 4)
+		{
+			Decode_Record(value);
+			records++;
+		}
+	}
+
+	return records;
+}
+
+int main(int argc, char *argv[])
+{
+	double coreHz = (argc > 2) ? strtod(argv[2], NULL) : DECODE_CORE_HZ;
+	uint8_t port = (argc > 3) ? (uint8_t)strtoul(argv[3], NULL, 0) : NFC_PROFILE_PORT;
+	double cyclesPerUs = coreHz / 1e6;
+	uint32_t records;
+	FILE *file;
+	int command;
+	uint8_t i;
+
+	if (argc < 2)
+	{
+		printf("Usage: %s capture [core Hz] [stimulus port]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if ((file = fopen(argv[1], "rb")) == NULL)
+	{
+		perror(argv[1]);
+		return EXIT_FAILURE;
+	}
+
+	records = Decode_Stream(file, port);
+	fclose(file);
+
+	printf("records %u  discarded commands %u  overflows %u  core %.0f MHz\n",
+			records, discarded, overflows, coreHz / 1e6);
+
+	for (command = 0; command < 256; command++)
+	{
+		if (completed[command] == 0)
+		{
+			continue;
+		}
+
+		printf("\ncommand 0x%02X %s  count %u", command, Decode_CommandName(command), completed[command]);
+		if (saturated[command] != 0)
+		{
+			printf("  saturated %u (phase longer than %.0f mS)", saturated[command], NFC_PROFILE_MAXCYCLES / cyclesPerUs / 1000);
+		}
+		printf("\n%-14s %10s %10s %10s %10s\n", "phase", "p50 us", "p90 us", "p99 us", "max us");
+
+		for (i = NFC_PHASE_SELECT; i <= DECODE_TOTAL; i++)
+		{
+			Decode_Samples *row = &samples[command][i];
+
+			if (row->count == 0)
+			{
+				continue;
+			}
+
+			qsort(row->values, row->count, sizeof(double), &Decode_Compare);
+			printf("%-14s %10.2f %10.2f %10.2f %10.2f\n", phaseNames[i],
+					Decode_Percentile(row, 50) / cyclesPerUs, Decode_Percentile(row, 90) / cyclesPerUs,
+					Decode_Percentile(row, 99) / cyclesPerUs, row->values[row->count - 1] / cyclesPerUs);
+		}
+	}
+
+	return EXIT_SUCCESS;
+}
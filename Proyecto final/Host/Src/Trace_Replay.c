@@ -0,0 +1,629 @@
+/*
+ * Trace_Replay.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ *
+ *  Record and replay of the SPI traffic of a PN532 (NFC_TRACE_ENABLE=1).
+ *
+ *  record: runs the driver over PN532_Sim with a trace attached and saves it
+ *  with NFC_DumpTrace. Every 8th read the field is slowed down (InListPassive
+ *  Target takes 15 mS) to have something to find in the replay.
+ *
+ *  replay: reads a trace saved by NFC_DumpTrace or the memory image of an
+ *  NFC_Trace dumped from the reader with the debugger, and sends every command
+ *  written in it through the driver again (NFC_StartCommand and
+ *  NFC_ProcessCommand) over a transport that answers with the recorded ACK and
+ *  responses. IRQ is raised after the recorded wait and transfers cost as in
+ *  PN532_Sim, time is virtual so the replay is deterministic. Frames written
+ *  by the driver are compared with the recorded ones; a difference makes the
+ *  tool fail, so traces work as regression tests. Latency of each command is
+ *  printed as recorded and as replayed. With a VCD file name the replay is
+ *  also saved as waveforms of CS, IRQ, MOSI and MISO.
+ *
+ *  Usage: Trace_Replay record trace [reads]
+ *         Trace_Replay replay trace [vcd] [device]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NFC.h"
+#include "PN532_Sim.h"
+#include "Host_Clock.h"
+
+/// Default amount of InListPassiveTarget of record mode
+#define REPLAY_READS		(40)
+
+/// Latency of InListPassiveTarget in uS when the field is slowed down
+#define REPLAY_SLOW_US		(15000)
+
+/// Timeout of each step of replayed commands in mS
+#define REPLAY_TIMEOUT		(1000)
+
+#define REPLAY_NEVER		(UINT64_MAX)
+
+typedef struct
+{
+	uint32_t timeUs;
+	uint32_t waitUs;
+	uint16_t length;
+	uint8_t device;
+	uint8_t direction;
+	const uint8_t *data;
+}Replay_Record;
+
+typedef struct
+{
+	double *recorded;
+	double *replayed;
+	uint32_t count;
+	uint32_t failed;
+}Replay_Command;
+
+/// Records of trace loaded for replay
+static Replay_Record *records = NULL;
+static uint32_t recordCount = 0;
+
+/// Transport state
+static uint32_t next = 0;				///< Record consumed by next transaction
+static Replay_Record *current = NULL;	///< Record of transaction in progress, NULL when CS is released
+static uint16_t position = 0;			///< Bytes of current record already moved
+static uint8_t opPending = 0;			///< SPI op of current transaction not received yet
+static uint64_t lastEndNs = 0;			///< Time when last transaction ended
+static uint64_t *selectNs = NULL;		///< Time when each record was selected in the replay
+static uint32_t mismatches = 0;
+static uint32_t firstMismatch = UINT32_MAX;
+
+/// Transfer costs, the same of PN532_Sim
+static uint32_t callNs = PN532_SIM_CALLCOST_NS;
+static uint32_t byteNs = PN532_SIM_BYTECOST_NS;
+
+/// Waveform output
+static FILE *vcd = NULL;
+static uint64_t vcdTime = 0;
+static uint8_t irqShown = 0;
+
+/// Buffer receiving NFC_DumpTrace
+static uint8_t *dump = NULL;
+static size_t dumpLength = 0;
+static FILE *dumpFile = NULL;
+
+static void Replay_WriteFile(const uint8_t *bytes, size_t amount)
+{
+	fwrite(bytes, 1, amount, dumpFile);
+}
+
+static void Replay_WriteMemory(const uint8_t *bytes, size_t amount)
+{
+	dump = realloc(dump, dumpLength + amount);
+	memcpy(&dump[dumpLength], bytes, amount);
+	dumpLength += amount;
+}
+
+static uint32_t Replay_Read32(const uint8_t *bytes)
+{
+	return bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/// Change of a signal in VCD: 1 bit signals take '0' or '1', buses a value
+static void Replay_Vcd(const uint64_t ns, const char id, const int bits, const uint8_t value)
+{
+	int i;
+
+	if (vcd == NULL)
+	{
+		return;
+	}
+
+	if (ns != vcdTime)
+	{
+		fprintf(vcd, "#%llu\n", (unsigned long long)ns);
+		vcdTime = ns;
+	}
+
+	if (bits == 1)
+	{
+		fprintf(vcd, "%u%c\n", value ? 1 : 0, id);
+		return;
+	}
+
+	fputc('b', vcd);
+	for (i = bits - 1; i >= 0; i--)
+	{
+		fputc((value >> i) & 1 ? '1' : '0', vcd);
+	}
+	fprintf(vcd, " %c\n", id);
+}
+
+static void Replay_VcdInit(void)
+{
+	fprintf(vcd, "$timescale 1ns $end\n$scope module pn532 $end\n");
+	fprintf(vcd, "$var wire 1 c cs_n $end\n$var wire 1 i irq_n $end\n");
+	fprintf(vcd, "$var wire 8 o mosi $end\n$var wire 8 m miso $end\n");
+	fprintf(vcd, "$upscope $end\n$enddefinitions $end\n#0\n1c\n1i\nb0 o\nb0 m\n");
+}
+
+static void Replay_Mismatch(void)
+{
+	mismatches++;
+
+	if (firstMismatch == UINT32_MAX && current != NULL)
+	{
+		firstMismatch = current - records;
+	}
+}
+
+/// Time when IRQ is raised for next record, it only happens before reads
+static uint64_t Replay_IrqNs(void)
+{
+	if (current != NULL || next >= recordCount || records[next].direction != NFC_TRACE_READ)
+	{
+		return REPLAY_NEVER;
+	}
+
+	return lastEndNs + (uint64_t)records[next].waitUs * 1000;
+}
+
+static uint8_t Replay_GetIRQ(void)
+{
+	uint64_t irq = Replay_IrqNs();
+
+	if (irq > Host_Clock_Now())
+	{
+		return 0;
+	}
+
+	if (!irqShown)
+	{
+		Replay_Vcd(irq, 'i', 1, 0);
+		irqShown = 1;
+	}
+
+	return 1;
+}
+
+static uint8_t Replay_WaitIRQ(uint32_t timeout)
+{
+	uint64_t irq = Replay_IrqNs(), limit = Host_Clock_Now() + (uint64_t)timeout * 1000000;
+
+	// Core sleeps until IRQ or timeout
+	if (irq > limit)
+	{
+		Host_Clock_Advance(limit - Host_Clock_Now());
+		return 0;
+	}
+
+	if (irq > Host_Clock_Now())
+	{
+		Host_Clock_Advance(irq - Host_Clock_Now());
+	}
+
+	return Replay_GetIRQ();
+}
+
+static void Replay_SetSelect(uint8_t state)
+{
+	uint64_t now = Host_Clock_Now();
+
+	Host_Clock_Advance(callNs);
+
+	if (state)
+	{
+		Replay_Vcd(now, 'c', 1, 0);
+
+		if (next >= recordCount)
+		{
+			mismatches++;
+			return;
+		}
+
+		// IRQ is released by PN532 when its data is read
+		if (irqShown)
+		{
+			Replay_Vcd(now, 'i', 1, 1);
+			irqShown = 0;
+		}
+
+		selectNs[next] = now;
+		current = &records[next++];
+		position = 0;
+		opPending = 1;
+		return;
+	}
+
+	Replay_Vcd(now, 'c', 1, 1);
+
+	// Driver moved a different amount of bytes than the reader
+	if (current != NULL && position != current->length)
+	{
+		Replay_Mismatch();
+	}
+
+	current = NULL;
+	lastEndNs = now;
+}
+
+static void Replay_SendBuffer(const uint8_t *buffer, size_t length)
+{
+	uint64_t start = Host_Clock_Now() + callNs;
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		Replay_Vcd(start + i * byteNs, 'o', 8, buffer[i]);
+
+		if (current == NULL)
+		{
+			continue;
+		}
+
+		// First byte is SPI op, it must match direction of record
+		if (opPending)
+		{
+			opPending = 0;
+			if ((buffer[i] == PN532_SPI_DATAREAD) != (current->direction == NFC_TRACE_READ))
+			{
+				Replay_Mismatch();
+			}
+			continue;
+		}
+
+		if (current->direction != NFC_TRACE_WRITE || position >= current->length || current->data[position] != buffer[i])
+		{
+			Replay_Mismatch();
+		}
+		position++;
+	}
+
+	Host_Clock_Advance(callNs + (uint64_t)length * byteNs);
+}
+
+static void Replay_ReceiveBuffer(uint8_t *buffer, size_t length)
+{
+	uint64_t start = Host_Clock_Now() + callNs;
+	size_t i;
+
+	for (i = 0; i < length; i++)
+	{
+		// Bytes past the recorded ones read as zero, like an idle MISO
+		if (current != NULL && current->direction == NFC_TRACE_READ && position < current->length)
+		{
+			buffer[i] = current->data[position++];
+		}
+		else
+		{
+			buffer[i] = 0x00;
+			Replay_Mismatch();
+		}
+
+		Replay_Vcd(start + i * byteNs, 'm', 8, buffer[i]);
+	}
+
+	Host_Clock_Advance(callNs + (uint64_t)length * byteNs);
+}
+
+static void Replay_DelayUs(uint32_t us)
+{
+	Host_Clock_Advance((uint64_t)us * 1000);
+}
+
+static uint32_t Replay_GetTimeUs(void)
+{
+	return (uint32_t)(Host_Clock_Now() / 1000);
+}
+
+/// Take command code and parameters out of a frame written to PN532
+static uint16_t Replay_ParseCommand(const Replay_Record *record, uint8_t *command)
+{
+	const uint8_t *data = record->data;
+	uint16_t length, header = PN532_FRAME_HEADER;
+
+	if (record->length < PN532_FRAME_HEADER + 2 || data[0] != PN532_PREAMBLE || data[1] != PN532_STARTCODE1 || data[2] != PN532_STARTCODE2)
+	{
+		return 0;
+	}
+
+	length = data[3];
+
+	if (data[3] == 0xFF && data[4] == 0xFF)
+	{
+		header = PN532_EXTENDED_HEADER;
+		length = ((uint16_t)data[5] << 8) | data[6];
+	}
+
+	// LEN counts TFI, which is not part of the command
+	if (length < 2 || length - 1 > PN532_BUFFERSIZE || header + length > record->length)
+	{
+		return 0;
+	}
+
+	memcpy(command, &data[header + 1], length - 1);
+
+	return length - 1;
+}
+
+static uint8_t Replay_Load(const char *name)
+{
+	static NFC_Trace image;
+	uint8_t *bytes;
+	size_t size, offset = 4;
+	FILE *file = fopen(name, "rb");
+	long length;
+
+	if (file == NULL)
+	{
+		perror(name);
+		return 0;
+	}
+
+	fseek(file, 0, SEEK_END);
+	length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bytes = malloc(length > 0 ? length : 1);
+	size = fread(bytes, 1, length, file);
+	fclose(file);
+
+	if (size >= 4 && memcmp(bytes, "NFCT", 4) == 0)
+	{
+		dump = bytes;
+		dumpLength = size;
+	}
+	else if (size == sizeof(NFC_Trace))
+	{
+		// Memory image of the ring, layout is the same on target and host
+		memcpy(&image, bytes, sizeof(NFC_Trace));
+		free(bytes);
+
+		if (image.head >= NFC_TRACE_SIZE || image.used > NFC_TRACE_SIZE)
+		{
+			printf("%s is not a valid NFC_Trace\n", name);
+			return 0;
+		}
+
+		NFC_DumpTrace(&image, &Replay_WriteMemory);
+		printf("memory image: %u records, %u dropped on reader\n", image.records, image.dropped);
+	}
+	else
+	{
+		printf("%s is not a trace\n", name);
+		return 0;
+	}
+
+	records = calloc(dumpLength / NFC_TRACE_HEADER + 1, sizeof(Replay_Record));
+
+	while (offset + NFC_TRACE_HEADER <= dumpLength)
+	{
+		Replay_Record *record = &records[recordCount];
+
+		record->timeUs = Replay_Read32(&dump[offset]);
+		record->waitUs = Replay_Read32(&dump[offset + 4]);
+		record->length = dump[offset + 8] | ((uint16_t)dump[offset + 9] << 8);
+		record->device = dump[offset + 10];
+		record->direction = dump[offset + 11];
+		record->data = &dump[offset + NFC_TRACE_HEADER];
+
+		if (offset + NFC_TRACE_HEADER + record->length > dumpLength)
+		{
+			break;
+		}
+
+		offset += NFC_TRACE_HEADER + record->length;
+		recordCount++;
+	}
+
+	return 1;
+}
+
+static int Replay_Compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+
+static int Replay(const char *name, const char *vcdName, const uint8_t device)
+{
+	static Replay_Command commands[256];
+	NFC_CommInterface interface;
+	NFC_Context context;
+	Replay_Command *row;
+	uint32_t write, filtered = 0, skipped = 0, i;
+	uint16_t length;
+	uint8_t state;
+	int code;
+
+	if (!Replay_Load(name))
+	{
+		return EXIT_FAILURE;
+	}
+
+	// Only the PN532 asked, waits of records are measured per PN532
+	for (i = 0; i < recordCount; i++)
+	{
+		if (records[i].device == device)
+		{
+			records[filtered++] = records[i];
+		}
+	}
+	recordCount = filtered;
+	selectNs = calloc(recordCount + 1, sizeof(uint64_t));
+
+	if (vcdName != NULL)
+	{
+		if ((vcd = fopen(vcdName, "w")) == NULL)
+		{
+			perror(vcdName);
+			return EXIT_FAILURE;
+		}
+		Replay_VcdInit();
+	}
+
+	memset(&interface, 0, sizeof(interface));
+	interface.SendBuffer = &Replay_SendBuffer;
+	interface.ReceiveBuffer = &Replay_ReceiveBuffer;
+	interface.SetSelect = &Replay_SetSelect;
+	interface.GetIRQ = &Replay_GetIRQ;
+	interface.WaitIRQ = &Replay_WaitIRQ;
+	interface.DelayUs = &Replay_DelayUs;
+	interface.GetTimeUs = &Replay_GetTimeUs;
+
+	Host_Clock_Reset();
+	NFC_CommInit(&context, &interface, device);
+
+	while (next < recordCount)
+	{
+		// Reads left by a command that failed on the reader
+		if (records[next].direction != NFC_TRACE_WRITE)
+		{
+			skipped++;
+			next++;
+			continue;
+		}
+
+		write = next;
+		length = Replay_ParseCommand(&records[write], context.buffer);
+		if (length == 0)
+		{
+			skipped++;
+			next++;
+			continue;
+		}
+
+		code = context.buffer[0];
+		NFC_StartCommand(&context, length, REPLAY_TIMEOUT);
+
+		while ((state = NFC_ProcessCommand(&context)) == NFC_COMMAND_WAITACK || state == NFC_COMMAND_WAITRESPONSE)
+		{
+			// Command did not finish on the reader either
+			if (Replay_IrqNs() == REPLAY_NEVER)
+			{
+				break;
+			}
+
+			// Core sleeps until IRQ, as NFC_Bus idle does
+			if (Replay_IrqNs() > Host_Clock_Now())
+			{
+				Host_Clock_Advance(Replay_IrqNs() - Host_Clock_Now());
+			}
+		}
+
+		if (state != NFC_COMMAND_DONE)
+		{
+			commands[code].failed++;
+			continue;
+		}
+
+		// Recorded end of last transaction is known from the wait of the next one
+		if (next >= recordCount)
+		{
+			break;
+		}
+
+		row = &commands[code];
+		row->recorded = realloc(row->recorded, (row->count + 1) * sizeof(double));
+		row->replayed = realloc(row->replayed, (row->count + 1) * sizeof(double));
+		row->recorded[row->count] = (double)(records[next].timeUs - records[next].waitUs - records[write].timeUs);
+		row->replayed[row->count] = (lastEndNs - selectNs[write]) / 1000.0;
+		row->count++;
+	}
+
+	if (vcd != NULL)
+	{
+		fclose(vcd);
+	}
+
+	printf("%u records of PN532 %u, %u skipped, %u mismatches", recordCount, device, skipped, mismatches);
+	if (firstMismatch != UINT32_MAX)
+	{
+		printf(" (first in record %u)", firstMismatch);
+	}
+	printf("\n\n%-8s %8s %8s %14s %14s %14s %14s\n", "command", "count", "failed", "recorded p50", "recorded max", "replay p50", "replay max");
+
+	for (code = 0; code < 256; code++)
+	{
+		row = &commands[code];
+
+		if (row->count == 0 && row->failed == 0)
+		{
+			continue;
+		}
+
+		if (row->count == 0)
+		{
+			printf("0x%02X     %8u %8u\n", code, row->count, row->failed);
+			continue;
+		}
+
+		qsort(row->recorded, row->count, sizeof(double), &Replay_Compare);
+		qsort(row->replayed, row->count, sizeof(double), &Replay_Compare);
+
+		printf("0x%02X     %8u %8u %11.1f us %11.1f us %11.1f us %11.1f us\n", code, row->count, row->failed,
+				row->recorded[row->count / 2], row->recorded[row->count - 1],
+				row->replayed[row->count / 2], row->replayed[row->count - 1]);
+	}
+
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int Record(const char *name, const uint32_t reads)
+{
+	static const uint8_t uid[4] = {0x12, 0x34, 0x56, 0x78};
+	static NFC_Trace trace;
+	NFC_CommInterface interface;
+	NFC_Context context;
+	uint8_t card[7], length;
+	uint32_t i, found = 0;
+
+	PN532_Sim_Init();
+	PN532_Sim_GetInterface(&interface, 1);
+	PN532_Sim_AddCard(0, uid, sizeof(uid), 0, PN532_SIM_NEVER);
+
+	NFC_CommInit(&context, &interface, 0);
+	NFC_InitTrace(&trace);
+	NFC_SetTrace(&context, &trace);
+
+	NFC_GetFirmwareVersion(&context);
+	NFC_SetPassiveActivationRetries(&context, 0xFF);
+	NFC_SAMConfig(&context);
+
+	for (i = 0; i < reads; i++)
+	{
+		// Some reads happen while the field is slow
+		PN532_Sim_SetLatency(0, PN532_COMMAND_INLISTPASSIVETARGET, (i % 8 == 7) ? REPLAY_SLOW_US : PN532_SIM_LATENCY_US);
+		found += NFC_ReadPassiveTargetID(&context, PN532_MIFARE_ISO14443A, card, &length, 1000);
+	}
+
+	if ((dumpFile = fopen(name, "wb")) == NULL)
+	{
+		perror(name);
+		return EXIT_FAILURE;
+	}
+
+	NFC_DumpTrace(&trace, &Replay_WriteFile);
+	fclose(dumpFile);
+
+	printf("%u reads, %u cards found, %u records (%u dropped) saved in %s\n",
+			reads, found, trace.records, trace.dropped, name);
+
+	return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc >= 3 && strcmp(argv[1], "record") == 0)
+	{
+		return Record(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 0) : REPLAY_READS);
+	}
+
+	if (argc >= 3 && strcmp(argv[1], "replay") == 0)
+	{
+		return Replay(argv[2], (argc > 3) ? argv[3] : NULL, (argc > 4) ? (uint8_t)strtoul(argv[4], NULL, 0) : 0);
+	}
+
+	printf("Usage: %s record trace [reads]\n       %s replay trace [vcd] [device]\n", argv[0], argv[0]);
+
+	return EXIT_FAILURE;
+}
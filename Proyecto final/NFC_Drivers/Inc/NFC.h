@@ -9,6 +9,7 @@
 #define INC_NFC_H_
 
 #include "stm32f7xx_hal.h"
+#include <stddef.h>
 
 #define PN532_PREAMBLE 		(0x00)
 #define PN532_STARTCODE1 	(0x00)
@@ -68,8 +69,45 @@
 #define PN532_I2C_READY 						(0x01)
 #define PN532_I2C_READYTIMEOUT 					(20)
 
+/// Baud rates of HSU port for SetSerialBaudRate, PN532 starts at 115200
+#define PN532_HSU_BAUD_9600 					(0x00)
+#define PN532_HSU_BAUD_19200 					(0x01)
+#define PN532_HSU_BAUD_38400 					(0x02)
+#define PN532_HSU_BAUD_57600 					(0x03)
+#define PN532_HSU_BAUD_115200 					(0x04)
+#define PN532_HSU_BAUD_230400 					(0x05)
+#define PN532_HSU_BAUD_460800 					(0x06)
+#define PN532_HSU_BAUD_921600 					(0x07)
+#define PN532_HSU_BAUD_1288000 					(0x08)
+
 #define PN532_MIFARE_ISO14443A 					(0x00)
 
+/// Target types of InAutoPoll
+#define PN532_AUTOPOLL_GENERIC106 				(0x00)	///< Generic passive 106 kbps: ISO14443-4A, Mifare and DEP
+#define PN532_AUTOPOLL_GENERIC212 				(0x01)	///< Generic passive 212 kbps: FeliCa and DEP
+#define PN532_AUTOPOLL_GENERIC424 				(0x02)	///< Generic passive 424 kbps: FeliCa and DEP
+#define PN532_AUTOPOLL_ISO14443B 				(0x03)	///< Passive 106 kbps ISO14443-4B
+#define PN532_AUTOPOLL_JEWEL 					(0x04)	///< Innovision Jewel tag
+#define PN532_AUTOPOLL_MIFARE 					(0x10)	///< Mifare card
+#define PN532_AUTOPOLL_FELICA212 				(0x11)	///< FeliCa 212 kbps card
+#define PN532_AUTOPOLL_FELICA424 				(0x12)	///< FeliCa 424 kbps card
+#define PN532_AUTOPOLL_ISO14443_4A 				(0x20)	///< Passive 106 kbps ISO14443-4A
+#define PN532_AUTOPOLL_ISO14443_4B 				(0x23)	///< Passive 106 kbps ISO14443-4B
+#define PN532_AUTOPOLL_DEP_PASSIVE106 			(0x40)	///< DEP passive 106 kbps
+#define PN532_AUTOPOLL_DEP_PASSIVE212 			(0x41)	///< DEP passive 212 kbps
+#define PN532_AUTOPOLL_DEP_PASSIVE424 			(0x42)	///< DEP passive 424 kbps
+#define PN532_AUTOPOLL_DEP_ACTIVE106 			(0x80)	///< DEP active 106 kbps
+#define PN532_AUTOPOLL_DEP_ACTIVE212 			(0x81)	///< DEP active 212 kbps
+#define PN532_AUTOPOLL_DEP_ACTIVE424 			(0x82)	///< DEP active 424 kbps
+
+/// Limits of InAutoPoll: types by command, targets by answer, PollNr to poll until a target is found
+#define PN532_AUTOPOLL_MAXTYPES 				(15)
+#define PN532_AUTOPOLL_MAXTARGETS 				(2)
+#define PN532_AUTOPOLL_ENDLESS 					(0xFF)
+
+/// Unit of Period of InAutoPoll in mS, the period goes from 1 to 15 units
+#define PN532_AUTOPOLL_PERIODMS 				(150)
+
 /// Mifare Commands
 #define MIFARE_CMD_AUTH_A 						(0x60)
 #define MIFARE_CMD_AUTH_B 						(0x61)
@@ -120,8 +158,186 @@
 #define NDEF_URIPREFIX_URN_NFC 					(0x23)
 
 
-/// Size maximum of buffer to store data received from PN532
+/** Set to 1 in the profiling build to timestamp each phase of a command with
+ *  NFC_Profile_Mark, provided by the platform. With 0 no code is added. */
+#ifndef NFC_PROFILE_ENABLE
+#define NFC_PROFILE_ENABLE		0
+#endif
+
+/** Set to 0 to remove statistics of commands from the driver, NFC_Stats of each
+ *  context is updated by every command and read with NFC_GetStats. */
+#ifndef NFC_STATS_ENABLE
+#define NFC_STATS_ENABLE		1
+#endif
+
+/// Amount of command codes with their own latency histogram in each context
+#ifndef NFC_STATS_COMMANDS
+#define NFC_STATS_COMMANDS		8
+#endif
+
+/// Buckets of latency histogram: bucket 0 is 0 uS, bucket n counts latencies from 2^(n-1) to 2^n - 1 uS
+#define NFC_STATS_BUCKETS		(22)
+
+/** Set to 1 to record each SPI transaction with PN532 of contexts attached to
+ *  an NFC_Trace with NFC_SetTrace, for the host tool Trace_Replay. */
+#ifndef NFC_TRACE_ENABLE
+#define NFC_TRACE_ENABLE		0
+#endif
+
+/// Bytes of ring buffer of NFC_Trace, oldest records are dropped when it is full
+#ifndef NFC_TRACE_SIZE
+#define NFC_TRACE_SIZE			4096
+#endif
+
+/** Bytes of header of each trace record, all fields little endian:
+ *  time uS (4), wait uS (4), length of data (2), device (1), direction (1) */
+#define NFC_TRACE_HEADER		(12)
+
+/// Direction of a trace record, from the SPI op sent first
+#define NFC_TRACE_WRITE			(0)		///< Frame written to PN532
+#define NFC_TRACE_READ			(1)		///< ACK or response read from PN532
+
+/** Set to 1 to run the hot path of the driver from ITCM and keep state given
+ *  to NFC_DTCM in DTCM, so its timing does not depend on flash wait states or
+ *  cache state. Sections are placed by the linker script and copied by the
+ *  platform before use, see Core/Inc/NFC_TCM.h. */
+#ifndef NFC_TCM_ENABLE
+#define NFC_TCM_ENABLE			0
+#endif
+
+#if NFC_TCM_ENABLE
+#define NFC_ITCM				__attribute__((section(".itcm_text")))
+#define NFC_DTCM				__attribute__((section(".dtcm_bss")))
+#else
+#define NFC_ITCM
+#define NFC_DTCM
+#endif
+
+/// Phases of a command given to NFC_Profile_Mark, each one ends at its mark
+#define NFC_PHASE_START			(0)		///< Frame built, chip select about to be asserted
+#define NFC_PHASE_SELECT		(1)		///< Chip select asserted and set up time waited
+#define NFC_PHASE_WRITE			(2)		///< Frame written and chip select released
+#define NFC_PHASE_WAITACK		(3)		///< IRQ of PN532 active after the command
+#define NFC_PHASE_ACK			(4)		///< ACK frame read
+#define NFC_PHASE_WAITRESPONSE	(5)		///< IRQ of PN532 active after the ACK
+#define NFC_PHASE_READ			(6)		///< Response frame read
+#define NFC_PHASE_COUNT			(7)
+
+/// Time between chip select and first clock of a transaction in uS, used when interface provides DelayUs
+#ifndef PN532_CS_SETUP_US
+#define PN532_CS_SETUP_US		(10)
+#endif
+
+/** Ready of PN532 is read with STATREAD when interface has no GetIRQ. The first
+ *  status read of a wait is done at 7/8 of its expected time, the next ones with
+ *  gaps from 1/32 of that time, each busy answer makes the gap 1.5 times longer.
+ *  Gaps are kept from NFC_POLL_MINUS up to NFC_POLL_MAXUS. The expected time of
+ *  a response follows what the command took the last times. */
+#ifndef NFC_POLL_MINUS
+#define NFC_POLL_MINUS			(20)
+#endif
+
+#ifndef NFC_POLL_MAXUS
+#define NFC_POLL_MAXUS			(2000)
+#endif
+
+/// Expected time of PN532 to have the ACK of a command ready in uS
+#define NFC_POLL_ACKUS			(200)
+
+/// Expected time of PN532 to process a command without RF exchange in uS
+#define NFC_POLL_COMMANDUS		(1000)
+
+/// Expected time of PN532 to process a command exchanging frames with a card in uS
+#define NFC_POLL_RFUS			(4000)
+
+/// Command codes whose time to answer is learned by each context, the expected times above are the start
+#ifndef NFC_POLL_COMMANDS
+#define NFC_POLL_COMMANDS		(4)
+#endif
+
+/** Size maximum of command or response data (command code and parameters) exchanged
+ *  with PN532. Define it at compile time up to 264 to exchange 262 bytes of
+ *  payload with InDataExchange or InCommunicateThru in extended frames. */
+#ifndef PN532_BUFFERSIZE
 #define PN532_BUFFERSIZE 64
+#endif
+
+#if PN532_BUFFERSIZE < 16 || PN532_BUFFERSIZE > 264
+#error "PN532_BUFFERSIZE must be between 16 and 264"
+#endif
+
+/// Bytes added by normal frame around command data: SPI op, preamble, start code (2), LEN, LCS, TFI, DCS, postamble
+#define PN532_FRAME_OVERHEAD 	(9)
+
+/// Bytes added by extended frame around command data: normal frame plus FF FF and 16 bit LEN
+#define PN532_EXTENDED_OVERHEAD	(12)
+
+/// Size of buffer to hold a whole frame of PN532_BUFFERSIZE data
+#define PN532_FRAMESIZE			(PN532_BUFFERSIZE + PN532_EXTENDED_OVERHEAD)
+
+/// Frames with LEN (TFI and data) bigger than this are sent as extended frames
+#define PN532_NORMAL_MAXLEN		(254)
+
+/// Bytes of received frame before TFI: preamble, start code (2), LEN, LCS
+#define PN532_FRAME_HEADER 		(5)
+
+/// Bytes of received extended frame before TFI: preamble, start code (2), FF FF, LENm, LENl, LCS
+#define PN532_EXTENDED_HEADER 	(8)
+
+/// Bytes of received frame after data: DCS, postamble
+#define PN532_FRAME_TRAILER 	(2)
+
+/**
+ *  View of the data of a frame received from PN532. It points inside the
+ *  buffer used to read the frame, so it is valid until that buffer is reused.
+ */
+typedef struct
+{
+	const uint8_t *data;		///< First byte after response code
+	uint16_t length;			///< Amount of bytes of data
+}NFC_FrameView;
+
+/// Timeout of NFC_StartCommand to wait the response without limit, the ACK is waited NFC_ACK_TIMEOUT
+#define NFC_TIMEOUT_NONE		(0)
+
+/// Time maximum to wait the ACK of a command started with NFC_TIMEOUT_NONE in mS
+#define NFC_ACK_TIMEOUT			(10)
+
+/**
+ *  Target found by InAutoPoll. Pointers are inside the buffer the response
+ *  was read to, so they are valid until that buffer is reused.
+ */
+typedef struct
+{
+	uint8_t type;				///< Type of target, one of PN532_AUTOPOLL_*
+	uint8_t number;				///< Logical number of target (Tg) for InDataExchange
+	const uint8_t *data;		///< Data of target after Tg, as InListPassiveTarget gives it for the baud rate
+	uint8_t length;				///< Amount of bytes of data
+	const uint8_t *uid;			///< UID of type A, PUPI of type B, NFCID2 of FeliCa, JEWELID or NFCID3 of DEP
+	uint8_t uidLength;			///< Amount of bytes of uid, 0 when data is too short
+}NFC_AutoPollTarget;
+
+/// Longest NFCID1 of a 106 kbps type A target, triple size UID
+#define NFC_TARGET_UIDSIZE		(10)
+
+/// Longest UID stored by NFC_ReadPassiveTargetID, single and double size UID
+#define NFC_PASSIVE_UIDSIZE		(7)
+
+/// Logical number of InDeselect and InRelease to act on every target
+#define NFC_TARGET_ALL			(0)
+
+/**
+ *  Target of 106 kbps type A listed by InListPassiveTarget. Values are copied
+ *  from the answer, so they stay valid while other commands are running.
+ */
+typedef struct
+{
+	uint8_t number;				///< Logical number of target (Tg) for InSelect and InDataExchange
+	uint8_t sensRes[2];			///< SENS_RES (ATQA)
+	uint8_t selRes;				///< SEL_RES (SAK)
+	uint8_t uid[NFC_TARGET_UIDSIZE];	///< NFCID1
+	uint8_t uidLength;			///< Amount of bytes of uid: 4, 7 or 10
+}NFC_Target;
 
 /**
  *  Structure to communicate with interface used to
@@ -132,17 +348,174 @@ typedef struct
 	uint8_t (*GetByte)(void);		///< Pointer to function to receive single byte from PN532
 	void (*SendByte)(uint8_t);		///< Pointer to function to sent single byte to PN532
 	void (*SetSelect)(uint8_t);		///< Pointer to function to enable o disable interface communication
-	uint8_t (*GetIRQ)(void);		///< Pointer to function to test pin IRQ of PN532
+	uint8_t (*GetIRQ)(void);		///< Pointer to function to test pin IRQ of PN532, NULL to read status of PN532 with STATREAD
+	void (*SendBuffer)(const uint8_t *, size_t);	///< Pointer to function to sent a whole buffer in one transfer, NULL to use SendByte
+	void (*ReceiveBuffer)(uint8_t *, size_t);		///< Pointer to function to receive a whole buffer in one transfer, NULL to use GetByte
+	uint8_t (*WaitIRQ)(uint32_t);					///< Pointer to function to sleep until IRQ of PN532 or timeout in mS, NULL to poll GetIRQ
+	void (*DelayUs)(uint32_t);						///< Pointer to function to wait a time in uS, NULL to wait 1 mS with HAL tick
+	void (*SetDevice)(uint8_t);						///< Pointer to function to route next calls to a PN532 of a shared bus, NULL with a single PN532
+	uint32_t (*GetTimeUs)(void);					///< Pointer to function to read a free running time in uS for statistics and status polling, NULL to use HAL tick
+	void (*SleepUs)(uint32_t);						///< Pointer to function to sleep the core a time in uS between status reads, NULL to wait with DelayUs
 }NFC_CommInterface;
 
+/**
+ *  Statistics of one command code. A command is measured from the write of
+ *  its frame to the read of its response, or to the step that failed.
+ */
+typedef struct
+{
+	uint8_t command;							///< Command code, slot is free while count is 0
+	uint32_t count;								///< Amount of commands finished
+	uint32_t errors;							///< Commands finished without valid response
+	uint32_t maxUs;								///< Longest latency
+	uint64_t totalUs;							///< Sum of latencies, divide by count for mean
+	uint32_t histogram[NFC_STATS_BUCKETS];		///< Latencies in logarithmic buckets, see NFC_STATS_BUCKETS
+}NFC_CommandStats;
+
+/**
+ *  Statistics of a PN532. Can be read while the driver runs (debugger live
+ *  view, interrupt or other task) through NFC_GetStats.
+ */
+typedef struct
+{
+	volatile uint32_t sequence;					///< Incremented before and after each update, odd while updating
+	uint32_t ackFailures;						///< Frames read instead of ACK
+	uint32_t timeouts;							///< Waits for IRQ of PN532 that timed out
+	uint32_t frameErrors;						///< Response frames with bad format, checksum or code
+	uint32_t bytesSent;							///< Bytes written to PN532, including SPI op
+	uint32_t bytesReceived;						///< Bytes read from PN532
+	uint32_t untracked;							///< Commands not measured because every slot was taken
+	uint32_t statusReads;						///< STATREAD transactions sent to poll ready of PN532
+	NFC_CommandStats commands[NFC_STATS_COMMANDS];	///< Slots taken by command codes in order of use
+}NFC_Stats;
+
+#if NFC_TRACE_SIZE < 2 * (PN532_FRAMESIZE + NFC_TRACE_HEADER) || NFC_TRACE_SIZE > 32768
+#error "NFC_TRACE_SIZE must hold two frames and be up to 32768"
+#endif
+
+/**
+ *  Ring buffer of SPI transactions with PN532. Each record is a header (see
+ *  NFC_TRACE_HEADER) followed by the bytes moved after the SPI op. Wait is the
+ *  time since the previous transaction of the same PN532 ended, for reads it
+ *  is the time PN532 took to raise IRQ. Several contexts can share one trace.
+ */
+typedef struct
+{
+	uint8_t data[NFC_TRACE_SIZE];	///< Records, the oldest at head
+	uint16_t head;					///< Position of oldest record
+	uint16_t used;					///< Bytes taken by closed records
+	uint16_t open;					///< Bytes of record being written, 0 when there is none
+	uint32_t records;				///< Records closed since NFC_InitTrace
+	uint32_t dropped;				///< Oldest records overwritten
+}NFC_Trace;
 
 /**
- * \brief Function to initialize pointer of communication interface functionality.
+ *  Time a command code took to answer after its ACK, learned while polling status.
+ */
+typedef struct
+{
+	uint8_t command;					///< Command code
+	uint32_t readyUs;					///< Moving average of time to answer, 0 while slot is free
+}NFC_PollEstimate;
+
+/// States of a command started with NFC_StartCommand
+#define NFC_COMMAND_IDLE			(0)
+#define NFC_COMMAND_WAITACK			(1)		///< Command written, waiting IRQ to read ACK
+#define NFC_COMMAND_WAITRESPONSE	(2)		///< ACK read, waiting IRQ to read response
+#define NFC_COMMAND_DONE			(3)		///< Response read and valid
+#define NFC_COMMAND_ERROR			(4)		///< No ACK, invalid response or timeout
+
+/**
+ *  State of the driver for one PN532. Every function of the driver works
+ *  over a context, so several PN532 can be operated from one firmware.
+ */
+typedef struct
+{
+	NFC_CommInterface *commInterface;	///< Interface used to operate with PN532
+	uint8_t device;						///< Number of PN532 given to SetDevice of interface
+	uint8_t buffer[PN532_FRAMESIZE];	///< Command to send and last frame received
+	uint8_t frame[PN532_FRAMESIZE];		///< Frame assembled before sending it
+	uint8_t status;						///< Status byte of last InDataExchange or InCommunicateThru
+	uint8_t target;						///< Logical number of target selected in PN532, 0 for none
+	uint8_t selection;					///< Changes each time the target selected ends, with its Crypto1 session
+
+	uint8_t state;						///< State of command started with NFC_StartCommand
+	uint8_t command;					///< Command code of last frame written, waiting for response
+	uint16_t timeout;					///< Timeout in mS of each step of the command
+	uint32_t startTick;					///< HAL tick when current step started
+	NFC_FrameView response;				///< Response of command when state is done
+	uint32_t pollGapUs;					///< Gap before next status read when interface has no GetIRQ
+	uint32_t pollNextUs;				///< Time of next status read
+	uint32_t pollStartUs;				///< Time when the current wait started
+	uint32_t pollBusyUs;				///< Time of last busy answer of the current wait
+	NFC_PollEstimate *pollEstimate;		///< Estimate learning from the current wait, NULL for none
+	NFC_PollEstimate pollEstimates[NFC_POLL_COMMANDS];	///< Times to answer of the last command codes
+	uint8_t pollReplace;				///< Estimate given to the next new command code
+
+#if NFC_STATS_ENABLE
+	NFC_Stats stats;					///< Statistics of commands
+	NFC_CommandStats *statsCommand;		///< Slot of command being measured, NULL when there is none
+	uint32_t statsStartUs;				///< Time when command being measured was written
+#endif
+
+#if NFC_TRACE_ENABLE
+	NFC_Trace *trace;					///< Trace receiving the transactions, NULL to record nothing
+	uint32_t traceEndUs;				///< Time when last transaction ended
+#endif
+}NFC_Context;
+
+
+/**
+ * \brief Function to initialize a driver context with the communication interface functionality.
  *
+ * \param[out] context Context to initialize.
  * \param[in] interface Pointer to contain all functions of interface;
+ * \param[in] device Number of PN532 in the interface, given to SetDevice before each access.
  *  \return Return 1 if operation was success or 0 the other way.
  */
-uint8_t NFC_CommInit(NFC_CommInterface *interface);
+uint8_t NFC_CommInit(NFC_Context *context, NFC_CommInterface *interface, const uint8_t device);
+
+/**
+ * \brief Write a command without waiting the answer of PN532.
+ * The command is taken from context buffer, first byte is command code.
+ * Use NFC_ProcessCommand to advance it while other PN532 are served.
+ *
+ * \param[in,out] context Context of PN532.
+ * \param[in] cmd_length Amount of bytes of command in context buffer.
+ * \param[in] timeout Timeout in mS to wait ACK and to wait response, NFC_TIMEOUT_NONE to wait response without limit.
+ */
+void NFC_StartCommand(NFC_Context *context, const uint16_t cmd_length, const uint16_t timeout);
+
+/**
+ * \brief Advance a command started with NFC_StartCommand, never waits for PN532.
+ * When IRQ of PN532 is active the ACK or the response is read.
+ *
+ * \param[in,out] context Context of PN532.
+ *
+ * \return Return state of command, NFC_COMMAND_DONE when response is in context.
+ */
+uint8_t NFC_ProcessCommand(NFC_Context *context);
+
+/**
+ * \brief Wait the end of a command started with NFC_StartCommand, sleeping
+ * while PN532 works as blocking commands do. The host can do some work
+ * between the start of a command and this call.
+ *
+ * \param[in,out] context Context of PN532.
+ *
+ * \return Return state of command, NFC_COMMAND_DONE or NFC_COMMAND_ERROR.
+ */
+uint8_t NFC_WaitCommand(NFC_Context *context);
+
+/**
+ * \brief Time left to the next status read of a command in progress, when
+ * interface has no GetIRQ. The caller can sleep it with SleepUs of interface.
+ *
+ * \param[in] context Context of PN532.
+ *
+ * \return Return time in uS, 0 when status is read in next NFC_ProcessCommand.
+ */
+uint32_t NFC_GetPollDelayUs(NFC_Context *context);
 
 
 /// Generic PN532 functions
@@ -157,26 +530,57 @@ uint8_t NFC_CommInit(NFC_CommInterface *interface);
  * 	Byte 3: Version number before decimal point eg. [1].6
  *  Byte 4: Version number after decimal point e.g. 1.[6]
  *
+ *  \param[in,out] context Context of PN532.
+ *
  *  \return Return variable containing hardware and software version from PN532
  */
-uint32_t NFC_GetFirmwareVersion(void);
+uint32_t NFC_GetFirmwareVersion(NFC_Context *context);
+
+/**
+ * \brief Communication line test of Diagnose command, PN532 answers the same data.
+ * Used to verify the link with the host, e.g. after changing its clock.
+ *
+ * \param[in,out] context Context of PN532.
+ * \param[in] data Data to be echoed.
+ * \param[in] length Length of data, up to PN532_BUFFERSIZE - 2.
+ * \param[in] timeout Time to wait ACK and answer in mS.
+ *
+ * \return Return 1 if the same data was received or 0 the other way.
+ */
+uint8_t NFC_Diagnose(NFC_Context *context, const uint8_t *data, const uint16_t length, const uint16_t timeout);
+
+/**
+ * \brief Change baud rate of HSU port of PN532 with SetSerialBaudRate.
+ * PN532 answers at the old rate and switches when the host acknowledges the
+ * answer, this function sends that ACK. The host must use the new rate
+ * for everything after it returns 1.
+ *
+ * \param[in,out] context Context of PN532.
+ * \param[in] rate Baud rate code, PN532_HSU_BAUD_9600 to PN532_HSU_BAUD_1288000.
+ *
+ * \return Return 1 if PN532 accepted the rate or 0 the other way.
+ */
+uint8_t NFC_SetSerialBaudRate(NFC_Context *context, const uint8_t rate);
 
 /**
  * 	\brief Configures the SAM (Secure Access Module)
  *
+ * 	\param[in,out] context Context of PN532.
+ *
  * 	\return Return 1 if everything executed properly, 0 for an error
  */
-uint8_t NFC_SAMConfig(void);
+uint8_t NFC_SAMConfig(NFC_Context *context);
 
 /**
  * 	\brief Set retries of PN532. Sets the MxRtyPassiveActivation byte
  * 	 of the RFConfiguration register.
  *
+ * 	 \param[in,out] context Context of PN532.
  * 	 \param[in] maxRetries Maximum retries to read
  *
  * 	 \return Return 1 if everything executed properly, 0 for an error
  */
-uint8_t NFC_SetPassiveActivationRetries(uint8_t maxRetries);
+uint8_t NFC_SetPassiveActivationRetries(NFC_Context *context, uint8_t maxRetries);
 
 
 /// Functions to ISO14443A
@@ -184,6 +588,7 @@ uint8_t NFC_SetPassiveActivationRetries(uint8_t maxRetries);
 /**
  * 	\brief Read UID of an ISO14443A card
  *
+ * 	\param[in,out] context		Context of PN532.
  * 	\param[in] card_			Baudrate Card baud rate. Possible value this field is:
  *
  * 								0x00 - 106 kbps type A (ISO/IEC14443 Type A)
@@ -192,12 +597,275 @@ uint8_t NFC_SetPassiveActivationRetries(uint8_t maxRetries);
  * 								0x03 : 106 kbps type B (ISO/IEC14443-3B)
  * 								0x04 : 106 kbps Innovision Jewel tag
  *
- * 	\param[in,out] uid 			Pointer to character array to store UID.
+ * 	\param[in,out] uid 			Pointer to array of NFC_PASSIVE_UIDSIZE bytes to store UID.
  * 	\param[in,out] length_uid	Pointer to variable to hold UID length (4 or 7)
  * 	\param[in] timeout			Timeout in mS default to allow PN532 to receive answer form card.
  *
  * 	\return Return state of real action. 1 was success, 0 failed
  */
-uint8_t NFC_ReadPassiveTargetID(const uint8_t card_Baudrate, uint8_t *uid, uint8_t *length_uid, const uint16_t timeout);
+uint8_t NFC_ReadPassiveTargetID(NFC_Context *context, const uint8_t card_Baudrate, uint8_t *uid, uint8_t *length_uid, const uint16_t timeout);
+
+/**
+ * 	\brief Start InListPassiveTarget without waiting a card, see NFC_StartCommand.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] card_Baudrate	Card baud rate, same values of NFC_ReadPassiveTargetID.
+ * 	\param[in] timeout			Timeout in mS to wait ACK and to wait a card.
+ */
+void NFC_StartReadPassiveTargetID(NFC_Context *context, const uint8_t card_Baudrate, const uint16_t timeout);
+
+/**
+ * 	\brief Get UID of card found by a command started with NFC_StartReadPassiveTargetID.
+ *
+ * 	\param[in] context			Context of PN532, command state must be NFC_COMMAND_DONE.
+ * 	\param[in,out] uid 			Pointer to array of NFC_PASSIVE_UIDSIZE bytes to store UID.
+ * 	\param[in,out] length_uid	Pointer to variable to hold UID length (4 or 7)
+ *
+ * 	\return Return 1 if a card was found, 0 the other way.
+ */
+uint8_t NFC_GetPassiveTargetID(NFC_Context *context, uint8_t *uid, uint8_t *length_uid);
+
+/**
+ * 	\brief List up to two 106 kbps type A targets with one InListPassiveTarget.
+ * 	Every target keeps its logical number, InSelect and InDataExchange move
+ * 	between them without polling the field again.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] maxTargets		Targets to list, 1 or PN532_AUTOPOLL_MAXTARGETS.
+ * 	\param[out] targets			Array of maxTargets targets.
+ * 	\param[out] found			Amount of targets listed.
+ * 	\param[in] timeout			Timeout in mS to wait ACK and to wait targets.
+ *
+ * 	\return Return 1 if at least a target was listed, 0 the other way.
+ */
+uint8_t NFC_ListPassiveTargets(NFC_Context *context, const uint8_t maxTargets, NFC_Target *targets, uint8_t *found, const uint16_t timeout);
+
+/**
+ * 	\brief Start InListPassiveTarget of up to two targets without waiting them,
+ * 	see NFC_StartCommand and NFC_ListPassiveTargets.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] maxTargets		Targets to list, 1 or PN532_AUTOPOLL_MAXTARGETS.
+ * 	\param[in] timeout			Timeout in mS to wait ACK and to wait targets.
+ *
+ * 	\return Return 1 if the command was started, 0 for invalid parameters.
+ */
+uint8_t NFC_StartListPassiveTargets(NFC_Context *context, const uint8_t maxTargets, const uint16_t timeout);
+
+/**
+ * 	\brief Get targets listed by a command started with NFC_StartListPassiveTargets.
+ *
+ * 	\param[in,out] context		Context of PN532, command state must be NFC_COMMAND_DONE.
+ * 	\param[out] targets			Array of maxTargets targets.
+ * 	\param[out] found			Amount of targets listed.
+ *
+ * 	\return Return 1 if at least a target was listed, 0 the other way.
+ */
+uint8_t NFC_GetPassiveTargets(NFC_Context *context, NFC_Target *targets, uint8_t *found);
+
+/**
+ * 	\brief Let PN532 poll several target types by itself (InAutoPoll). It answers
+ * 	when targets are found or the polls are over, there is no traffic meanwhile.
+ * 	Found targets are activated for InDataExchange.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] types			Target types to poll in order, PN532_AUTOPOLL_*.
+ * 	\param[in] typeCount		Amount of types, 1 to PN532_AUTOPOLL_MAXTYPES.
+ * 	\param[in] pollCount		Polls of every type, 1 to 254, or PN532_AUTOPOLL_ENDLESS until a target is found.
+ * 	\param[in] period			Time between polls in units of PN532_AUTOPOLL_PERIODMS, 1 to 15.
+ * 	\param[out] targets			Array of PN532_AUTOPOLL_MAXTARGETS targets, views inside the context buffer.
+ * 	\param[out] found			Amount of targets found, 0 when polls ended without target.
+ * 	\param[in] timeout			Timeout in mS to wait ACK and to wait targets.
+ *
+ * 	\return Return 1 if PN532 answered, 0 for an error or timeout.
+ */
+uint8_t NFC_AutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period, NFC_AutoPollTarget *targets, uint8_t *found, const uint16_t timeout);
+
+/**
+ * 	\brief Start InAutoPoll without waiting targets, see NFC_StartCommand and NFC_AutoPoll.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] types			Target types to poll in order, PN532_AUTOPOLL_*.
+ * 	\param[in] typeCount		Amount of types, 1 to PN532_AUTOPOLL_MAXTYPES.
+ * 	\param[in] pollCount		Polls of every type, 1 to 254, or PN532_AUTOPOLL_ENDLESS until a target is found.
+ * 	\param[in] period			Time between polls in units of PN532_AUTOPOLL_PERIODMS, 1 to 15.
+ * 	\param[in] timeout			Timeout in mS to wait targets, NFC_TIMEOUT_NONE to wait without limit.
+ *
+ * 	\return Return 1 if the command was started, 0 for invalid parameters.
+ */
+uint8_t NFC_StartAutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period, const uint16_t timeout);
+
+/**
+ * 	\brief Get targets found by a command started with NFC_StartAutoPoll.
+ *
+ * 	\param[in] context			Context of PN532, command state must be NFC_COMMAND_DONE.
+ * 	\param[out] targets			Array of PN532_AUTOPOLL_MAXTARGETS targets, views inside the context buffer.
+ * 	\param[out] found			Amount of targets found, 0 when polls ended without target.
+ *
+ * 	\return Return 1 if the answer of InAutoPoll is valid, 0 the other way.
+ */
+uint8_t NFC_GetAutoPollTargets(NFC_Context *context, NFC_AutoPollTarget *targets, uint8_t *found);
+
+/**
+ * 	\brief Exchange data with an activated target through PN532 protocol handling
+ * 	(InDataExchange). Frames longer than 254 bytes are sent and received as extended frames.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] target			Logical number of target given by InListPassiveTarget (usually 1).
+ * 	\param[in] data				Data to send to target.
+ * 	\param[in] length			Amount of bytes of data, up to PN532_BUFFERSIZE - 2.
+ * 	\param[out] response		View of data answered by target, without status byte. It points
+ * 								inside the context buffer and is valid until next command.
+ * 	\param[in] timeout			Timeout in mS to wait the answer of target.
+ *
+ * 	\return Return 1 if target answered with status success, 0 for an error
+ */
+uint8_t NFC_InDataExchange(NFC_Context *context, const uint8_t target, const uint8_t *data, const uint16_t length, NFC_FrameView *response, const uint16_t timeout);
+
+/**
+ * 	\brief Start InDataExchange without waiting the answer, see NFC_StartCommand.
+ * 	The host can work meanwhile, data is copied before the function returns.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] target			Logical number of target.
+ * 	\param[in] data				Data to send to target.
+ * 	\param[in] length			Amount of bytes of data, up to PN532_BUFFERSIZE - 2.
+ * 	\param[in] timeout			Timeout in mS to wait ACK and to wait the answer of target.
+ *
+ * 	\return Return 1 if the command was started, 0 for invalid parameters.
+ */
+uint8_t NFC_StartInDataExchange(NFC_Context *context, const uint8_t target, const uint8_t *data, const uint16_t length, const uint16_t timeout);
+
+/**
+ * 	\brief Get answer of target to a command started with NFC_StartInDataExchange.
+ *
+ * 	\param[in,out] context		Context of PN532, command state must be NFC_COMMAND_DONE.
+ * 	\param[out] response		View of data answered by target, without status byte. It points
+ * 								inside the context buffer and is valid until next command.
+ *
+ * 	\return Return 1 if target answered with status success, 0 for an error
+ */
+uint8_t NFC_GetInDataExchange(NFC_Context *context, NFC_FrameView *response);
+
+/**
+ * 	\brief Exchange raw data with the current target, PN532 adds no protocol
+ * 	information (InCommunicateThru). Frames longer than 254 bytes are sent and
+ * 	received as extended frames.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] data				Data to send to target.
+ * 	\param[in] length			Amount of bytes of data, up to PN532_BUFFERSIZE - 1.
+ * 	\param[out] response		View of data answered by target, without status byte. It points
+ * 								inside the context buffer and is valid until next command.
+ * 	\param[in] timeout			Timeout in mS to wait the answer of target.
+ *
+ * 	\return Return 1 if target answered with status success, 0 for an error
+ */
+uint8_t NFC_InCommunicateThru(NFC_Context *context, const uint8_t *data, const uint16_t length, NFC_FrameView *response, const uint16_t timeout);
+
+/**
+ * 	\brief Select a listed target (InSelect), the one selected before is deselected.
+ * 	InDataExchange selects its target the same way, this lets the host do it
+ * 	ahead, for instance before InCommunicateThru.
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] target			Logical number of target.
+ * 	\param[in] timeout			Timeout in mS to wait the answer.
+ *
+ * 	\return Return 1 if target was selected, 0 for an error.
+ */
+uint8_t NFC_InSelect(NFC_Context *context, const uint8_t target, const uint16_t timeout);
+
+/**
+ * 	\brief Deselect a target, PN532 keeps its information to select it again (InDeselect).
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] target			Logical number of target, NFC_TARGET_ALL for every target.
+ * 	\param[in] timeout			Timeout in mS to wait the answer.
+ *
+ * 	\return Return 1 if target was deselected, 0 for an error.
+ */
+uint8_t NFC_InDeselect(NFC_Context *context, const uint8_t target, const uint16_t timeout);
+
+/**
+ * 	\brief Release a target, PN532 forgets it and the card is halted (InRelease).
+ *
+ * 	\param[in,out] context		Context of PN532.
+ * 	\param[in] target			Logical number of target, NFC_TARGET_ALL for every target.
+ * 	\param[in] timeout			Timeout in mS to wait the answer.
+ *
+ * 	\return Return 1 if target was released, 0 for an error.
+ */
+uint8_t NFC_InRelease(NFC_Context *context, const uint8_t target, const uint16_t timeout);
+
+/**
+ * 	\brief Status byte of the last InDataExchange or InCommunicateThru answered by PN532.
+ * 	Bits 0 to 5 hold the error code, 0x00 is success, 0x01 timeout of target.
+ *
+ * 	\param[in] context Context of PN532.
+ *
+ * 	\return Return status byte.
+ */
+uint8_t NFC_GetLastStatus(NFC_Context *context);
+
+#if NFC_STATS_ENABLE
+/**
+ * 	\brief Copy statistics of a PN532 without stopping the driver.
+ * 	The copy is discarded when the driver updated statistics during it, call
+ * 	again later. From the loop that runs the driver it always succeeds.
+ *
+ * 	\param[in] context	Context of PN532.
+ * 	\param[out] stats	Structure to store statistics.
+ *
+ * 	\return Return 1 if copy is consistent, 0 the other way.
+ */
+uint8_t NFC_GetStats(NFC_Context *context, NFC_Stats *stats);
+
+/**
+ * 	\brief Clear statistics of a PN532, call it from the loop that runs the driver.
+ *
+ * 	\param[in,out] context	Context of PN532.
+ */
+void NFC_ResetStats(NFC_Context *context);
+#endif
+
+#if NFC_TRACE_ENABLE
+/**
+ * 	\brief Empty a trace.
+ *
+ * 	\param[out] trace	Trace to initialize.
+ */
+void NFC_InitTrace(NFC_Trace *trace);
+
+/**
+ * 	\brief Record the transactions of a PN532 in a trace.
+ *
+ * 	\param[in,out] context	Context of PN532.
+ * 	\param[in] trace		Trace shared with other contexts or not, NULL to stop recording.
+ */
+void NFC_SetTrace(NFC_Context *context, NFC_Trace *trace);
+
+/**
+ * 	\brief Give records of a trace from the oldest after the magic "NFCT", as the
+ * 	file read by Trace_Replay. The memory image of an NFC_Trace taken with a
+ * 	debugger is also accepted by the tool.
+ *
+ * 	\param[in] trace	Trace to dump, not modified.
+ * 	\param[in] write	Function receiving bytes of records, called several times.
+ */
+void NFC_DumpTrace(const NFC_Trace *trace, void (*write)(const uint8_t *, size_t));
+#endif
+
+#if NFC_PROFILE_ENABLE
+/**
+ * 	\brief Timestamp the end of a phase of a command, implemented by the platform.
+ * 	Called by the driver only when NFC_PROFILE_ENABLE is 1, it must not block.
+ *
+ * 	\param[in] device	Number of PN532 given to NFC_CommInit.
+ * 	\param[in] phase	Phase that ended, one of NFC_PHASE_x.
+ * 	\param[in] command	Command code of the frame, only meaningful with NFC_PHASE_START.
+ */
+void NFC_Profile_Mark(const uint8_t device, const uint8_t phase, const uint8_t command);
+#endif
 
 #endif /* INC_NFC_H_ */
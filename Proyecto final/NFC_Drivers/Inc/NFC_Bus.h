@@ -0,0 +1,74 @@
+/*
+ * NFC_Bus.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#ifndef INC_NFC_BUS_H_
+#define INC_NFC_BUS_H_
+
+#include "NFC.h"
+
+/// Maximum amount of readers served by one bus
+#ifndef NFC_BUS_MAXREADERS
+#define NFC_BUS_MAXREADERS	4
+#endif
+
+/**
+ *  Scheduler of several PN532 sharing one communication bus. Each reader
+ *  runs a command started with NFC_StartCommand; while one PN532 works on
+ *  the RF field the bus is used to serve the others.
+ */
+typedef struct
+{
+	NFC_Context *readers[NFC_BUS_MAXREADERS];	///< Contexts of readers on the bus
+	uint8_t count;								///< Amount of readers added
+	uint8_t next;								///< Reader served first in next pass
+	void (*Idle)(void);							///< Called when no reader progress, NULL to poll without sleeping
+	void (*Sleep)(void);						///< Called instead of Idle when no waiting reader has a timeout, NULL to use Idle
+}NFC_Bus;
+
+
+/**
+ * \brief Initialize an empty bus.
+ *
+ * \param[out] bus Bus to initialize.
+ * \param[in] idle Function to sleep until an IRQ edge or NULL.
+ */
+void NFC_Bus_Init(NFC_Bus *bus, void (*idle)(void));
+
+/**
+ * \brief Add a reader to bus, its context must be initialized by NFC_CommInit.
+ *
+ * \param[in,out] bus Bus of reader.
+ * \param[in] context Context of reader.
+ *
+ * \return Return 1 if reader was added, 0 the other way.
+ */
+uint8_t NFC_Bus_Add(NFC_Bus *bus, NFC_Context *context);
+
+/**
+ * \brief Set function to sleep when every waiting reader waits a response
+ * without limit (NFC_TIMEOUT_NONE), e.g. InAutoPoll. Nothing has to be timed
+ * then, so it can stop SysTick and wake up only on an IRQ edge.
+ *
+ * \param[in,out] bus Bus of readers.
+ * \param[in] sleep Function to sleep until an IRQ edge or NULL.
+ */
+void NFC_Bus_SetSleep(NFC_Bus *bus, void (*sleep)(void));
+
+/**
+ * \brief Advance commands of every reader once, round robin.
+ * First reader served changes in each call, so no reader holds the bus.
+ * When no waiting reader has IRQ line, the pass ends with SleepUs of
+ * interface until the first status read instead of Idle.
+ *
+ * \param[in,out] bus Bus of readers.
+ *
+ * \return Return context of a reader whose command ended (done or error),
+ * NULL when no command ended in this pass.
+ */
+NFC_Context *NFC_Bus_Process(NFC_Bus *bus);
+
+#endif /* INC_NFC_BUS_H_ */
@@ -0,0 +1,425 @@
+/*
+ * NFC_Mifare.h
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#ifndef INC_NFC_MIFARE_H_
+#define INC_NFC_MIFARE_H_
+
+#include "NFC.h"
+
+/// Bytes of a block and of a key
+#define NFC_MIFARE_BLOCKSIZE	(16)
+#define NFC_MIFARE_KEYSIZE		(6)
+
+/// Sectors of MIFARE Classic 1K and 4K, sectors from 32 on of 4K have 16 blocks
+#define NFC_MIFARE_SECTORS_1K	(16)
+#define NFC_MIFARE_SECTORS_4K	(40)
+#define NFC_MIFARE_MAXBLOCKS	(16)
+
+/// Timeout in mS of each exchange with the card
+#ifndef NFC_MIFARE_TIMEOUT
+#define NFC_MIFARE_TIMEOUT		(100)
+#endif
+
+/// Sectors with diversified keys in a key table, up to 16
+#ifndef NFC_MIFARE_KEYSECTORS
+#define NFC_MIFARE_KEYSECTORS	(8)
+#endif
+
+/// Cards whose keys are kept in a key table, the least used is replaced
+#ifndef NFC_MIFARE_KEYCARDS
+#define NFC_MIFARE_KEYCARDS		(4)
+#endif
+
+#if NFC_MIFARE_KEYSECTORS > 16
+#error "NFC_MIFARE_KEYSECTORS must be 16 or less"
+#endif
+
+/// Sector of a card without authentication
+#define NFC_MIFARE_NOSECTOR		(0xFF)
+
+/// Command to restore a value block to the transfer buffer, named store in the command list
+#define MIFARE_CMD_RESTORE		MIFARE_CMD_STORE
+
+/// Keys of one card diversified from its UID
+typedef struct
+{
+	uint8_t uid[NFC_TARGET_UIDSIZE];	///< NFCID1 of card
+	uint8_t uidLength;					///< Bytes of NFCID1, 0 for an entry not used
+	uint16_t derived;					///< Bit i set when key of sectors[i] of table is derived
+	uint32_t used;						///< Use count of table when entry was last used
+	uint8_t keys[NFC_MIFARE_KEYSECTORS][NFC_MIFARE_KEYSIZE];	///< Key of each sector of table
+}NFC_MifareKeyCard;
+
+/**
+ *  Table of diversified keys. Keys of a card are derived by the application
+ *  function from the UID and the sector, the first time the card is seen.
+ *  Each key is derived while PN532 exchanges frames with the card.
+ */
+typedef struct
+{
+	void (*diversify)(const uint8_t *uid, const uint8_t uidLength, const uint8_t sector, uint8_t *key, void *user);	///< Derive key of sector of card
+	void *user;							///< Pointer given to diversify
+	uint8_t keyType;					///< MIFARE_CMD_AUTH_A or MIFARE_CMD_AUTH_B
+	uint8_t sectors[NFC_MIFARE_KEYSECTORS];	///< Sectors with diversified keys
+	uint8_t sectorCount;				///< Amount of sectors
+	uint32_t used;						///< Count of cards looked up
+	NFC_MifareKeyCard cards[NFC_MIFARE_KEYCARDS];	///< Keys of last cards
+}NFC_MifareKeys;
+
+/**
+ *  MIFARE Classic card activated by a PN532. Sectors are authenticated with
+ *  the key of NFC_Mifare_SetKey, or with the key table of NFC_Mifare_UseKeys
+ *  for its sectors. The sector authenticated is remembered so that accesses
+ *  to it do not authenticate again while the target stays selected.
+ */
+typedef struct
+{
+	NFC_Context *context;				///< PN532 that activated the card
+	uint8_t target;						///< Logical number of target for InDataExchange
+	uint8_t uid[NFC_TARGET_UIDSIZE];	///< NFCID1, authentication uses its last 4 bytes
+	uint8_t uidLength;					///< Bytes of NFCID1
+	uint8_t keyType;					///< MIFARE_CMD_AUTH_A or MIFARE_CMD_AUTH_B
+	uint8_t key[NFC_MIFARE_KEYSIZE];	///< Key of sectors out of key table
+	uint16_t timeout;					///< Timeout in mS of each exchange
+	NFC_MifareKeys *keys;				///< Key table, NULL for none
+	NFC_MifareKeyCard *keyCard;			///< Keys of this card in key table
+	uint8_t sector;						///< Sector authenticated, NFC_MIFARE_NOSECTOR for none
+	uint8_t selection;					///< Selection of context when sector was authenticated
+}NFC_Mifare;
+
+/**
+ *  Purse of a value block and its backup in the same sector. Each debit
+ *  transfers the new balance to the block holding the old one, so the last
+ *  balance is kept by the other block if the transfer is torn. Balance only
+ *  goes down between credits, so the valid block with the lowest value is
+ *  the current one.
+ */
+typedef struct
+{
+	uint8_t blocks[2];					///< Value blocks of purse
+	uint8_t current;					///< Index in blocks of the balance
+	int32_t value;						///< Balance
+}NFC_MifarePurse;
+
+
+/**
+ * \brief Initialize a card listed by a PN532, key is the transport key FFFFFFFFFFFF as key A.
+ *
+ * \param[out] card Card to initialize.
+ * \param[in] context Context of PN532 that listed the card.
+ * \param[in] target Target listed by NFC_ListPassiveTargets.
+ *
+ * \return Return 1 if the target is a MIFARE Classic card, 0 the other way.
+ */
+uint8_t NFC_Mifare_Init(NFC_Mifare *card, NFC_Context *context, const NFC_Target *target);
+
+/**
+ * \brief Set key to authenticate sectors out of key table, ends authentication of sector.
+ *
+ * \param[in,out] card Card.
+ * \param[in] keyType MIFARE_CMD_AUTH_A or MIFARE_CMD_AUTH_B.
+ * \param[in] key Key of NFC_MIFARE_KEYSIZE bytes.
+ */
+void NFC_Mifare_SetKey(NFC_Mifare *card, const uint8_t keyType, const uint8_t *key);
+
+/**
+ * \brief Initialize a key table without cards.
+ *
+ * \param[out] keys Key table.
+ * \param[in] keyType MIFARE_CMD_AUTH_A or MIFARE_CMD_AUTH_B.
+ * \param[in] sectors Sectors with diversified keys.
+ * \param[in] count Amount of sectors, up to NFC_MIFARE_KEYSECTORS.
+ * \param[in] diversify Function that writes in key the key of a sector of the card of uid.
+ * \param[in] user Pointer given to diversify.
+ *
+ * \return Return 1 if table was initialized, 0 if there are too many sectors.
+ */
+uint8_t NFC_Mifare_KeysInit(NFC_MifareKeys *keys, const uint8_t keyType, const uint8_t *sectors, const uint8_t count,
+		void (*diversify)(const uint8_t *uid, const uint8_t uidLength, const uint8_t sector, uint8_t *key, void *user), void *user);
+
+/**
+ * \brief Authenticate sectors of key table with the keys of this card. Keys
+ * not derived yet are derived while PN532 exchanges the first frames with the
+ * card, the key of a sector is derived before it when it is not.
+ *
+ * \param[in,out] card Card.
+ * \param[in,out] keys Key table, the card takes the entry of the least used card when it is not in table.
+ */
+void NFC_Mifare_UseKeys(NFC_Mifare *card, NFC_MifareKeys *keys);
+
+/**
+ * \brief Get first block of a sector.
+ *
+ * \param[in] sector Sector of card, up to NFC_MIFARE_SECTORS_4K - 1.
+ *
+ * \return Return number of block.
+ */
+uint8_t NFC_Mifare_FirstBlock(const uint8_t sector);
+
+/**
+ * \brief Get amount of blocks of a sector, trailer included.
+ *
+ * \param[in] sector Sector of card, up to NFC_MIFARE_SECTORS_4K - 1.
+ *
+ * \return Return 4, or 16 for the big sectors of 4K.
+ */
+uint8_t NFC_Mifare_BlockCount(const uint8_t sector);
+
+/**
+ * \brief Authenticate a sector with the key of the card. Nothing is sent when
+ * the sector is already authenticated and the target was not selected again.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sector Sector to authenticate.
+ *
+ * \return Return 1 if card accepted the key, 0 the other way.
+ */
+uint8_t NFC_Mifare_Authenticate(NFC_Mifare *card, const uint8_t sector);
+
+/**
+ * \brief Read a block of the sector authenticated.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Block to read.
+ * \param[out] data Buffer of NFC_MIFARE_BLOCKSIZE bytes.
+ *
+ * \return Return 1 if block was read, 0 the other way.
+ */
+uint8_t NFC_Mifare_ReadBlock(NFC_Mifare *card, const uint8_t block, uint8_t *data);
+
+/**
+ * \brief Write a block of the sector authenticated.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Block to write.
+ * \param[in] data Data of NFC_MIFARE_BLOCKSIZE bytes.
+ *
+ * \return Return 1 if block was written, 0 the other way.
+ */
+uint8_t NFC_Mifare_WriteBlock(NFC_Mifare *card, const uint8_t block, const uint8_t *data);
+
+/**
+ * \brief Authenticate a sector once and read its blocks in order.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sector Sector to read.
+ * \param[in] trailers 1 to read the trailer too, 0 for data blocks only.
+ * \param[out] data Buffer of NFC_Mifare_BlockCount blocks, one less without trailer.
+ *
+ * \return Return 1 if every block was read, 0 the other way.
+ */
+uint8_t NFC_Mifare_ReadSector(NFC_Mifare *card, const uint8_t sector, const uint8_t trailers, uint8_t *data);
+
+/**
+ * \brief Authenticate a sector once and write all its data blocks. The trailer
+ * and the manufacturer block 0 are never written.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sector Sector to write.
+ * \param[in] data Data blocks in order, 2 for sector 0 (blocks 1 and 2).
+ *
+ * \return Return 1 if every block was written, 0 the other way.
+ */
+uint8_t NFC_Mifare_WriteSector(NFC_Mifare *card, const uint8_t sector, const uint8_t *data);
+
+/**
+ * \brief Read data blocks of several sectors, one authentication each. Each
+ * block is given to the handler while PN532 exchanges the next one with the
+ * card, so parsing takes no time of the tap.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sectors Sectors to read, in order.
+ * \param[in] count Amount of sectors.
+ * \param[in] trailers 1 to read trailers too, 0 for data blocks only.
+ * \param[in] handler Function called with each block read, its data is valid during the call.
+ * \param[in] user Pointer given to handler.
+ *
+ * \return Return 1 if every block was read, 0 the other way. Blocks read
+ * before an error are given to the handler.
+ */
+uint8_t NFC_Mifare_ReadSectors(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t trailers,
+		void (*handler)(const uint8_t block, const uint8_t *data, void *user), void *user);
+
+/**
+ * \brief Write data blocks of several sectors, one authentication each. Trailers
+ * and block 0 are never written.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sectors Sectors to write, in order.
+ * \param[in] count Amount of sectors.
+ * \param[in] data Data blocks of sectors in order, as NFC_Mifare_WriteSector takes them.
+ *
+ * \return Return 1 if every block was written, 0 the other way.
+ */
+uint8_t NFC_Mifare_WriteSectors(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t *data);
+
+/**
+ * \brief Read every block of the first sectors of card, see NFC_Mifare_ReadSectors.
+ *
+ * \param[in,out] card Card.
+ * \param[in] sectorCount NFC_MIFARE_SECTORS_1K or NFC_MIFARE_SECTORS_4K.
+ * \param[in] handler Function called with each block read, its data is valid during the call.
+ * \param[in] user Pointer given to handler.
+ *
+ * \return Return 1 if every block was read, 0 the other way.
+ */
+uint8_t NFC_Mifare_Dump(NFC_Mifare *card, const uint8_t sectorCount,
+		void (*handler)(const uint8_t block, const uint8_t *data, void *user), void *user);
+
+/**
+ * \brief Build a value block: value, its inverse and value again, then address,
+ * its inverse, address and its inverse.
+ *
+ * \param[in] value Value.
+ * \param[in] address Byte kept with value, usually the number of the block.
+ * \param[out] data Block of NFC_MIFARE_BLOCKSIZE bytes.
+ */
+void NFC_Mifare_EncodeValue(const int32_t value, const uint8_t address, uint8_t *data);
+
+/**
+ * \brief Check the redundancy of a value block already read and get its value.
+ *
+ * \param[in] data Block of NFC_MIFARE_BLOCKSIZE bytes.
+ * \param[out] value Value, may be NULL.
+ * \param[out] address Address byte, may be NULL.
+ *
+ * \return Return 1 if data is a valid value block, 0 the other way.
+ */
+uint8_t NFC_Mifare_DecodeValue(const uint8_t *data, int32_t *value, uint8_t *address);
+
+/**
+ * \brief Write a block as value block, its sector is authenticated when it is not.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Block to format.
+ * \param[in] value Initial value.
+ * \param[in] address Address byte, usually the number of the block.
+ *
+ * \return Return 1 if block was written, 0 the other way.
+ */
+uint8_t NFC_Mifare_FormatValue(NFC_Mifare *card, const uint8_t block, const int32_t value, const uint8_t address);
+
+/**
+ * \brief Read a value block, its sector is authenticated when it is not.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Block to read.
+ * \param[out] value Value, may be NULL.
+ * \param[out] address Address byte, may be NULL.
+ *
+ * \return Return 1 if block was read and is a valid value block, 0 the other way.
+ */
+uint8_t NFC_Mifare_ReadValue(NFC_Mifare *card, const uint8_t block, int32_t *value, uint8_t *address);
+
+/**
+ * \brief Increment a value block and transfer the result, two exchanges.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Value block incremented.
+ * \param[in] amount Amount added.
+ * \param[in] destination Block receiving the result, block itself or another block of its sector.
+ *
+ * \return Return 1 if result was transferred, 0 the other way.
+ */
+uint8_t NFC_Mifare_Increment(NFC_Mifare *card, const uint8_t block, const uint32_t amount, const uint8_t destination);
+
+/**
+ * \brief Decrement a value block and transfer the result, two exchanges.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Value block decremented.
+ * \param[in] amount Amount subtracted.
+ * \param[in] destination Block receiving the result, block itself or another block of its sector.
+ *
+ * \return Return 1 if result was transferred, 0 the other way.
+ */
+uint8_t NFC_Mifare_Decrement(NFC_Mifare *card, const uint8_t block, const uint32_t amount, const uint8_t destination);
+
+/**
+ * \brief Copy a value block to another block of its sector with restore and transfer, two exchanges.
+ *
+ * \param[in,out] card Card.
+ * \param[in] block Value block copied.
+ * \param[in] destination Block receiving the value.
+ *
+ * \return Return 1 if value was transferred, 0 the other way.
+ */
+uint8_t NFC_Mifare_Restore(NFC_Mifare *card, const uint8_t block, const uint8_t destination);
+
+/**
+ * \brief Initialize a purse of two value blocks.
+ *
+ * \param[out] purse Purse.
+ * \param[in] block Value block.
+ * \param[in] backup Backup block, in the sector of block.
+ *
+ * \return Return 1 if both blocks are data blocks of the same sector, 0 the other way.
+ */
+uint8_t NFC_Mifare_PurseInit(NFC_MifarePurse *purse, const uint8_t block, const uint8_t backup);
+
+/**
+ * \brief Get balance of a purse from its blocks already read, for instance
+ * by NFC_Mifare_ReadSectors. A torn block is ignored.
+ *
+ * \param[in,out] purse Purse.
+ * \param[in] data Data of blocks[0] of purse.
+ * \param[in] backup Data of blocks[1] of purse.
+ *
+ * \return Return 1 if a block is valid, 0 if purse must be formatted again.
+ */
+uint8_t NFC_Mifare_PurseLoad(NFC_MifarePurse *purse, const uint8_t *data, const uint8_t *backup);
+
+/**
+ * \brief Read both blocks of a purse and get its balance, see NFC_Mifare_PurseLoad.
+ *
+ * \param[in,out] card Card.
+ * \param[in,out] purse Purse.
+ *
+ * \return Return 1 if a block is valid, 0 the other way.
+ */
+uint8_t NFC_Mifare_PurseRead(NFC_Mifare *card, NFC_MifarePurse *purse);
+
+/**
+ * \brief Write balance in both blocks of a purse.
+ *
+ * \param[in,out] card Card.
+ * \param[in,out] purse Purse.
+ * \param[in] value Balance.
+ *
+ * \return Return 1 if both blocks were written, 0 the other way.
+ */
+uint8_t NFC_Mifare_PurseFormat(NFC_Mifare *card, NFC_MifarePurse *purse, const int32_t value);
+
+/**
+ * \brief Subtract from balance of a loaded purse with a decrement of the current
+ * block transferred to the other one: two exchanges, plus the authentication
+ * when the sector is not authenticated. The new balance is not read back.
+ *
+ * \param[in,out] card Card.
+ * \param[in,out] purse Purse loaded.
+ * \param[in] amount Amount subtracted, up to the balance.
+ *
+ * \return Return 1 if balance was subtracted, 0 if it is not enough or exchange
+ * failed, then purse must be read again.
+ */
+uint8_t NFC_Mifare_PurseDebit(NFC_Mifare *card, NFC_MifarePurse *purse, const uint32_t amount);
+
+/**
+ * \brief Add to balance of a loaded purse. The result is transferred to the other
+ * block then restored to the current one, four exchanges, so both blocks hold
+ * it and the lowest value keeps telling the current block.
+ *
+ * \param[in,out] card Card.
+ * \param[in,out] purse Purse loaded.
+ * \param[in] amount Amount added.
+ *
+ * \return Return 1 if both blocks hold the new balance, 0 the other way, then
+ * purse must be read again.
+ */
+uint8_t NFC_Mifare_PurseCredit(NFC_Mifare *card, NFC_MifarePurse *purse, const uint32_t amount);
+
+#endif /* INC_NFC_MIFARE_H_ */
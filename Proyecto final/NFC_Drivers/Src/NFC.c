@@ -11,280 +11,1764 @@
 #define true	(1)
 #define false	(0)
 
-static uint8_t pn532ack[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
-static uint8_t pn532response_firmwarevers[6] = {0x00, 0x00, 0xFF, 0x06, 0xFA, 0xD5};
-static uint8_t pn532_buffer[PN532_BUFFERSIZE];
-static NFC_CommInterface *commInterface;
+#if NFC_PROFILE_ENABLE
+#define NFC_PROFILE_MARK(context, phase, command)	NFC_Profile_Mark((context)->device, (phase), (command))
+#else
+#define NFC_PROFILE_MARK(context, phase, command)
+#endif
+
+#if NFC_STATS_ENABLE
+#define NFC_STATS_BEGIN(context, command)			NFC_StatsBegin((context), (command))
+#define NFC_STATS_END(context, valid)				NFC_StatsEnd((context), (valid))
+#define NFC_STATS_ADD(context, counter, amount)		NFC_StatsAdd((context), &(context)->stats.counter, (amount))
+#else
+#define NFC_STATS_BEGIN(context, command)
+#define NFC_STATS_END(context, valid)
+#define NFC_STATS_ADD(context, counter, amount)
+#endif
+
+#if NFC_TRACE_ENABLE
+#define NFC_TRACE_OPEN(context)						NFC_TraceOpen(context)
+#define NFC_TRACE_APPEND(context, bytes, amount, sent)	NFC_TraceAppend((context), (bytes), (amount), (sent))
+#define NFC_TRACE_CLOSE(context)					NFC_TraceClose(context)
+#else
+#define NFC_TRACE_OPEN(context)
+#define NFC_TRACE_APPEND(context, bytes, amount, sent)
+#define NFC_TRACE_CLOSE(context)
+#endif
+
+static const uint8_t pn532ack[6] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
 
 static void NFC_Delay(const uint32_t time);
-static void NFC_ReadData(uint8_t *buffer, uint32_t amount);
-static void NFC_WriteCommand(uint8_t *cmd, uint16_t cmd_length);
-static uint8_t NFC_IsReady(void);
-static uint8_t NFC_WaitReady(const uint16_t timeout);
-static uint8_t NFC_ReadACK(void);
-static uint8_t NFC_SendCommandCheckAck(uint8_t *cmd, const uint16_t cmd_length, const uint16_t timeout);
+static void NFC_Route(NFC_Context *context);
+static void NFC_WaitSetup(NFC_CommInterface *commInterface);
+static void NFC_Select(NFC_Context *context);
+static void NFC_Deselect(NFC_Context *context);
+static void NFC_SendBytes(NFC_Context *context, const uint8_t *buffer, size_t amount);
+static void NFC_ReceiveBytes(NFC_Context *context, uint8_t *buffer, size_t amount);
+static void NFC_ReadData(NFC_Context *context, uint8_t *buffer, uint32_t amount);
+static uint8_t NFC_ReceiveFrame(NFC_Context *context, const uint8_t command, uint8_t *buffer, const uint16_t size, NFC_FrameView *view);
+static uint8_t NFC_ReadFrame(NFC_Context *context, const uint8_t command, uint8_t *buffer, const uint16_t size, NFC_FrameView *view);
+static void NFC_WriteCommand(NFC_Context *context, uint8_t *cmd, uint16_t cmd_length);
+static uint32_t NFC_ExpectedUs(NFC_Context *context);
+static void NFC_StartPolling(NFC_Context *context, const uint32_t expectedUs);
+static uint8_t NFC_ReadStatus(NFC_Context *context);
+static uint8_t NFC_IsReady(NFC_Context *context);
+static uint8_t NFC_PollReady(NFC_Context *context, const uint16_t timeout);
+static uint8_t NFC_WaitReady(NFC_Context *context, const uint16_t timeout);
+static uint8_t NFC_ReadACK(NFC_Context *context);
+static uint8_t NFC_SendCommandCheckAck(NFC_Context *context, uint8_t *cmd, const uint16_t cmd_length, const uint16_t timeout);
+static uint8_t NFC_Exchange(NFC_Context *context, const uint16_t cmd_length, NFC_FrameView *response, const uint16_t timeout);
+static void NFC_EndSelection(NFC_Context *context);
+static uint8_t NFC_ParsePassiveTarget(const NFC_FrameView *view, uint8_t *uid, uint8_t *length_uid);
+static uint8_t NFC_ParseTargets(const NFC_FrameView *view, NFC_Target *targets, uint8_t *found);
+static uint16_t NFC_BuildAutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period);
+static uint8_t NFC_ParseAutoPoll(const NFC_FrameView *view, NFC_AutoPollTarget *targets, uint8_t *found);
+static uint32_t NFC_GetTimeUs(NFC_Context *context);
+#if NFC_STATS_ENABLE
+static void NFC_StatsAdd(NFC_Context *context, uint32_t *counter, const uint32_t amount);
+static void NFC_StatsBegin(NFC_Context *context, const uint8_t command);
+static void NFC_StatsEnd(NFC_Context *context, const uint8_t valid);
+#endif
+#if NFC_TRACE_ENABLE
+static void NFC_TraceCopy(NFC_Trace *trace, uint16_t position, const uint8_t *bytes, size_t amount);
+static uint8_t NFC_TraceReserve(NFC_Trace *trace, const size_t amount);
+static void NFC_TraceOpen(NFC_Context *context);
+static void NFC_TraceAppend(NFC_Context *context, const uint8_t *bytes, size_t amount, const uint8_t sent);
+static void NFC_TraceClose(NFC_Context *context);
+#endif
+
+NFC_ITCM static void NFC_Delay(const uint32_t time)
+{
+	uint32_t startTick = HAL_GetTick();
+	while(HAL_GetTick() - startTick < time);
+}
+
+NFC_ITCM static uint32_t NFC_GetTimeUs(NFC_Context *context)
+{
+	if (context->commInterface->GetTimeUs != NULL)
+	{
+		return context->commInterface->GetTimeUs();
+	}
+
+	return HAL_GetTick() * 1000;
+}
+
+#if NFC_STATS_ENABLE
+NFC_ITCM static void NFC_StatsAdd(NFC_Context *context, uint32_t *counter, const uint32_t amount)
+{
+	// Odd sequence tells readers that statistics are changing
+	context->stats.sequence++;
+	__DMB();
+	*counter += amount;
+	__DMB();
+	context->stats.sequence++;
+}
+
+NFC_ITCM static void NFC_StatsBegin(NFC_Context *context, const uint8_t command)
+{
+	NFC_CommandStats *slot = NULL;
+	uint8_t i;
+
+	// Slot already used by command code or first free slot
+	for (i = 0; i < NFC_STATS_COMMANDS; i++)
+	{
+		if (context->stats.commands[i].count == 0)
+		{
+			if (slot == NULL)
+			{
+				slot = &context->stats.commands[i];
+			}
+		}
+		else if (context->stats.commands[i].command == command)
+		{
+			slot = &context->stats.commands[i];
+			break;
+		}
+	}
+
+	if (slot == NULL)
+	{
+		NFC_StatsAdd(context, &context->stats.untracked, 1);
+	}
+	else if (slot->count == 0)
+	{
+		slot->command = command;
+	}
+
+	context->statsCommand = slot;
+	context->statsStartUs = NFC_GetTimeUs(context);
+}
+
+NFC_ITCM static void NFC_StatsEnd(NFC_Context *context, const uint8_t valid)
+{
+	NFC_CommandStats *slot = context->statsCommand;
+	uint32_t latency, bucket;
+
+	if (slot == NULL)
+	{
+		return;
+	}
+
+	latency = NFC_GetTimeUs(context) - context->statsStartUs;
+
+	// Bucket is the amount of significant bits of latency
+	bucket = 32 - __CLZ(latency);
+	if (bucket >= NFC_STATS_BUCKETS)
+	{
+		bucket = NFC_STATS_BUCKETS - 1;
+	}
+
+	context->stats.sequence++;
+	__DMB();
+
+	slot->count++;
+	slot->errors += valid ? 0 : 1;
+	slot->totalUs += latency;
+	slot->histogram[bucket]++;
+
+	if (latency > slot->maxUs)
+	{
+		slot->maxUs = latency;
+	}
+
+	__DMB();
+	context->stats.sequence++;
+
+	context->statsCommand = NULL;
+}
+#endif
+
+#if NFC_TRACE_ENABLE
+static void NFC_TraceCopy(NFC_Trace *trace, uint16_t position, const uint8_t *bytes, size_t amount)
+{
+	// Records wrap at the end of the ring
+	while (amount--)
+	{
+		trace->data[position] = *bytes++;
+
+		if (++position == NFC_TRACE_SIZE)
+		{
+			position = 0;
+		}
+	}
+}
+
+static uint8_t NFC_TraceReserve(NFC_Trace *trace, const size_t amount)
+{
+	uint16_t length;
+
+	// Drop oldest records until amount fits after the record being written
+	while ((size_t)(NFC_TRACE_SIZE - trace->used - trace->open) < amount)
+	{
+		if (trace->used == 0)
+		{
+			return false;
+		}
+
+		length = trace->data[(trace->head + 8) % NFC_TRACE_SIZE];
+		length |= (uint16_t)trace->data[(trace->head + 9) % NFC_TRACE_SIZE] << 8;
+
+		trace->head = (trace->head + NFC_TRACE_HEADER + length) % NFC_TRACE_SIZE;
+		trace->used -= NFC_TRACE_HEADER + length;
+		trace->dropped++;
+	}
+
+	return true;
+}
+
+static void NFC_TraceOpen(NFC_Context *context)
+{
+	NFC_Trace *trace = context->trace;
+	uint8_t header[NFC_TRACE_HEADER];
+	uint32_t now, wait;
+
+	if (trace == NULL)
+	{
+		return;
+	}
+
+	now = NFC_GetTimeUs(context);
+	wait = now - context->traceEndUs;
+	trace->open = 0;
+
+	if (!NFC_TraceReserve(trace, NFC_TRACE_HEADER))
+	{
+		return;
+	}
+
+	header[0] = (uint8_t)now;
+	header[1] = (uint8_t)(now >> 8);
+	header[2] = (uint8_t)(now >> 16);
+	header[3] = (uint8_t)(now >> 24);
+	header[4] = (uint8_t)wait;
+	header[5] = (uint8_t)(wait >> 8);
+	header[6] = (uint8_t)(wait >> 16);
+	header[7] = (uint8_t)(wait >> 24);
+	header[8] = 0;							// Length is written when record is closed
+	header[9] = 0;
+	header[10] = context->device;
+	header[11] = NFC_TRACE_WRITE;
+
+	NFC_TraceCopy(trace, (trace->head + trace->used) % NFC_TRACE_SIZE, header, NFC_TRACE_HEADER);
+	trace->open = NFC_TRACE_HEADER;
+}
+
+static void NFC_TraceAppend(NFC_Context *context, const uint8_t *bytes, size_t amount, const uint8_t sent)
+{
+	NFC_Trace *trace = context->trace;
+	uint16_t start;
+
+	if (trace == NULL || trace->open == 0)
+	{
+		return;
+	}
+
+	start = (trace->head + trace->used) % NFC_TRACE_SIZE;
+
+	// SPI op is the first byte sent, it gives direction of record and is not stored
+	if (sent && trace->open == NFC_TRACE_HEADER && amount > 0)
+	{
+		trace->data[(start + 11) % NFC_TRACE_SIZE] = (bytes[0] == PN532_SPI_DATAREAD) ? NFC_TRACE_READ : NFC_TRACE_WRITE;
+		bytes++;
+		amount--;
+	}
+
+	// Record is truncated when it does not fit in the whole ring
+	if (amount == 0 || !NFC_TraceReserve(trace, amount))
+	{
+		return;
+	}
+
+	NFC_TraceCopy(trace, (start + trace->open) % NFC_TRACE_SIZE, bytes, amount);
+	trace->open += amount;
+}
+
+static void NFC_TraceClose(NFC_Context *context)
+{
+	NFC_Trace *trace = context->trace;
+	uint16_t start, length;
+
+	if (trace == NULL)
+	{
+		return;
+	}
+
+	context->traceEndUs = NFC_GetTimeUs(context);
+
+	if (trace->open == 0)
+	{
+		return;
+	}
+
+	start = (trace->head + trace->used) % NFC_TRACE_SIZE;
+	length = trace->open - NFC_TRACE_HEADER;
+
+	trace->data[(start + 8) % NFC_TRACE_SIZE] = (uint8_t)length;
+	trace->data[(start + 9) % NFC_TRACE_SIZE] = (uint8_t)(length >> 8);
+
+	trace->used += trace->open;
+	trace->open = 0;
+	trace->records++;
+}
+#endif
+
+NFC_ITCM static void NFC_Route(NFC_Context *context)
+{
+	// Readers sharing the bus are told apart by interface before each access
+	if (context->commInterface->SetDevice != NULL)
+	{
+		context->commInterface->SetDevice(context->device);
+	}
+}
+
+NFC_ITCM static void NFC_WaitSetup(NFC_CommInterface *commInterface)
+{
+	// Wait set up time of PN532, with HAL tick the minimum is 1 mS
+	if (commInterface->DelayUs != NULL)
+	{
+		commInterface->DelayUs(PN532_CS_SETUP_US);
+	}
+	else
+	{
+		NFC_Delay(1);
+	}
+}
+
+NFC_ITCM static void NFC_Select(NFC_Context *context)
+{
+	NFC_CommInterface *commInterface = context->commInterface;
+
+	NFC_Route(context);
+
+	commInterface->SetSelect(true);
+
+	NFC_TRACE_OPEN(context);
+
+	NFC_WaitSetup(commInterface);
+}
+
+NFC_ITCM static void NFC_Deselect(NFC_Context *context)
+{
+	context->commInterface->SetSelect(false);
+
+	NFC_TRACE_CLOSE(context);
+}
+
+NFC_ITCM static void NFC_SendBytes(NFC_Context *context, const uint8_t *buffer, size_t amount)
+{
+	NFC_CommInterface *commInterface = context->commInterface;
+	size_t i;
+
+	NFC_STATS_ADD(context, bytesSent, amount);
+	NFC_TRACE_APPEND(context, buffer, amount, true);
+
+	// Move the whole buffer in one transfer when interface support it
+	if (commInterface->SendBuffer != NULL)
+	{
+		commInterface->SendBuffer(buffer, amount);
+		return;
+	}
+
+	for (i = 0; i < amount; i++)
+	{
+		commInterface->SendByte(buffer[i]);
+	}
+}
+
+NFC_ITCM static void NFC_ReceiveBytes(NFC_Context *context, uint8_t *buffer, size_t amount)
+{
+	NFC_CommInterface *commInterface = context->commInterface;
+	size_t i;
+
+	NFC_STATS_ADD(context, bytesReceived, amount);
+
+	// Move the whole buffer in one transfer when interface support it
+	if (commInterface->ReceiveBuffer != NULL)
+	{
+		commInterface->ReceiveBuffer(buffer, amount);
+	}
+	else
+	{
+		for (i = 0; i < amount; i++)
+		{
+			buffer[i] = commInterface->GetByte();	// put data in buffer at position i
+		}
+	}
+
+	NFC_TRACE_APPEND(context, buffer, amount, false);
+}
+
+NFC_ITCM static void NFC_ReadData(NFC_Context *context, uint8_t *buffer, uint32_t amount)
+{
+	const uint8_t operation = PN532_SPI_DATAREAD;
+
+	// Enable PN532 and wait set up time
+	NFC_Select(context);
+
+	// Send message to PN532 to request information
+	NFC_SendBytes(context, &operation, 1);
+
+	NFC_ReceiveBytes(context, buffer, amount);
+
+	// Disable PN532
+	NFC_Deselect(context);
+
+}
+
+NFC_ITCM static uint8_t NFC_ReceiveFrame(NFC_Context *context, const uint8_t command, uint8_t *buffer, const uint16_t size, NFC_FrameView *view)
+{
+	const uint8_t operation = PN532_SPI_DATAREAD;
+	uint8_t checksum = 0;
+	uint16_t header = PN532_FRAME_HEADER, length, i;
+
+	if (size < PN532_EXTENDED_HEADER)
+	{
+		return false;
+	}
+
+	// Enable PN532 and wait set up time
+	NFC_Select(context);
+
+	// Send message to PN532 to request information
+	NFC_SendBytes(context, &operation, 1);
+
+	// Read preamble, start code and length, the rest of frame is read only when it fits
+	NFC_ReceiveBytes(context, buffer, PN532_FRAME_HEADER);
+
+	if (buffer[0] != PN532_PREAMBLE || buffer[1] != PN532_STARTCODE1 || buffer[2] != PN532_STARTCODE2)
+	{
+		NFC_Deselect(context);
+		return false;
+	}
+
+	if (buffer[3] == 0xFF && buffer[4] == 0xFF)
+	{
+		// Extended frame, 16 bits length and its checksum follow
+		NFC_ReceiveBytes(context, &buffer[PN532_FRAME_HEADER], PN532_EXTENDED_HEADER - PN532_FRAME_HEADER);
+
+		header = PN532_EXTENDED_HEADER;
+		length = ((uint16_t)buffer[5] << 8) | buffer[6];
+
+		if ((uint8_t)(buffer[5] + buffer[6] + buffer[7]) != 0)
+		{
+			NFC_Deselect(context);
+			return false;
+		}
+	}
+	else
+	{
+		length = buffer[3];
+
+		if ((uint8_t)(buffer[3] + buffer[4]) != 0)
+		{
+			NFC_Deselect(context);
+			return false;
+		}
+	}
+
+	if (length < 2 || header + length + PN532_FRAME_TRAILER > size)
+	{
+		NFC_Deselect(context);
+		return false;
+	}
+
+	// Read TFI, data, DCS and postamble
+	NFC_ReceiveBytes(context, &buffer[header], length + PN532_FRAME_TRAILER);
+
+	// Disable PN532
+	NFC_Deselect(context);
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_READ, 0);
+
+	// Frame must come from PN532 and answer the command sent
+	if (buffer[header] != PN532_PN532TOHOST || buffer[header + 1] != (uint8_t)(command + 1))
+	{
+		return false;
+	}
+
+	// Sum of TFI, data and DCS must be zero
+	for (i = 0; i <= length; i++)
+	{
+		checksum += buffer[header + i];
+	}
+
+	if (checksum != 0)
+	{
+		return false;
+	}
+
+	view->data = &buffer[header + 2];
+	view->length = length - 2;	// Skip TFI and response code
+
+	return true;
+}
+
+NFC_ITCM static uint8_t NFC_ReadFrame(NFC_Context *context, const uint8_t command, uint8_t *buffer, const uint16_t size, NFC_FrameView *view)
+{
+	uint8_t valid = NFC_ReceiveFrame(context, command, buffer, size, view);
+
+	// Response ends the command being measured
+	if (!valid)
+	{
+		NFC_STATS_ADD(context, frameErrors, 1);
+	}
+	NFC_STATS_END(context, valid);
+
+	return valid;
+}
+
+NFC_ITCM static void NFC_WriteCommand(NFC_Context *context, uint8_t *cmd, uint16_t cmd_length)
+{
+	uint8_t *frame = context->frame;
+	uint8_t checksum;	// variable to store checksum
+	uint16_t i, position = 0;
+
+	if (cmd_length > PN532_BUFFERSIZE)
+	{
+		return;
+	}
+
+	NFC_STATS_BEGIN(context, cmd[0]);
+
+	context->command = cmd[0];
+
+	cmd_length++;	// increment command length for TFI
+
+	checksum = PN532_PREAMBLE + PN532_STARTCODE1 + PN532_STARTCODE2;
+
+	frame[position++] = PN532_SPI_DATAWRITE;	// inform SPI port of PN532 that data will be written
+	frame[position++] = PN532_PREAMBLE;			// Send preamble
+	frame[position++] = PN532_STARTCODE1;		// Send start of packet 1/2
+	frame[position++] = PN532_STARTCODE2;		// Send start of packet 2/2
+
+	if (cmd_length > PN532_NORMAL_MAXLEN)
+	{
+		frame[position++] = 0xFF;						// Extended frame marker
+		frame[position++] = 0xFF;
+		frame[position++] = (uint8_t)(cmd_length >> 8);	// Send packet length MSB (LENm)
+		frame[position++] = (uint8_t)cmd_length;		// Send packet length LSB (LENl)
+		frame[position++] = ~(uint8_t)((cmd_length >> 8) + cmd_length) + 1;	// Send packet length checksum
+	}
+	else
+	{
+		frame[position++] = cmd_length;				// Send packet length (LEN)
+		frame[position++] = ~cmd_length + 1;		// Send packet length checksum
+	}
+
+	frame[position++] = PN532_HOSTTOPN532;		// Inform PN532 that data direction is from host to PN532 (TFI)
+
+	checksum += PN532_HOSTTOPN532;
+
+	for (i = 0; i < cmd_length-1; i++)
+	{
+		frame[position++] = cmd[i];				// Send data to PN532
+		checksum += cmd[i];
+	}
+
+	frame[position++] = ~checksum;				// Send checksum (DCS)
+	frame[position++] = PN532_POSTAMBLE;		// Send postamble
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_START, cmd[0]);
+
+	// Enable PN532 and wait set up time
+	NFC_Select(context);
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_SELECT, 0);
+
+	NFC_SendBytes(context, frame, position);
+
+	NFC_Deselect(context);
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_WRITE, 0);
+
+	// Time of ACK is not learned, it does not depend on the command
+	context->pollEstimate = NULL;
+	NFC_StartPolling(context, NFC_POLL_ACKUS);
+}
+
+NFC_ITCM static uint32_t NFC_ExpectedUs(NFC_Context *context)
+{
+	NFC_PollEstimate *estimate;
+	uint8_t i;
+
+	if (context->commInterface->GetIRQ != NULL)
+	{
+		return 0;
+	}
+
+	for (i = 0; i < NFC_POLL_COMMANDS; i++)
+	{
+		estimate = &context->pollEstimates[i];
+		if (estimate->readyUs != 0 && estimate->command == context->command)
+		{
+			context->pollEstimate = estimate;
+			return estimate->readyUs;
+		}
+	}
+
+	// New command code takes the oldest estimate and starts from the time of its kind
+	estimate = &context->pollEstimates[context->pollReplace];
+	context->pollReplace = (context->pollReplace + 1) % NFC_POLL_COMMANDS;
+	estimate->command = context->command;
+	estimate->readyUs = 0;
+	context->pollEstimate = estimate;
+
+	// Commands talking with a card take the RF exchange on top of processing
+	switch (context->command)
+	{
+	case PN532_COMMAND_INLISTPASSIVETARGET:
+	case PN532_COMMAND_INAUTOPOLL:
+	case PN532_COMMAND_INDATAEXCHANGE:
+	case PN532_COMMAND_INCOMMUNICATETHRU:
+		return NFC_POLL_RFUS;
+
+	default:
+		return NFC_POLL_COMMANDUS;
+	}
+}
+
+NFC_ITCM static void NFC_StartPolling(NFC_Context *context, const uint32_t expectedUs)
+{
+	uint32_t gap = expectedUs / 32;
+
+	if (context->commInterface->GetIRQ != NULL)
+	{
+		return;
+	}
+
+	if (gap < NFC_POLL_MINUS)
+	{
+		gap = NFC_POLL_MINUS;
+	}
+	else if (gap > NFC_POLL_MAXUS)
+	{
+		gap = NFC_POLL_MAXUS;
+	}
+
+	// Nothing is asked before most of the expected time, then gaps start short
+	context->pollGapUs = gap;
+	context->pollStartUs = NFC_GetTimeUs(context);
+	context->pollBusyUs = context->pollStartUs;
+	context->pollNextUs = context->pollStartUs + expectedUs - expectedUs / 8;
+}
+
+NFC_ITCM static uint8_t NFC_ReadStatus(NFC_Context *context)
+{
+	NFC_CommInterface *commInterface = context->commInterface;
+	const uint8_t operation = PN532_SPI_STATREAD;
+	uint8_t status;
+
+	NFC_STATS_ADD(context, statusReads, 1);
+
+	// Status reads are not traced, replay waits the time they cover
+	commInterface->SetSelect(true);
+	NFC_WaitSetup(commInterface);
+
+	if (commInterface->SendBuffer != NULL)
+	{
+		commInterface->SendBuffer(&operation, 1);
+	}
+	else
+	{
+		commInterface->SendByte(operation);
+	}
+
+	if (commInterface->ReceiveBuffer != NULL)
+	{
+		commInterface->ReceiveBuffer(&status, 1);
+	}
+	else
+	{
+		status = commInterface->GetByte();
+	}
+
+	commInterface->SetSelect(false);
+
+	return (status & PN532_SPI_READY) ? true : false;
+}
+
+NFC_ITCM static uint8_t NFC_IsReady(NFC_Context *context)
+{
+	NFC_PollEstimate *estimate = context->pollEstimate;
+	uint32_t now, taken;
+
+	NFC_Route(context);
+
+	if (context->commInterface->GetIRQ != NULL)
+	{
+		return context->commInterface->GetIRQ() ? true : false;
+	}
+
+	// Without IRQ line PN532 is asked only when the gap of polling is over
+	now = NFC_GetTimeUs(context);
+	if ((int32_t)(now - context->pollNextUs) < 0)
+	{
+		return false;
+	}
+
+	if (NFC_ReadStatus(context))
+	{
+		// Answer came after the last busy read and by now, a quarter of the difference moves the estimate
+		if (estimate != NULL)
+		{
+			taken = (context->pollBusyUs - context->pollStartUs + now - context->pollStartUs) / 2;
+			if (taken == 0)
+			{
+				taken = 1;		// 0 marks a free estimate
+			}
+			if (estimate->readyUs == 0)
+			{
+				estimate->readyUs = taken;
+			}
+			else
+			{
+				estimate->readyUs = estimate->readyUs - estimate->readyUs / 4 + taken / 4;
+			}
+			context->pollEstimate = NULL;
+		}
+
+		return true;
+	}
+
+	// Busy answer, ask later each time the wait goes longer than expected
+	context->pollGapUs += context->pollGapUs / 2;
+	if (context->pollGapUs > NFC_POLL_MAXUS)
+	{
+		context->pollGapUs = NFC_POLL_MAXUS;
+	}
+	context->pollBusyUs = now;
+	context->pollNextUs = NFC_GetTimeUs(context) + context->pollGapUs;
+
+	return false;
+}
+
+NFC_ITCM static uint8_t NFC_PollReady(NFC_Context *context, const uint16_t timeout)
+{
+	NFC_CommInterface *commInterface = context->commInterface;
+	uint32_t startTick, startUs, now, left;
+
+	// Interface can sleep until IRQ signal instead of polling it
+	if (commInterface->WaitIRQ != NULL)
+	{
+		NFC_Route(context);
+		if (commInterface->WaitIRQ(timeout))
+		{
+			return true;
+		}
+	}
+	else if (commInterface->GetIRQ == NULL)
+	{
+		startUs = NFC_GetTimeUs(context);
+
+		// Status is read at the gaps of polling, the last read is done when timeout expires
+		while (true)
+		{
+			if (NFC_IsReady(context))
+			{
+				return true;
+			}
+
+			now = NFC_GetTimeUs(context);
+			if (now - startUs >= (uint32_t)timeout * 1000)
+			{
+				break;
+			}
+
+			left = (uint32_t)timeout * 1000 - (now - startUs);
+			if ((int32_t)(context->pollNextUs - now) > (int32_t)left)
+			{
+				context->pollNextUs = now + left;
+			}
+
+			// Sleep until the next status read instead of asking the clock
+			if ((int32_t)(context->pollNextUs - now) > 0)
+			{
+				if (commInterface->SleepUs != NULL)
+				{
+					commInterface->SleepUs(context->pollNextUs - now);
+				}
+				else if (commInterface->DelayUs != NULL)
+				{
+					commInterface->DelayUs(context->pollNextUs - now);
+				}
+			}
+		}
+	}
+	else
+	{
+		startTick = HAL_GetTick();
+
+		// For as long as the timeout is reached try to detect ready signal from PN532
+		do
+		{
+			if (NFC_IsReady(context))
+			{
+				return true;
+			}
+		} while (HAL_GetTick() - startTick < timeout);
+	}
+
+	return false;
+}
+
+NFC_ITCM static uint8_t NFC_WaitReady(NFC_Context *context, const uint16_t timeout)
+{
+	if (NFC_PollReady(context, timeout))
+	{
+		return true;
+	}
+
+	// Callers give up the command when PN532 does not answer
+	NFC_STATS_ADD(context, timeouts, 1);
+	NFC_STATS_END(context, false);
+
+	return false;
+}
+
+NFC_ITCM static uint8_t NFC_ReadACK(NFC_Context *context)
+{
+	uint8_t ackBuffer[6];		// Array to store read message form PN532
+
+	NFC_ReadData(context, ackBuffer, 6);	// Read message form PN532
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_ACK, 0);
+
+	// compare message with ACK message syntax and return true when ACK is received.
+	if (memcmp(ackBuffer, pn532ack, 6) != 0)
+	{
+		NFC_STATS_ADD(context, ackFailures, 1);
+		NFC_STATS_END(context, false);
+		return false;
+	}
+
+	NFC_StartPolling(context, NFC_ExpectedUs(context));
+
+	return true;
+}
+
+NFC_ITCM static uint8_t NFC_SendCommandCheckAck(NFC_Context *context, uint8_t *cmd, const uint16_t cmd_length, const uint16_t timeout)
+{
+
+	// write the command
+	NFC_WriteCommand(context, cmd, cmd_length);
+
+	// Wait for chip to say its ready!
+	if ( !NFC_WaitReady(context, timeout) )
+	{
+		return false;
+	}
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_WAITACK, 0);
+
+	// read acknowledge
+	if (!NFC_ReadACK(context))
+	{
+		return false;
+	}
+
+	// Wait for chip to say its ready!
+	if ( !NFC_WaitReady(context, timeout) )
+	{
+		return false;
+	}
+
+	NFC_PROFILE_MARK(context, NFC_PHASE_WAITRESPONSE, 0);
+
+	return true;
+}
+
+static uint8_t NFC_Exchange(NFC_Context *context, const uint16_t cmd_length, NFC_FrameView *response, const uint16_t timeout)
+{
+	const uint8_t command = context->buffer[0];
+
+	if (!NFC_SendCommandCheckAck(context, context->buffer, cmd_length, timeout))
+	{
+		return false;
+	}
+
+	if (!NFC_ReadFrame(context, command, context->buffer, PN532_FRAMESIZE, response) || response->length < 1)
+	{
+		return false;
+	}
+
+	// First byte of answer is status, error code is in bits 0 to 5
+	context->status = response->data[0];
+	response->data++;
+	response->length--;
+
+	return (context->status & 0x3F) == 0x00 ? true : false;
+}
+
+static void NFC_EndSelection(NFC_Context *context)
+{
+	// Crypto1 session of the target selected ends with it
+	context->target = 0;
+	context->selection++;
+}
+
+static uint8_t NFC_ParsePassiveTarget(const NFC_FrameView *view, uint8_t *uid, uint8_t *length_uid)
+{
+	/* ISO14443A card response should be in the following format:
+
+	    byte            Description
+	    -------------   ------------------------------------------
+	    b0              Tags Found
+	    b1              Tag Number (only one used in this example)
+	    b2..3           SENS_RES
+	    b4              SEL_RES
+	    b5              NFCID Length
+	    b6..NFCIDLen    NFCID                                      */
+
+	// Test for the number of tags found, the first one is read
+	if (view->length < 6 || view->data[0] == 0)
+	{
+		return false;	// No tags found, end of read, return false
+	}
+
+	// NFCID must be inside the frame and fit in the buffer of caller, triple size UID is rejected
+	if (view->data[5] > view->length - 6 || view->data[5] > NFC_PASSIVE_UIDSIZE)
+	{
+		return false;
+	}
+
+	/* Card appears to be Mifare Classic */
+	*length_uid = view->data[5];	// set value of NFCID length to uidLength
+
+	// Move UID to packet buffer
+	for (uint8_t i=0; i < view->data[5]; i++)
+	{
+		uid[i] = view->data[6+i];
+	}
+
+	return true; // return success as card is read.
+}
+
+static uint8_t NFC_ParseTargets(const NFC_FrameView *view, NFC_Target *targets, uint8_t *found)
+{
+	/* Each 106 kbps type A target of the answer has the format of
+	   NFC_ParsePassiveTarget, followed by ATS when SEL_RES tells the
+	   target is ISO14443-4 compliant:
+
+	    byte            Description
+	    -------------   ------------------------------------------
+	    b0              Tg
+	    b1..2           SENS_RES
+	    b3              SEL_RES
+	    b4              NFCID Length
+	    b5..NFCIDLen    NFCID
+	    ...             ATS, its first byte is its length           */
+
+	const uint8_t *data = view->data;
+	uint16_t position = 1;
+	uint8_t i, length;
+	NFC_Target *target;
+
+	if (view->length < 1 || data[0] > PN532_AUTOPOLL_MAXTARGETS)
+	{
+		return false;
+	}
+
+	for (i = 0; i < data[0]; i++)
+	{
+		target = &targets[i];
+
+		// Fixed part and NFCID must be inside the frame
+		if (position + 5 > view->length)
+		{
+			return false;
+		}
+
+		length = data[position + 4];
+
+		if (length > NFC_TARGET_UIDSIZE || position + 5 + length > view->length)
+		{
+			return false;
+		}
+
+		target->number = data[position];
+		target->sensRes[0] = data[position + 1];
+		target->sensRes[1] = data[position + 2];
+		target->selRes = data[position + 3];
+		target->uidLength = length;
+		memcpy(target->uid, &data[position + 5], length);
+		position += 5 + length;
+
+		if ((target->selRes & 0x20) && position < view->length)
+		{
+			position += (data[position] > 0) ? data[position] : 1;
+		}
+	}
+
+	*found = data[0];
+
+	return (*found > 0) ? true : false;
+}
+
+static uint16_t NFC_BuildAutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period)
+{
+	if (typeCount == 0 || typeCount > PN532_AUTOPOLL_MAXTYPES || typeCount + 3 > PN532_BUFFERSIZE ||
+		pollCount == 0 || period == 0 || period > 15)
+	{
+		return 0;
+	}
+
+	context->buffer[0] = PN532_COMMAND_INAUTOPOLL;
+	context->buffer[1] = pollCount;		// PollNr
+	context->buffer[2] = period;		// Period
+	memcpy(&context->buffer[3], types, typeCount);
+
+	return typeCount + 3;
+}
+
+static uint8_t NFC_ParseAutoPoll(const NFC_FrameView *view, NFC_AutoPollTarget *targets, uint8_t *found)
+{
+	/* InAutoPoll response is in the following format:
+
+	    byte            Description
+	    -------------   ------------------------------------------
+	    b0              Tags Found
+	    b1              Type of first target
+	    b2              Length of its data (Tg included)
+	    b3              Tg
+	    b4..            Data of target, as InListPassiveTarget for its baud rate
+	    ...             Second target with the same layout              */
+
+	const uint8_t *data = view->data;
+	uint16_t position = 1;
+	uint8_t i, offset, uidLength;
+	NFC_AutoPollTarget *target;
+
+	if (view->length < 1 || data[0] > PN532_AUTOPOLL_MAXTARGETS)
+	{
+		return false;
+	}
+
+	for (i = 0; i < data[0]; i++)
+	{
+		target = &targets[i];
+
+		// Type, length and Tg must be inside the frame, and the data of the length
+		if (position + 3 > view->length || data[position + 1] < 1 || position + 2 + data[position + 1] > view->length)
+		{
+			return false;
+		}
+
+		target->type = data[position];
+		target->number = data[position + 2];
+		target->data = &data[position + 3];
+		target->length = data[position + 1] - 1;
+		position += 2 + data[position + 1];
+
+		// UID position depends on the technology of the type
+		switch (target->type)
+		{
+		case PN532_AUTOPOLL_GENERIC106:
+		case PN532_AUTOPOLL_MIFARE:
+		case PN532_AUTOPOLL_ISO14443_4A:
+			offset = 4;			// SENS_RES (2), SEL_RES, NFCID length
+			uidLength = (target->length > 3) ? target->data[3] : 0;
+			break;
+
+		case PN532_AUTOPOLL_GENERIC212:
+		case PN532_AUTOPOLL_GENERIC424:
+		case PN532_AUTOPOLL_FELICA212:
+		case PN532_AUTOPOLL_FELICA424:
+			offset = 2;			// POL_RES length, response code
+			uidLength = 8;
+			break;
+
+		case PN532_AUTOPOLL_ISO14443B:
+		case PN532_AUTOPOLL_ISO14443_4B:
+			offset = 1;			// ATQB starts with 0x50
+			uidLength = 4;
+			break;
+
+		case PN532_AUTOPOLL_JEWEL:
+			offset = 2;			// SENS_RES (2)
+			uidLength = 4;
+			break;
+
+		default:
+			offset = 0;			// DEP targets start with NFCID3 of ATR_RES
+			uidLength = 10;
+			break;
+		}
+
+		if (offset + uidLength > target->length)
+		{
+			uidLength = 0;
+		}
+
+		target->uid = &target->data[offset];
+		target->uidLength = uidLength;
+	}
+
+	*found = data[0];
+
+	return true;
+}
+
+uint8_t NFC_CommInit(NFC_Context *context, NFC_CommInterface *interface, const uint8_t device)
+{
+	if (context == NULL || interface == NULL)
+	{
+		return false;
+	}
+
+	// Each direction needs buffer function or single byte function as fallback
+	if ((interface->SendBuffer == NULL && interface->SendByte == NULL) ||
+		(interface->ReceiveBuffer == NULL && interface->GetByte == NULL))
+	{
+		return false;
+	}
+
+	memset(context, 0, sizeof(NFC_Context));
+	context->commInterface = interface;
+	context->device = device;
+	context->state = NFC_COMMAND_IDLE;
+	return true;
+}
+
+NFC_ITCM void NFC_StartCommand(NFC_Context *context, const uint16_t cmd_length, const uint16_t timeout)
+{
+	context->command = context->buffer[0];
+	context->timeout = timeout;
+	context->response.data = NULL;
+	context->response.length = 0;
+
+	NFC_WriteCommand(context, context->buffer, cmd_length);
+
+	context->startTick = HAL_GetTick();
+	context->state = NFC_COMMAND_WAITACK;
+}
+
+NFC_ITCM uint8_t NFC_ProcessCommand(NFC_Context *context)
+{
+	switch (context->state)
+	{
+	case NFC_COMMAND_WAITACK:
+		if (NFC_IsReady(context))
+		{
+			NFC_PROFILE_MARK(context, NFC_PHASE_WAITACK, 0);
+
+			// ACK is read as soon as it is ready, then the answer is waited with a new timeout
+			context->state = NFC_ReadACK(context) ? NFC_COMMAND_WAITRESPONSE : NFC_COMMAND_ERROR;
+			context->startTick = HAL_GetTick();
+		}
+		else if (HAL_GetTick() - context->startTick >= ((context->timeout == NFC_TIMEOUT_NONE) ? NFC_ACK_TIMEOUT : context->timeout))
+		{
+			NFC_STATS_ADD(context, timeouts, 1);
+			NFC_STATS_END(context, false);
+			context->state = NFC_COMMAND_ERROR;
+		}
+		break;
+
+	case NFC_COMMAND_WAITRESPONSE:
+		if (NFC_IsReady(context))
+		{
+			NFC_PROFILE_MARK(context, NFC_PHASE_WAITRESPONSE, 0);
+
+			if (NFC_ReadFrame(context, context->command, context->buffer, PN532_FRAMESIZE, &context->response))
+			{
+				context->state = NFC_COMMAND_DONE;
+			}
+			else
+			{
+				context->state = NFC_COMMAND_ERROR;
+			}
+		}
+		else if (context->timeout != NFC_TIMEOUT_NONE && HAL_GetTick() - context->startTick >= context->timeout)
+		{
+			NFC_STATS_ADD(context, timeouts, 1);
+			NFC_STATS_END(context, false);
+			context->state = NFC_COMMAND_ERROR;
+		}
+		break;
 
-static void NFC_Delay(const uint32_t time)
-{
-	uint32_t startTick = HAL_GetTick();
-	while(HAL_GetTick() - startTick < time);
+	default:
+		break;
+	}
+
+	return context->state;
 }
 
-static void NFC_ReadData(uint8_t *buffer, uint32_t amount)
+uint8_t NFC_WaitCommand(NFC_Context *context)
 {
-	uint32_t i;
+	uint32_t timeout, elapsed;
 
-	// Enable PN532 and wait 1 mS
-	commInterface->SetSelect(true);
-	NFC_Delay(1);
+	while (context->state == NFC_COMMAND_WAITACK || context->state == NFC_COMMAND_WAITRESPONSE)
+	{
+		if (context->timeout == NFC_TIMEOUT_NONE && context->state == NFC_COMMAND_WAITRESPONSE)
+		{
+			// Without limit the answer is waited again and again, no wait is a timeout
+			if (NFC_PollReady(context, UINT16_MAX))
+			{
+				NFC_ProcessCommand(context);
+			}
+			continue;
+		}
 
-	// Send message to PN532 to request information
-	commInterface->SendByte(PN532_SPI_DATAREAD);
+		timeout = (context->timeout == NFC_TIMEOUT_NONE) ? NFC_ACK_TIMEOUT : context->timeout;
 
-	for (i = 0; i < amount; i++)
+		// Time of the step already spent is not waited again
+		elapsed = HAL_GetTick() - context->startTick;
+
+		if (elapsed >= timeout)
+		{
+			// Reads what is ready or counts the timeout
+			NFC_ProcessCommand(context);
+		}
+		else if (NFC_WaitReady(context, timeout - elapsed))
+		{
+			NFC_ProcessCommand(context);
+		}
+		else
+		{
+			// Timeout was counted while waiting
+			context->state = NFC_COMMAND_ERROR;
+		}
+	}
+
+	return context->state;
+}
+
+NFC_ITCM uint32_t NFC_GetPollDelayUs(NFC_Context *context)
+{
+	int32_t left;
+
+	if (context->commInterface->GetIRQ != NULL ||
+		(context->state != NFC_COMMAND_WAITACK && context->state != NFC_COMMAND_WAITRESPONSE))
 	{
-		buffer[i] = commInterface->GetByte();	// put data in buffer at position i
+		return 0;
 	}
 
-	// Disable PN532
-	commInterface->SetSelect(false);
+	left = (int32_t)(context->pollNextUs - NFC_GetTimeUs(context));
 
+	return (left > 0) ? (uint32_t)left : 0;
 }
 
-static void NFC_WriteCommand(uint8_t *cmd, uint16_t cmd_length)
+uint32_t NFC_GetFirmwareVersion(NFC_Context *context)
 {
-	uint8_t checksum;	// variable to store checksum
-	uint16_t i;
+	uint32_t response = 0;
+	NFC_FrameView view;
 
-	cmd_length++;	// increment command length for TFI
+	context->buffer[0] = PN532_COMMAND_GETFIRMWAREVERSION;	// Set buffer position 0 with command
 
-	// Enable PN532 and wait 1 mS
-	commInterface->SetSelect(true);
-	NFC_Delay(1);
+	// Send command with length of 1 byte, when result is false byte is not send.
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 1, 2))
+	{
+		return false;
+	}
 
-	checksum = PN532_PREAMBLE + PN532_STARTCODE1 + PN532_STARTCODE2;
+	// Data was successfully send now retrieve data read data packet
+	if (!NFC_ReadFrame(context, PN532_COMMAND_GETFIRMWAREVERSION, context->buffer, PN532_FRAMESIZE, &view) || view.length < 3)
+	{
+		return false;
+	}
 
-	commInterface->SendByte(PN532_SPI_DATAWRITE);	// inform SPI port of PN532 that data will be written
-	commInterface->SendByte(PN532_PREAMBLE);		// Send preamble
-	commInterface->SendByte(PN532_STARTCODE1);		// Send start of packet 1/2
-	commInterface->SendByte(PN532_STARTCODE2);		// Send start of packet 2/2
-	commInterface->SendByte(cmd_length);			// Send packet length (LEN)
-	commInterface->SendByte(~cmd_length + 1);		// Send packet length checksum
-	commInterface->SendByte(PN532_HOSTTOPN532);		// Inform PN532 that data direction is from host to PN532 (TFI)
+	/* Shift relevant data from response in to uint32_t, the response
+	 * code takes the MSB followed by IC, Ver and Rev.
+	 */
+	 response = PN532_COMMAND_GETFIRMWAREVERSION + 1;	// Response code
+	 response <<= 8;									// Shift response 8 bits left
+	 response |= view.data[0];							// Operation OR IC with response
+	 response <<= 8;									// Shift response 8 bits left
+	 response |= view.data[1];							// Operation OR Ver with response
+	 response <<= 8;									// Shift response 8 bits left
+	 response |= view.data[2];							// Operation OR Rev with response
 
-	checksum += PN532_HOSTTOPN532;
+	 return response;
+}
 
-	for (i = 0; i < cmd_length-1; i++)
+uint8_t NFC_Diagnose(NFC_Context *context, const uint8_t *data, const uint16_t length, const uint16_t timeout)
+{
+	NFC_FrameView view;
+
+	if (length > PN532_BUFFERSIZE - 2)
 	{
-		commInterface->SendByte(cmd[i]);			// Send data to PN532
-		checksum += cmd[i];
+		return false;
 	}
 
-	commInterface->SendByte(~checksum);				// Send checksum (DCS)
-	commInterface->SendByte(PN532_POSTAMBLE);		// Send postamble
+	context->buffer[0] = PN532_COMMAND_DIAGNOSE;
+	context->buffer[1] = 0x00;		// NumTst: communication line test
+	memcpy(&context->buffer[2], data, length);
 
-	commInterface->SetSelect(false);
+	if (!NFC_SendCommandCheckAck(context, context->buffer, length + 2, timeout))
+	{
+		return false;
+	}
+
+	// Answer is NumTst followed by the data
+	if (!NFC_ReadFrame(context, PN532_COMMAND_DIAGNOSE, context->buffer, PN532_FRAMESIZE, &view) ||
+		view.length != length + 1 || view.data[0] != 0x00)
+	{
+		return false;
+	}
+
+	return memcmp(&view.data[1], data, length) == 0 ? true : false;
 }
 
-static uint8_t NFC_IsReady(void)
+uint8_t NFC_SetSerialBaudRate(NFC_Context *context, const uint8_t rate)
 {
-	if( !commInterface->GetIRQ() )
+	NFC_FrameView view;
+	uint8_t *frame = context->frame;
+
+	if (rate > PN532_HSU_BAUD_1288000)
+	{
+		return false;
+	}
+
+	context->buffer[0] = PN532_COMMAND_SETSERIALBAUDRATE;
+	context->buffer[1] = rate;
+
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 2, 2))
+	{
+		return false;
+	}
+
+	// Answer has no data, it only tells the command was accepted
+	if (!NFC_ReadFrame(context, PN532_COMMAND_SETSERIALBAUDRATE, context->buffer, PN532_FRAMESIZE, &view))
 	{
 		return false;
 	}
 
+	// PN532 changes its rate after the ACK of host, which still goes at the old rate
+	frame[0] = PN532_SPI_DATAWRITE;
+	memcpy(&frame[1], pn532ack, sizeof(pn532ack));
+
+	NFC_Select(context);
+	NFC_SendBytes(context, frame, sizeof(pn532ack) + 1);
+	NFC_Deselect(context);
+
 	return true;
 }
 
-static uint8_t NFC_WaitReady(const uint16_t timeout)
+uint8_t NFC_SAMConfig(NFC_Context *context)
 {
-	uint32_t startTick = HAL_GetTick();
+	NFC_FrameView view;
 
-	// For as long as the timeout is reached try to detect ready signal from PN532
-	do
+	context->buffer[0] = PN532_COMMAND_SAMCONFIGURATION;
+	context->buffer[1] = 0x01;		// Normal Mode
+	context->buffer[2] = 0x14;		// Timeout 50ms * 20 = 1 second
+	context->buffer[3] = 0x01;		// P70_IRQ used
+
+	// send message
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 4, 2))
 	{
-		if (NFC_IsReady())
-		{
-			return true;
-		}
-	} while (HAL_GetTick() - startTick < timeout);
+		return false;
+	}
 
-	return false;
+	// Read data, response code is checked when frame is read
+	return NFC_ReadFrame(context, PN532_COMMAND_SAMCONFIGURATION, context->buffer, PN532_FRAMESIZE, &view);
 }
 
-static uint8_t NFC_ReadACK(void)
+uint8_t NFC_SetPassiveActivationRetries(NFC_Context *context, uint8_t maxRetries)
 {
-	uint8_t ackBuffer[6];		// Array to store read message form PN532
+	NFC_FrameView view;
 
-	NFC_ReadData(ackBuffer, 6);	// Read message form PN532
+	context->buffer[0] = PN532_COMMAND_RFCONFIGURATION;
+	context->buffer[1] = 0x05;		// Config item 5 (MaxRetries)
+	context->buffer[2] = 0xFF;		// MxRtyATR (default = 0xFF)
+	context->buffer[3] = 0x01;		// MxRtyPSL (default = 0x01)
+	context->buffer[4] = maxRetries;
 
-	// compare message with ACK message syntax and return true when ACK is received.
-	return !strncmp((const char *)ackBuffer, (const char *)pn532ack, 6) ? true : false;
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 5, 2))
+	{
+		return false;
+	}
+
+	// Read response to leave PN532 ready for next command
+	return NFC_ReadFrame(context, PN532_COMMAND_RFCONFIGURATION, context->buffer, PN532_FRAMESIZE, &view);
 }
 
-static uint8_t NFC_SendCommandCheckAck(uint8_t *cmd, const uint16_t cmd_length, const uint16_t timeout)
+uint8_t NFC_ReadPassiveTargetID(NFC_Context *context, const uint8_t card_Baudrate, uint8_t *uid, uint8_t *length_uid, const uint16_t timeout)
 {
+	NFC_FrameView view;
 
-	// write the command
-	NFC_WriteCommand(cmd, cmd_length);
+	context->buffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+	context->buffer[1] = 0x01;	// Maximum 1 card at once (We can set a 0x02 as maximum)
+	context->buffer[2] = card_Baudrate;
 
-	// Wait for chip to say its ready!
-	if ( !NFC_WaitReady(timeout) )
+	// Send command, command length and timeout.
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 3, timeout))
+	{
+		return false; // No cards read
+	}
+
+	// Wait for a card to enter the field (only possible with I2C)
+	if (!NFC_WaitReady(context, timeout))
 	{
 		return false;
 	}
 
-	// read acknowledge
-	if (!NFC_ReadACK())
+	NFC_PROFILE_MARK(context, NFC_PHASE_WAITRESPONSE, 0);
+
+	// Read data of packet
+	if (!NFC_ReadFrame(context, PN532_COMMAND_INLISTPASSIVETARGET, context->buffer, PN532_FRAMESIZE, &view))
 	{
 		return false;
 	}
 
-	// Wait for chip to say its ready!
-	if ( !NFC_WaitReady(timeout) )
+	NFC_EndSelection(context);
+
+	if (!NFC_ParsePassiveTarget(&view, uid, length_uid))
 	{
 		return false;
 	}
 
+	context->target = 1;
 	return true;
 }
 
+void NFC_StartReadPassiveTargetID(NFC_Context *context, const uint8_t card_Baudrate, const uint16_t timeout)
+{
+	context->buffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+	context->buffer[1] = 0x01;	// Maximum 1 card at once
+	context->buffer[2] = card_Baudrate;
 
+	NFC_StartCommand(context, 3, timeout);
+}
 
-uint8_t NFC_CommInit(NFC_CommInterface *interface)
+uint8_t NFC_GetPassiveTargetID(NFC_Context *context, uint8_t *uid, uint8_t *length_uid)
 {
-	if (interface == NULL)
+	if (context->state != NFC_COMMAND_DONE || context->command != PN532_COMMAND_INLISTPASSIVETARGET)
+	{
+		return false;
+	}
+
+	NFC_EndSelection(context);
+
+	if (!NFC_ParsePassiveTarget(&context->response, uid, length_uid))
 	{
 		return false;
 	}
 
-	commInterface = interface;
+	context->target = 1;
 	return true;
 }
 
-uint32_t NFC_GetFirmwareVersion(void)
+uint8_t NFC_ListPassiveTargets(NFC_Context *context, const uint8_t maxTargets, NFC_Target *targets, uint8_t *found, const uint16_t timeout)
 {
-	uint32_t response = 0;
-	uint8_t offset = 0;
+	NFC_FrameView view;
+
+	if (maxTargets == 0 || maxTargets > PN532_AUTOPOLL_MAXTARGETS)
+	{
+		return false;
+	}
 
-	pn532_buffer[0] = PN532_COMMAND_GETFIRMWAREVERSION;	// Set buffer position 0 with command
+	context->buffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+	context->buffer[1] = maxTargets;
+	context->buffer[2] = PN532_MIFARE_ISO14443A;
 
-	// Send command with length of 1 byte, when result is false byte is not send.
-	if (!NFC_SendCommandCheckAck(pn532_buffer, 1, 2))
+	// PN532 is ready when the anticollision of every target is over
+	if (!NFC_SendCommandCheckAck(context, context->buffer, 3, timeout))
 	{
 		return false;
 	}
 
-	// Data was successfully send now retrieve data read data packet
-	NFC_ReadData(pn532_buffer, 12);
+	if (!NFC_ReadFrame(context, PN532_COMMAND_INLISTPASSIVETARGET, context->buffer, PN532_FRAMESIZE, &view))
+	{
+		return false;
+	}
 
-	// When buffer is not equal firmware version return
-	if (strncmp((char *)pn532_buffer, (char *)pn532response_firmwarevers, 6) != 0)
+	// Targets before the last one were halted to activate the next, the last stays selected
+	NFC_EndSelection(context);
+
+	if (!NFC_ParseTargets(&view, targets, found))
 	{
 		return false;
 	}
 
+	context->target = *found;
+	return true;
+}
 
-	/* Shift relevant data from response in to uint32_t,
-	 * while SPI is used though conditional operator select
-	 * a shift of 6 positions
-	 */
-	 offset = 6;	 						// Skip a response byte when using I2C to ignore extra data.
-	 response = pn532_buffer[offset++];		// Position 6 of pn532_packetbuffer into response
-	 response <<= 8;							// Shift response 8 bits left
-	 response |= pn532_buffer[offset++];	// Operation OR position 7 of pn532_packetbuffer with response
-	 response <<= 8;							// Shift response 8 bits left
-	 response |= pn532_buffer[offset++];	// Operation OR position 8 of pn532_packetbuffer with response
-	 response <<= 8;							// Shift response 8 bits left
-	 response |= pn532_buffer[offset];		// Operation OR position 9 of pn532_packetbuffer with response
+uint8_t NFC_StartListPassiveTargets(NFC_Context *context, const uint8_t maxTargets, const uint16_t timeout)
+{
+	if (maxTargets == 0 || maxTargets > PN532_AUTOPOLL_MAXTARGETS)
+	{
+		return false;
+	}
 
-	 return response;
+	context->buffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
+	context->buffer[1] = maxTargets;
+	context->buffer[2] = PN532_MIFARE_ISO14443A;
+
+	NFC_StartCommand(context, 3, timeout);
+
+	return true;
 }
 
-uint8_t NFC_SAMConfig(void)
+uint8_t NFC_GetPassiveTargets(NFC_Context *context, NFC_Target *targets, uint8_t *found)
 {
-	pn532_buffer[0] = PN532_COMMAND_SAMCONFIGURATION;
-	pn532_buffer[1] = 0x01;		// Normal Mode
-	pn532_buffer[2] = 0x14;		// Timeout 50ms * 20 = 1 second
-	pn532_buffer[3] = 0x01;		// P70_IRQ used
+	if (context->state != NFC_COMMAND_DONE || context->command != PN532_COMMAND_INLISTPASSIVETARGET)
+	{
+		return false;
+	}
 
-	// send message
-	if (!NFC_SendCommandCheckAck(pn532_buffer, 4, 2))
+	NFC_EndSelection(context);
+
+	if (!NFC_ParseTargets(&context->response, targets, found))
+	{
+		return false;
+	}
+
+	context->target = *found;
+	return true;
+}
+
+uint8_t NFC_AutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period, NFC_AutoPollTarget *targets, uint8_t *found, const uint16_t timeout)
+{
+	NFC_FrameView view;
+	uint16_t length = NFC_BuildAutoPoll(context, types, typeCount, pollCount, period);
+
+	if (length == 0)
+	{
+		return false;
+	}
+
+	// PN532 is ready once a target is found or every poll is done
+	if (!NFC_SendCommandCheckAck(context, context->buffer, length, timeout))
+	{
+		return false;
+	}
+
+	if (!NFC_ReadFrame(context, PN532_COMMAND_INAUTOPOLL, context->buffer, PN532_FRAMESIZE, &view))
 	{
 		return false;
 	}
 
-	// Read data
-	NFC_ReadData(pn532_buffer, 8);
+	NFC_EndSelection(context);
+
+	if (!NFC_ParseAutoPoll(&view, targets, found))
+	{
+		return false;
+	}
 
-	return (pn532_buffer[6] == 0x15) ? true : false;
+	context->target = *found;
+	return true;
 }
 
-uint8_t NFC_SetPassiveActivationRetries(uint8_t maxRetries)
+uint8_t NFC_StartAutoPoll(NFC_Context *context, const uint8_t *types, const uint8_t typeCount, const uint8_t pollCount, const uint8_t period, const uint16_t timeout)
 {
-	pn532_buffer[0] = PN532_COMMAND_RFCONFIGURATION;
-	pn532_buffer[1] = 0x05;		// Config item 5 (MaxRetries)
-	pn532_buffer[2] = 0xFF;		// MxRtyATR (default = 0xFF)
-	pn532_buffer[3] = 0x01;		// MxRtyPSL (default = 0x01)
-	pn532_buffer[4] = maxRetries;
+	uint16_t length = NFC_BuildAutoPoll(context, types, typeCount, pollCount, period);
 
-	if (!NFC_SendCommandCheckAck(pn532_buffer, 5, 2))
+	if (length == 0)
 	{
 		return false;
 	}
 
+	NFC_StartCommand(context, length, timeout);
+
 	return true;
 }
 
-uint8_t NFC_ReadPassiveTargetID(const uint8_t card_Baudrate, uint8_t *uid, uint8_t *length_uid, const uint16_t timeout)
+uint8_t NFC_GetAutoPollTargets(NFC_Context *context, NFC_AutoPollTarget *targets, uint8_t *found)
 {
-	pn532_buffer[0] = PN532_COMMAND_INLISTPASSIVETARGET;
-	pn532_buffer[1] = 0x01;	// Maximum 1 card at once (We can set a 0x02 as maximum)
-	pn532_buffer[2] = card_Baudrate;
+	if (context->state != NFC_COMMAND_DONE || context->command != PN532_COMMAND_INAUTOPOLL)
+	{
+		return false;
+	}
 
-	// Send command, command length and timeout.
-	if (!NFC_SendCommandCheckAck(pn532_buffer, 3, timeout))
+	NFC_EndSelection(context);
+
+	if (!NFC_ParseAutoPoll(&context->response, targets, found))
 	{
-		return false; // No cards read
+		return false;
 	}
 
-	// Wait for a card to enter the field (only possible with I2C)
-	if (!NFC_WaitReady(timeout))
+	context->target = *found;
+	return true;
+}
+
+uint8_t NFC_InDataExchange(NFC_Context *context, const uint8_t target, const uint8_t *data, const uint16_t length, NFC_FrameView *response, const uint16_t timeout)
+{
+	if (length > PN532_BUFFERSIZE - 2)
 	{
 		return false;
 	}
 
-	// Read data of packet
-	NFC_ReadData(pn532_buffer, 20);
+	context->buffer[0] = PN532_COMMAND_INDATAEXCHANGE;
+	context->buffer[1] = target;
+	memcpy(&context->buffer[2], data, length);
 
-	/* ISO14443A card response should be in the following format:
+	// PN532 selects the target before the exchange when it is not the current one
+	if (target != context->target)
+	{
+		NFC_EndSelection(context);
+		context->target = target;
+	}
 
-	    byte            Description
-	    -------------   ------------------------------------------
-	    b0..6           Frame header and preamble
-	    b7              Tags Found
-	    b8              Tag Number (only one used in this example)
-	    b9..10          SENS_RES
-	    b11             SEL_RES
-	    b12             NFCID Length
-	    b13..NFCIDLen   NFCID                                      */
+	return NFC_Exchange(context, length + 2, response, timeout);
+}
+
+uint8_t NFC_StartInDataExchange(NFC_Context *context, const uint8_t target, const uint8_t *data, const uint16_t length, const uint16_t timeout)
+{
+	if (length > PN532_BUFFERSIZE - 2)
+	{
+		return false;
+	}
 
-	// Test for the number of tags found. Should be 1!
-	if (pn532_buffer[7] != 1)
+	context->buffer[0] = PN532_COMMAND_INDATAEXCHANGE;
+	context->buffer[1] = target;
+	memcpy(&context->buffer[2], data, length);
+
+	if (target != context->target)
 	{
-		return false;	// No tags found, end of read, return false
+		NFC_EndSelection(context);
+		context->target = target;
 	}
 
-	/* Card appears to be Mifare Classic */
-	*length_uid = pn532_buffer[12];	// set value of NFCID length to uidLength
+	NFC_StartCommand(context, length + 2, timeout);
 
-	// Move UID to packet buffer
-	for (uint8_t i=0; i < pn532_buffer[12]; i++)
+	return true;
+}
+
+uint8_t NFC_GetInDataExchange(NFC_Context *context, NFC_FrameView *response)
+{
+	if (context->state != NFC_COMMAND_DONE || context->command != PN532_COMMAND_INDATAEXCHANGE ||
+		context->response.length < 1)
 	{
-		uid[i] = pn532_buffer[13+i];
+		return false;
 	}
 
-	return true; // return success as card is read.
+	// Status byte goes out of the view as in NFC_Exchange
+	context->status = context->response.data[0];
+	response->data = context->response.data + 1;
+	response->length = context->response.length - 1;
+
+	return (context->status & 0x3F) == 0x00 ? true : false;
+}
+
+uint8_t NFC_InCommunicateThru(NFC_Context *context, const uint8_t *data, const uint16_t length, NFC_FrameView *response, const uint16_t timeout)
+{
+	if (length > PN532_BUFFERSIZE - 1)
+	{
+		return false;
+	}
+
+	context->buffer[0] = PN532_COMMAND_INCOMMUNICATETHRU;
+	memcpy(&context->buffer[1], data, length);
+
+	return NFC_Exchange(context, length + 1, response, timeout);
+}
+
+uint8_t NFC_InSelect(NFC_Context *context, const uint8_t target, const uint16_t timeout)
+{
+	NFC_FrameView view;
+
+	context->buffer[0] = PN532_COMMAND_INSELECT;
+	context->buffer[1] = target;
+
+	// Selection of the new target ends the one of the current target
+	NFC_EndSelection(context);
+
+	if (!NFC_Exchange(context, 2, &view, timeout))
+	{
+		return false;
+	}
+
+	context->target = target;
+	return true;
+}
+
+uint8_t NFC_InDeselect(NFC_Context *context, const uint8_t target, const uint16_t timeout)
+{
+	NFC_FrameView view;
+
+	context->buffer[0] = PN532_COMMAND_INDESELECT;
+	context->buffer[1] = target;
+
+	if (target == NFC_TARGET_ALL || target == context->target)
+	{
+		NFC_EndSelection(context);
+	}
+
+	return NFC_Exchange(context, 2, &view, timeout);
+}
+
+uint8_t NFC_InRelease(NFC_Context *context, const uint8_t target, const uint16_t timeout)
+{
+	NFC_FrameView view;
+
+	context->buffer[0] = PN532_COMMAND_INRELEASE;
+	context->buffer[1] = target;
+
+	if (target == NFC_TARGET_ALL || target == context->target)
+	{
+		NFC_EndSelection(context);
+	}
+
+	return NFC_Exchange(context, 2, &view, timeout);
+}
+
+uint8_t NFC_GetLastStatus(NFC_Context *context)
+{
+	return context->status;
+}
+
+#if NFC_STATS_ENABLE
+uint8_t NFC_GetStats(NFC_Context *context, NFC_Stats *stats)
+{
+	uint32_t sequence = context->stats.sequence;
+
+	// Driver is in the middle of an update
+	if (sequence & 1)
+	{
+		return false;
+	}
+
+	__DMB();
+	memcpy(stats, &context->stats, sizeof(NFC_Stats));
+	__DMB();
+
+	// Copy is valid only when no update started while it was taken
+	return context->stats.sequence == sequence ? true : false;
+}
+
+void NFC_ResetStats(NFC_Context *context)
+{
+	const size_t start = offsetof(NFC_Stats, ackFailures);
+
+	context->stats.sequence++;
+	__DMB();
+	memset((uint8_t *)&context->stats + start, 0, sizeof(NFC_Stats) - start);
+	__DMB();
+	context->stats.sequence++;
+
+	context->statsCommand = NULL;
+}
+#endif
+
+#if NFC_TRACE_ENABLE
+void NFC_InitTrace(NFC_Trace *trace)
+{
+	memset(trace, 0, sizeof(NFC_Trace));
+}
+
+void NFC_SetTrace(NFC_Context *context, NFC_Trace *trace)
+{
+	context->trace = trace;
+	context->traceEndUs = NFC_GetTimeUs(context);
 }
 
+void NFC_DumpTrace(const NFC_Trace *trace, void (*write)(const uint8_t *, size_t))
+{
+	static const uint8_t magic[4] = {'N', 'F', 'C', 'T'};
+	uint16_t first = NFC_TRACE_SIZE - trace->head;
+
+	write(magic, sizeof(magic));
 
+	// Oldest records are at head, they can wrap at the end of the ring
+	if (trace->used <= first)
+	{
+		write(&trace->data[trace->head], trace->used);
+	}
+	else
+	{
+		write(&trace->data[trace->head], first);
+		write(trace->data, trace->used - first);
+	}
+}
+#endif
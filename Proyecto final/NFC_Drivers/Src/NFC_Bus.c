@@ -0,0 +1,103 @@
+/*
+ * NFC_Bus.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_Bus.h"
+#include <string.h>
+
+#define true	(1)
+#define false	(0)
+
+void NFC_Bus_Init(NFC_Bus *bus, void (*idle)(void))
+{
+	memset(bus, 0, sizeof(NFC_Bus));
+	bus->Idle = idle;
+}
+
+void NFC_Bus_SetSleep(NFC_Bus *bus, void (*sleep)(void))
+{
+	bus->Sleep = sleep;
+}
+
+uint8_t NFC_Bus_Add(NFC_Bus *bus, NFC_Context *context)
+{
+	if (context == NULL || bus->count >= NFC_BUS_MAXREADERS)
+	{
+		return false;
+	}
+
+	bus->readers[bus->count++] = context;
+	return true;
+}
+
+NFC_ITCM NFC_Context *NFC_Bus_Process(NFC_Bus *bus)
+{
+	NFC_Context *context, *polled = NULL;
+	uint8_t i, index, state, busy = false, timed = false, irq = false;
+	uint32_t delay = 0, left;
+
+	for (i = 0; i < bus->count; i++)
+	{
+		index = (bus->next + i) % bus->count;
+		context = bus->readers[index];
+
+		if (context->state != NFC_COMMAND_WAITACK && context->state != NFC_COMMAND_WAITRESPONSE)
+		{
+			continue;
+		}
+
+		state = NFC_ProcessCommand(context);
+
+		if (state == NFC_COMMAND_DONE || state == NFC_COMMAND_ERROR)
+		{
+			// Next pass starts after this reader
+			bus->next = (index + 1) % bus->count;
+			return context;
+		}
+
+		busy = true;
+
+		if (state == NFC_COMMAND_WAITACK || context->timeout != NFC_TIMEOUT_NONE)
+		{
+			timed = true;
+		}
+
+		// Without IRQ line the reader asks its PN532 at the gaps of polling
+		if (context->commInterface->GetIRQ != NULL)
+		{
+			irq = true;
+		}
+		else
+		{
+			left = NFC_GetPollDelayUs(context);
+			if (polled == NULL || left < delay)
+			{
+				polled = context;
+				delay = left;
+			}
+		}
+	}
+
+	// No reader has IRQ line, nothing wakes the core before the first status read
+	if (busy && !irq && polled->commInterface->SleepUs != NULL)
+	{
+		if (delay > 0)
+		{
+			polled->commInterface->SleepUs(delay);
+		}
+	}
+	// Every reader waits its PN532, sleep until an IRQ edge or the tick
+	else if (busy && !timed && bus->Sleep != NULL)
+	{
+		bus->Sleep();
+	}
+	else if (busy && bus->Idle != NULL)
+	{
+		bus->Idle();
+	}
+
+	return NULL;
+}
@@ -0,0 +1,694 @@
+/*
+ * NFC_Mifare.c
+ *
+ *  Created on: Oct 17, 2026
+ *      Author: hanes
+ */
+
+#include "NFC_Mifare.h"
+#include <string.h>
+#include <stdint.h>
+
+#define true	(1)
+#define false	(0)
+
+/// First block of the big sectors of 4K
+#define NFC_MIFARE_BIGBLOCK		(128)
+
+/// Sector from which 4K has big sectors
+#define NFC_MIFARE_BIGSECTOR	(32)
+
+/// Block read waiting to be given to the handler of the sectors read
+typedef struct
+{
+	void (*handler)(const uint8_t block, const uint8_t *data, void *user);
+	void *user;
+	uint8_t block;
+	uint8_t valid;
+	uint8_t data[NFC_MIFARE_BLOCKSIZE];
+}NFC_MifarePending;
+
+static const uint8_t mifareTransportKey[NFC_MIFARE_KEYSIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+static uint8_t NFC_Mifare_KeyIndex(NFC_Mifare *card, const uint8_t sector);
+static void NFC_Mifare_Derive(NFC_Mifare *card, const uint8_t index);
+static uint8_t NFC_Mifare_DeriveNext(NFC_Mifare *card);
+static uint8_t NFC_Mifare_BuildAuth(NFC_Mifare *card, const uint8_t sector, uint8_t *command);
+static uint8_t NFC_Mifare_InSession(NFC_Mifare *card, const uint8_t sector);
+static uint8_t NFC_Mifare_Auth(NFC_Mifare *card, const uint8_t sector, NFC_MifarePending *pending);
+static void NFC_Mifare_Flush(NFC_MifarePending *pending);
+static uint8_t NFC_Mifare_Sector(const uint8_t block);
+static uint8_t NFC_Mifare_IsData(const uint8_t block);
+static uint8_t NFC_Mifare_Operate(NFC_Mifare *card, const uint8_t operation, const uint8_t block, const uint32_t amount, const uint8_t destination);
+static uint8_t NFC_Mifare_Exchange(NFC_Mifare *card, const uint8_t *command, const uint8_t length, NFC_MifarePending *pending, NFC_FrameView *response);
+static uint8_t NFC_Mifare_Run(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t trailers, const uint8_t *write, NFC_MifarePending *pending);
+
+static uint8_t NFC_Mifare_KeyIndex(NFC_Mifare *card, const uint8_t sector)
+{
+	uint8_t i;
+
+	if (card->keys == NULL)
+	{
+		return NFC_MIFARE_KEYSECTORS;
+	}
+
+	for (i = 0; i < card->keys->sectorCount; i++)
+	{
+		if (card->keys->sectors[i] == sector)
+		{
+			return i;
+		}
+	}
+
+	return NFC_MIFARE_KEYSECTORS;
+}
+
+static void NFC_Mifare_Derive(NFC_Mifare *card, const uint8_t index)
+{
+	NFC_MifareKeyCard *keyCard = card->keyCard;
+
+	if (!(keyCard->derived & (1U << index)))
+	{
+		card->keys->diversify(keyCard->uid, keyCard->uidLength, card->keys->sectors[index], keyCard->keys[index], card->keys->user);
+		keyCard->derived |= (1U << index);
+	}
+}
+
+static uint8_t NFC_Mifare_DeriveNext(NFC_Mifare *card)
+{
+	uint8_t i;
+
+	if (card->keys == NULL)
+	{
+		return false;
+	}
+
+	for (i = 0; i < card->keys->sectorCount; i++)
+	{
+		if (!(card->keyCard->derived & (1U << i)))
+		{
+			NFC_Mifare_Derive(card, i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint8_t NFC_Mifare_BuildAuth(NFC_Mifare *card, const uint8_t sector, uint8_t *command)
+{
+	uint8_t index = NFC_Mifare_KeyIndex(card, sector);
+
+	command[1] = NFC_Mifare_FirstBlock(sector);
+
+	if (index < NFC_MIFARE_KEYSECTORS)
+	{
+		// Only the key of this sector is derived before the exchange
+		NFC_Mifare_Derive(card, index);
+		command[0] = card->keys->keyType;
+		memcpy(&command[2], card->keyCard->keys[index], NFC_MIFARE_KEYSIZE);
+	}
+	else
+	{
+		command[0] = card->keyType;
+		memcpy(&command[2], card->key, NFC_MIFARE_KEYSIZE);
+	}
+
+	memcpy(&command[2 + NFC_MIFARE_KEYSIZE], &card->uid[card->uidLength - 4], 4);
+
+	return 2 + NFC_MIFARE_KEYSIZE + 4;
+}
+
+static uint8_t NFC_Mifare_InSession(NFC_Mifare *card, const uint8_t sector)
+{
+	// Any selection after the authentication ended the Crypto1 session of card
+	return (card->sector == sector && card->context->target == card->target &&
+			card->context->selection == card->selection) ? true : false;
+}
+
+static uint8_t NFC_Mifare_Auth(NFC_Mifare *card, const uint8_t sector, NFC_MifarePending *pending)
+{
+	uint8_t command[2 + NFC_MIFARE_KEYSIZE + 4], length;
+	NFC_FrameView response;
+
+	if (sector >= NFC_MIFARE_SECTORS_4K)
+	{
+		return false;
+	}
+
+	if (NFC_Mifare_InSession(card, sector))
+	{
+		return true;
+	}
+
+	length = NFC_Mifare_BuildAuth(card, sector, command);
+
+	if (!NFC_Mifare_Exchange(card, command, length, pending, &response))
+	{
+		return false;
+	}
+
+	card->sector = sector;
+	card->selection = card->context->selection;
+
+	return true;
+}
+
+static void NFC_Mifare_Flush(NFC_MifarePending *pending)
+{
+	if (pending != NULL && pending->valid)
+	{
+		pending->valid = false;
+		pending->handler(pending->block, pending->data, pending->user);
+	}
+}
+
+static uint8_t NFC_Mifare_Sector(const uint8_t block)
+{
+	if (block < NFC_MIFARE_BIGBLOCK)
+	{
+		return block / 4;
+	}
+
+	return NFC_MIFARE_BIGSECTOR + (block - NFC_MIFARE_BIGBLOCK) / 16;
+}
+
+static uint8_t NFC_Mifare_IsData(const uint8_t block)
+{
+	const uint8_t sector = NFC_Mifare_Sector(block);
+
+	return (block != 0 && block != NFC_Mifare_FirstBlock(sector) + NFC_Mifare_BlockCount(sector) - 1) ? true : false;
+}
+
+static uint8_t NFC_Mifare_Operate(NFC_Mifare *card, const uint8_t operation, const uint8_t block, const uint32_t amount, const uint8_t destination)
+{
+	uint8_t command[6];
+	NFC_FrameView response;
+
+	if (NFC_Mifare_Sector(destination) != NFC_Mifare_Sector(block) || !NFC_Mifare_Auth(card, NFC_Mifare_Sector(block), NULL))
+	{
+		return false;
+	}
+
+	// Card loads block in its transfer buffer and applies the operand, restore takes one too
+	command[0] = operation;
+	command[1] = block;
+	command[2] = amount & 0xFF;
+	command[3] = (amount >> 8) & 0xFF;
+	command[4] = (amount >> 16) & 0xFF;
+	command[5] = (amount >> 24) & 0xFF;
+
+	if (!NFC_Mifare_Exchange(card, command, sizeof(command), NULL, &response))
+	{
+		return false;
+	}
+
+	// Nothing is written in the card up to the transfer
+	command[0] = MIFARE_CMD_TRANSFER;
+	command[1] = destination;
+
+	return NFC_Mifare_Exchange(card, command, 2, NULL, &response);
+}
+
+static uint8_t NFC_Mifare_Exchange(NFC_Mifare *card, const uint8_t *command, const uint8_t length, NFC_MifarePending *pending, NFC_FrameView *response)
+{
+	uint8_t state;
+
+	if (!NFC_StartInDataExchange(card->context, card->target, command, length, card->timeout))
+	{
+		return false;
+	}
+
+	// Block read before is parsed while PN532 exchanges this one with the card
+	NFC_Mifare_Flush(pending);
+
+	// Keys are derived one by one while PN532 is busy, the rest in the next exchanges
+	while (NFC_Mifare_DeriveNext(card))
+	{
+		state = NFC_ProcessCommand(card->context);
+
+		if (state != NFC_COMMAND_WAITACK && state != NFC_COMMAND_WAITRESPONSE)
+		{
+			break;
+		}
+	}
+
+	if (NFC_WaitCommand(card->context) != NFC_COMMAND_DONE || !NFC_GetInDataExchange(card->context, response))
+	{
+		// Card halts on any error, authentication is lost
+		card->sector = NFC_MIFARE_NOSECTOR;
+		return false;
+	}
+
+	return true;
+}
+
+static uint8_t NFC_Mifare_Run(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t trailers, const uint8_t *write, NFC_MifarePending *pending)
+{
+	uint8_t command[2 + NFC_MIFARE_BLOCKSIZE], i;
+	uint16_t block, trailer;		// Trailer of the last sector of 4K is block 255
+	NFC_FrameView response;
+
+	for (i = 0; i < count; i++)
+	{
+		// One authentication serves every block of the sector
+		if (!NFC_Mifare_Auth(card, sectors[i], pending))
+		{
+			return false;
+		}
+
+		trailer = NFC_Mifare_FirstBlock(sectors[i]) + NFC_Mifare_BlockCount(sectors[i]) - 1;
+
+		for (block = NFC_Mifare_FirstBlock(sectors[i]); block <= trailer; block++)
+		{
+			// Trailer holds keys and access bits, block 0 is written by the manufacturer
+			if ((block == trailer && (write != NULL || !trailers)) || (block == 0 && write != NULL))
+			{
+				continue;
+			}
+
+			command[1] = block;
+
+			if (write != NULL)
+			{
+				command[0] = MIFARE_CMD_WRITE;
+				memcpy(&command[2], write, NFC_MIFARE_BLOCKSIZE);
+				write += NFC_MIFARE_BLOCKSIZE;
+
+				if (!NFC_Mifare_Exchange(card, command, 2 + NFC_MIFARE_BLOCKSIZE, pending, &response))
+				{
+					return false;
+				}
+				continue;
+			}
+
+			command[0] = MIFARE_CMD_READ;
+
+			if (!NFC_Mifare_Exchange(card, command, 2, pending, &response) || response.length < NFC_MIFARE_BLOCKSIZE)
+			{
+				return false;
+			}
+
+			// Answer leaves the context buffer before the next command is written
+			memcpy(pending->data, response.data, NFC_MIFARE_BLOCKSIZE);
+			pending->block = block;
+			pending->valid = true;
+		}
+	}
+
+	return true;
+}
+
+uint8_t NFC_Mifare_Init(NFC_Mifare *card, NFC_Context *context, const NFC_Target *target)
+{
+	// Bit 3 of SEL_RES tells MIFARE Classic protocol
+	if (!(target->selRes & 0x08) || target->uidLength < 4)
+	{
+		return false;
+	}
+
+	card->context = context;
+	card->target = target->number;
+	memcpy(card->uid, target->uid, target->uidLength);
+	card->uidLength = target->uidLength;
+	card->timeout = NFC_MIFARE_TIMEOUT;
+	card->keys = NULL;
+	card->keyCard = NULL;
+	NFC_Mifare_SetKey(card, MIFARE_CMD_AUTH_A, mifareTransportKey);
+
+	return true;
+}
+
+void NFC_Mifare_SetKey(NFC_Mifare *card, const uint8_t keyType, const uint8_t *key)
+{
+	card->keyType = keyType;
+	memcpy(card->key, key, NFC_MIFARE_KEYSIZE);
+	card->sector = NFC_MIFARE_NOSECTOR;
+}
+
+uint8_t NFC_Mifare_KeysInit(NFC_MifareKeys *keys, const uint8_t keyType, const uint8_t *sectors, const uint8_t count,
+		void (*diversify)(const uint8_t *uid, const uint8_t uidLength, const uint8_t sector, uint8_t *key, void *user), void *user)
+{
+	if (count > NFC_MIFARE_KEYSECTORS)
+	{
+		return false;
+	}
+
+	memset(keys, 0, sizeof(NFC_MifareKeys));
+	keys->diversify = diversify;
+	keys->user = user;
+	keys->keyType = keyType;
+	memcpy(keys->sectors, sectors, count);
+	keys->sectorCount = count;
+
+	return true;
+}
+
+void NFC_Mifare_UseKeys(NFC_Mifare *card, NFC_MifareKeys *keys)
+{
+	NFC_MifareKeyCard *keyCard = &keys->cards[0];
+	uint8_t i;
+
+	keys->used++;
+
+	for (i = 0; i < NFC_MIFARE_KEYCARDS; i++)
+	{
+		if (keys->cards[i].uidLength == card->uidLength && memcmp(keys->cards[i].uid, card->uid, card->uidLength) == 0)
+		{
+			keyCard = &keys->cards[i];
+			break;
+		}
+
+		// Entry not used or used longest ago takes the new card
+		if (keys->cards[i].used < keyCard->used)
+		{
+			keyCard = &keys->cards[i];
+		}
+	}
+
+	if (i == NFC_MIFARE_KEYCARDS)
+	{
+		memcpy(keyCard->uid, card->uid, card->uidLength);
+		keyCard->uidLength = card->uidLength;
+		keyCard->derived = 0;
+	}
+
+	keyCard->used = keys->used;
+	card->keys = keys;
+	card->keyCard = keyCard;
+	card->sector = NFC_MIFARE_NOSECTOR;
+}
+
+uint8_t NFC_Mifare_FirstBlock(const uint8_t sector)
+{
+	if (sector < NFC_MIFARE_BIGSECTOR)
+	{
+		return sector * 4;
+	}
+
+	return NFC_MIFARE_BIGBLOCK + (sector - NFC_MIFARE_BIGSECTOR) * 16;
+}
+
+uint8_t NFC_Mifare_BlockCount(const uint8_t sector)
+{
+	return (sector < NFC_MIFARE_BIGSECTOR) ? 4 : 16;
+}
+
+uint8_t NFC_Mifare_Authenticate(NFC_Mifare *card, const uint8_t sector)
+{
+	return NFC_Mifare_Auth(card, sector, NULL);
+}
+
+uint8_t NFC_Mifare_ReadBlock(NFC_Mifare *card, const uint8_t block, uint8_t *data)
+{
+	uint8_t command[2] = {MIFARE_CMD_READ, block};
+	NFC_FrameView response;
+
+	if (!NFC_Mifare_Exchange(card, command, sizeof(command), NULL, &response) || response.length < NFC_MIFARE_BLOCKSIZE)
+	{
+		return false;
+	}
+
+	memcpy(data, response.data, NFC_MIFARE_BLOCKSIZE);
+
+	return true;
+}
+
+uint8_t NFC_Mifare_WriteBlock(NFC_Mifare *card, const uint8_t block, const uint8_t *data)
+{
+	uint8_t command[2 + NFC_MIFARE_BLOCKSIZE];
+	NFC_FrameView response;
+
+	command[0] = MIFARE_CMD_WRITE;
+	command[1] = block;
+	memcpy(&command[2], data, NFC_MIFARE_BLOCKSIZE);
+
+	return NFC_Mifare_Exchange(card, command, sizeof(command), NULL, &response);
+}
+
+uint8_t NFC_Mifare_ReadSector(NFC_Mifare *card, const uint8_t sector, const uint8_t trailers, uint8_t *data)
+{
+	uint8_t block, count, i;
+
+	if (!NFC_Mifare_Authenticate(card, sector))
+	{
+		return false;
+	}
+
+	// Trailer is the last block of the sector, keys read back as zeros
+	block = NFC_Mifare_FirstBlock(sector);
+	count = NFC_Mifare_BlockCount(sector) - (trailers ? 0 : 1);
+
+	for (i = 0; i < count; i++)
+	{
+		if (!NFC_Mifare_ReadBlock(card, block + i, &data[i * NFC_MIFARE_BLOCKSIZE]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint8_t NFC_Mifare_WriteSector(NFC_Mifare *card, const uint8_t sector, const uint8_t *data)
+{
+	return NFC_Mifare_WriteSectors(card, &sector, 1, data);
+}
+
+uint8_t NFC_Mifare_ReadSectors(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t trailers,
+		void (*handler)(const uint8_t block, const uint8_t *data, void *user), void *user)
+{
+	NFC_MifarePending pending;
+	uint8_t result;
+
+	pending.handler = handler;
+	pending.user = user;
+	pending.valid = false;
+
+	result = NFC_Mifare_Run(card, sectors, count, trailers, NULL, &pending);
+
+	// Last block read has no exchange after it to hide its parsing
+	NFC_Mifare_Flush(&pending);
+
+	return result;
+}
+
+uint8_t NFC_Mifare_WriteSectors(NFC_Mifare *card, const uint8_t *sectors, const uint8_t count, const uint8_t *data)
+{
+	return NFC_Mifare_Run(card, sectors, count, false, data, NULL);
+}
+
+uint8_t NFC_Mifare_Dump(NFC_Mifare *card, const uint8_t sectorCount,
+		void (*handler)(const uint8_t block, const uint8_t *data, void *user), void *user)
+{
+	uint8_t sectors[NFC_MIFARE_SECTORS_4K], i;
+
+	if (sectorCount > NFC_MIFARE_SECTORS_4K)
+	{
+		return false;
+	}
+
+	for (i = 0; i < sectorCount; i++)
+	{
+		sectors[i] = i;
+	}
+
+	return NFC_Mifare_ReadSectors(card, sectors, sectorCount, true, handler, user);
+}
+
+void NFC_Mifare_EncodeValue(const int32_t value, const uint8_t address, uint8_t *data)
+{
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+	{
+		data[i] = ((uint32_t)value >> (8 * i)) & 0xFF;
+		data[4 + i] = ~data[i];
+		data[8 + i] = data[i];
+	}
+
+	data[12] = address;
+	data[13] = ~address;
+	data[14] = address;
+	data[15] = ~address;
+}
+
+uint8_t NFC_Mifare_DecodeValue(const uint8_t *data, int32_t *value, uint8_t *address)
+{
+	uint32_t result = 0;
+	uint8_t i;
+
+	for (i = 0; i < 4; i++)
+	{
+		if (data[i] != data[8 + i] || (data[i] ^ data[4 + i]) != 0xFF)
+		{
+			return false;
+		}
+
+		result |= (uint32_t)data[i] << (8 * i);
+	}
+
+	if (data[12] != data[14] || data[13] != data[15] || (data[12] ^ data[13]) != 0xFF)
+	{
+		return false;
+	}
+
+	if (value != NULL)
+	{
+		*value = (int32_t)result;
+	}
+
+	if (address != NULL)
+	{
+		*address = data[12];
+	}
+
+	return true;
+}
+
+uint8_t NFC_Mifare_FormatValue(NFC_Mifare *card, const uint8_t block, const int32_t value, const uint8_t address)
+{
+	uint8_t data[NFC_MIFARE_BLOCKSIZE];
+
+	if (!NFC_Mifare_IsData(block) || !NFC_Mifare_Auth(card, NFC_Mifare_Sector(block), NULL))
+	{
+		return false;
+	}
+
+	NFC_Mifare_EncodeValue(value, address, data);
+
+	return NFC_Mifare_WriteBlock(card, block, data);
+}
+
+uint8_t NFC_Mifare_ReadValue(NFC_Mifare *card, const uint8_t block, int32_t *value, uint8_t *address)
+{
+	uint8_t data[NFC_MIFARE_BLOCKSIZE];
+
+	if (!NFC_Mifare_Auth(card, NFC_Mifare_Sector(block), NULL) || !NFC_Mifare_ReadBlock(card, block, data))
+	{
+		return false;
+	}
+
+	return NFC_Mifare_DecodeValue(data, value, address);
+}
+
+uint8_t NFC_Mifare_Increment(NFC_Mifare *card, const uint8_t block, const uint32_t amount, const uint8_t destination)
+{
+	return NFC_Mifare_Operate(card, MIFARE_CMD_INCREMENT, block, amount, destination);
+}
+
+uint8_t NFC_Mifare_Decrement(NFC_Mifare *card, const uint8_t block, const uint32_t amount, const uint8_t destination)
+{
+	return NFC_Mifare_Operate(card, MIFARE_CMD_DECREMENT, block, amount, destination);
+}
+
+uint8_t NFC_Mifare_Restore(NFC_Mifare *card, const uint8_t block, const uint8_t destination)
+{
+	return NFC_Mifare_Operate(card, MIFARE_CMD_RESTORE, block, 0, destination);
+}
+
+uint8_t NFC_Mifare_PurseInit(NFC_MifarePurse *purse, const uint8_t block, const uint8_t backup)
+{
+	if (block == backup || NFC_Mifare_Sector(block) != NFC_Mifare_Sector(backup) ||
+		!NFC_Mifare_IsData(block) || !NFC_Mifare_IsData(backup))
+	{
+		return false;
+	}
+
+	purse->blocks[0] = block;
+	purse->blocks[1] = backup;
+	purse->current = 0;
+	purse->value = 0;
+
+	return true;
+}
+
+uint8_t NFC_Mifare_PurseLoad(NFC_MifarePurse *purse, const uint8_t *data, const uint8_t *backup)
+{
+	int32_t values[2];
+	uint8_t valid[2];
+
+	valid[0] = NFC_Mifare_DecodeValue(data, &values[0], NULL);
+	valid[1] = NFC_Mifare_DecodeValue(backup, &values[1], NULL);
+
+	if (!valid[0] && !valid[1])
+	{
+		return false;
+	}
+
+	// Torn block is ignored, else the lowest value is the last debit
+	purse->current = (!valid[0] || (valid[1] && values[1] < values[0])) ? 1 : 0;
+	purse->value = values[purse->current];
+
+	return true;
+}
+
+uint8_t NFC_Mifare_PurseRead(NFC_Mifare *card, NFC_MifarePurse *purse)
+{
+	uint8_t data[2][NFC_MIFARE_BLOCKSIZE];
+
+	if (!NFC_Mifare_Auth(card, NFC_Mifare_Sector(purse->blocks[0]), NULL) ||
+		!NFC_Mifare_ReadBlock(card, purse->blocks[0], data[0]) ||
+		!NFC_Mifare_ReadBlock(card, purse->blocks[1], data[1]))
+	{
+		return false;
+	}
+
+	return NFC_Mifare_PurseLoad(purse, data[0], data[1]);
+}
+
+uint8_t NFC_Mifare_PurseFormat(NFC_Mifare *card, NFC_MifarePurse *purse, const int32_t value)
+{
+	if (!NFC_Mifare_FormatValue(card, purse->blocks[0], value, purse->blocks[0]) ||
+		!NFC_Mifare_FormatValue(card, purse->blocks[1], value, purse->blocks[1]))
+	{
+		return false;
+	}
+
+	purse->current = 0;
+	purse->value = value;
+
+	return true;
+}
+
+uint8_t NFC_Mifare_PurseDebit(NFC_Mifare *card, NFC_MifarePurse *purse, const uint32_t amount)
+{
+	const uint8_t other = purse->current ^ 1;
+
+	if (purse->value < 0 || amount > (uint32_t)purse->value)
+	{
+		return false;
+	}
+
+	// Current block keeps the old balance as backup until the next debit
+	if (!NFC_Mifare_Decrement(card, purse->blocks[purse->current], amount, purse->blocks[other]))
+	{
+		return false;
+	}
+
+	purse->value -= amount;
+	purse->current = other;
+
+	return true;
+}
+
+uint8_t NFC_Mifare_PurseCredit(NFC_Mifare *card, NFC_MifarePurse *purse, const uint32_t amount)
+{
+	const uint8_t other = purse->current ^ 1;
+
+	if (purse->value < 0 || amount > (uint32_t)(INT32_MAX - purse->value))
+	{
+		return false;
+	}
+
+	// Until the restore, the old balance is the lowest and stays current
+	if (!NFC_Mifare_Increment(card, purse->blocks[purse->current], amount, purse->blocks[other]) ||
+		!NFC_Mifare_Restore(card, purse->blocks[other], purse->blocks[purse->current]))
+	{
+		return false;
+	}
+
+	purse->value += amount;
+
+	return true;
+}